@@ -0,0 +1,450 @@
+/* Copyright (C) 1999-2023 Free Software Foundation, Inc.
+   This file is part of the cppp-base library.
+
+   The cppp-base library is free software; you can redistribute it
+   and/or modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either version 3
+   of the License, or (at your option) any later version.
+
+   The cppp-base library is distributed in the hope that it will be
+   useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the cppp-base library; see the file COPYING.
+   If not, see <https://www.gnu.org/licenses/>.  */
+
+/* We do not use '#pragma once' because it may has bugs in some compiler. */
+#ifndef _CPPP_ARENA_HPP
+#define _CPPP_ARENA_HPP
+
+/* C++ Plus monotonic arena allocator */
+
+#include "basedef.hpp"
+#include "hardware.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#if CPPP_CPLUSPLUS >= 201703L && defined(__has_include)
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+#define CPPP_ARENA_HAVE_PMR 1
+#endif
+#endif
+
+namespace cppp
+{
+    /* How an arena sizes the blocks it requests from the system.
+       Each new block is 'growth_factor' times the previous one, capped at
+       'max_block_size'.  Requests larger than the cap get a block of their
+       own size. */
+    struct arena_growth_policy
+    {
+        size_t initial_block_size;
+        size_t max_block_size;
+        size_t growth_factor;
+
+        arena_growth_policy(size_t initial = 4096, size_t max = 1024 * 1024, size_t factor = 2) noexcept
+            : initial_block_size(initial), max_block_size(max), growth_factor(factor)
+        {
+        }
+    };
+
+    /* A bump-pointer allocator.
+       Memory is carved from a chain of blocks and is never freed one by one,
+       'deallocate' is a no-op.  Everything is released at once by 'reset',
+       'rewind' or destruction, destructors of created objects are NOT run.
+       Blocks are kept after 'reset' and 'rewind' and reused by later
+       allocations, so a per-request arena stops touching malloc once warm.
+       An arena is not thread safe. */
+    class arena
+    {
+    private:
+        /* Header placed in front of every block. */
+        struct block
+        {
+            block* next;
+            size_t capacity;
+
+            char* begin() noexcept
+            {
+                return reinterpret_cast<char*>(this + 1);
+            }
+
+            char* end() noexcept
+            {
+                return begin() + capacity;
+            }
+        };
+
+    public:
+        /* A position in the arena, see 'mark' and 'rewind'. */
+        struct checkpoint
+        {
+            block* current;
+            char* ptr;
+            size_t used;
+        };
+
+    private:
+        arena_growth_policy policy;
+        block* head = nullptr;
+        block* current = nullptr;
+        char* ptr = nullptr;
+        char* limit = nullptr;
+        size_t next_block_size;
+        size_t used = 0;
+
+    public:
+        explicit arena(const arena_growth_policy& growth = arena_growth_policy()) noexcept
+            : policy(growth), next_block_size(growth.initial_block_size)
+        {
+        }
+
+        explicit arena(size_t initial_block_size) noexcept : arena(arena_growth_policy(initial_block_size))
+        {
+        }
+
+        arena(const arena&) = delete;
+        arena& operator=(const arena&) = delete;
+
+        arena(arena&& other) noexcept
+            : policy(other.policy), head(other.head), current(other.current), ptr(other.ptr), limit(other.limit),
+              next_block_size(other.next_block_size), used(other.used)
+        {
+            other.head = other.current = nullptr;
+            other.ptr = other.limit = nullptr;
+            other.used = 0;
+        }
+
+        arena& operator=(arena&& other) noexcept
+        {
+            if (this != &other)
+            {
+                release();
+                policy = other.policy;
+                head = other.head;
+                current = other.current;
+                ptr = other.ptr;
+                limit = other.limit;
+                next_block_size = other.next_block_size;
+                used = other.used;
+                other.head = other.current = nullptr;
+                other.ptr = other.limit = nullptr;
+                other.used = 0;
+            }
+            return *this;
+        }
+
+        ~arena()
+        {
+            release();
+        }
+
+        /* Allocate 'size' bytes aligned to 'alignment', which must be a power
+           of two.  Throws 'std::bad_alloc' when the system is out of memory. */
+        CPPP_FORCE_INLINE void* allocate(size_t size, size_t alignment = alignof(std::max_align_t))
+        {
+            char* aligned = align_up(ptr, alignment);
+            size_t space = static_cast<size_t>(limit - ptr);
+            size_t padding = static_cast<size_t>(aligned - ptr);
+            if (CPPP_LIKELY(aligned != nullptr && padding <= space && size <= space - padding))
+            {
+                ptr = aligned + size;
+                used += size;
+                return aligned;
+            }
+            return allocate_slow(size, alignment);
+        }
+
+        /* Arena memory is released in bulk, this exists for interface
+           symmetry with other allocators. */
+        void deallocate(void*, size_t, size_t = alignof(std::max_align_t)) noexcept
+        {
+        }
+
+        /* Construct a 'T' in the arena.  Its destructor will not be called. */
+        template<typename T, typename... Args>
+        T* create(Args&&... args)
+        {
+            void* p = allocate(sizeof(T), alignof(T));
+            return ::new (p) T(std::forward<Args>(args)...);
+        }
+
+        /* Allocate uninitialized storage for 'count' objects of type 'T'. */
+        template<typename T>
+        T* allocate_array(size_t count)
+        {
+            if (CPPP_UNLIKELY(count > static_cast<size_t>(-1) / sizeof(T)))
+            {
+                throw std::bad_alloc();
+            }
+            return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+        }
+
+        /* Remember the current position. */
+        checkpoint mark() const noexcept
+        {
+            return checkpoint{current, ptr, used};
+        }
+
+        /* Release everything allocated since 'point' was taken, in O(1).
+           'point' must come from this arena and must not be older than
+           the last 'reset'. */
+        void rewind(const checkpoint& point) noexcept
+        {
+            if (point.current == nullptr)
+            {
+                reset();
+                return;
+            }
+            current = point.current;
+            ptr = point.ptr;
+            limit = current->end();
+            used = point.used;
+        }
+
+        /* Release all allocations in O(1), keeping the blocks for reuse. */
+        void reset() noexcept
+        {
+            current = head;
+            ptr = head != nullptr ? head->begin() : nullptr;
+            limit = head != nullptr ? head->end() : nullptr;
+            used = 0;
+        }
+
+        /* Release all allocations and return all blocks to the system. */
+        void release() noexcept
+        {
+            block* b = head;
+            while (b != nullptr)
+            {
+                block* next = b->next;
+                std::free(b);
+                b = next;
+            }
+            head = current = nullptr;
+            ptr = limit = nullptr;
+            next_block_size = policy.initial_block_size;
+            used = 0;
+        }
+
+        /* Bytes handed out since the last reset. */
+        size_t bytes_used() const noexcept
+        {
+            return used;
+        }
+
+        /* Bytes held in blocks, including unused tails and cached blocks. */
+        size_t bytes_reserved() const noexcept
+        {
+            size_t total = 0;
+            for (block* b = head; b != nullptr; b = b->next)
+            {
+                total += b->capacity;
+            }
+            return total;
+        }
+
+    private:
+        static char* align_up(char* p, size_t alignment) noexcept
+        {
+            std::uintptr_t value = reinterpret_cast<std::uintptr_t>(p);
+            std::uintptr_t aligned = (value + alignment - 1) & ~static_cast<std::uintptr_t>(alignment - 1);
+            return reinterpret_cast<char*>(aligned);
+        }
+
+        CPPP_NOINLINE void* allocate_slow(size_t size, size_t alignment)
+        {
+            size_t needed = size + alignment - 1;
+            if (CPPP_UNLIKELY(needed < size))
+            {
+                throw std::bad_alloc();
+            }
+
+            /* Reuse a cached block left behind by 'reset' or 'rewind'. */
+            block* first = current != nullptr ? current->next : nullptr;
+            block* candidate = first;
+            while (candidate != nullptr && candidate->capacity < needed)
+            {
+                candidate = candidate->next;
+            }
+            block* b = candidate;
+            if (b == nullptr)
+            {
+                b = new_block(needed);
+            }
+            else if (b != first)
+            {
+                /* Move the fitting block right after 'current',
+                   the skipped ones stay cached further down the chain. */
+                unlink(b);
+                insert_after_current(b);
+            }
+
+            current = b;
+            ptr = b->begin();
+            limit = b->end();
+            char* aligned = align_up(ptr, alignment);
+            ptr = aligned + size;
+            used += size;
+            return aligned;
+        }
+
+        block* new_block(size_t needed)
+        {
+            size_t capacity = next_block_size > needed ? next_block_size : needed;
+            if (CPPP_UNLIKELY(capacity > static_cast<size_t>(-1) - sizeof(block)))
+            {
+                throw std::bad_alloc();
+            }
+            if (next_block_size < policy.max_block_size)
+            {
+                size_t grown = next_block_size * (policy.growth_factor > 1 ? policy.growth_factor : 1);
+                next_block_size = grown < policy.max_block_size ? grown : policy.max_block_size;
+            }
+            void* memory = std::malloc(sizeof(block) + capacity);
+            if (CPPP_UNLIKELY(memory == nullptr))
+            {
+                throw std::bad_alloc();
+            }
+            block* b = static_cast<block*>(memory);
+            b->next = nullptr;
+            b->capacity = capacity;
+            insert_after_current(b);
+            return b;
+        }
+
+        void insert_after_current(block* b) noexcept
+        {
+            if (current == nullptr)
+            {
+                b->next = head;
+                head = b;
+            }
+            else
+            {
+                b->next = current->next;
+                current->next = b;
+            }
+        }
+
+        void unlink(block* b) noexcept
+        {
+            if (head == b)
+            {
+                head = b->next;
+                return;
+            }
+            for (block* p = head; p != nullptr; p = p->next)
+            {
+                if (p->next == b)
+                {
+                    p->next = b->next;
+                    return;
+                }
+            }
+        }
+    };
+
+    /* A standard Allocator backed by an arena,
+       e.g. 'std::vector<int, cppp::arena_allocator<int>> v(cppp::arena_allocator<int>(a))'. */
+    template<typename T>
+    class arena_allocator
+    {
+    private:
+        template<typename U>
+        friend class arena_allocator;
+
+        arena* source;
+
+    public:
+        using value_type = T;
+        using propagate_on_container_copy_assignment = std::true_type;
+        using propagate_on_container_move_assignment = std::true_type;
+        using propagate_on_container_swap = std::true_type;
+
+        template<typename U>
+        struct rebind
+        {
+            using other = arena_allocator<U>;
+        };
+
+        explicit arena_allocator(arena& a) noexcept : source(&a)
+        {
+        }
+
+        template<typename U>
+        arena_allocator(const arena_allocator<U>& other) noexcept : source(other.source)
+        {
+        }
+
+        T* allocate(size_t n)
+        {
+            return source->allocate_array<T>(n);
+        }
+
+        void deallocate(T*, size_t) noexcept
+        {
+        }
+
+        arena& get_arena() const noexcept
+        {
+            return *source;
+        }
+
+        template<typename U>
+        bool operator==(const arena_allocator<U>& other) const noexcept
+        {
+            return source == other.source;
+        }
+
+        template<typename U>
+        bool operator!=(const arena_allocator<U>& other) const noexcept
+        {
+            return source != other.source;
+        }
+    };
+
+#if defined(CPPP_ARENA_HAVE_PMR)
+    /* Expose an arena as a 'std::pmr::memory_resource'. */
+    class arena_resource : public std::pmr::memory_resource
+    {
+    private:
+        arena* source;
+
+    public:
+        explicit arena_resource(arena& a) noexcept : source(&a)
+        {
+        }
+
+        arena& get_arena() const noexcept
+        {
+            return *source;
+        }
+
+    private:
+        void* do_allocate(size_t bytes, size_t alignment) override
+        {
+            return source->allocate(bytes, alignment);
+        }
+
+        void do_deallocate(void*, size_t, size_t) override
+        {
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+        {
+            const arena_resource* that = dynamic_cast<const arena_resource*>(&other);
+            return that != nullptr && that->source == source;
+        }
+    };
+#endif
+} // namespace cppp
+
+#endif
@@ -26,6 +26,132 @@
    we can use some type in it like 'size_t'. */
 #include <cstddef>
 
+/* Compiler detection.
+   Exactly one of CPPP_COMPILER_CLANG, CPPP_COMPILER_GCC, CPPP_COMPILER_MSVC
+   or CPPP_COMPILER_UNKNOWN is defined to 1.  Clang must be tested first
+   because it also defines '__GNUC__'.  Defining CPPP_COMPILER_UNKNOWN before
+   including this file disables detection, every annotation macro below then
+   expands to its portable no-op form. */
+#if !defined(CPPP_COMPILER_UNKNOWN)
+#if defined(__clang__)
+#define CPPP_COMPILER_CLANG 1
+#elif defined(__GNUC__)
+#define CPPP_COMPILER_GCC 1
+#elif defined(_MSC_VER)
+#define CPPP_COMPILER_MSVC 1
+#else
+#define CPPP_COMPILER_UNKNOWN 1
+#endif
+#endif
+
+/* GCC and Clang share the same builtins and attributes. */
+#if defined(CPPP_COMPILER_CLANG) || defined(CPPP_COMPILER_GCC)
+#define CPPP_COMPILER_GNU_LIKE 1
+#endif
+
+/* Architecture detection. */
+#if defined(__x86_64__) || defined(_M_X64) || defined(_M_AMD64)
+#define CPPP_ARCH_X86_64 1
+#elif defined(__i386__) || defined(_M_IX86)
+#define CPPP_ARCH_X86 1
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define CPPP_ARCH_ARM64 1
+#elif defined(__arm__) || defined(_M_ARM)
+#define CPPP_ARCH_ARM 1
+#else
+#define CPPP_ARCH_UNKNOWN 1
+#endif
+
+/* The C++ standard in use.
+   MSVC keeps '__cplusplus' at 199711L unless '/Zc:__cplusplus' is given,
+   so prefer '_MSVC_LANG' there. */
+#if defined(_MSVC_LANG) && _MSVC_LANG > __cplusplus
+#define CPPP_CPLUSPLUS _MSVC_LANG
+#else
+#define CPPP_CPLUSPLUS __cplusplus
+#endif
+
+/* 'constexpr' for functions that need C++14 relaxed constexpr rules
+   (loops, local variables), plain functions before C++14. */
+#if CPPP_CPLUSPLUS >= 201402L
+#define CPPP_CONSTEXPR14 constexpr
+#else
+#define CPPP_CONSTEXPR14 inline
+#endif
+
+#if defined(CPPP_COMPILER_MSVC) && (defined(CPPP_ARCH_X86_64) || defined(CPPP_ARCH_X86))
+#include <intrin.h>
+#endif
+
+/* Branch prediction hints,
+   use them like 'if (CPPP_UNLIKELY(ptr == nullptr))'. */
+#if defined(CPPP_COMPILER_GNU_LIKE)
+#define CPPP_LIKELY(x) (__builtin_expect(!!(x), 1))
+#define CPPP_UNLIKELY(x) (__builtin_expect(!!(x), 0))
+#else
+#define CPPP_LIKELY(x) (x)
+#define CPPP_UNLIKELY(x) (x)
+#endif
+
+/* Inlining control.
+   CPPP_FORCE_INLINE already implies 'inline', do not repeat it. */
+#if defined(CPPP_COMPILER_GNU_LIKE)
+#define CPPP_FORCE_INLINE inline __attribute__((__always_inline__))
+#define CPPP_NOINLINE __attribute__((__noinline__))
+#elif defined(CPPP_COMPILER_MSVC)
+#define CPPP_FORCE_INLINE __forceinline
+#define CPPP_NOINLINE __declspec(noinline)
+#else
+#define CPPP_FORCE_INLINE inline
+#define CPPP_NOINLINE
+#endif
+
+/* Pointer aliasing hint, the pointed-to object is only accessed through
+   this pointer in its scope. */
+#if defined(CPPP_COMPILER_GNU_LIKE)
+#define CPPP_RESTRICT __restrict__
+#elif defined(CPPP_COMPILER_MSVC)
+#define CPPP_RESTRICT __restrict
+#else
+#define CPPP_RESTRICT
+#endif
+
+/* Tell the optimizer that 'cond' is always true.
+   'cond' must not have side effects, it may or may not be evaluated.
+   Behavior is undefined if 'cond' is false at runtime. */
+#if defined(CPPP_COMPILER_CLANG)
+#define CPPP_ASSUME(cond) __builtin_assume(cond)
+#elif defined(CPPP_COMPILER_GCC)
+#define CPPP_ASSUME(cond) ((cond) ? static_cast<void>(0) : __builtin_unreachable())
+#elif defined(CPPP_COMPILER_MSVC)
+#define CPPP_ASSUME(cond) __assume(cond)
+#else
+#define CPPP_ASSUME(cond) static_cast<void>(0)
+#endif
+
+/* Mark a function as frequently or rarely executed,
+   cold functions are optimized for size and moved out of the hot text. */
+#if defined(CPPP_COMPILER_GNU_LIKE)
+#define CPPP_HOT __attribute__((__hot__))
+#define CPPP_COLD __attribute__((__cold__))
+#else
+#define CPPP_HOT
+#define CPPP_COLD
+#endif
+
+/* Prefetch the cache line containing 'addr' for reading or writing,
+   with high temporal locality.  Prefetching never faults. */
+#if defined(CPPP_COMPILER_GNU_LIKE)
+#define CPPP_PREFETCH(addr) __builtin_prefetch((addr), 0, 3)
+#define CPPP_PREFETCH_WRITE(addr) __builtin_prefetch((addr), 1, 3)
+#elif defined(CPPP_COMPILER_MSVC) && (defined(CPPP_ARCH_X86_64) || defined(CPPP_ARCH_X86))
+#define CPPP_PREFETCH(addr) _mm_prefetch(reinterpret_cast<const char*>(addr), _MM_HINT_T0)
+#define CPPP_PREFETCH_WRITE(addr) _mm_prefetch(reinterpret_cast<const char*>(addr), _MM_HINT_T0)
+#else
+#define CPPP_PREFETCH(addr) static_cast<void>(addr)
+#define CPPP_PREFETCH_WRITE(addr) static_cast<void>(addr)
+#endif
+
 /* C++ Plus base namespace,
    This namespace include all things in C++ Plus base library. */
 namespace cppp
@@ -0,0 +1,106 @@
+/* Copyright (C) 1999-2023 Free Software Foundation, Inc.
+   This file is part of the cppp-base library.
+
+   The cppp-base library is free software; you can redistribute it
+   and/or modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either version 3
+   of the License, or (at your option) any later version.
+
+   The cppp-base library is distributed in the hope that it will be
+   useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the cppp-base library; see the file COPYING.
+   If not, see <https://www.gnu.org/licenses/>.  */
+
+/* We do not use '#pragma once' because it may has bugs in some compiler. */
+#ifndef _CPPP_BITS_HPP
+#define _CPPP_BITS_HPP
+
+/* C++ Plus bit manipulation helpers */
+
+#include "basedef.hpp"
+
+#include <cstdint>
+
+#if defined(CPPP_COMPILER_MSVC)
+#include <intrin.h>
+#endif
+
+namespace cppp
+{
+    /* Number of trailing zero bits, 'x' must not be zero. */
+    CPPP_FORCE_INLINE unsigned countr_zero(std::uint64_t x) noexcept
+    {
+#if defined(CPPP_COMPILER_GNU_LIKE)
+        return static_cast<unsigned>(__builtin_ctzll(x));
+#elif defined(CPPP_COMPILER_MSVC) && defined(CPPP_ARCH_X86_64)
+        unsigned long index;
+        _BitScanForward64(&index, x);
+        return static_cast<unsigned>(index);
+#else
+        unsigned n = 0;
+        while ((x & 1) == 0)
+        {
+            x >>= 1;
+            ++n;
+        }
+        return n;
+#endif
+    }
+
+    /* Number of leading zero bits, 'x' must not be zero. */
+    CPPP_FORCE_INLINE unsigned countl_zero(std::uint64_t x) noexcept
+    {
+#if defined(CPPP_COMPILER_GNU_LIKE)
+        return static_cast<unsigned>(__builtin_clzll(x));
+#elif defined(CPPP_COMPILER_MSVC) && defined(CPPP_ARCH_X86_64)
+        unsigned long index;
+        _BitScanReverse64(&index, x);
+        return 63u - static_cast<unsigned>(index);
+#else
+        unsigned n = 0;
+        while ((x & (std::uint64_t(1) << 63)) == 0)
+        {
+            x <<= 1;
+            ++n;
+        }
+        return n;
+#endif
+    }
+
+    /* Number of set bits. */
+    CPPP_FORCE_INLINE unsigned popcount(std::uint64_t x) noexcept
+    {
+#if defined(CPPP_COMPILER_GNU_LIKE)
+        return static_cast<unsigned>(__builtin_popcountll(x));
+#else
+        x = x - ((x >> 1) & 0x5555555555555555ULL);
+        x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+        x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+        return static_cast<unsigned>((x * 0x0101010101010101ULL) >> 56);
+#endif
+    }
+
+    /* Index of the highest set bit, 'x' must not be zero. */
+    CPPP_FORCE_INLINE unsigned log2_floor(std::uint64_t x) noexcept
+    {
+        return 63u - countl_zero(x);
+    }
+
+    /* Whether 'x' is a power of two, zero is not. */
+    constexpr bool is_pow2(std::uint64_t x) noexcept
+    {
+        return x != 0 && (x & (x - 1)) == 0;
+    }
+
+    /* Smallest power of two not less than 'x', 'x' must not exceed 2^63. */
+    CPPP_FORCE_INLINE std::uint64_t ceil_pow2(std::uint64_t x) noexcept
+    {
+        return x <= 1 ? 1 : std::uint64_t(1) << (64u - countl_zero(x - 1));
+    }
+} // namespace cppp
+
+#endif
@@ -0,0 +1,2015 @@
+/* Copyright (C) 1999-2023 Free Software Foundation, Inc.
+   This file is part of the cppp-base library.
+
+   The cppp-base library is free software; you can redistribute it
+   and/or modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either version 3
+   of the License, or (at your option) any later version.
+
+   The cppp-base library is distributed in the hope that it will be
+   useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the cppp-base library; see the file COPYING.
+   If not, see <https://www.gnu.org/licenses/>.  */
+
+/* We do not use '#pragma once' because it may has bugs in some compiler. */
+#ifndef _CPPP_BTREE_HPP
+#define _CPPP_BTREE_HPP
+
+/* C++ Plus B+tree */
+
+#include "basedef.hpp"
+#include "bits.hpp"
+#include "type_traits.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(CPPP_ARCH_X86_64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <immintrin.h>
+#define CPPP_BTREE_X86 1
+#elif defined(CPPP_ARCH_ARM64) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define CPPP_BTREE_NEON 1
+#endif
+
+/* Node search runs once per level on every lookup, too often for a
+   call through a dispatch table: it uses the ISA the program is built
+   for. 64-bit lanes need SSE4.2 or AVX2 on x86. */
+#if defined(CPPP_BTREE_X86) && (defined(__SSE4_2__) || defined(__AVX2__))
+#define CPPP_BTREE_INT64 1
+#elif defined(CPPP_BTREE_NEON)
+#define CPPP_BTREE_INT64 1
+#endif
+
+namespace cppp
+{
+    namespace detail
+    {
+        namespace btree
+        {
+            /* Policy of a set, slots hold the keys themselves. */
+            template<typename Key>
+            struct set_policy
+            {
+                using key_type = Key;
+                using slot_type = Key;
+                using value_type = Key;
+                using reference = const Key&;
+                using const_reference = const Key&;
+
+                static const Key& key(const slot_type& slot) noexcept
+                {
+                    return slot;
+                }
+
+                static const value_type& element(const slot_type& slot) noexcept
+                {
+                    return slot;
+                }
+            };
+
+            /* Policy of a map.  Slots hold 'std::pair<Key, T>' so elements
+               can be moved between nodes, and are exposed as
+               'std::pair<const Key, T>', which has the same layout. */
+            template<typename Key, typename T>
+            struct map_policy
+            {
+                using key_type = Key;
+                using slot_type = std::pair<Key, T>;
+                using value_type = std::pair<const Key, T>;
+                using reference = value_type&;
+                using const_reference = const value_type&;
+
+                static_assert(sizeof(slot_type) == sizeof(value_type) && alignof(slot_type) == alignof(value_type),
+                              "pair<const K, V> must be layout compatible with pair<K, V>");
+
+                static const Key& key(const slot_type& slot) noexcept
+                {
+                    return slot.first;
+                }
+
+                static value_type& element(slot_type& slot) noexcept
+                {
+                    return reinterpret_cast<value_type&>(slot);
+                }
+
+                static const value_type& element(const slot_type& slot) noexcept
+                {
+                    return reinterpret_cast<const value_type&>(slot);
+                }
+            };
+
+            /* Comparators that order arithmetic keys like the built-in '<'. */
+            template<typename Compare, typename Key>
+            struct is_plain_less : std::is_same<Compare, std::less<Key>>
+            {
+            };
+
+#if CPPP_CPLUSPLUS >= 201402L
+            template<typename Key>
+            struct is_plain_less<std::less<void>, Key> : std::true_type
+            {
+            };
+#endif
+
+            /* Vector compares over a node's keys.  'count' gives the number
+               of leading lanes below 'key' (not above it when 'Upper'),
+               keys being sorted these lanes are a prefix. */
+#if defined(CPPP_BTREE_X86)
+#if defined(__AVX2__)
+            template<typename T>
+            struct int32_keys
+            {
+                static constexpr size_t lanes = 8;
+                using vector = __m256i;
+
+                static vector bias() noexcept
+                {
+                    return _mm256_set1_epi32(std::is_signed<T>::value ? 0 : std::numeric_limits<std::int32_t>::min());
+                }
+
+                static vector splat(T key) noexcept
+                {
+                    return _mm256_xor_si256(_mm256_set1_epi32(static_cast<std::int32_t>(key)), bias());
+                }
+
+                template<bool Upper>
+                static unsigned count(const T* keys, vector key) noexcept
+                {
+                    vector v = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys)), bias());
+                    unsigned mask = static_cast<unsigned>(
+                        _mm256_movemask_ps(_mm256_castsi256_ps(Upper ? _mm256_cmpgt_epi32(v, key) : _mm256_cmpgt_epi32(key, v))));
+                    return Upper ? countr_zero(mask | (1u << lanes)) : countr_zero(~mask);
+                }
+            };
+
+            template<typename T>
+            struct int64_keys
+            {
+                static constexpr size_t lanes = 4;
+                using vector = __m256i;
+
+                static vector bias() noexcept
+                {
+                    return _mm256_set1_epi64x(std::is_signed<T>::value ? 0 : std::numeric_limits<std::int64_t>::min());
+                }
+
+                static vector splat(T key) noexcept
+                {
+                    return _mm256_xor_si256(_mm256_set1_epi64x(static_cast<std::int64_t>(key)), bias());
+                }
+
+                template<bool Upper>
+                static unsigned count(const T* keys, vector key) noexcept
+                {
+                    vector v = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys)), bias());
+                    unsigned mask = static_cast<unsigned>(
+                        _mm256_movemask_pd(_mm256_castsi256_pd(Upper ? _mm256_cmpgt_epi64(v, key) : _mm256_cmpgt_epi64(key, v))));
+                    return Upper ? countr_zero(mask | (1u << lanes)) : countr_zero(~mask);
+                }
+            };
+
+            struct float_keys
+            {
+                static constexpr size_t lanes = 8;
+                using vector = __m256;
+
+                static vector splat(float key) noexcept
+                {
+                    return _mm256_set1_ps(key);
+                }
+
+                template<bool Upper>
+                static unsigned count(const float* keys, vector key) noexcept
+                {
+                    vector v = _mm256_loadu_ps(keys);
+                    return countr_zero(~static_cast<unsigned>(_mm256_movemask_ps(
+                        Upper ? _mm256_cmp_ps(v, key, _CMP_LE_OQ) : _mm256_cmp_ps(v, key, _CMP_LT_OQ))));
+                }
+            };
+
+            struct double_keys
+            {
+                static constexpr size_t lanes = 4;
+                using vector = __m256d;
+
+                static vector splat(double key) noexcept
+                {
+                    return _mm256_set1_pd(key);
+                }
+
+                template<bool Upper>
+                static unsigned count(const double* keys, vector key) noexcept
+                {
+                    vector v = _mm256_loadu_pd(keys);
+                    return countr_zero(~static_cast<unsigned>(_mm256_movemask_pd(
+                        Upper ? _mm256_cmp_pd(v, key, _CMP_LE_OQ) : _mm256_cmp_pd(v, key, _CMP_LT_OQ))));
+                }
+            };
+#else
+            template<typename T>
+            struct int32_keys
+            {
+                static constexpr size_t lanes = 4;
+                using vector = __m128i;
+
+                static vector bias() noexcept
+                {
+                    return _mm_set1_epi32(std::is_signed<T>::value ? 0 : std::numeric_limits<std::int32_t>::min());
+                }
+
+                static vector splat(T key) noexcept
+                {
+                    return _mm_xor_si128(_mm_set1_epi32(static_cast<std::int32_t>(key)), bias());
+                }
+
+                template<bool Upper>
+                static unsigned count(const T* keys, vector key) noexcept
+                {
+                    vector v = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(keys)), bias());
+                    unsigned mask = static_cast<unsigned>(
+                        _mm_movemask_ps(_mm_castsi128_ps(Upper ? _mm_cmpgt_epi32(v, key) : _mm_cmplt_epi32(v, key))));
+                    return Upper ? countr_zero(mask | (1u << lanes)) : countr_zero(~mask);
+                }
+            };
+
+#if defined(CPPP_BTREE_INT64)
+            template<typename T>
+            struct int64_keys
+            {
+                static constexpr size_t lanes = 2;
+                using vector = __m128i;
+
+                static vector bias() noexcept
+                {
+                    return _mm_set1_epi64x(std::is_signed<T>::value ? 0 : std::numeric_limits<std::int64_t>::min());
+                }
+
+                static vector splat(T key) noexcept
+                {
+                    return _mm_xor_si128(_mm_set1_epi64x(static_cast<std::int64_t>(key)), bias());
+                }
+
+                template<bool Upper>
+                static unsigned count(const T* keys, vector key) noexcept
+                {
+                    vector v = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(keys)), bias());
+                    unsigned mask = static_cast<unsigned>(
+                        _mm_movemask_pd(_mm_castsi128_pd(Upper ? _mm_cmpgt_epi64(v, key) : _mm_cmpgt_epi64(key, v))));
+                    return Upper ? countr_zero(mask | (1u << lanes)) : countr_zero(~mask);
+                }
+            };
+#endif
+
+            struct float_keys
+            {
+                static constexpr size_t lanes = 4;
+                using vector = __m128;
+
+                static vector splat(float key) noexcept
+                {
+                    return _mm_set1_ps(key);
+                }
+
+                template<bool Upper>
+                static unsigned count(const float* keys, vector key) noexcept
+                {
+                    vector v = _mm_loadu_ps(keys);
+                    return countr_zero(~static_cast<unsigned>(_mm_movemask_ps(Upper ? _mm_cmple_ps(v, key) : _mm_cmplt_ps(v, key))));
+                }
+            };
+
+            struct double_keys
+            {
+                static constexpr size_t lanes = 2;
+                using vector = __m128d;
+
+                static vector splat(double key) noexcept
+                {
+                    return _mm_set1_pd(key);
+                }
+
+                template<bool Upper>
+                static unsigned count(const double* keys, vector key) noexcept
+                {
+                    vector v = _mm_loadu_pd(keys);
+                    return countr_zero(~static_cast<unsigned>(_mm_movemask_pd(Upper ? _mm_cmple_pd(v, key) : _mm_cmplt_pd(v, key))));
+                }
+            };
+#endif
+#elif defined(CPPP_BTREE_NEON)
+            /* Lanes of a compare are all ones or all zeros, the top bits
+               summed give the count. */
+            template<typename T>
+            struct int32_keys
+            {
+                static constexpr size_t lanes = 4;
+                using vector = typename std::conditional<std::is_signed<T>::value, int32x4_t, uint32x4_t>::type;
+
+                static int32x4_t splat_as(std::int32_t key, std::true_type) noexcept
+                {
+                    return vdupq_n_s32(key);
+                }
+
+                static uint32x4_t splat_as(std::uint32_t key, std::false_type) noexcept
+                {
+                    return vdupq_n_u32(key);
+                }
+
+                static vector splat(T key) noexcept
+                {
+                    return splat_as(key, std::is_signed<T>());
+                }
+
+                template<bool Upper>
+                static unsigned count(const T* keys, int32x4_t key) noexcept
+                {
+                    int32x4_t v = vld1q_s32(reinterpret_cast<const std::int32_t*>(keys));
+                    return vaddvq_u32(vshrq_n_u32(Upper ? vcleq_s32(v, key) : vcltq_s32(v, key), 31));
+                }
+
+                template<bool Upper>
+                static unsigned count(const T* keys, uint32x4_t key) noexcept
+                {
+                    uint32x4_t v = vld1q_u32(reinterpret_cast<const std::uint32_t*>(keys));
+                    return vaddvq_u32(vshrq_n_u32(Upper ? vcleq_u32(v, key) : vcltq_u32(v, key), 31));
+                }
+            };
+
+            template<typename T>
+            struct int64_keys
+            {
+                static constexpr size_t lanes = 2;
+                using vector = typename std::conditional<std::is_signed<T>::value, int64x2_t, uint64x2_t>::type;
+
+                static int64x2_t splat_as(std::int64_t key, std::true_type) noexcept
+                {
+                    return vdupq_n_s64(key);
+                }
+
+                static uint64x2_t splat_as(std::uint64_t key, std::false_type) noexcept
+                {
+                    return vdupq_n_u64(key);
+                }
+
+                static vector splat(T key) noexcept
+                {
+                    return splat_as(key, std::is_signed<T>());
+                }
+
+                template<bool Upper>
+                static unsigned count(const T* keys, int64x2_t key) noexcept
+                {
+                    int64x2_t v = vld1q_s64(reinterpret_cast<const std::int64_t*>(keys));
+                    return static_cast<unsigned>(vaddvq_u64(vshrq_n_u64(Upper ? vcleq_s64(v, key) : vcltq_s64(v, key), 63)));
+                }
+
+                template<bool Upper>
+                static unsigned count(const T* keys, uint64x2_t key) noexcept
+                {
+                    uint64x2_t v = vld1q_u64(reinterpret_cast<const std::uint64_t*>(keys));
+                    return static_cast<unsigned>(vaddvq_u64(vshrq_n_u64(Upper ? vcleq_u64(v, key) : vcltq_u64(v, key), 63)));
+                }
+            };
+
+            struct float_keys
+            {
+                static constexpr size_t lanes = 4;
+                using vector = float32x4_t;
+
+                static vector splat(float key) noexcept
+                {
+                    return vdupq_n_f32(key);
+                }
+
+                template<bool Upper>
+                static unsigned count(const float* keys, vector key) noexcept
+                {
+                    vector v = vld1q_f32(keys);
+                    return vaddvq_u32(vshrq_n_u32(Upper ? vcleq_f32(v, key) : vcltq_f32(v, key), 31));
+                }
+            };
+
+            struct double_keys
+            {
+                static constexpr size_t lanes = 2;
+                using vector = float64x2_t;
+
+                static vector splat(double key) noexcept
+                {
+                    return vdupq_n_f64(key);
+                }
+
+                template<bool Upper>
+                static unsigned count(const double* keys, vector key) noexcept
+                {
+                    vector v = vld1q_f64(keys);
+                    return static_cast<unsigned>(vaddvq_u64(vshrq_n_u64(Upper ? vcleq_f64(v, key) : vcltq_f64(v, key), 63)));
+                }
+            };
+#endif
+
+            /* The vector search for keys of type 'T', 'void' when there is
+               none. */
+            template<typename T>
+            struct vector_keys
+            {
+                static constexpr bool integer = std::is_integral<T>::value && !std::is_same<T, bool>::value;
+
+#if defined(CPPP_BTREE_X86) || defined(CPPP_BTREE_NEON)
+                using type = typename std::conditional<
+                    std::is_same<T, float>::value, float_keys,
+                    typename std::conditional<
+                        std::is_same<T, double>::value, double_keys,
+                        typename std::conditional<integer && sizeof(T) == 4, int32_keys<T>,
+#if defined(CPPP_BTREE_INT64)
+                                                  typename std::conditional<integer && sizeof(T) == 8, int64_keys<T>, void>::type
+#else
+                                                  void
+#endif
+                                                  >::type>::type>::type;
+#else
+                using type = void;
+#endif
+            };
+
+            /* Number of elements of sorted 'first[0, n)' whose key is below
+               'key' (not above it when 'Upper'), the lower or upper bound.
+               A search without branches on the outcome of compares. */
+            template<bool Upper, typename Slot, typename Project, typename K, typename Compare>
+            CPPP_FORCE_INLINE size_t rank_binary(const Slot* first, size_t n, const K& key, const Compare& comp,
+                                                 Project project)
+            {
+                if (n == 0)
+                {
+                    return 0;
+                }
+                const Slot* base = first;
+                while (n > 1)
+                {
+                    size_t half = n / 2;
+                    bool below = Upper ? !comp(key, project(base[half])) : static_cast<bool>(comp(project(base[half]), key));
+                    base = below ? base + half : base;
+                    n -= half;
+                }
+                bool below = Upper ? !comp(key, project(*base)) : static_cast<bool>(comp(project(*base), key));
+                return static_cast<size_t>(base - first) + (below ? 1 : 0);
+            }
+
+            struct identity
+            {
+                template<typename T>
+                const T& operator()(const T& value) const noexcept
+                {
+                    return value;
+                }
+            };
+
+            /* Linear scan a vector at a time, it stops at the first vector
+               with a key on the other side. */
+            template<bool Upper, typename V, typename T, typename Compare>
+            CPPP_FORCE_INLINE size_t rank_keys(const T* keys, size_t n, const T& key, const Compare&, std::true_type) noexcept
+            {
+                typename V::vector k = V::splat(key);
+                size_t i = 0;
+                for (; i + V::lanes <= n; i += V::lanes)
+                {
+                    unsigned below = V::template count<Upper>(keys + i, k);
+                    if (below != V::lanes)
+                    {
+                        return i + below;
+                    }
+                }
+                while (i < n && (Upper ? !(key < keys[i]) : keys[i] < key))
+                {
+                    ++i;
+                }
+                return i;
+            }
+
+            template<bool Upper, typename V, typename T, typename K, typename Compare>
+            CPPP_FORCE_INLINE size_t rank_keys(const T* keys, size_t n, const K& key, const Compare& comp, std::false_type)
+            {
+                return rank_binary<Upper>(keys, n, key, comp, identity());
+            }
+
+            /* Lower or upper bound of 'key' in sorted 'keys[0, n)'. */
+            template<bool Upper, typename T, typename K, typename Compare>
+            CPPP_FORCE_INLINE size_t rank(const T* keys, size_t n, const K& key, const Compare& comp)
+            {
+                using vector = typename std::conditional<std::is_same<T, K>::value && is_plain_less<Compare, T>::value,
+                                                         typename vector_keys<T>::type, void>::type;
+                return rank_keys<Upper, vector>(keys, n, key, comp, std::integral_constant<bool, !std::is_void<vector>::value>());
+            }
+
+            /* The tree behind 'btree_map' and 'btree_set'.
+
+               Elements live in leaves of about 512 bytes, chained in order
+               so scans walk arrays.  Internal nodes hold copies of keys
+               as separators: the keys under child 'i' are at least
+               'keys[i - 1]' and below 'keys[i]'. */
+            template<typename Policy, typename Compare, typename Allocator>
+            class raw_btree
+            {
+            public:
+                using key_type = typename Policy::key_type;
+                using value_type = typename Policy::value_type;
+                using size_type = size_t;
+                using difference_type = std::ptrdiff_t;
+                using key_compare = Compare;
+                using allocator_type = Allocator;
+                using reference = typename Policy::reference;
+                using const_reference = typename Policy::const_reference;
+
+            private:
+                using slot_type = typename Policy::slot_type;
+                using slot_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<slot_type>;
+                using slot_traits = std::allocator_traits<slot_allocator>;
+                using key_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<key_type>;
+                using key_traits = std::allocator_traits<key_allocator>;
+
+                static_assert(std::is_nothrow_move_constructible<slot_type>::value &&
+                                  std::is_nothrow_move_constructible<key_type>::value &&
+                                  std::is_nothrow_move_assignable<key_type>::value,
+                              "elements move between nodes, their moves must not throw");
+
+                static constexpr bool transparent = is_transparent_helper<Compare>::value;
+
+                /* Relocating elements with 'memcpy' when they allow it. */
+                static constexpr bool relocatable_slots = is_trivially_relocatable<slot_type>::value;
+                static constexpr bool relocatable_keys = is_trivially_relocatable<key_type>::value;
+
+                static constexpr size_t node_size = 512;
+                static constexpr size_t leaf_header = 4 * sizeof(void*);
+                static constexpr size_t internal_header = 2 * sizeof(void*);
+
+            public:
+                /* Elements per leaf and children per internal node. */
+                static constexpr size_t leaf_capacity =
+                    (node_size - leaf_header) / sizeof(slot_type) > 4 ? (node_size - leaf_header) / sizeof(slot_type) : 4;
+                static constexpr size_t internal_capacity =
+                    (node_size - internal_header) / (sizeof(key_type) + sizeof(void*)) > 4
+                        ? (node_size - internal_header) / (sizeof(key_type) + sizeof(void*))
+                        : 4;
+
+            private:
+                static_assert(leaf_capacity <= 0xffff && internal_capacity <= 0xffff, "node counts are 16-bit");
+
+                /* Leaves merge with a neighbour below half full when both
+                   fit in one, internal nodes also borrow from it. */
+                static constexpr size_t min_leaf = leaf_capacity / 2;
+                static constexpr size_t min_internal = internal_capacity / 2;
+
+                struct internal_node;
+
+                struct node_base
+                {
+                    internal_node* parent;
+                    std::uint16_t position; /* index in the parent */
+                    std::uint16_t count;    /* elements or children */
+                    bool leaf;
+                };
+
+                struct leaf_node : node_base
+                {
+                    leaf_node* prev;
+                    leaf_node* next;
+                    alignas(slot_type) unsigned char storage[leaf_capacity * sizeof(slot_type)];
+
+                    slot_type* slots() noexcept
+                    {
+                        return reinterpret_cast<slot_type*>(storage);
+                    }
+                };
+
+                struct internal_node : node_base
+                {
+                    node_base* children[internal_capacity];
+                    alignas(key_type) unsigned char storage[(internal_capacity - 1) * sizeof(key_type)];
+
+                    key_type* keys() noexcept
+                    {
+                        return reinterpret_cast<key_type*>(storage);
+                    }
+                };
+
+                using leaf_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<leaf_node>;
+                using leaf_traits = std::allocator_traits<leaf_allocator>;
+                using internal_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<internal_node>;
+                using internal_traits = std::allocator_traits<internal_allocator>;
+
+            protected:
+                /* Lookup key type, any type with a transparent comparator. */
+                template<typename K>
+                using key_arg = typename key_arg_helper<transparent>::template type<K, key_type>;
+
+            public:
+                template<bool Const>
+                class basic_iterator
+                {
+                private:
+                    friend class raw_btree;
+
+                    leaf_node* leaf = nullptr;
+                    size_t index = 0;
+
+                    basic_iterator(leaf_node* l, size_t i) noexcept : leaf(l), index(i)
+                    {
+                    }
+
+                public:
+                    using iterator_category = std::bidirectional_iterator_tag;
+                    using value_type = typename raw_btree::value_type;
+                    using difference_type = std::ptrdiff_t;
+                    using reference = typename std::conditional<Const, const_reference, typename raw_btree::reference>::type;
+                    using pointer = typename std::remove_reference<reference>::type*;
+
+                    basic_iterator() noexcept = default;
+
+                    template<bool C = Const, typename = typename std::enable_if<C>::type>
+                    basic_iterator(const basic_iterator<false>& other) noexcept : leaf(other.leaf), index(other.index)
+                    {
+                    }
+
+                    reference operator*() const noexcept
+                    {
+                        return Policy::element(leaf->slots()[index]);
+                    }
+
+                    pointer operator->() const noexcept
+                    {
+                        return &Policy::element(leaf->slots()[index]);
+                    }
+
+                    /* The end of the last leaf is the end of the tree. */
+                    basic_iterator& operator++() noexcept
+                    {
+                        if (++index == leaf->count && leaf->next != nullptr)
+                        {
+                            leaf = leaf->next;
+                            index = 0;
+                        }
+                        return *this;
+                    }
+
+                    basic_iterator operator++(int) noexcept
+                    {
+                        basic_iterator old = *this;
+                        ++*this;
+                        return old;
+                    }
+
+                    basic_iterator& operator--() noexcept
+                    {
+                        if (index == 0)
+                        {
+                            leaf = leaf->prev;
+                            index = leaf->count;
+                        }
+                        --index;
+                        return *this;
+                    }
+
+                    basic_iterator operator--(int) noexcept
+                    {
+                        basic_iterator old = *this;
+                        --*this;
+                        return old;
+                    }
+
+                    friend bool operator==(const basic_iterator& a, const basic_iterator& b) noexcept
+                    {
+                        return a.leaf == b.leaf && a.index == b.index;
+                    }
+
+                    friend bool operator!=(const basic_iterator& a, const basic_iterator& b) noexcept
+                    {
+                        return !(a == b);
+                    }
+
+                    template<bool>
+                    friend class basic_iterator;
+                };
+
+                using iterator = basic_iterator<std::is_same<reference, const_reference>::value>;
+                using const_iterator = basic_iterator<true>;
+                using reverse_iterator = std::reverse_iterator<iterator>;
+                using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+            private:
+                node_base* root = nullptr;
+                leaf_node* first_leaf = nullptr;
+                leaf_node* last_leaf = nullptr;
+                size_t element_count = 0;
+                struct functors : Compare, slot_allocator
+                {
+                    functors(const Compare& c, const slot_allocator& a) : Compare(c), slot_allocator(a)
+                    {
+                    }
+                } fn;
+
+            public:
+                raw_btree() : raw_btree(Compare())
+                {
+                }
+
+                explicit raw_btree(const Compare& comp, const Allocator& alloc = Allocator()) : fn(comp, slot_allocator(alloc))
+                {
+                }
+
+                explicit raw_btree(const Allocator& alloc) : raw_btree(Compare(), alloc)
+                {
+                }
+
+                template<typename InputIt>
+                raw_btree(InputIt from, InputIt to, const Compare& comp = Compare(), const Allocator& alloc = Allocator())
+                    : raw_btree(comp, alloc)
+                {
+                    insert(from, to);
+                }
+
+                /* Linear time construction from sorted unique input. */
+                template<typename InputIt>
+                raw_btree(sorted_unique_t, InputIt from, InputIt to, const Compare& comp = Compare(),
+                          const Allocator& alloc = Allocator())
+                    : raw_btree(comp, alloc)
+                {
+                    build_sorted(from, to);
+                }
+
+                raw_btree(std::initializer_list<value_type> list, const Compare& comp = Compare(),
+                          const Allocator& alloc = Allocator())
+                    : raw_btree(list.begin(), list.end(), comp, alloc)
+                {
+                }
+
+                raw_btree(const raw_btree& other)
+                    : raw_btree(other.key_comp(), slot_traits::select_on_container_copy_construction(other.slot_alloc()))
+                {
+                    build_sorted(other.begin(), other.end());
+                }
+
+                raw_btree(raw_btree&& other) noexcept
+                    : root(other.root), first_leaf(other.first_leaf), last_leaf(other.last_leaf),
+                      element_count(other.element_count), fn(std::move(other.fn))
+                {
+                    other.reset_empty();
+                }
+
+                ~raw_btree()
+                {
+                    destroy_tree();
+                }
+
+                raw_btree& operator=(const raw_btree& other)
+                {
+                    if (this != &other)
+                    {
+                        raw_btree copy(other.key_comp(), slot_traits::propagate_on_container_copy_assignment::value
+                                                             ? other.slot_alloc()
+                                                             : slot_alloc());
+                        copy.build_sorted(other.begin(), other.end());
+                        clear();
+                        static_cast<Compare&>(fn) = static_cast<const Compare&>(other.fn);
+                        copy_allocator(other, typename slot_traits::propagate_on_container_copy_assignment());
+                        take(copy);
+                    }
+                    return *this;
+                }
+
+                raw_btree& operator=(raw_btree&& other) noexcept(
+                    slot_traits::propagate_on_container_move_assignment::value || std::is_empty<slot_allocator>::value)
+                {
+                    if (this != &other)
+                    {
+                        clear();
+                        static_cast<Compare&>(fn) = std::move(static_cast<Compare&>(other.fn));
+                        if (slot_traits::propagate_on_container_move_assignment::value || slot_alloc() == other.slot_alloc())
+                        {
+                            move_allocator(other, typename slot_traits::propagate_on_container_move_assignment());
+                            take(other);
+                        }
+                        else
+                        {
+                            /* Nodes cannot change allocator, move the
+                               elements into new ones. */
+                            build_sorted(slot_mover{other.begin()}, slot_mover{other.end()});
+                            other.clear();
+                        }
+                    }
+                    return *this;
+                }
+
+                raw_btree& operator=(std::initializer_list<value_type> list)
+                {
+                    raw_btree copy(list, key_comp(), get_allocator());
+                    swap(copy);
+                    return *this;
+                }
+
+                /* Iterators */
+
+                iterator begin() noexcept
+                {
+                    return iterator(first_leaf, 0);
+                }
+
+                const_iterator begin() const noexcept
+                {
+                    return const_iterator(first_leaf, 0);
+                }
+
+                const_iterator cbegin() const noexcept
+                {
+                    return begin();
+                }
+
+                iterator end() noexcept
+                {
+                    return iterator(last_leaf, last_leaf != nullptr ? last_leaf->count : 0);
+                }
+
+                const_iterator end() const noexcept
+                {
+                    return const_iterator(last_leaf, last_leaf != nullptr ? last_leaf->count : 0);
+                }
+
+                const_iterator cend() const noexcept
+                {
+                    return end();
+                }
+
+                reverse_iterator rbegin() noexcept
+                {
+                    return reverse_iterator(end());
+                }
+
+                const_reverse_iterator rbegin() const noexcept
+                {
+                    return const_reverse_iterator(end());
+                }
+
+                reverse_iterator rend() noexcept
+                {
+                    return reverse_iterator(begin());
+                }
+
+                const_reverse_iterator rend() const noexcept
+                {
+                    return const_reverse_iterator(begin());
+                }
+
+                /* Call 'f(const value_type* data, size_t n)' for each run of
+                   elements of '[from, to)' stored together in a leaf, in
+                   order. */
+                template<typename F>
+                void for_each_segment(const_iterator from, const_iterator to, F f) const
+                {
+                    while (from != to)
+                    {
+                        leaf_node* leaf = from.leaf;
+                        size_t last = leaf == to.leaf ? to.index : leaf->count;
+                        f(&Policy::element(leaf->slots()[from.index]), last - from.index);
+                        if (leaf == to.leaf)
+                        {
+                            break;
+                        }
+                        from = const_iterator(leaf->next, 0);
+                    }
+                }
+
+                /* Capacity */
+
+                bool empty() const noexcept
+                {
+                    return element_count == 0;
+                }
+
+                size_type size() const noexcept
+                {
+                    return element_count;
+                }
+
+                size_type max_size() const noexcept
+                {
+                    return (std::numeric_limits<size_t>::max)() / sizeof(slot_type) / 2;
+                }
+
+                /* Modifiers */
+
+                void clear() noexcept
+                {
+                    destroy_tree();
+                    reset_empty();
+                }
+
+                std::pair<iterator, bool> insert(const value_type& value)
+                {
+                    return emplace_key(Policy::key(as_slot(value)), value);
+                }
+
+                std::pair<iterator, bool> insert(value_type&& value)
+                {
+                    return emplace_key(Policy::key(as_slot(value)), std::move(value));
+                }
+
+                iterator insert(const_iterator hint, const value_type& value)
+                {
+                    return emplace_key_hint(hint, Policy::key(as_slot(value)), value);
+                }
+
+                iterator insert(const_iterator hint, value_type&& value)
+                {
+                    return emplace_key_hint(hint, Policy::key(as_slot(value)), std::move(value));
+                }
+
+                /* Each element is tried at the end first, sorted input
+                   appends without searching. */
+                template<typename InputIt>
+                void insert(InputIt from, InputIt to)
+                {
+                    for (; from != to; ++from)
+                    {
+                        emplace_hint(cend(), *from);
+                    }
+                }
+
+                /* Linear time into an empty tree. */
+                template<typename InputIt>
+                void insert(sorted_unique_t, InputIt from, InputIt to)
+                {
+                    if (empty())
+                    {
+                        build_sorted(from, to);
+                    }
+                    else
+                    {
+                        insert(from, to);
+                    }
+                }
+
+                void insert(std::initializer_list<value_type> list)
+                {
+                    insert(list.begin(), list.end());
+                }
+
+                /* Construct the value first to learn its key. */
+                template<typename... Args>
+                std::pair<iterator, bool> emplace(Args&&... args)
+                {
+                    slot_type temp(std::forward<Args>(args)...);
+                    return emplace_key(Policy::key(temp), std::move(temp));
+                }
+
+                template<typename... Args>
+                iterator emplace_hint(const_iterator hint, Args&&... args)
+                {
+                    slot_type temp(std::forward<Args>(args)...);
+                    return emplace_key_hint(hint, Policy::key(temp), std::move(temp));
+                }
+
+                iterator erase(const_iterator pos) noexcept
+                {
+                    return erase_at(pos.leaf, pos.index);
+                }
+
+                template<typename It = iterator,
+                         typename = typename std::enable_if<!std::is_same<It, const_iterator>::value>::type>
+                iterator erase(iterator pos) noexcept
+                {
+                    return erase(const_iterator(pos));
+                }
+
+                iterator erase(const_iterator from, const_iterator to) noexcept
+                {
+                    /* Erasing moves elements, count them first. */
+                    size_t n = static_cast<size_t>(std::distance(from, to));
+                    iterator it(from.leaf, from.index);
+                    for (; n != 0; --n)
+                    {
+                        it = erase_at(it.leaf, it.index);
+                    }
+                    return it;
+                }
+
+                template<typename K = key_type>
+                size_type erase(const key_arg<K>& key)
+                {
+                    const_iterator it = find(key);
+                    if (it == end())
+                    {
+                        return 0;
+                    }
+                    erase(it);
+                    return 1;
+                }
+
+                void swap(raw_btree& other) noexcept(slot_traits::propagate_on_container_swap::value ||
+                                                     std::is_empty<slot_allocator>::value)
+                {
+                    using std::swap;
+                    if (this == &other)
+                    {
+                        return;
+                    }
+                    if (slot_traits::propagate_on_container_swap::value || slot_alloc() == other.slot_alloc())
+                    {
+                        swap(root, other.root);
+                        swap(first_leaf, other.first_leaf);
+                        swap(last_leaf, other.last_leaf);
+                        swap(element_count, other.element_count);
+                        swap_allocator(other, typename slot_traits::propagate_on_container_swap());
+                    }
+                    else
+                    {
+                        /* Each tree keeps its allocator, rebuild both sides
+                           with the other's elements. */
+                        raw_btree mine(key_comp(), other.slot_alloc());
+                        mine.build_sorted(slot_mover{begin()}, slot_mover{end()});
+                        raw_btree theirs(other.key_comp(), slot_alloc());
+                        theirs.build_sorted(slot_mover{other.begin()}, slot_mover{other.end()});
+                        clear();
+                        take(theirs);
+                        other.clear();
+                        other.take(mine);
+                    }
+                    swap(static_cast<Compare&>(fn), static_cast<Compare&>(other.fn));
+                }
+
+                /* Lookup */
+
+                template<typename K = key_type>
+                iterator find(const key_arg<K>& key)
+                {
+                    iterator it = lower_bound(key);
+                    return it != end() && !compare(key, Policy::key(it.leaf->slots()[it.index])) ? it : end();
+                }
+
+                template<typename K = key_type>
+                const_iterator find(const key_arg<K>& key) const
+                {
+                    return const_cast<raw_btree*>(this)->find(key);
+                }
+
+                template<typename K = key_type>
+                bool contains(const key_arg<K>& key) const
+                {
+                    return find(key) != end();
+                }
+
+                template<typename K = key_type>
+                size_type count(const key_arg<K>& key) const
+                {
+                    return contains(key) ? 1 : 0;
+                }
+
+                template<typename K = key_type>
+                iterator lower_bound(const key_arg<K>& key)
+                {
+                    return search<false>(key);
+                }
+
+                template<typename K = key_type>
+                const_iterator lower_bound(const key_arg<K>& key) const
+                {
+                    return const_cast<raw_btree*>(this)->template search<false>(key);
+                }
+
+                template<typename K = key_type>
+                iterator upper_bound(const key_arg<K>& key)
+                {
+                    return search<true>(key);
+                }
+
+                template<typename K = key_type>
+                const_iterator upper_bound(const key_arg<K>& key) const
+                {
+                    return const_cast<raw_btree*>(this)->template search<true>(key);
+                }
+
+                template<typename K = key_type>
+                std::pair<iterator, iterator> equal_range(const key_arg<K>& key)
+                {
+                    iterator it = find(key);
+                    if (it == end())
+                    {
+                        it = lower_bound(key);
+                        return std::make_pair(it, it);
+                    }
+                    iterator next = it;
+                    return std::make_pair(it, ++next);
+                }
+
+                template<typename K = key_type>
+                std::pair<const_iterator, const_iterator> equal_range(const key_arg<K>& key) const
+                {
+                    return const_cast<raw_btree*>(this)->equal_range(key);
+                }
+
+                /* Observers */
+
+                key_compare key_comp() const
+                {
+                    return static_cast<const Compare&>(fn);
+                }
+
+                allocator_type get_allocator() const
+                {
+                    return allocator_type(slot_alloc());
+                }
+
+                friend bool operator==(const raw_btree& a, const raw_btree& b)
+                {
+                    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin());
+                }
+
+                friend bool operator!=(const raw_btree& a, const raw_btree& b)
+                {
+                    return !(a == b);
+                }
+
+                friend bool operator<(const raw_btree& a, const raw_btree& b)
+                {
+                    return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end());
+                }
+
+                friend bool operator>(const raw_btree& a, const raw_btree& b)
+                {
+                    return b < a;
+                }
+
+                friend bool operator<=(const raw_btree& a, const raw_btree& b)
+                {
+                    return !(b < a);
+                }
+
+                friend bool operator>=(const raw_btree& a, const raw_btree& b)
+                {
+                    return !(a < b);
+                }
+
+            protected:
+                /* Insert a slot built from 'args' unless 'key' is present,
+                   'args' are untouched then. */
+                template<typename K, typename... Args>
+                std::pair<iterator, bool> emplace_key(const K& key, Args&&... args)
+                {
+                    if (root == nullptr)
+                    {
+                        return std::make_pair(insert_first(std::forward<Args>(args)...), true);
+                    }
+                    iterator it = descend<false>(key);
+                    if (it.index < it.leaf->count && !compare(key, Policy::key(it.leaf->slots()[it.index])))
+                    {
+                        return std::make_pair(it, false);
+                    }
+                    return std::make_pair(insert_at(it.leaf, it.index, std::forward<Args>(args)...), true);
+                }
+
+                slot_type& slot_of(iterator it) noexcept
+                {
+                    return it.leaf->slots()[it.index];
+                }
+
+            private:
+                slot_allocator& slot_alloc() noexcept
+                {
+                    return fn;
+                }
+
+                const slot_allocator& slot_alloc() const noexcept
+                {
+                    return fn;
+                }
+
+                template<typename A, typename B>
+                bool compare(const A& a, const B& b) const
+                {
+                    return static_cast<const Compare&>(fn)(a, b);
+                }
+
+                static const slot_type& as_slot(const value_type& value) noexcept
+                {
+                    return reinterpret_cast<const slot_type&>(value);
+                }
+
+                void reset_empty() noexcept
+                {
+                    root = nullptr;
+                    first_leaf = nullptr;
+                    last_leaf = nullptr;
+                    element_count = 0;
+                }
+
+                /* Adopt the nodes of 'other', which uses an equal
+                   allocator.  This tree must be empty. */
+                void take(raw_btree& other) noexcept
+                {
+                    root = other.root;
+                    first_leaf = other.first_leaf;
+                    last_leaf = other.last_leaf;
+                    element_count = other.element_count;
+                    other.reset_empty();
+                }
+
+                void copy_allocator(const raw_btree& other, std::true_type)
+                {
+                    slot_alloc() = other.slot_alloc();
+                }
+
+                void copy_allocator(const raw_btree&, std::false_type)
+                {
+                }
+
+                void move_allocator(raw_btree& other, std::true_type)
+                {
+                    slot_alloc() = std::move(other.slot_alloc());
+                }
+
+                void move_allocator(raw_btree&, std::false_type)
+                {
+                }
+
+                void swap_allocator(raw_btree& other, std::true_type)
+                {
+                    using std::swap;
+                    swap(slot_alloc(), other.slot_alloc());
+                }
+
+                void swap_allocator(raw_btree&, std::false_type)
+                {
+                }
+
+                /* Moves the slots of a tree out in order, for
+                   'build_sorted'. */
+                struct slot_mover
+                {
+                    iterator it;
+
+                    slot_type&& operator*() const noexcept
+                    {
+                        return std::move(it.leaf->slots()[it.index]);
+                    }
+
+                    slot_mover& operator++() noexcept
+                    {
+                        ++it;
+                        return *this;
+                    }
+
+                    bool operator!=(const slot_mover& other) const noexcept
+                    {
+                        return it != other.it;
+                    }
+                };
+
+                static iterator normalize(leaf_node* leaf, size_t index) noexcept
+                {
+                    if (index == leaf->count && leaf->next != nullptr)
+                    {
+                        return iterator(leaf->next, 0);
+                    }
+                    return iterator(leaf, index);
+                }
+
+                /* The leaf position of the lower or upper bound of 'key'.
+                   Separators equal to 'key' send it right. */
+                template<bool Upper, typename K>
+                CPPP_FORCE_INLINE iterator descend(const K& key) const
+                {
+                    const Compare& comp = fn;
+                    node_base* n = root;
+                    while (!n->leaf)
+                    {
+                        internal_node* in = static_cast<internal_node*>(n);
+                        n = in->children[rank<true>(in->keys(), in->count - 1u, key, comp)];
+                    }
+                    leaf_node* leaf = static_cast<leaf_node*>(n);
+                    return iterator(leaf, rank_leaf<Upper>(leaf, key, comp, std::is_same<slot_type, key_type>()));
+                }
+
+                template<bool Upper, typename K>
+                static size_t rank_leaf(leaf_node* leaf, const K& key, const Compare& comp, std::true_type)
+                {
+                    return rank<Upper>(leaf->slots(), leaf->count, key, comp);
+                }
+
+                template<bool Upper, typename K>
+                static size_t rank_leaf(leaf_node* leaf, const K& key, const Compare& comp, std::false_type)
+                {
+                    return rank_binary<Upper>(leaf->slots(), leaf->count, key, comp, slot_key());
+                }
+
+                struct slot_key
+                {
+                    const key_type& operator()(const slot_type& slot) const noexcept
+                    {
+                        return Policy::key(slot);
+                    }
+                };
+
+                template<bool Upper, typename K>
+                iterator search(const K& key)
+                {
+                    if (root == nullptr)
+                    {
+                        return end();
+                    }
+                    iterator it = descend<Upper>(key);
+                    return normalize(it.leaf, it.index);
+                }
+
+                /* A hint is used when the key goes right before it inside
+                   its leaf, or after the last element. */
+                template<typename K, typename... Args>
+                iterator emplace_key_hint(const_iterator hint, const K& key, Args&&... args)
+                {
+                    if (root != nullptr && hint.leaf != nullptr && (hint.index != 0 || hint == cbegin()))
+                    {
+                        leaf_node* leaf = hint.leaf;
+                        slot_type* slots = leaf->slots();
+                        bool before_hint = hint.index == leaf->count || compare(key, Policy::key(slots[hint.index]));
+                        if (before_hint && (hint.index == 0 || compare(Policy::key(slots[hint.index - 1]), key)))
+                        {
+                            return insert_at(leaf, hint.index, std::forward<Args>(args)...);
+                        }
+                    }
+                    return emplace_key(key, std::forward<Args>(args)...).first;
+                }
+
+                leaf_node* new_leaf()
+                {
+                    leaf_allocator alloc(slot_alloc());
+                    leaf_node* leaf = leaf_traits::allocate(alloc, 1);
+                    leaf->parent = nullptr;
+                    leaf->position = 0;
+                    leaf->count = 0;
+                    leaf->leaf = true;
+                    leaf->prev = nullptr;
+                    leaf->next = nullptr;
+                    return leaf;
+                }
+
+                internal_node* new_internal()
+                {
+                    internal_allocator alloc(slot_alloc());
+                    internal_node* node = internal_traits::allocate(alloc, 1);
+                    node->parent = nullptr;
+                    node->position = 0;
+                    node->count = 0;
+                    node->leaf = false;
+                    return node;
+                }
+
+                void free_node(node_base* n) noexcept
+                {
+                    if (n->leaf)
+                    {
+                        leaf_allocator alloc(slot_alloc());
+                        leaf_traits::deallocate(alloc, static_cast<leaf_node*>(n), 1);
+                    }
+                    else
+                    {
+                        internal_allocator alloc(slot_alloc());
+                        internal_traits::deallocate(alloc, static_cast<internal_node*>(n), 1);
+                    }
+                }
+
+                void destroy_slots(leaf_node* leaf) noexcept
+                {
+                    if (!std::is_trivially_destructible<slot_type>::value)
+                    {
+                        for (size_t i = 0; i < leaf->count; ++i)
+                        {
+                            slot_traits::destroy(slot_alloc(), leaf->slots() + i);
+                        }
+                    }
+                }
+
+                void destroy_keys(internal_node* node) noexcept
+                {
+                    if (!std::is_trivially_destructible<key_type>::value && node->count > 1)
+                    {
+                        key_allocator alloc(slot_alloc());
+                        for (size_t i = 0; i + 1 < node->count; ++i)
+                        {
+                            key_traits::destroy(alloc, node->keys() + i);
+                        }
+                    }
+                }
+
+                void destroy_subtree(node_base* n) noexcept
+                {
+                    if (n->leaf)
+                    {
+                        destroy_slots(static_cast<leaf_node*>(n));
+                    }
+                    else
+                    {
+                        internal_node* in = static_cast<internal_node*>(n);
+                        for (size_t i = 0; i < in->count; ++i)
+                        {
+                            destroy_subtree(in->children[i]);
+                        }
+                        destroy_keys(in);
+                    }
+                    free_node(n);
+                }
+
+                void destroy_tree() noexcept
+                {
+                    if (root != nullptr)
+                    {
+                        destroy_subtree(root);
+                    }
+                }
+
+                /* Move 'n' objects from 'from' to 'to', ending the lifetime
+                   of the originals.  The ranges may overlap. */
+                template<typename T, typename Alloc>
+                static void relocate(Alloc& alloc, T* from, size_t n, T* to, std::true_type) noexcept
+                {
+                    static_cast<void>(alloc);
+                    if (n != 0)
+                    {
+                        std::memmove(static_cast<void*>(to), static_cast<const void*>(from), n * sizeof(T));
+                    }
+                }
+
+                template<typename T, typename Alloc>
+                static void relocate(Alloc& alloc, T* from, size_t n, T* to, std::false_type) noexcept
+                {
+                    using traits = std::allocator_traits<Alloc>;
+                    if (to < from)
+                    {
+                        for (size_t i = 0; i < n; ++i)
+                        {
+                            traits::construct(alloc, to + i, std::move(from[i]));
+                            traits::destroy(alloc, from + i);
+                        }
+                    }
+                    else
+                    {
+                        for (size_t i = n; i-- != 0;)
+                        {
+                            traits::construct(alloc, to + i, std::move(from[i]));
+                            traits::destroy(alloc, from + i);
+                        }
+                    }
+                }
+
+                void move_slots(slot_type* from, size_t n, slot_type* to) noexcept
+                {
+                    relocate(slot_alloc(), from, n, to, std::integral_constant<bool, relocatable_slots>());
+                }
+
+                void move_keys(key_type* from, size_t n, key_type* to) noexcept
+                {
+                    key_allocator alloc(slot_alloc());
+                    relocate(alloc, from, n, to, std::integral_constant<bool, relocatable_keys>());
+                }
+
+                /* Children moved into 'node' from 'first' on learn their
+                   place. */
+                static void adopt(internal_node* node, size_t first) noexcept
+                {
+                    for (size_t i = first; i < node->count; ++i)
+                    {
+                        node->children[i]->parent = node;
+                        node->children[i]->position = static_cast<std::uint16_t>(i);
+                    }
+                }
+
+                template<typename... Args>
+                iterator insert_first(Args&&... args)
+                {
+                    leaf_node* leaf = new_leaf();
+                    try
+                    {
+                        slot_traits::construct(slot_alloc(), leaf->slots(), std::forward<Args>(args)...);
+                    }
+                    catch (...)
+                    {
+                        free_node(leaf);
+                        throw;
+                    }
+                    leaf->count = 1;
+                    root = first_leaf = last_leaf = leaf;
+                    element_count = 1;
+                    return iterator(leaf, 0);
+                }
+
+                template<typename... Args>
+                iterator insert_at(leaf_node* leaf, size_t index, Args&&... args)
+                {
+                    if (leaf->count == leaf_capacity)
+                    {
+                        return split_insert(leaf, index, std::forward<Args>(args)...);
+                    }
+                    slot_type* slots = leaf->slots();
+                    move_slots(slots + index, leaf->count - index, slots + index + 1);
+                    try
+                    {
+                        slot_traits::construct(slot_alloc(), slots + index, std::forward<Args>(args)...);
+                    }
+                    catch (...)
+                    {
+                        move_slots(slots + index + 1, leaf->count - index, slots + index);
+                        throw;
+                    }
+                    ++leaf->count;
+                    ++element_count;
+                    return iterator(leaf, index);
+                }
+
+                /* Nodes allocated before a split changes anything, so a
+                   failed allocation leaves the tree as it was. */
+                struct spare_nodes
+                {
+                    raw_btree& tree;
+                    leaf_node* leaf = nullptr;
+                    internal_node* internals[64];
+                    size_t count = 0;
+
+                    explicit spare_nodes(raw_btree& t) noexcept : tree(t)
+                    {
+                    }
+
+                    ~spare_nodes()
+                    {
+                        if (leaf != nullptr)
+                        {
+                            tree.free_node(leaf);
+                        }
+                        while (count != 0)
+                        {
+                            tree.free_node(internals[--count]);
+                        }
+                    }
+
+                    internal_node* take() noexcept
+                    {
+                        return internals[--count];
+                    }
+                };
+
+                template<typename... Args>
+                iterator split_insert(leaf_node* leaf, size_t index, Args&&... args)
+                {
+                    /* Everything that may throw comes first. */
+                    slot_type value(std::forward<Args>(args)...);
+                    const size_t total = leaf_capacity + 1;
+                    /* Appends leave full leaves behind, sorted input packs
+                       the tree. */
+                    size_t left_count = leaf->next == nullptr && index == leaf_capacity ? leaf_capacity
+                                        : leaf->prev == nullptr && index == 0          ? 1
+                                                                                       : total / 2;
+                    const slot_type* slots = leaf->slots();
+                    key_type separator(left_count == index  ? static_cast<const key_type&>(Policy::key(value))
+                                       : left_count < index ? Policy::key(slots[left_count])
+                                                            : Policy::key(slots[left_count - 1]));
+                    spare_nodes spare(*this);
+                    spare.leaf = new_leaf();
+                    for (internal_node* p = leaf->parent;; p = p->parent)
+                    {
+                        if (p == nullptr || p->count < internal_capacity)
+                        {
+                            if (p == nullptr)
+                            {
+                                spare.internals[spare.count] = new_internal();
+                                ++spare.count;
+                            }
+                            break;
+                        }
+                        spare.internals[spare.count] = new_internal();
+                        ++spare.count;
+                    }
+
+                    leaf_node* right = spare.leaf;
+                    spare.leaf = nullptr;
+                    right->prev = leaf;
+                    right->next = leaf->next;
+                    if (leaf->next != nullptr)
+                    {
+                        leaf->next->prev = right;
+                    }
+                    else
+                    {
+                        last_leaf = right;
+                    }
+                    leaf->next = right;
+
+                    slot_type* from = leaf->slots();
+                    slot_type* to = right->slots();
+                    iterator result;
+                    if (index < left_count)
+                    {
+                        move_slots(from + left_count - 1, leaf_capacity - left_count + 1, to);
+                        move_slots(from + index, left_count - 1 - index, from + index + 1);
+                        slot_traits::construct(slot_alloc(), from + index, std::move(value));
+                        result = iterator(leaf, index);
+                    }
+                    else
+                    {
+                        size_t at = index - left_count;
+                        move_slots(from + left_count, at, to);
+                        slot_traits::construct(slot_alloc(), to + at, std::move(value));
+                        move_slots(from + index, leaf_capacity - index, to + at + 1);
+                        result = iterator(right, at);
+                    }
+                    leaf->count = static_cast<std::uint16_t>(left_count);
+                    right->count = static_cast<std::uint16_t>(total - left_count);
+                    ++element_count;
+                    insert_child(leaf, std::move(separator), right, spare);
+                    return result;
+                }
+
+                /* Put 'child' right after 'left' in their parent, splitting
+                   full nodes up the tree. */
+                void insert_child(node_base* left, key_type&& separator, node_base* child, spare_nodes& spare) noexcept
+                {
+                    key_allocator alloc(slot_alloc());
+                    internal_node* parent = left->parent;
+                    if (parent == nullptr)
+                    {
+                        internal_node* top = spare.take();
+                        top->children[0] = left;
+                        top->children[1] = child;
+                        key_traits::construct(alloc, top->keys(), std::move(separator));
+                        top->count = 2;
+                        adopt(top, 0);
+                        root = top;
+                        return;
+                    }
+                    size_t at = left->position + 1u;
+                    if (parent->count < internal_capacity)
+                    {
+                        insert_into(parent, at, std::move(separator), child);
+                        return;
+                    }
+                    internal_node* right = spare.take();
+                    size_t n = parent->count, keep = (n + 1) / 2;
+                    key_type* keys = parent->keys();
+                    key_type up(std::move(keys[keep - 1]));
+                    key_traits::destroy(alloc, keys + keep - 1);
+                    move_keys(keys + keep, n - 1 - keep, right->keys());
+                    std::copy(parent->children + keep, parent->children + n, right->children);
+                    parent->count = static_cast<std::uint16_t>(keep);
+                    right->count = static_cast<std::uint16_t>(n - keep);
+                    adopt(right, 0);
+                    if (at <= keep)
+                    {
+                        insert_into(parent, at, std::move(separator), child);
+                    }
+                    else
+                    {
+                        insert_into(right, at - keep, std::move(separator), child);
+                    }
+                    insert_child(parent, std::move(up), right, spare);
+                }
+
+                void insert_into(internal_node* node, size_t at, key_type&& separator, node_base* child) noexcept
+                {
+                    key_type* keys = node->keys();
+                    move_keys(keys + at - 1, node->count - at, keys + at);
+                    key_allocator alloc(slot_alloc());
+                    key_traits::construct(alloc, keys + at - 1, std::move(separator));
+                    std::copy_backward(node->children + at, node->children + node->count, node->children + node->count + 1);
+                    node->children[at] = child;
+                    ++node->count;
+                    adopt(node, at);
+                }
+
+                /* Drop child 'at' > 0 and the separator before it. */
+                void remove_child(internal_node* node, size_t at) noexcept
+                {
+                    key_type* keys = node->keys();
+                    key_allocator alloc(slot_alloc());
+                    key_traits::destroy(alloc, keys + at - 1);
+                    move_keys(keys + at, node->count - 1 - at, keys + at - 1);
+                    std::copy(node->children + at + 1, node->children + node->count, node->children + at);
+                    --node->count;
+                    adopt(node, at);
+                }
+
+                iterator erase_at(leaf_node* leaf, size_t index) noexcept
+                {
+                    slot_type* slots = leaf->slots();
+                    slot_traits::destroy(slot_alloc(), slots + index);
+                    move_slots(slots + index + 1, leaf->count - index - 1u, slots + index);
+                    --leaf->count;
+                    --element_count;
+                    if (leaf == root)
+                    {
+                        if (leaf->count == 0)
+                        {
+                            free_node(leaf);
+                            reset_empty();
+                            return end();
+                        }
+                        return normalize(leaf, index);
+                    }
+                    if (leaf->count < min_leaf)
+                    {
+                        /* Below half full, a leaf joins a neighbour that has
+                           room.  Moving elements the other way would need a
+                           new separator, a copy that may throw. */
+                        internal_node* parent = leaf->parent;
+                        size_t at = leaf->position;
+                        if (at + 1u < parent->count)
+                        {
+                            leaf_node* right = static_cast<leaf_node*>(parent->children[at + 1]);
+                            if (leaf->count + right->count <= leaf_capacity)
+                            {
+                                merge_leaves(leaf, right);
+                                iterator result = normalize(leaf, index);
+                                rebalance(parent);
+                                return result;
+                            }
+                        }
+                        if (at != 0)
+                        {
+                            leaf_node* left = static_cast<leaf_node*>(parent->children[at - 1]);
+                            if (left->count + leaf->count <= leaf_capacity)
+                            {
+                                size_t offset = left->count;
+                                merge_leaves(left, leaf);
+                                iterator result = normalize(left, offset + index);
+                                rebalance(parent);
+                                return result;
+                            }
+                        }
+                    }
+                    return normalize(leaf, index);
+                }
+
+                void merge_leaves(leaf_node* left, leaf_node* right) noexcept
+                {
+                    move_slots(right->slots(), right->count, left->slots() + left->count);
+                    left->count = static_cast<std::uint16_t>(left->count + right->count);
+                    left->next = right->next;
+                    if (right->next != nullptr)
+                    {
+                        right->next->prev = left;
+                    }
+                    else
+                    {
+                        last_leaf = left;
+                    }
+                    remove_child(right->parent, right->position);
+                    free_node(right);
+                }
+
+                /* Restore the fill of 'node' after it lost a child. */
+                void rebalance(internal_node* node) noexcept
+                {
+                    while (node != root)
+                    {
+                        if (node->count >= min_internal)
+                        {
+                            return;
+                        }
+                        internal_node* parent = node->parent;
+                        size_t at = node->position;
+                        if (at + 1u < parent->count)
+                        {
+                            internal_node* right = static_cast<internal_node*>(parent->children[at + 1]);
+                            if (node->count + right->count > internal_capacity)
+                            {
+                                borrow_right(node, right);
+                                return;
+                            }
+                            merge_internal(node, right);
+                        }
+                        else
+                        {
+                            internal_node* left = static_cast<internal_node*>(parent->children[at - 1]);
+                            if (left->count + node->count > internal_capacity)
+                            {
+                                borrow_left(node, left);
+                                return;
+                            }
+                            merge_internal(left, node);
+                        }
+                        node = parent;
+                    }
+                    if (node->count == 1)
+                    {
+                        root = node->children[0];
+                        root->parent = nullptr;
+                        root->position = 0;
+                        free_node(node);
+                    }
+                }
+
+                /* The separator between the two comes down between their
+                   keys. */
+                void merge_internal(internal_node* left, internal_node* right) noexcept
+                {
+                    internal_node* parent = left->parent;
+                    key_type* keys = left->keys();
+                    key_allocator alloc(slot_alloc());
+                    key_traits::construct(alloc, keys + left->count - 1, std::move(parent->keys()[left->position]));
+                    move_keys(right->keys(), right->count - 1u, keys + left->count);
+                    std::copy(right->children, right->children + right->count, left->children + left->count);
+                    size_t first = left->count;
+                    left->count = static_cast<std::uint16_t>(left->count + right->count);
+                    adopt(left, first);
+                    remove_child(parent, right->position);
+                    free_node(right);
+                }
+
+                /* Keys rotate through the parent's separator. */
+                void borrow_right(internal_node* node, internal_node* right) noexcept
+                {
+                    key_type& separator = node->parent->keys()[node->position];
+                    key_allocator alloc(slot_alloc());
+                    key_traits::construct(alloc, node->keys() + node->count - 1, std::move(separator));
+                    separator = std::move(right->keys()[0]);
+                    key_traits::destroy(alloc, right->keys());
+                    move_keys(right->keys() + 1, right->count - 2u, right->keys());
+                    node->children[node->count] = right->children[0];
+                    ++node->count;
+                    adopt(node, node->count - 1u);
+                    std::copy(right->children + 1, right->children + right->count, right->children);
+                    --right->count;
+                    adopt(right, 0);
+                }
+
+                void borrow_left(internal_node* node, internal_node* left) noexcept
+                {
+                    key_type& separator = node->parent->keys()[left->position];
+                    key_allocator alloc(slot_alloc());
+                    move_keys(node->keys(), node->count - 1u, node->keys() + 1);
+                    key_traits::construct(alloc, node->keys(), std::move(separator));
+                    separator = std::move(left->keys()[left->count - 2]);
+                    key_traits::destroy(alloc, left->keys() + left->count - 2);
+                    std::copy_backward(node->children, node->children + node->count, node->children + node->count + 1);
+                    node->children[0] = left->children[left->count - 1];
+                    --left->count;
+                    ++node->count;
+                    adopt(node, 0);
+                }
+
+                /* Fill leaves in order, then build each level over the one
+                   below, with nodes of even sizes.  The tree must be
+                   empty. */
+                template<typename InputIt>
+                void build_sorted(InputIt from, InputIt to)
+                {
+                    std::vector<node_base*> level;
+                    std::vector<internal_node*> built;
+                    try
+                    {
+                        leaf_node* prev = nullptr;
+                        while (from != to)
+                        {
+                            level.push_back(nullptr);
+                            leaf_node* leaf = new_leaf();
+                            level.back() = leaf;
+                            leaf->prev = prev;
+                            if (prev != nullptr)
+                            {
+                                prev->next = leaf;
+                            }
+                            else
+                            {
+                                first_leaf = leaf;
+                            }
+                            last_leaf = prev = leaf;
+                            for (; leaf->count < leaf_capacity && from != to; ++from)
+                            {
+                                slot_traits::construct(slot_alloc(), leaf->slots() + leaf->count, *from);
+                                ++leaf->count;
+                                ++element_count;
+                            }
+                        }
+                        if (level.empty())
+                        {
+                            return;
+                        }
+                        /* The last leaf takes from the one before it. */
+                        if (level.size() > 1 && last_leaf->count < min_leaf)
+                        {
+                            leaf_node* before = last_leaf->prev;
+                            size_t total = before->count + last_leaf->count, moved = total / 2 - last_leaf->count;
+                            move_slots(last_leaf->slots(), last_leaf->count, last_leaf->slots() + moved);
+                            move_slots(before->slots() + before->count - moved, moved, last_leaf->slots());
+                            before->count = static_cast<std::uint16_t>(before->count - moved);
+                            last_leaf->count = static_cast<std::uint16_t>(last_leaf->count + moved);
+                        }
+                        while (level.size() > 1)
+                        {
+                            size_t n = level.size(), groups = (n + internal_capacity - 1) / internal_capacity, first = 0;
+                            built.reserve(built.size() + groups);
+                            for (size_t g = 0; g < groups; ++g)
+                            {
+                                size_t size = n / groups + (g < n % groups ? 1 : 0);
+                                internal_node* node = new_internal();
+                                built.push_back(node);
+                                node->children[0] = level[first];
+                                node->count = 1;
+                                key_allocator alloc(slot_alloc());
+                                for (size_t i = 1; i < size; ++i)
+                                {
+                                    node_base* child = level[first + i];
+                                    key_traits::construct(alloc, node->keys() + i - 1, first_key(child));
+                                    node->children[i] = child;
+                                    ++node->count;
+                                }
+                                level[g] = node;
+                                first += size;
+                            }
+                            /* Nodes own their children from here on. */
+                            for (size_t g = 0; g < groups; ++g)
+                            {
+                                adopt(static_cast<internal_node*>(level[g]), 0);
+                            }
+                            level.resize(groups);
+                        }
+                        root = level[0];
+                        built.clear();
+                    }
+                    catch (...)
+                    {
+                        /* Internal nodes hold copies of keys only, the
+                           leaves own the elements. */
+                        for (internal_node* node : built)
+                        {
+                            destroy_keys(node);
+                            free_node(node);
+                        }
+                        for (leaf_node* leaf = first_leaf; leaf != nullptr;)
+                        {
+                            leaf_node* next = leaf->next;
+                            destroy_slots(leaf);
+                            free_node(leaf);
+                            leaf = next;
+                        }
+                        reset_empty();
+                        throw;
+                    }
+                }
+
+                static const key_type& first_key(node_base* n) noexcept
+                {
+                    while (!n->leaf)
+                    {
+                        n = static_cast<internal_node*>(n)->children[0];
+                    }
+                    return Policy::key(static_cast<leaf_node*>(n)->slots()[0]);
+                }
+            };
+
+            template<typename P, typename C, typename A>
+            constexpr bool raw_btree<P, C, A>::transparent;
+
+            template<typename P, typename C, typename A>
+            constexpr bool raw_btree<P, C, A>::relocatable_slots;
+
+            template<typename P, typename C, typename A>
+            constexpr bool raw_btree<P, C, A>::relocatable_keys;
+
+            template<typename P, typename C, typename A>
+            constexpr size_t raw_btree<P, C, A>::node_size;
+
+            template<typename P, typename C, typename A>
+            constexpr size_t raw_btree<P, C, A>::leaf_header;
+
+            template<typename P, typename C, typename A>
+            constexpr size_t raw_btree<P, C, A>::internal_header;
+
+            template<typename P, typename C, typename A>
+            constexpr size_t raw_btree<P, C, A>::leaf_capacity;
+
+            template<typename P, typename C, typename A>
+            constexpr size_t raw_btree<P, C, A>::internal_capacity;
+
+            template<typename P, typename C, typename A>
+            constexpr size_t raw_btree<P, C, A>::min_leaf;
+
+            template<typename P, typename C, typename A>
+            constexpr size_t raw_btree<P, C, A>::min_internal;
+        } // namespace btree
+    } // namespace detail
+} // namespace cppp
+
+#undef CPPP_BTREE_X86
+#undef CPPP_BTREE_NEON
+#undef CPPP_BTREE_INT64
+
+#endif
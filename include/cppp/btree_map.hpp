@@ -0,0 +1,165 @@
+/* Copyright (C) 1999-2023 Free Software Foundation, Inc.
+   This file is part of the cppp-base library.
+
+   The cppp-base library is free software; you can redistribute it
+   and/or modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either version 3
+   of the License, or (at your option) any later version.
+
+   The cppp-base library is distributed in the hope that it will be
+   useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the cppp-base library; see the file COPYING.
+   If not, see <https://www.gnu.org/licenses/>.  */
+
+/* We do not use '#pragma once' because it may has bugs in some compiler. */
+#ifndef _CPPP_BTREE_MAP_HPP
+#define _CPPP_BTREE_MAP_HPP
+
+/* C++ Plus B+tree ordered map */
+
+#include "basedef.hpp"
+#include "btree.hpp"
+
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+
+namespace cppp
+{
+    /* An ordered map storing its elements in arrays of a B+tree, see
+       'btree.hpp' for the layout.  A few times less memory and pointer
+       chasing than 'std::map' for small elements.
+
+       Differences from 'std::map':
+       - Inserting and erasing move elements between nodes, so they
+         invalidate all iterators, pointers and references.  Moves of
+         keys and values must not throw.
+       - Keys must be copy constructible, internal nodes hold copies.
+       - Construction from 'sorted_unique' input takes linear time, and
+         inserting sorted input appends without searching.
+       - 'for_each_segment' visits a range as arrays of elements.
+       - When 'Compare' is 'std::less' over an arithmetic key, nodes are
+         searched with vector compares. */
+    template<typename Key, typename T, typename Compare = std::less<Key>,
+             typename Allocator = std::allocator<std::pair<const Key, T>>>
+    class btree_map : public detail::btree::raw_btree<detail::btree::map_policy<Key, T>, Compare, Allocator>
+    {
+    private:
+        using base = detail::btree::raw_btree<detail::btree::map_policy<Key, T>, Compare, Allocator>;
+
+        template<typename K>
+        using key_arg = typename base::template key_arg<K>;
+
+    public:
+        using mapped_type = T;
+        using typename base::const_iterator;
+        using typename base::iterator;
+        using typename base::key_type;
+        using typename base::value_type;
+
+        using base::base;
+
+        btree_map() : base()
+        {
+        }
+
+        btree_map(std::initializer_list<value_type> list) : base(list)
+        {
+        }
+
+        template<typename... Args>
+        std::pair<iterator, bool> try_emplace(const key_type& key, Args&&... args)
+        {
+            return this->emplace_key(key, std::piecewise_construct, std::forward_as_tuple(key),
+                                     std::forward_as_tuple(std::forward<Args>(args)...));
+        }
+
+        /* The key is moved only once it is known to be new. */
+        template<typename... Args>
+        std::pair<iterator, bool> try_emplace(key_type&& key, Args&&... args)
+        {
+            return this->emplace_key(key, std::piecewise_construct, std::forward_as_tuple(std::move(key)),
+                                     std::forward_as_tuple(std::forward<Args>(args)...));
+        }
+
+        template<typename... Args>
+        iterator try_emplace(const_iterator, const key_type& key, Args&&... args)
+        {
+            return try_emplace(key, std::forward<Args>(args)...).first;
+        }
+
+        template<typename... Args>
+        iterator try_emplace(const_iterator, key_type&& key, Args&&... args)
+        {
+            return try_emplace(std::move(key), std::forward<Args>(args)...).first;
+        }
+
+        template<typename M>
+        std::pair<iterator, bool> insert_or_assign(const key_type& key, M&& value)
+        {
+            std::pair<iterator, bool> result = try_emplace(key, std::forward<M>(value));
+            if (!result.second)
+            {
+                result.first->second = std::forward<M>(value);
+            }
+            return result;
+        }
+
+        template<typename M>
+        std::pair<iterator, bool> insert_or_assign(key_type&& key, M&& value)
+        {
+            std::pair<iterator, bool> result = this->emplace_key(key, std::move(key), std::forward<M>(value));
+            if (!result.second)
+            {
+                result.first->second = std::forward<M>(value);
+            }
+            return result;
+        }
+
+        T& operator[](const key_type& key)
+        {
+            return try_emplace(key).first->second;
+        }
+
+        T& operator[](key_type&& key)
+        {
+            return try_emplace(std::move(key)).first->second;
+        }
+
+        template<typename K = key_type>
+        T& at(const key_arg<K>& key)
+        {
+            iterator it = this->find(key);
+            if (it == this->end())
+            {
+                throw std::out_of_range("cppp::btree_map::at");
+            }
+            return it->second;
+        }
+
+        template<typename K = key_type>
+        const T& at(const key_arg<K>& key) const
+        {
+            const_iterator it = this->find(key);
+            if (it == this->end())
+            {
+                throw std::out_of_range("cppp::btree_map::at");
+            }
+            return it->second;
+        }
+    };
+
+    template<typename K, typename T, typename C, typename A>
+    void swap(btree_map<K, T, C, A>& lhs, btree_map<K, T, C, A>& rhs) noexcept
+    {
+        lhs.swap(rhs);
+    }
+} // namespace cppp
+
+#endif
@@ -0,0 +1,61 @@
+/* Copyright (C) 1999-2023 Free Software Foundation, Inc.
+   This file is part of the cppp-base library.
+
+   The cppp-base library is free software; you can redistribute it
+   and/or modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either version 3
+   of the License, or (at your option) any later version.
+
+   The cppp-base library is distributed in the hope that it will be
+   useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the cppp-base library; see the file COPYING.
+   If not, see <https://www.gnu.org/licenses/>.  */
+
+/* We do not use '#pragma once' because it may has bugs in some compiler. */
+#ifndef _CPPP_BTREE_SET_HPP
+#define _CPPP_BTREE_SET_HPP
+
+/* C++ Plus B+tree ordered set */
+
+#include "basedef.hpp"
+#include "btree.hpp"
+
+#include <functional>
+#include <memory>
+
+namespace cppp
+{
+    /* An ordered set storing its keys in arrays of a B+tree, see
+       'btree_map' for the differences from the standard containers. */
+    template<typename Key, typename Compare = std::less<Key>, typename Allocator = std::allocator<Key>>
+    class btree_set : public detail::btree::raw_btree<detail::btree::set_policy<Key>, Compare, Allocator>
+    {
+    private:
+        using base = detail::btree::raw_btree<detail::btree::set_policy<Key>, Compare, Allocator>;
+
+    public:
+        using typename base::value_type;
+
+        using base::base;
+
+        btree_set() : base()
+        {
+        }
+
+        btree_set(std::initializer_list<value_type> list) : base(list)
+        {
+        }
+    };
+
+    template<typename K, typename C, typename A>
+    void swap(btree_set<K, C, A>& lhs, btree_set<K, C, A>& rhs) noexcept
+    {
+        lhs.swap(rhs);
+    }
+} // namespace cppp
+
+#endif
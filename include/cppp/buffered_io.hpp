@@ -0,0 +1,773 @@
+/* Copyright (C) 1999-2023 Free Software Foundation, Inc.
+   This file is part of the cppp-base library.
+
+   The cppp-base library is free software; you can redistribute it
+   and/or modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either version 3
+   of the License, or (at your option) any later version.
+
+   The cppp-base library is distributed in the hope that it will be
+   useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the cppp-base library; see the file COPYING.
+   If not, see <https://www.gnu.org/licenses/>.  */
+
+/* We do not use '#pragma once' because it may has bugs in some compiler. */
+#ifndef _CPPP_BUFFERED_IO_HPP
+#define _CPPP_BUFFERED_IO_HPP
+
+/* C++ Plus buffered file descriptor I/O */
+
+#include "basedef.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+
+#include "hardware.hpp"
+
+#include <cerrno>
+#include <climits>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+/* 'buffered_writer' and 'buffered_reader' sit directly on a file
+   descriptor: no locale, no virtual calls, no locking. Small writes are
+   copied into the buffer. A write larger than the buffer goes out in one
+   'writev' together with the buffered bytes, so it is never copied. The
+   same holds for 'write_vectored' gathers.
+
+   With 'direct' the file is opened with 'O_DIRECT' (Linux) and all I/O
+   goes through an aligned buffer in whole blocks. The writer pads the
+   last partial block and then truncates the file back to its real
+   length. */
+
+namespace cppp
+{
+    /* When a writer forces data to stable storage. */
+    enum class sync_policy
+    {
+        /* Never, call 'sync' explicitly. */
+        none,
+        /* 'fdatasync' after every 'flush'. */
+        on_flush,
+        /* 'fsync' once in 'close'. */
+        on_close
+    };
+
+    struct buffered_io_options
+    {
+        size_t buffer_size = 64 * 1024;
+        /* Bypass the page cache with 'O_DIRECT'. Needs a file system
+           that supports it. */
+        bool direct = false;
+        /* Block size for 'direct', usually the logical sector size. */
+        size_t direct_alignment = 4096;
+        sync_policy sync = sync_policy::none;
+    };
+
+    namespace detail
+    {
+        namespace buffered
+        {
+            [[noreturn]] inline void throw_errno(const char* what)
+            {
+                throw std::system_error(errno, std::system_category(), what);
+            }
+
+#if defined(IOV_MAX)
+            constexpr int max_iov = IOV_MAX < 1024 ? IOV_MAX : 1024;
+#else
+            constexpr int max_iov = 16;
+#endif
+
+            inline int open_file(const char* path, int flags, bool direct)
+            {
+                if (direct)
+                {
+#if defined(O_DIRECT)
+                    flags |= O_DIRECT;
+#else
+                    throw std::system_error(ENOTSUP, std::system_category(), "O_DIRECT");
+#endif
+                }
+                int fd = ::open(path, flags | O_CLOEXEC, 0644);
+                if (fd < 0)
+                {
+                    throw_errno("open");
+                }
+                return fd;
+            }
+
+            /* Owns the buffer, aligned to 'alignment' in direct mode. */
+            class buffer
+            {
+            private:
+                char* memory = nullptr;
+                size_t bytes = 0;
+
+            public:
+                buffer(size_t size, size_t alignment)
+                {
+                    if (alignment == 0 || (alignment & (alignment - 1)) != 0)
+                    {
+                        throw std::invalid_argument("buffered I/O: alignment must be a power of two");
+                    }
+                    bytes = (size < alignment ? alignment : size + alignment - 1) & ~(alignment - 1);
+                    void* p = nullptr;
+                    if (alignment < sizeof(void*))
+                    {
+                        alignment = sizeof(void*);
+                    }
+                    if (::posix_memalign(&p, alignment, bytes) != 0)
+                    {
+                        throw std::bad_alloc();
+                    }
+                    memory = static_cast<char*>(p);
+                }
+
+                buffer(buffer&& other) noexcept
+                    : memory(other.memory), bytes(other.bytes)
+                {
+                    other.memory = nullptr;
+                    other.bytes = 0;
+                }
+
+                buffer(const buffer&) = delete;
+                buffer& operator=(const buffer&) = delete;
+
+                ~buffer()
+                {
+                    std::free(memory);
+                }
+
+                char* data() const noexcept
+                {
+                    return memory;
+                }
+
+                size_t size() const noexcept
+                {
+                    return bytes;
+                }
+            };
+        } // namespace buffered
+    } // namespace detail
+
+    /* Buffered output to a file descriptor. Data not yet flushed is lost
+       if the writer is destroyed by an exception, and errors of the
+       implicit flush in the destructor are ignored: call 'close' to see
+       them. */
+    class buffered_writer
+    {
+    private:
+        int fd;
+        bool owned;
+        buffered_io_options options;
+        detail::buffered::buffer storage;
+        size_t used = 0;
+        /* Direct mode: file offset of the buffer start, always aligned. */
+        off_t position = 0;
+        unsigned long long total = 0;
+
+    public:
+        /* Create or truncate 'path'. */
+        explicit buffered_writer(const char* path, const buffered_io_options& o = buffered_io_options())
+            : buffered_writer(detail::buffered::open_file(path, O_WRONLY | O_CREAT | O_TRUNC, o.direct), true, o)
+        {
+        }
+
+        /* Write to 'file', which stays open. A direct writer starts at
+           offset 0 and 'file' must have been opened with 'O_DIRECT'. */
+        explicit buffered_writer(int file, const buffered_io_options& o = buffered_io_options())
+            : buffered_writer(file, false, o)
+        {
+        }
+
+        buffered_writer(const buffered_writer&) = delete;
+        buffered_writer& operator=(const buffered_writer&) = delete;
+
+        ~buffered_writer()
+        {
+            try
+            {
+                close();
+            }
+            catch (...)
+            {
+            }
+        }
+
+        /* Bytes accepted so far, flushed or not. */
+        unsigned long long bytes_written() const noexcept
+        {
+            return total;
+        }
+
+        size_t buffered() const noexcept
+        {
+            return used;
+        }
+
+        int native_handle() const noexcept
+        {
+            return fd;
+        }
+
+        void put(char c)
+        {
+            if (CPPP_UNLIKELY(used == storage.size()))
+            {
+                drain();
+            }
+            storage.data()[used++] = c;
+            ++total;
+        }
+
+        void write(const void* data, size_t size)
+        {
+            if (CPPP_LIKELY(size <= storage.size() - used))
+            {
+                std::memcpy(storage.data() + used, data, size);
+                used += size;
+                total += size;
+                return;
+            }
+            iovec part;
+            part.iov_base = const_cast<void*>(data);
+            part.iov_len = size;
+            write_vectored(&part, 1);
+        }
+
+        void write(const std::string& text)
+        {
+            write(text.data(), text.size());
+        }
+
+        /* Write 'count' spans in order. Spans that fit the free buffer
+           space are copied, otherwise the buffer and the spans go out in
+           'writev' calls without copying the spans. */
+        void write_vectored(const iovec* parts, size_t count)
+        {
+            size_t size = 0;
+            for (size_t i = 0; i < count; ++i)
+            {
+                size += parts[i].iov_len;
+            }
+            if (size <= storage.size() - used || options.direct)
+            {
+                for (size_t i = 0; i < count; ++i)
+                {
+                    copy_in(static_cast<const char*>(parts[i].iov_base), parts[i].iov_len);
+                }
+                return;
+            }
+            gather(parts, count);
+            total += size;
+        }
+
+        /* Hand the buffered bytes to the kernel, then apply
+           'sync_policy::on_flush'. */
+        void flush()
+        {
+            flush_buffer(true);
+            if (options.sync == sync_policy::on_flush)
+            {
+                datasync();
+            }
+        }
+
+        /* Flush and force file data and metadata to stable storage. */
+        void sync()
+        {
+            flush_buffer(true);
+            if (::fsync(fd) != 0)
+            {
+                detail::buffered::throw_errno("fsync");
+            }
+        }
+
+        /* Flush, apply the sync policy and close an owned descriptor. Does
+           nothing the second time. */
+        void close()
+        {
+            if (fd < 0)
+            {
+                return;
+            }
+            int file = fd;
+            try
+            {
+                flush();
+                if (options.sync == sync_policy::on_close && ::fsync(file) != 0)
+                {
+                    detail::buffered::throw_errno("fsync");
+                }
+            }
+            catch (...)
+            {
+                release();
+                throw;
+            }
+            release();
+        }
+
+    private:
+        buffered_writer(int file, bool own, const buffered_io_options& o) try
+            : fd(file), owned(own), options(o),
+              storage(o.buffer_size, o.direct ? o.direct_alignment : alignof(std::max_align_t))
+        {
+        }
+        catch (...)
+        {
+            if (own)
+            {
+                ::close(file);
+            }
+        }
+
+        void release() noexcept
+        {
+            if (owned)
+            {
+                ::close(fd);
+            }
+            fd = -1;
+        }
+
+        void datasync()
+        {
+#if defined(__APPLE__)
+            int result = ::fsync(fd);
+#else
+            int result = ::fdatasync(fd);
+#endif
+            if (result != 0)
+            {
+                detail::buffered::throw_errno("fdatasync");
+            }
+        }
+
+        void copy_in(const char* data, size_t size)
+        {
+            total += size;
+            while (size != 0)
+            {
+                if (used == storage.size())
+                {
+                    drain();
+                }
+                size_t n = storage.size() - used < size ? storage.size() - used : size;
+                std::memcpy(storage.data() + used, data, n);
+                used += n;
+                data += n;
+                size -= n;
+            }
+        }
+
+        /* Make room in a full buffer. */
+        void drain()
+        {
+            flush_buffer(false);
+        }
+
+        /* Write out the buffer. In direct mode only whole blocks leave it
+           unless 'all', in which case the partial block is written padded
+           and kept, so that later writes complete it. */
+        void flush_buffer(bool all)
+        {
+            if (!options.direct)
+            {
+                if (used != 0)
+                {
+                    iovec part;
+                    part.iov_base = storage.data();
+                    part.iov_len = used;
+                    used = 0;
+                    write_all(&part, 1);
+                }
+                return;
+            }
+            size_t block = options.direct_alignment;
+            size_t whole = used & ~(block - 1);
+            size_t tail = used - whole;
+            if (whole != 0)
+            {
+                pwrite_all(storage.data(), whole, position);
+                position += static_cast<off_t>(whole);
+                std::memmove(storage.data(), storage.data() + whole, tail);
+                used = tail;
+            }
+            if (all && tail != 0)
+            {
+                std::memset(storage.data() + tail, 0, block - tail);
+                pwrite_all(storage.data(), block, position);
+                if (::ftruncate(fd, position + static_cast<off_t>(tail)) != 0)
+                {
+                    detail::buffered::throw_errno("ftruncate");
+                }
+            }
+        }
+
+        void gather(const iovec* parts, size_t count)
+        {
+            iovec vector[detail::buffered::max_iov];
+            size_t n = 0;
+            if (used != 0)
+            {
+                vector[n].iov_base = storage.data();
+                vector[n].iov_len = used;
+                ++n;
+                used = 0;
+            }
+            for (size_t i = 0; i < count; ++i)
+            {
+                if (n == static_cast<size_t>(detail::buffered::max_iov))
+                {
+                    write_all(vector, n);
+                    n = 0;
+                }
+                vector[n++] = parts[i];
+            }
+            write_all(vector, n);
+        }
+
+        /* 'writev' until everything is written, 'parts' is consumed. */
+        void write_all(iovec* parts, size_t count)
+        {
+            while (count != 0)
+            {
+                ssize_t written = ::writev(fd, parts, static_cast<int>(count));
+                if (written < 0)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+                    detail::buffered::throw_errno("writev");
+                }
+                size_t left = static_cast<size_t>(written);
+                while (count != 0 && left >= parts->iov_len)
+                {
+                    left -= parts->iov_len;
+                    ++parts;
+                    --count;
+                }
+                if (count != 0)
+                {
+                    parts->iov_base = static_cast<char*>(parts->iov_base) + left;
+                    parts->iov_len -= left;
+                }
+            }
+        }
+
+        void pwrite_all(const char* data, size_t size, off_t offset)
+        {
+            while (size != 0)
+            {
+                ssize_t written = ::pwrite(fd, data, size, offset);
+                if (written < 0)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+                    detail::buffered::throw_errno("pwrite");
+                }
+                data += written;
+                size -= static_cast<size_t>(written);
+                offset += written;
+            }
+        }
+    };
+
+    /* Buffered input from a file descriptor. */
+    class buffered_reader
+    {
+    private:
+        int fd;
+        bool owned;
+        buffered_io_options options;
+        detail::buffered::buffer storage;
+        size_t head = 0;
+        size_t tail = 0;
+        /* Direct mode: file offset of the next block to read. */
+        off_t position = 0;
+        bool at_end = false;
+
+    public:
+        explicit buffered_reader(const char* path, const buffered_io_options& o = buffered_io_options())
+            : buffered_reader(detail::buffered::open_file(path, O_RDONLY, o.direct), true, o)
+        {
+        }
+
+        /* Read from 'file', which stays open. A direct reader starts at
+           offset 0 and 'file' must have been opened with 'O_DIRECT'. */
+        explicit buffered_reader(int file, const buffered_io_options& o = buffered_io_options())
+            : buffered_reader(file, false, o)
+        {
+        }
+
+        buffered_reader(const buffered_reader&) = delete;
+        buffered_reader& operator=(const buffered_reader&) = delete;
+
+        ~buffered_reader()
+        {
+            close();
+        }
+
+        void close() noexcept
+        {
+            if (fd >= 0 && owned)
+            {
+                ::close(fd);
+            }
+            fd = -1;
+        }
+
+        int native_handle() const noexcept
+        {
+            return fd;
+        }
+
+        /* Zero-copy access: the buffered bytes are
+           [data(), data() + available()). 'fill' reads more, 'consume'
+           drops bytes from the front. */
+
+        const char* data() const noexcept
+        {
+            return storage.data() + head;
+        }
+
+        size_t available() const noexcept
+        {
+            return tail - head;
+        }
+
+        /* Move the buffered bytes to the front and read once into the
+           free space. Returns the number of bytes added, 0 at the end of
+           the file or when the buffer is full. */
+        size_t fill()
+        {
+            if (at_end)
+            {
+                return 0;
+            }
+            compact();
+            if (tail == storage.size())
+            {
+                return 0;
+            }
+            size_t n = options.direct ? read_block() : read_some(storage.data() + tail, storage.size() - tail);
+            if (n == 0)
+            {
+                at_end = true;
+            }
+            tail += n;
+            return n;
+        }
+
+        void consume(size_t size) noexcept
+        {
+            head += size < available() ? size : available();
+        }
+
+        bool eof() const noexcept
+        {
+            return at_end && head == tail;
+        }
+
+        int get()
+        {
+            if (head == tail && fill() == 0)
+            {
+                return -1;
+            }
+            return static_cast<unsigned char>(storage.data()[head++]);
+        }
+
+        /* Read up to 'size' bytes, fewer only at the end of the file. */
+        size_t read(void* data, size_t size)
+        {
+            char* out = static_cast<char*>(data);
+            size_t done = take(out, size);
+            if (done == size || at_end)
+            {
+                return done;
+            }
+            if (!options.direct && size - done >= storage.size())
+            {
+                /* Large read: straight into the caller's memory. */
+                while (done != size)
+                {
+                    size_t n = read_some(out + done, size - done);
+                    if (n == 0)
+                    {
+                        at_end = true;
+                        break;
+                    }
+                    done += n;
+                }
+                return done;
+            }
+            while (done != size && fill() != 0)
+            {
+                done += take(out + done, size - done);
+            }
+            return done;
+        }
+
+        /* Scatter into 'count' spans, returns the total bytes read. */
+        size_t read_vectored(const iovec* parts, size_t count)
+        {
+            size_t done = 0;
+            for (size_t i = 0; i < count; ++i)
+            {
+                size_t n = read(parts[i].iov_base, parts[i].iov_len);
+                done += n;
+                if (n != parts[i].iov_len)
+                {
+                    break;
+                }
+            }
+            return done;
+        }
+
+        /* Read up to 'delimiter', which is consumed but not stored.
+           Returns false when nothing is left to read. */
+        bool getline(std::string& line, char delimiter = '\n')
+        {
+            line.clear();
+            for (;;)
+            {
+                const char* begin = data();
+                const void* found = std::memchr(begin, delimiter, available());
+                if (found != nullptr)
+                {
+                    size_t n = static_cast<size_t>(static_cast<const char*>(found) - begin);
+                    line.append(begin, n);
+                    consume(n + 1);
+                    return true;
+                }
+                line.append(begin, available());
+                bool any = available() != 0 || !line.empty();
+                head = tail = 0;
+                if (fill() == 0)
+                {
+                    return any;
+                }
+            }
+        }
+
+    private:
+        buffered_reader(int file, bool own, const buffered_io_options& o) try
+            : fd(file), owned(own), options(o),
+              storage(o.buffer_size, o.direct ? o.direct_alignment : alignof(std::max_align_t))
+        {
+        }
+        catch (...)
+        {
+            if (own)
+            {
+                ::close(file);
+            }
+        }
+
+        size_t take(char* out, size_t size) noexcept
+        {
+            size_t n = available() < size ? available() : size;
+            std::memcpy(out, storage.data() + head, n);
+            head += n;
+            return n;
+        }
+
+        void compact() noexcept
+        {
+            if (head == tail)
+            {
+                head = tail = 0;
+                return;
+            }
+            if (options.direct)
+            {
+                /* Keep the block alignment of the free space. */
+                size_t block = options.direct_alignment;
+                size_t start = head & ~(block - 1);
+                if (start != 0)
+                {
+                    std::memmove(storage.data(), storage.data() + start, tail - start);
+                    head -= start;
+                    tail -= start;
+                }
+                return;
+            }
+            if (head != 0)
+            {
+                std::memmove(storage.data(), storage.data() + head, tail - head);
+                tail -= head;
+                head = 0;
+            }
+        }
+
+        /* Direct mode: read whole blocks at the aligned file position.
+           A partial block at the end of the file is kept at 'tail' and
+           read again on the next fill, so 'tail' stays aligned. */
+        size_t read_block()
+        {
+            size_t block = options.direct_alignment;
+            size_t partial = tail & (block - 1);
+            size_t start = tail - partial;
+            off_t offset = position - static_cast<off_t>(partial);
+            for (;;)
+            {
+                ssize_t n = ::pread(fd, storage.data() + start, storage.size() - start, offset);
+                if (n < 0)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+                    detail::buffered::throw_errno("pread");
+                }
+                size_t got = static_cast<size_t>(n);
+                if (got <= partial)
+                {
+                    return 0;
+                }
+                position = offset + n;
+                return got - partial;
+            }
+        }
+
+        size_t read_some(char* out, size_t size)
+        {
+            for (;;)
+            {
+                ssize_t n = ::read(fd, out, size);
+                if (n >= 0)
+                {
+                    return static_cast<size_t>(n);
+                }
+                if (errno != EINTR)
+                {
+                    detail::buffered::throw_errno("read");
+                }
+            }
+        }
+    };
+} // namespace cppp
+
+#endif
+
+#endif
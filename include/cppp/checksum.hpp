@@ -0,0 +1,521 @@
+/* Copyright (C) 1999-2023 Free Software Foundation, Inc.
+   This file is part of the cppp-base library.
+
+   The cppp-base library is free software; you can redistribute it
+   and/or modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either version 3
+   of the License, or (at your option) any later version.
+
+   The cppp-base library is distributed in the hope that it will be
+   useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the cppp-base library; see the file COPYING.
+   If not, see <https://www.gnu.org/licenses/>.  */
+
+/* We do not use '#pragma once' because it may has bugs in some compiler. */
+#ifndef _CPPP_CHECKSUM_HPP
+#define _CPPP_CHECKSUM_HPP
+
+/* C++ Plus checksums: CRC32C and XXH64
+
+   'crc32c' uses the CRC32 instructions of SSE4.2 (picked at runtime) or
+   ARMv8 (when the target has them), otherwise a slicing-by-8 table.  The
+   instructions have a latency of three cycles and a throughput of one, so
+   large buffers are split into three streams computed at the same time and
+   joined with precomputed shift tables (the method of Mark Adler's
+   crc32c.c). */
+
+#include "basedef.hpp"
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(CPPP_ARCH_X86_64) || defined(CPPP_ARCH_X86)
+#if defined(CPPP_COMPILER_MSVC)
+#include <intrin.h>
+#include <nmmintrin.h>
+#define CPPP_CRC32C_X86 1
+#elif defined(CPPP_COMPILER_GNU_LIKE)
+#include <nmmintrin.h>
+#define CPPP_CRC32C_X86 1
+#endif
+#elif defined(CPPP_ARCH_ARM64) && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#define CPPP_CRC32C_ARM 1
+#endif
+
+namespace cppp
+{
+    namespace detail
+    {
+        namespace checksum
+        {
+            /* Reflected Castagnoli polynomial. */
+            constexpr std::uint32_t crc32c_poly = 0x82F63B78u;
+
+            /* Bytes per stream in the interleaved loops. */
+            constexpr size_t long_block = 8192;
+            constexpr size_t short_block = 256;
+
+            CPPP_FORCE_INLINE std::uint64_t load64(const unsigned char* p) noexcept
+            {
+                std::uint64_t v;
+                std::memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+                v = __builtin_bswap64(v);
+#endif
+                return v;
+            }
+
+            CPPP_FORCE_INLINE std::uint32_t load32(const unsigned char* p) noexcept
+            {
+                std::uint32_t v;
+                std::memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+                v = __builtin_bswap32(v);
+#endif
+                return v;
+            }
+
+            /* a * b modulo the polynomial, both reflected. */
+            inline std::uint32_t multmodp(std::uint32_t a, std::uint32_t b) noexcept
+            {
+                std::uint32_t m = 1u << 31;
+                std::uint32_t p = 0;
+                for (;;)
+                {
+                    if (a & m)
+                    {
+                        p ^= b;
+                        if ((a & (m - 1)) == 0)
+                        {
+                            break;
+                        }
+                    }
+                    m >>= 1;
+                    b = b & 1 ? (b >> 1) ^ crc32c_poly : b >> 1;
+                }
+                return p;
+            }
+
+            /* x^(8 * n) modulo the polynomial. */
+            inline std::uint32_t x8nmodp(std::uint64_t n) noexcept
+            {
+                std::uint32_t result = 1u << 31;
+                std::uint32_t power = 1u << 23; /* x^8 */
+                while (n != 0)
+                {
+                    if (n & 1)
+                    {
+                        result = multmodp(power, result);
+                    }
+                    n >>= 1;
+                    power = multmodp(power, power);
+                }
+                return result;
+            }
+
+            struct crc32c_tables
+            {
+                /* Slicing-by-8 tables of the software path. */
+                std::uint32_t slice[8][256];
+                /* Advance a CRC register over 'long_block' or 'short_block'
+                   zero bytes, one table per byte of the register. */
+                std::uint32_t shift_long[4][256];
+                std::uint32_t shift_short[4][256];
+
+                crc32c_tables() noexcept
+                {
+                    for (std::uint32_t i = 0; i < 256; ++i)
+                    {
+                        std::uint32_t crc = i;
+                        for (int k = 0; k < 8; ++k)
+                        {
+                            crc = crc & 1 ? (crc >> 1) ^ crc32c_poly : crc >> 1;
+                        }
+                        slice[0][i] = crc;
+                    }
+                    for (std::uint32_t i = 0; i < 256; ++i)
+                    {
+                        for (int k = 1; k < 8; ++k)
+                        {
+                            slice[k][i] = (slice[k - 1][i] >> 8) ^ slice[0][slice[k - 1][i] & 0xFF];
+                        }
+                    }
+                    std::uint32_t long_op = x8nmodp(long_block);
+                    std::uint32_t short_op = x8nmodp(short_block);
+                    for (std::uint32_t i = 0; i < 256; ++i)
+                    {
+                        for (int k = 0; k < 4; ++k)
+                        {
+                            shift_long[k][i] = multmodp(long_op, i << (8 * k));
+                            shift_short[k][i] = multmodp(short_op, i << (8 * k));
+                        }
+                    }
+                }
+            };
+
+            inline const crc32c_tables& tables() noexcept
+            {
+                static const crc32c_tables instance;
+                return instance;
+            }
+
+            CPPP_FORCE_INLINE std::uint32_t shift(const std::uint32_t (&table)[4][256], std::uint32_t crc) noexcept
+            {
+                return table[0][crc & 0xFF] ^ table[1][(crc >> 8) & 0xFF] ^ table[2][(crc >> 16) & 0xFF] ^ table[3][crc >> 24];
+            }
+
+            /* Software CRC on the inverted register. */
+            inline std::uint32_t crc32c_software(std::uint32_t crc, const unsigned char* p, size_t n) noexcept
+            {
+                const crc32c_tables& t = tables();
+                while (n != 0 && (reinterpret_cast<std::uintptr_t>(p) & 7) != 0)
+                {
+                    crc = (crc >> 8) ^ t.slice[0][(crc ^ *p++) & 0xFF];
+                    --n;
+                }
+                while (n >= 8)
+                {
+                    std::uint64_t word = load64(p) ^ crc;
+                    crc = t.slice[7][word & 0xFF] ^ t.slice[6][(word >> 8) & 0xFF] ^ t.slice[5][(word >> 16) & 0xFF] ^
+                          t.slice[4][(word >> 24) & 0xFF] ^ t.slice[3][(word >> 32) & 0xFF] ^
+                          t.slice[2][(word >> 40) & 0xFF] ^ t.slice[1][(word >> 48) & 0xFF] ^ t.slice[0][word >> 56];
+                    p += 8;
+                    n -= 8;
+                }
+                while (n != 0)
+                {
+                    crc = (crc >> 8) ^ t.slice[0][(crc ^ *p++) & 0xFF];
+                    --n;
+                }
+                return crc;
+            }
+
+#if defined(CPPP_CRC32C_X86) || defined(CPPP_CRC32C_ARM)
+#if defined(CPPP_CRC32C_X86) && defined(CPPP_COMPILER_GNU_LIKE)
+#define CPPP_CRC32C_TARGET __attribute__((__target__("sse4.2")))
+#else
+#define CPPP_CRC32C_TARGET
+#endif
+
+            CPPP_CRC32C_TARGET inline std::uint32_t hw_crc8(std::uint32_t crc, unsigned char v) noexcept
+            {
+#if defined(CPPP_CRC32C_X86)
+                return _mm_crc32_u8(crc, v);
+#else
+                return __crc32cb(crc, v);
+#endif
+            }
+
+            CPPP_CRC32C_TARGET inline std::uint32_t hw_crc64(std::uint32_t crc, std::uint64_t v) noexcept
+            {
+#if defined(CPPP_CRC32C_X86) && defined(CPPP_ARCH_X86_64)
+                return static_cast<std::uint32_t>(_mm_crc32_u64(crc, v));
+#elif defined(CPPP_CRC32C_X86)
+                crc = _mm_crc32_u32(crc, static_cast<std::uint32_t>(v));
+                return _mm_crc32_u32(crc, static_cast<std::uint32_t>(v >> 32));
+#else
+                return __crc32cd(crc, v);
+#endif
+            }
+
+            /* Three interleaved streams of 'block' bytes each. */
+            CPPP_CRC32C_TARGET inline std::uint32_t hw_interleaved(std::uint32_t crc, const unsigned char*& p, size_t& n,
+                                                                   size_t block, const std::uint32_t (&table)[4][256]) noexcept
+            {
+                while (n >= 3 * block)
+                {
+                    std::uint32_t crc0 = crc, crc1 = 0, crc2 = 0;
+                    const unsigned char* end = p + block;
+                    do
+                    {
+                        crc0 = hw_crc64(crc0, load64(p));
+                        crc1 = hw_crc64(crc1, load64(p + block));
+                        crc2 = hw_crc64(crc2, load64(p + 2 * block));
+                        p += 8;
+                    } while (p < end);
+                    crc = shift(table, crc0) ^ crc1;
+                    crc = shift(table, crc) ^ crc2;
+                    p += 2 * block;
+                    n -= 3 * block;
+                }
+                return crc;
+            }
+
+            CPPP_CRC32C_TARGET inline std::uint32_t crc32c_hardware(std::uint32_t crc, const unsigned char* p, size_t n) noexcept
+            {
+                while (n != 0 && (reinterpret_cast<std::uintptr_t>(p) & 7) != 0)
+                {
+                    crc = hw_crc8(crc, *p++);
+                    --n;
+                }
+                if (n >= 3 * short_block)
+                {
+                    const crc32c_tables& t = tables();
+                    crc = hw_interleaved(crc, p, n, long_block, t.shift_long);
+                    crc = hw_interleaved(crc, p, n, short_block, t.shift_short);
+                }
+                while (n >= 8)
+                {
+                    crc = hw_crc64(crc, load64(p));
+                    p += 8;
+                    n -= 8;
+                }
+                while (n != 0)
+                {
+                    crc = hw_crc8(crc, *p++);
+                    --n;
+                }
+                return crc;
+            }
+
+#undef CPPP_CRC32C_TARGET
+#endif
+
+            inline bool crc32c_hardware_available() noexcept
+            {
+#if defined(CPPP_CRC32C_ARM)
+                return true;
+#elif defined(CPPP_CRC32C_X86) && defined(CPPP_COMPILER_GNU_LIKE)
+                return __builtin_cpu_supports("sse4.2");
+#elif defined(CPPP_CRC32C_X86)
+                int info[4];
+                __cpuid(info, 1);
+                return (info[2] & (1 << 20)) != 0;
+#else
+                return false;
+#endif
+            }
+
+            using crc32c_function = std::uint32_t (*)(std::uint32_t, const unsigned char*, size_t) noexcept;
+
+            inline crc32c_function crc32c_dispatch() noexcept
+            {
+#if defined(CPPP_CRC32C_X86) || defined(CPPP_CRC32C_ARM)
+                static const crc32c_function selected = crc32c_hardware_available() ? &crc32c_hardware : &crc32c_software;
+#else
+                static const crc32c_function selected = &crc32c_software;
+#endif
+                return selected;
+            }
+
+            constexpr std::uint64_t xxh_p1 = 0x9E3779B185EBCA87ULL;
+            constexpr std::uint64_t xxh_p2 = 0xC2B2AE3D27D4EB4FULL;
+            constexpr std::uint64_t xxh_p3 = 0x165667B19E3779F9ULL;
+            constexpr std::uint64_t xxh_p4 = 0x85EBCA77C2B2AE63ULL;
+            constexpr std::uint64_t xxh_p5 = 0x27D4EB2F165667C5ULL;
+
+            CPPP_FORCE_INLINE std::uint64_t rotl64(std::uint64_t x, unsigned r) noexcept
+            {
+                return (x << r) | (x >> (64 - r));
+            }
+
+            CPPP_FORCE_INLINE std::uint64_t xxh_round(std::uint64_t acc, std::uint64_t input) noexcept
+            {
+                acc += input * xxh_p2;
+                acc = rotl64(acc, 31);
+                return acc * xxh_p1;
+            }
+
+            CPPP_FORCE_INLINE std::uint64_t xxh_merge(std::uint64_t acc, std::uint64_t value) noexcept
+            {
+                acc ^= xxh_round(0, value);
+                return acc * xxh_p1 + xxh_p4;
+            }
+
+            /* Hash the tail (< 32 bytes) and finish. */
+            inline std::uint64_t xxh_finish(std::uint64_t h, const unsigned char* p, size_t n) noexcept
+            {
+                while (n >= 8)
+                {
+                    h ^= xxh_round(0, load64(p));
+                    h = rotl64(h, 27) * xxh_p1 + xxh_p4;
+                    p += 8;
+                    n -= 8;
+                }
+                if (n >= 4)
+                {
+                    h ^= static_cast<std::uint64_t>(load32(p)) * xxh_p1;
+                    h = rotl64(h, 23) * xxh_p2 + xxh_p3;
+                    p += 4;
+                    n -= 4;
+                }
+                while (n != 0)
+                {
+                    h ^= *p++ * xxh_p5;
+                    h = rotl64(h, 11) * xxh_p1;
+                    --n;
+                }
+                h ^= h >> 33;
+                h *= xxh_p2;
+                h ^= h >> 29;
+                h *= xxh_p3;
+                return h ^ (h >> 32);
+            }
+        } // namespace checksum
+    } // namespace detail
+
+    /* CRC-32C (Castagnoli) of 'n' bytes at 'data'.
+       Pass the previous result as 'crc' to continue a checksum over
+       several buffers; start with 0. */
+    inline std::uint32_t crc32c(const void* data, size_t n, std::uint32_t crc = 0) noexcept
+    {
+        return ~detail::checksum::crc32c_dispatch()(~crc, static_cast<const unsigned char*>(data), n);
+    }
+
+    /* CRC-32C of A followed by B, given 'crc1' of A, 'crc2' of B and the
+       length of B.  Lets independent parts of a buffer be checksummed in
+       parallel. */
+    inline std::uint32_t crc32c_combine(std::uint32_t crc1, std::uint32_t crc2, std::uint64_t length2) noexcept
+    {
+        return detail::checksum::multmodp(detail::checksum::x8nmodp(length2), crc1) ^ crc2;
+    }
+
+    /* Name of the CRC-32C implementation in use:
+       "sse4.2", "armv8-crc" or "table". */
+    inline const char* crc32c_implementation() noexcept
+    {
+#if defined(CPPP_CRC32C_X86)
+        return detail::checksum::crc32c_dispatch() == &detail::checksum::crc32c_software ? "table" : "sse4.2";
+#elif defined(CPPP_CRC32C_ARM)
+        return "armv8-crc";
+#else
+        return "table";
+#endif
+    }
+
+    /* XXH64 of 'n' bytes at 'data', compatible with the reference
+       xxHash implementation. */
+    inline std::uint64_t xxhash64(const void* data, size_t n, std::uint64_t seed = 0) noexcept
+    {
+        using namespace detail::checksum;
+        const unsigned char* p = static_cast<const unsigned char*>(data);
+        const unsigned char* end = p + n;
+        std::uint64_t h;
+        if (n >= 32)
+        {
+            std::uint64_t v1 = seed + xxh_p1 + xxh_p2, v2 = seed + xxh_p2, v3 = seed, v4 = seed - xxh_p1;
+            do
+            {
+                v1 = xxh_round(v1, load64(p));
+                v2 = xxh_round(v2, load64(p + 8));
+                v3 = xxh_round(v3, load64(p + 16));
+                v4 = xxh_round(v4, load64(p + 24));
+                p += 32;
+            } while (end - p >= 32);
+            h = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+            h = xxh_merge(h, v1);
+            h = xxh_merge(h, v2);
+            h = xxh_merge(h, v3);
+            h = xxh_merge(h, v4);
+        }
+        else
+        {
+            h = seed + xxh_p5;
+        }
+        h += static_cast<std::uint64_t>(n);
+        return xxh_finish(h, p, static_cast<size_t>(end - p));
+    }
+
+    /* Streaming XXH64, feeding the same bytes in any number of 'update'
+       calls gives the same 'digest' as one 'xxhash64' call. */
+    class xxhash64_state
+    {
+    private:
+        std::uint64_t v[4];
+        std::uint64_t seed;
+        std::uint64_t total = 0;
+        unsigned char buffer[32];
+        size_t buffered = 0;
+
+    public:
+        explicit xxhash64_state(std::uint64_t s = 0) noexcept
+        {
+            reset(s);
+        }
+
+        void reset(std::uint64_t s = 0) noexcept
+        {
+            using namespace detail::checksum;
+            seed = s;
+            v[0] = s + xxh_p1 + xxh_p2;
+            v[1] = s + xxh_p2;
+            v[2] = s;
+            v[3] = s - xxh_p1;
+            total = 0;
+            buffered = 0;
+        }
+
+        void update(const void* data, size_t n) noexcept
+        {
+            using namespace detail::checksum;
+            const unsigned char* p = static_cast<const unsigned char*>(data);
+            total += n;
+            if (buffered + n < 32)
+            {
+                if (n != 0)
+                {
+                    std::memcpy(buffer + buffered, p, n);
+                }
+                buffered += n;
+                return;
+            }
+            if (buffered != 0)
+            {
+                size_t fill = 32 - buffered;
+                std::memcpy(buffer + buffered, p, fill);
+                consume(buffer);
+                p += fill;
+                n -= fill;
+                buffered = 0;
+            }
+            while (n >= 32)
+            {
+                consume(p);
+                p += 32;
+                n -= 32;
+            }
+            if (n != 0)
+            {
+                std::memcpy(buffer, p, n);
+            }
+            buffered = n;
+        }
+
+        std::uint64_t digest() const noexcept
+        {
+            using namespace detail::checksum;
+            std::uint64_t h;
+            if (total >= 32)
+            {
+                h = rotl64(v[0], 1) + rotl64(v[1], 7) + rotl64(v[2], 12) + rotl64(v[3], 18);
+                for (int i = 0; i < 4; ++i)
+                {
+                    h = xxh_merge(h, v[i]);
+                }
+            }
+            else
+            {
+                h = seed + xxh_p5;
+            }
+            h += total;
+            return xxh_finish(h, buffer, buffered);
+        }
+
+    private:
+        void consume(const unsigned char* p) noexcept
+        {
+            using namespace detail::checksum;
+            for (int i = 0; i < 4; ++i)
+            {
+                v[i] = xxh_round(v[i], load64(p + 8 * i));
+            }
+        }
+    };
+} // namespace cppp
+
+#endif
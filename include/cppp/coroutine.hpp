@@ -0,0 +1,1254 @@
+/* Copyright (C) 1999-2023 Free Software Foundation, Inc.
+   This file is part of the cppp-base library.
+
+   The cppp-base library is free software; you can redistribute it
+   and/or modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either version 3
+   of the License, or (at your option) any later version.
+
+   The cppp-base library is distributed in the hope that it will be
+   useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the cppp-base library; see the file COPYING.
+   If not, see <https://www.gnu.org/licenses/>.  */
+
+/* We do not use '#pragma once' because it may has bugs in some compiler. */
+#ifndef _CPPP_COROUTINE_HPP
+#define _CPPP_COROUTINE_HPP
+
+/* C++ Plus coroutine primitives
+
+   'task<T>' is a lazy coroutine. It starts when it is awaited, and when
+   it finishes it transfers control straight back to the awaiting
+   coroutine (symmetric transfer), so long chains of tasks do not grow
+   the stack.
+   'generator<T>' is a synchronous range fed by 'co_yield'.
+   'sync_wait' blocks a normal thread until an awaitable completes, and
+   'when_all' runs several tasks concurrently.
+   An executor is anything with 'execute(std::coroutine_handle<>)'.
+   'co_await schedule_on(e)' moves the current coroutine onto it.
+
+   Coroutine frames are allocated through a 'coroutine_frame_allocator'.
+   By default a per-thread cache recycles frames by size, so a steady
+   stream of coroutines does not reach the global heap.
+
+   Everything here needs C++20 coroutines. Without them the header is
+   empty and 'CPPP_HAVE_COROUTINES' is not defined. */
+
+#include "basedef.hpp"
+
+#if CPPP_CPLUSPLUS >= 202002L && defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#define CPPP_HAVE_COROUTINES 1
+#endif
+#endif
+
+#if defined(CPPP_HAVE_COROUTINES)
+
+#include "thread_pool.hpp"
+
+#include <atomic>
+#include <concepts>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace cppp
+{
+    /* Source of coroutine frame memory, see 'scoped_frame_allocator'.
+       A frame is always returned to the allocator that created it,
+       possibly from another thread. */
+    class coroutine_frame_allocator
+    {
+    public:
+        virtual ~coroutine_frame_allocator() = default;
+        virtual void* allocate(size_t size) = 0;
+        virtual void deallocate(void* p, size_t size) noexcept = 0;
+    };
+
+    namespace detail
+    {
+        namespace coro
+        {
+            /* Recycles frames on the calling thread, in 64-byte size
+               classes up to 2 KiB. Frames may be freed on another thread,
+               in which case they go to that thread's cache. */
+            class frame_cache
+            {
+            private:
+                static constexpr size_t granularity = 64;
+                static constexpr size_t classes = 32;
+                static constexpr size_t max_cached = 64;
+
+                struct free_frame
+                {
+                    free_frame* next;
+                };
+
+                free_frame* lists[classes] = {};
+                size_t counts[classes] = {};
+
+            public:
+                frame_cache() = default;
+                frame_cache(const frame_cache&) = delete;
+                frame_cache& operator=(const frame_cache&) = delete;
+
+                ~frame_cache()
+                {
+                    for (size_t c = 0; c < classes; ++c)
+                    {
+                        while (lists[c] != nullptr)
+                        {
+                            free_frame* f = lists[c];
+                            lists[c] = f->next;
+                            ::operator delete(f);
+                        }
+                    }
+                }
+
+                void* allocate(size_t size)
+                {
+                    size_t c = (size - 1) / granularity;
+                    if (c >= classes)
+                    {
+                        return ::operator new(size);
+                    }
+                    if (free_frame* f = lists[c])
+                    {
+                        lists[c] = f->next;
+                        --counts[c];
+                        return f;
+                    }
+                    return ::operator new((c + 1) * granularity);
+                }
+
+                void deallocate(void* p, size_t size) noexcept
+                {
+                    size_t c = (size - 1) / granularity;
+                    if (c >= classes || counts[c] == max_cached)
+                    {
+                        ::operator delete(p);
+                        return;
+                    }
+                    free_frame* f = static_cast<free_frame*>(p);
+                    f->next = lists[c];
+                    lists[c] = f;
+                    ++counts[c];
+                }
+            };
+
+            inline frame_cache& default_frames() noexcept
+            {
+                static thread_local frame_cache instance;
+                return instance;
+            }
+
+            inline coroutine_frame_allocator*& current_allocator() noexcept
+            {
+                static thread_local coroutine_frame_allocator* instance = nullptr;
+                return instance;
+            }
+
+            /* Stored in front of every frame, null means the default
+               cache. */
+            struct alignas(__STDCPP_DEFAULT_NEW_ALIGNMENT__) frame_header
+            {
+                coroutine_frame_allocator* allocator;
+            };
+
+            /* Base of every promise type in this header. */
+            struct frame_allocation
+            {
+                static void* operator new(size_t size)
+                {
+                    coroutine_frame_allocator* allocator = current_allocator();
+                    size_t total = size + sizeof(frame_header);
+                    void* p = allocator != nullptr ? allocator->allocate(total) : default_frames().allocate(total);
+                    frame_header* header = ::new (p) frame_header{allocator};
+                    return header + 1;
+                }
+
+                static void operator delete(void* p, size_t size) noexcept
+                {
+                    frame_header* header = static_cast<frame_header*>(p) - 1;
+                    size_t total = size + sizeof(frame_header);
+                    if (header->allocator != nullptr)
+                    {
+                        header->allocator->deallocate(header, total);
+                    }
+                    else
+                    {
+                        default_frames().deallocate(header, total);
+                    }
+                }
+            };
+
+            /* A value, a reference, nothing, or an exception. */
+            template<typename T>
+            class result_storage
+            {
+            private:
+                std::optional<T> value;
+                std::exception_ptr error;
+
+            public:
+                template<typename U>
+                void set_value(U&& v)
+                {
+                    value.emplace(std::forward<U>(v));
+                }
+
+                void set_exception(std::exception_ptr e) noexcept
+                {
+                    error = std::move(e);
+                }
+
+                T& get() &
+                {
+                    if (error)
+                    {
+                        std::rethrow_exception(error);
+                    }
+                    return *value;
+                }
+
+                T get() &&
+                {
+                    if (error)
+                    {
+                        std::rethrow_exception(error);
+                    }
+                    return std::move(*value);
+                }
+            };
+
+            template<typename T>
+            class result_storage<T&>
+            {
+            private:
+                T* value = nullptr;
+                std::exception_ptr error;
+
+            public:
+                void set_value(T& v) noexcept
+                {
+                    value = std::addressof(v);
+                }
+
+                void set_exception(std::exception_ptr e) noexcept
+                {
+                    error = std::move(e);
+                }
+
+                T& get() const
+                {
+                    if (error)
+                    {
+                        std::rethrow_exception(error);
+                    }
+                    return *value;
+                }
+            };
+
+            template<>
+            class result_storage<void>
+            {
+            private:
+                std::exception_ptr error;
+
+            public:
+                void set_exception(std::exception_ptr e) noexcept
+                {
+                    error = std::move(e);
+                }
+
+                void get() const
+                {
+                    if (error)
+                    {
+                        std::rethrow_exception(error);
+                    }
+                }
+            };
+
+            /* 'return_value' or 'return_void', a promise may not have both. */
+            template<typename T>
+            struct return_channel : result_storage<T>
+            {
+                template<typename U = T>
+                void return_value(U&& v)
+                {
+                    this->set_value(std::forward<U>(v));
+                }
+
+                void unhandled_exception() noexcept
+                {
+                    this->set_exception(std::current_exception());
+                }
+            };
+
+            template<>
+            struct return_channel<void> : result_storage<void>
+            {
+                void return_void() noexcept
+                {
+                }
+
+                void unhandled_exception() noexcept
+                {
+                    this->set_exception(std::current_exception());
+                }
+            };
+
+            template<typename Awaitable>
+            decltype(auto) get_awaiter(Awaitable&& a)
+            {
+                if constexpr (requires { std::forward<Awaitable>(a).operator co_await(); })
+                {
+                    return std::forward<Awaitable>(a).operator co_await();
+                }
+                else if constexpr (requires { operator co_await(std::forward<Awaitable>(a)); })
+                {
+                    return operator co_await(std::forward<Awaitable>(a));
+                }
+                else
+                {
+                    return std::forward<Awaitable>(a);
+                }
+            }
+
+            template<typename Awaitable>
+            using await_result_t = decltype(get_awaiter(std::declval<Awaitable>()).await_resume());
+
+            /* 'when_all' maps 'void' results to 'std::monostate'. */
+            template<typename T>
+            using non_void_t = std::conditional_t<std::is_void_v<T>, std::monostate, T>;
+        } // namespace coro
+    } // namespace detail
+
+    /* Use 'allocator' for the frames of coroutines created by this thread
+       while the scope is alive. */
+    class scoped_frame_allocator
+    {
+    private:
+        coroutine_frame_allocator* previous;
+
+    public:
+        explicit scoped_frame_allocator(coroutine_frame_allocator& allocator) noexcept
+            : previous(detail::coro::current_allocator())
+        {
+            detail::coro::current_allocator() = &allocator;
+        }
+
+        scoped_frame_allocator(const scoped_frame_allocator&) = delete;
+        scoped_frame_allocator& operator=(const scoped_frame_allocator&) = delete;
+
+        ~scoped_frame_allocator()
+        {
+            detail::coro::current_allocator() = previous;
+        }
+    };
+
+    template<typename T = void>
+    class task;
+
+    namespace detail
+    {
+        namespace coro
+        {
+            template<typename T>
+            struct task_promise : frame_allocation, return_channel<T>
+            {
+                std::coroutine_handle<> continuation;
+
+                struct final_awaiter
+                {
+                    bool await_ready() const noexcept
+                    {
+                        return false;
+                    }
+
+                    std::coroutine_handle<> await_suspend(std::coroutine_handle<task_promise> self) noexcept
+                    {
+                        std::coroutine_handle<> next = self.promise().continuation;
+                        return next ? next : std::noop_coroutine();
+                    }
+
+                    void await_resume() const noexcept
+                    {
+                    }
+                };
+
+                task<T> get_return_object() noexcept;
+
+                std::suspend_always initial_suspend() const noexcept
+                {
+                    return {};
+                }
+
+                final_awaiter final_suspend() const noexcept
+                {
+                    return {};
+                }
+            };
+        } // namespace coro
+    } // namespace detail
+
+    /* Lazy coroutine returning 'T'. It runs when awaited and resumes the
+       awaiting coroutine on the thread where it finished. */
+    template<typename T>
+    class [[nodiscard]] task
+    {
+    public:
+        using promise_type = detail::coro::task_promise<T>;
+        using value_type = T;
+
+    private:
+        std::coroutine_handle<promise_type> handle;
+
+        template<bool Move>
+        struct awaiter
+        {
+            std::coroutine_handle<promise_type> handle;
+
+            bool await_ready() const noexcept
+            {
+                return !handle || handle.done();
+            }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+            {
+                handle.promise().continuation = awaiting;
+                return handle;
+            }
+
+            decltype(auto) await_resume()
+            {
+                if (!handle)
+                {
+                    throw std::logic_error("cppp::task: awaiting an empty task");
+                }
+                if constexpr (Move)
+                {
+                    return std::move(handle.promise()).get();
+                }
+                else
+                {
+                    return handle.promise().get();
+                }
+            }
+        };
+
+    public:
+        task() noexcept = default;
+
+        explicit task(std::coroutine_handle<promise_type> h) noexcept
+            : handle(h)
+        {
+        }
+
+        task(task&& other) noexcept
+            : handle(std::exchange(other.handle, nullptr))
+        {
+        }
+
+        task& operator=(task&& other) noexcept
+        {
+            if (this != &other)
+            {
+                if (handle)
+                {
+                    handle.destroy();
+                }
+                handle = std::exchange(other.handle, nullptr);
+            }
+            return *this;
+        }
+
+        ~task()
+        {
+            if (handle)
+            {
+                handle.destroy();
+            }
+        }
+
+        bool valid() const noexcept
+        {
+            return static_cast<bool>(handle);
+        }
+
+        bool is_ready() const noexcept
+        {
+            return !handle || handle.done();
+        }
+
+        /* Awaiting an lvalue gives a reference to the result, awaiting an
+           rvalue moves the result out. */
+        auto operator co_await() & noexcept
+        {
+            return awaiter<false>{handle};
+        }
+
+        auto operator co_await() && noexcept
+        {
+            return awaiter<true>{handle};
+        }
+    };
+
+    template<typename T>
+    task<T> detail::coro::task_promise<T>::get_return_object() noexcept
+    {
+        return task<T>(std::coroutine_handle<task_promise>::from_promise(*this));
+    }
+
+    /* Synchronous range of the values passed to 'co_yield'. The body runs
+       step by step as the range is iterated. */
+    template<typename T>
+    class [[nodiscard]] generator
+    {
+    public:
+        using value_type = std::remove_cvref_t<T>;
+        using reference = std::conditional_t<std::is_reference_v<T>, T, T&>;
+
+        struct promise_type : detail::coro::frame_allocation
+        {
+            std::add_pointer_t<reference> current = nullptr;
+            std::exception_ptr error;
+
+            generator get_return_object() noexcept
+            {
+                return generator(std::coroutine_handle<promise_type>::from_promise(*this));
+            }
+
+            std::suspend_always initial_suspend() const noexcept
+            {
+                return {};
+            }
+
+            std::suspend_always final_suspend() const noexcept
+            {
+                return {};
+            }
+
+            /* The yielded object lives until the generator is resumed. */
+            std::suspend_always yield_value(std::remove_reference_t<reference>& v) noexcept
+            {
+                current = std::addressof(v);
+                return {};
+            }
+
+            std::suspend_always yield_value(std::remove_reference_t<reference>&& v) noexcept
+            {
+                current = std::addressof(v);
+                return {};
+            }
+
+            void return_void() noexcept
+            {
+            }
+
+            void unhandled_exception() noexcept
+            {
+                error = std::current_exception();
+            }
+
+            /* A generator is synchronous. */
+            template<typename U>
+            std::suspend_never await_transform(U&&) = delete;
+        };
+
+        class iterator
+        {
+        private:
+            std::coroutine_handle<promise_type> handle;
+
+        public:
+            using iterator_category = std::input_iterator_tag;
+            using difference_type = std::ptrdiff_t;
+            using value_type = generator::value_type;
+            using reference = generator::reference;
+            using pointer = std::add_pointer_t<reference>;
+
+            iterator() noexcept = default;
+
+            explicit iterator(std::coroutine_handle<promise_type> h) noexcept
+                : handle(h)
+            {
+            }
+
+            reference operator*() const noexcept
+            {
+                return static_cast<reference>(*handle.promise().current);
+            }
+
+            pointer operator->() const noexcept
+            {
+                return handle.promise().current;
+            }
+
+            iterator& operator++()
+            {
+                advance(handle);
+                return *this;
+            }
+
+            void operator++(int)
+            {
+                ++*this;
+            }
+
+            friend bool operator==(const iterator& it, std::default_sentinel_t) noexcept
+            {
+                return !it.handle || it.handle.done();
+            }
+        };
+
+    private:
+        std::coroutine_handle<promise_type> handle;
+
+        static void advance(std::coroutine_handle<promise_type> h)
+        {
+            h.resume();
+            if (h.done() && h.promise().error)
+            {
+                std::rethrow_exception(std::exchange(h.promise().error, nullptr));
+            }
+        }
+
+    public:
+        generator() noexcept = default;
+
+        explicit generator(std::coroutine_handle<promise_type> h) noexcept
+            : handle(h)
+        {
+        }
+
+        generator(generator&& other) noexcept
+            : handle(std::exchange(other.handle, nullptr))
+        {
+        }
+
+        generator& operator=(generator&& other) noexcept
+        {
+            if (this != &other)
+            {
+                if (handle)
+                {
+                    handle.destroy();
+                }
+                handle = std::exchange(other.handle, nullptr);
+            }
+            return *this;
+        }
+
+        ~generator()
+        {
+            if (handle)
+            {
+                handle.destroy();
+            }
+        }
+
+        /* Starts the body, call it once. */
+        iterator begin()
+        {
+            if (handle)
+            {
+                advance(handle);
+            }
+            return iterator(handle);
+        }
+
+        std::default_sentinel_t end() const noexcept
+        {
+            return {};
+        }
+    };
+
+    /* Executors. */
+
+    template<typename E>
+    concept executor = requires(E& e, std::coroutine_handle<> h) { e.execute(h); };
+
+    /* Resume on the calling thread, right away. */
+    struct inline_executor
+    {
+        void execute(std::coroutine_handle<> h) const
+        {
+            h.resume();
+        }
+    };
+
+    /* Queue of coroutines resumed by whoever calls 'run_one' or 'run',
+       e.g. a game loop or a test. 'execute' may be called from any
+       thread. */
+    class manual_executor
+    {
+    private:
+        std::mutex lock;
+        std::deque<std::coroutine_handle<>> ready;
+
+    public:
+        void execute(std::coroutine_handle<> h)
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            ready.push_back(h);
+        }
+
+        /* Resume one queued coroutine, false when there was none. */
+        bool run_one()
+        {
+            std::coroutine_handle<> h;
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                if (ready.empty())
+                {
+                    return false;
+                }
+                h = ready.front();
+                ready.pop_front();
+            }
+            h.resume();
+            return true;
+        }
+
+        /* Resume coroutines until the queue is empty, including those
+           queued meanwhile, and return how many ran. */
+        size_t run()
+        {
+            size_t count = 0;
+            while (run_one())
+            {
+                ++count;
+            }
+            return count;
+        }
+    };
+
+    /* A dedicated thread that resumes queued coroutines in order, e.g.
+       to own a socket or a non-thread-safe library. The destructor
+       resumes what is still queued and joins the thread. */
+    class thread_executor
+    {
+    private:
+        std::mutex lock;
+        std::condition_variable wake;
+        std::deque<std::coroutine_handle<>> ready;
+        bool stopping = false;
+        std::thread thread;
+
+    public:
+        thread_executor()
+            : thread([this]() { loop(); })
+        {
+        }
+
+        thread_executor(const thread_executor&) = delete;
+        thread_executor& operator=(const thread_executor&) = delete;
+
+        ~thread_executor()
+        {
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                stopping = true;
+            }
+            wake.notify_one();
+            thread.join();
+        }
+
+        void execute(std::coroutine_handle<> h)
+        {
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                ready.push_back(h);
+            }
+            wake.notify_one();
+        }
+
+        std::thread::id get_id() const noexcept
+        {
+            return thread.get_id();
+        }
+
+    private:
+        void loop()
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            for (;;)
+            {
+                wake.wait(guard, [this]() { return stopping || !ready.empty(); });
+                if (ready.empty())
+                {
+                    return;
+                }
+                std::coroutine_handle<> h = ready.front();
+                ready.pop_front();
+                guard.unlock();
+                h.resume();
+                guard.lock();
+            }
+        }
+    };
+
+    /* Resume coroutines as tasks of a 'thread_pool'. */
+    class pool_executor
+    {
+    private:
+        thread_pool* pool;
+
+    public:
+        explicit pool_executor(thread_pool& p) noexcept
+            : pool(&p)
+        {
+        }
+
+        void execute(std::coroutine_handle<> h)
+        {
+            pool->submit([h]() { h.resume(); });
+        }
+    };
+
+    /* 'co_await schedule_on(e)' suspends the coroutine and resumes it on
+       'e'. */
+    template<executor E>
+    auto schedule_on(E& e) noexcept
+    {
+        struct awaiter
+        {
+            E* target;
+
+            bool await_ready() const noexcept
+            {
+                return false;
+            }
+
+            void await_suspend(std::coroutine_handle<> h)
+            {
+                /* The coroutine may run on another thread before this
+                   returns, so do not touch 'this' afterwards. */
+                target->execute(h);
+            }
+
+            void await_resume() const noexcept
+            {
+            }
+        };
+        return awaiter{&e};
+    }
+
+    namespace detail
+    {
+        namespace coro
+        {
+            struct detached
+            {
+                struct promise_type : frame_allocation
+                {
+                    detached get_return_object() const noexcept
+                    {
+                        return {};
+                    }
+
+                    std::suspend_never initial_suspend() const noexcept
+                    {
+                        return {};
+                    }
+
+                    std::suspend_never final_suspend() const noexcept
+                    {
+                        return {};
+                    }
+
+                    void return_void() const noexcept
+                    {
+                    }
+
+                    void unhandled_exception() const noexcept
+                    {
+                        std::terminate();
+                    }
+                };
+            };
+
+            template<typename E>
+            detached spawn_on(E& e, task<void> t)
+            {
+                co_await schedule_on(e);
+                co_await std::move(t);
+            }
+
+            /* Lives on the stack of the thread blocked in 'sync_wait'.
+               The waiter cannot return, and free the coroutine frame,
+               before the finishing thread releases the mutex, and after
+               that the finishing thread touches neither. */
+            struct sync_signal
+            {
+                std::mutex mutex;
+                std::condition_variable done;
+                bool finished = false;
+
+                void set() noexcept
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    finished = true;
+                    done.notify_one();
+                }
+
+                void wait()
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    done.wait(lock, [this] { return finished; });
+                }
+            };
+
+            /* Drives an awaitable for 'sync_wait' and wakes the blocked
+               thread at the end. */
+            template<typename T>
+            class sync_driver
+            {
+            public:
+                struct promise_type : frame_allocation, return_channel<T>
+                {
+                    sync_signal* signal = nullptr;
+
+                    struct final_awaiter
+                    {
+                        bool await_ready() const noexcept
+                        {
+                            return false;
+                        }
+
+                        void await_suspend(std::coroutine_handle<promise_type> self) const noexcept
+                        {
+                            sync_signal* signal = self.promise().signal;
+                            signal->set();
+                        }
+
+                        void await_resume() const noexcept
+                        {
+                        }
+                    };
+
+                    sync_driver get_return_object() noexcept
+                    {
+                        return sync_driver(std::coroutine_handle<promise_type>::from_promise(*this));
+                    }
+
+                    std::suspend_always initial_suspend() const noexcept
+                    {
+                        return {};
+                    }
+
+                    final_awaiter final_suspend() const noexcept
+                    {
+                        return {};
+                    }
+                };
+
+                std::coroutine_handle<promise_type> handle;
+
+                explicit sync_driver(std::coroutine_handle<promise_type> h) noexcept
+                    : handle(h)
+                {
+                }
+
+                sync_driver(const sync_driver&) = delete;
+                sync_driver& operator=(const sync_driver&) = delete;
+
+                ~sync_driver()
+                {
+                    handle.destroy();
+                }
+
+                decltype(auto) run()
+                {
+                    sync_signal signal;
+                    handle.promise().signal = &signal;
+                    handle.resume();
+                    signal.wait();
+                    if constexpr (std::is_reference_v<T> || std::is_void_v<T>)
+                    {
+                        return handle.promise().get();
+                    }
+                    else
+                    {
+                        return std::move(handle.promise()).get();
+                    }
+                }
+            };
+
+            template<typename T, typename Awaitable>
+            sync_driver<T> make_sync_driver(Awaitable&& a)
+            {
+                if constexpr (std::is_void_v<T>)
+                {
+                    co_await std::forward<Awaitable>(a);
+                }
+                else
+                {
+                    co_return co_await std::forward<Awaitable>(a);
+                }
+            }
+
+            /* Shared by the children of one 'when_all', the last child to
+               finish resumes the parent. The extra count held by the
+               parent covers the time it takes to start the children. */
+            struct when_all_latch
+            {
+                std::atomic<size_t> remaining;
+                std::coroutine_handle<> parent;
+
+                explicit when_all_latch(size_t children) noexcept
+                    : remaining(children + 1)
+                {
+                }
+
+                std::coroutine_handle<> arrive() noexcept
+                {
+                    if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                    {
+                        return parent;
+                    }
+                    return std::noop_coroutine();
+                }
+            };
+
+            template<typename T>
+            class when_all_child
+            {
+            public:
+                struct promise_type : frame_allocation, return_channel<T>
+                {
+                    when_all_latch* latch = nullptr;
+
+                    struct final_awaiter
+                    {
+                        bool await_ready() const noexcept
+                        {
+                            return false;
+                        }
+
+                        std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> self) const noexcept
+                        {
+                            return self.promise().latch->arrive();
+                        }
+
+                        void await_resume() const noexcept
+                        {
+                        }
+                    };
+
+                    when_all_child get_return_object() noexcept
+                    {
+                        return when_all_child(std::coroutine_handle<promise_type>::from_promise(*this));
+                    }
+
+                    std::suspend_always initial_suspend() const noexcept
+                    {
+                        return {};
+                    }
+
+                    final_awaiter final_suspend() const noexcept
+                    {
+                        return {};
+                    }
+                };
+
+                std::coroutine_handle<promise_type> handle;
+
+                explicit when_all_child(std::coroutine_handle<promise_type> h) noexcept
+                    : handle(h)
+                {
+                }
+
+                when_all_child(when_all_child&& other) noexcept
+                    : handle(std::exchange(other.handle, nullptr))
+                {
+                }
+
+                when_all_child& operator=(when_all_child&&) = delete;
+
+                ~when_all_child()
+                {
+                    if (handle)
+                    {
+                        handle.destroy();
+                    }
+                }
+
+                void start(when_all_latch& latch) noexcept
+                {
+                    handle.promise().latch = &latch;
+                    handle.resume();
+                }
+
+                non_void_t<T> result()
+                {
+                    if constexpr (std::is_void_v<T>)
+                    {
+                        handle.promise().get();
+                        return std::monostate();
+                    }
+                    else if constexpr (std::is_reference_v<T>)
+                    {
+                        return handle.promise().get();
+                    }
+                    else
+                    {
+                        return std::move(handle.promise()).get();
+                    }
+                }
+            };
+
+            template<typename T>
+            when_all_child<T> make_when_all_child(task<T> t)
+            {
+                if constexpr (std::is_void_v<T>)
+                {
+                    co_await std::move(t);
+                }
+                else
+                {
+                    co_return co_await std::move(t);
+                }
+            }
+
+            /* Start every child, then suspend until the last one is done. */
+            template<typename Children>
+            struct when_all_awaiter
+            {
+                when_all_latch& latch;
+                Children& children;
+
+                bool await_ready() const noexcept
+                {
+                    return false;
+                }
+
+                bool await_suspend(std::coroutine_handle<> parent) noexcept
+                {
+                    latch.parent = parent;
+                    std::apply([this](auto&... child) { (child.start(latch), ...); }, children);
+                    /* Release the parent's count, suspend unless every
+                       child already finished. */
+                    return latch.remaining.fetch_sub(1, std::memory_order_acq_rel) != 1;
+                }
+
+                void await_resume() const noexcept
+                {
+                }
+            };
+
+            template<typename T>
+            struct when_all_awaiter<std::vector<when_all_child<T>>>
+            {
+                when_all_latch& latch;
+                std::vector<when_all_child<T>>& children;
+
+                bool await_ready() const noexcept
+                {
+                    return false;
+                }
+
+                bool await_suspend(std::coroutine_handle<> parent) noexcept
+                {
+                    latch.parent = parent;
+                    for (when_all_child<T>& child : children)
+                    {
+                        child.start(latch);
+                    }
+                    return latch.remaining.fetch_sub(1, std::memory_order_acq_rel) != 1;
+                }
+
+                void await_resume() const noexcept
+                {
+                }
+            };
+        } // namespace coro
+    } // namespace detail
+
+    /* Run 'body' detached: it is resumed on 'e' and nobody awaits it. An
+       exception escaping 'body' calls 'std::terminate'. */
+    template<executor E>
+    void spawn(E& e, task<void> body)
+    {
+        detail::coro::spawn_on(e, std::move(body));
+    }
+
+    /* Block the calling thread until 'awaitable' completes and return its
+       result. Must not be called from a thread that the awaitable needs
+       to make progress (e.g. a 'thread_executor' awaiting itself). */
+    template<typename Awaitable>
+    decltype(auto) sync_wait(Awaitable&& awaitable)
+    {
+        using result_type = detail::coro::await_result_t<Awaitable>;
+        auto driver = detail::coro::make_sync_driver<result_type>(std::forward<Awaitable>(awaitable));
+        if constexpr (std::is_void_v<result_type>)
+        {
+            driver.run();
+        }
+        else
+        {
+            return static_cast<result_type>(driver.run());
+        }
+    }
+
+    /* Run all tasks concurrently and wait for all of them. The result
+       tuple holds 'std::monostate' for 'task<void>'. The tasks run on the
+       thread that awaits 'when_all' until they suspend, so schedule them
+       on an executor to get parallelism. If tasks fail, the exception of
+       the first one in argument order is rethrown. */
+    template<typename... Ts>
+    task<std::tuple<detail::coro::non_void_t<Ts>...>> when_all(task<Ts>... tasks)
+    {
+        std::tuple<detail::coro::when_all_child<Ts>...> children(detail::coro::make_when_all_child(std::move(tasks))...);
+        detail::coro::when_all_latch latch(sizeof...(Ts));
+        co_await detail::coro::when_all_awaiter<decltype(children)>{latch, children};
+        /* A braced list evaluates the results, and so rethrows, in order. */
+        co_return std::apply([](auto&... child) { return std::tuple<detail::coro::non_void_t<Ts>...>{child.result()...}; },
+                             children);
+    }
+
+    /* Vector form, for a number of tasks known at run time. */
+    template<typename T>
+    task<std::vector<detail::coro::non_void_t<T>>> when_all(std::vector<task<T>> tasks)
+    {
+        std::vector<detail::coro::when_all_child<T>> children;
+        children.reserve(tasks.size());
+        for (task<T>& t : tasks)
+        {
+            children.push_back(detail::coro::make_when_all_child(std::move(t)));
+        }
+        detail::coro::when_all_latch latch(children.size());
+        co_await detail::coro::when_all_awaiter<std::vector<detail::coro::when_all_child<T>>>{latch, children};
+        std::vector<detail::coro::non_void_t<T>> results;
+        results.reserve(children.size());
+        for (detail::coro::when_all_child<T>& child : children)
+        {
+            results.push_back(child.result());
+        }
+        co_return results;
+    }
+} // namespace cppp
+
+#endif
+
+#endif
@@ -0,0 +1,169 @@
+/* Copyright (C) 1999-2023 Free Software Foundation, Inc.
+   This file is part of the cppp-base library.
+
+   The cppp-base library is free software; you can redistribute it
+   and/or modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either version 3
+   of the License, or (at your option) any later version.
+
+   The cppp-base library is distributed in the hope that it will be
+   useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the cppp-base library; see the file COPYING.
+   If not, see <https://www.gnu.org/licenses/>.  */
+
+/* We do not use '#pragma once' because it may has bugs in some compiler. */
+#ifndef _CPPP_FLAT_HASH_MAP_HPP
+#define _CPPP_FLAT_HASH_MAP_HPP
+
+/* C++ Plus open addressing hash map */
+
+#include "basedef.hpp"
+#include "swiss_table.hpp"
+
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+
+namespace cppp
+{
+    /* An unordered map storing its elements inline in one flat array,
+       see 'swiss_table.hpp' for the layout.
+
+       Differences from 'std::unordered_map':
+       - Rehashing moves elements, so it invalidates pointers and references
+         to them, not only iterators.
+       - Erasing does not invalidate other iterators and never rehashes.
+       - When both 'Hash' and 'KeyEqual' define 'is_transparent', lookups
+         accept any key type they can handle (e.g. 'std::string_view' for
+         'std::string' keys) without building a temporary key. */
+    template<typename Key, typename T, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>,
+             typename Allocator = std::allocator<std::pair<const Key, T>>>
+    class flat_hash_map : public detail::swiss::raw_table<detail::swiss::map_policy<Key, T>, Hash, KeyEqual, Allocator>
+    {
+    private:
+        using base = detail::swiss::raw_table<detail::swiss::map_policy<Key, T>, Hash, KeyEqual, Allocator>;
+
+        template<typename K>
+        using key_arg = typename base::template key_arg<K>;
+
+    public:
+        using mapped_type = T;
+        using typename base::const_iterator;
+        using typename base::iterator;
+        using typename base::key_type;
+        using typename base::value_type;
+
+        using base::base;
+
+        flat_hash_map() : base()
+        {
+        }
+
+        flat_hash_map(std::initializer_list<value_type> list) : base(list)
+        {
+        }
+
+        template<typename... Args>
+        std::pair<iterator, bool> try_emplace(const key_type& key, Args&&... args)
+        {
+            return this->emplace_key(key, std::piecewise_construct, std::forward_as_tuple(key),
+                                     std::forward_as_tuple(std::forward<Args>(args)...));
+        }
+
+        template<typename... Args>
+        std::pair<iterator, bool> try_emplace(key_type&& key, Args&&... args)
+        {
+            std::pair<size_t, bool> result = this->find_or_prepare_insert(key);
+            if (result.second)
+            {
+                this->construct_at(result.first, std::piecewise_construct, std::forward_as_tuple(std::move(key)),
+                                   std::forward_as_tuple(std::forward<Args>(args)...));
+            }
+            return std::make_pair(this->iterator_at(result.first), result.second);
+        }
+
+        template<typename... Args>
+        iterator try_emplace(const_iterator, const key_type& key, Args&&... args)
+        {
+            return try_emplace(key, std::forward<Args>(args)...).first;
+        }
+
+        template<typename... Args>
+        iterator try_emplace(const_iterator, key_type&& key, Args&&... args)
+        {
+            return try_emplace(std::move(key), std::forward<Args>(args)...).first;
+        }
+
+        template<typename M>
+        std::pair<iterator, bool> insert_or_assign(const key_type& key, M&& value)
+        {
+            std::pair<iterator, bool> result = try_emplace(key, std::forward<M>(value));
+            if (!result.second)
+            {
+                result.first->second = std::forward<M>(value);
+            }
+            return result;
+        }
+
+        template<typename M>
+        std::pair<iterator, bool> insert_or_assign(key_type&& key, M&& value)
+        {
+            std::pair<size_t, bool> result = this->find_or_prepare_insert(key);
+            if (result.second)
+            {
+                this->construct_at(result.first, std::move(key), std::forward<M>(value));
+            }
+            else
+            {
+                this->slot_at(result.first).second = std::forward<M>(value);
+            }
+            return std::make_pair(this->iterator_at(result.first), result.second);
+        }
+
+        T& operator[](const key_type& key)
+        {
+            return try_emplace(key).first->second;
+        }
+
+        T& operator[](key_type&& key)
+        {
+            return try_emplace(std::move(key)).first->second;
+        }
+
+        template<typename K = key_type>
+        T& at(const key_arg<K>& key)
+        {
+            iterator it = this->find(key);
+            if (it == this->end())
+            {
+                throw std::out_of_range("cppp::flat_hash_map::at");
+            }
+            return it->second;
+        }
+
+        template<typename K = key_type>
+        const T& at(const key_arg<K>& key) const
+        {
+            const_iterator it = this->find(key);
+            if (it == this->end())
+            {
+                throw std::out_of_range("cppp::flat_hash_map::at");
+            }
+            return it->second;
+        }
+    };
+
+    template<typename K, typename T, typename H, typename E, typename A>
+    void swap(flat_hash_map<K, T, H, E, A>& lhs, flat_hash_map<K, T, H, E, A>& rhs) noexcept
+    {
+        lhs.swap(rhs);
+    }
+} // namespace cppp
+
+#endif
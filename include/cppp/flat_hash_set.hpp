@@ -0,0 +1,62 @@
+/* Copyright (C) 1999-2023 Free Software Foundation, Inc.
+   This file is part of the cppp-base library.
+
+   The cppp-base library is free software; you can redistribute it
+   and/or modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either version 3
+   of the License, or (at your option) any later version.
+
+   The cppp-base library is distributed in the hope that it will be
+   useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the cppp-base library; see the file COPYING.
+   If not, see <https://www.gnu.org/licenses/>.  */
+
+/* We do not use '#pragma once' because it may has bugs in some compiler. */
+#ifndef _CPPP_FLAT_HASH_SET_HPP
+#define _CPPP_FLAT_HASH_SET_HPP
+
+/* C++ Plus open addressing hash set */
+
+#include "basedef.hpp"
+#include "swiss_table.hpp"
+
+#include <functional>
+#include <memory>
+
+namespace cppp
+{
+    /* An unordered set storing its elements inline in one flat array,
+       see 'flat_hash_map' for the differences from the standard containers. */
+    template<typename Key, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>,
+             typename Allocator = std::allocator<Key>>
+    class flat_hash_set : public detail::swiss::raw_table<detail::swiss::set_policy<Key>, Hash, KeyEqual, Allocator>
+    {
+    private:
+        using base = detail::swiss::raw_table<detail::swiss::set_policy<Key>, Hash, KeyEqual, Allocator>;
+
+    public:
+        using typename base::value_type;
+
+        using base::base;
+
+        flat_hash_set() : base()
+        {
+        }
+
+        flat_hash_set(std::initializer_list<value_type> list) : base(list)
+        {
+        }
+    };
+
+    template<typename K, typename H, typename E, typename A>
+    void swap(flat_hash_set<K, H, E, A>& lhs, flat_hash_set<K, H, E, A>& rhs) noexcept
+    {
+        lhs.swap(rhs);
+    }
+} // namespace cppp
+
+#endif
@@ -0,0 +1,1082 @@
+/* Copyright (C) 1999-2023 Free Software Foundation, Inc.
+   This file is part of the cppp-base library.
+
+   The cppp-base library is free software; you can redistribute it
+   and/or modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either version 3
+   of the License, or (at your option) any later version.
+
+   The cppp-base library is distributed in the hope that it will be
+   useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the cppp-base library; see the file COPYING.
+   If not, see <https://www.gnu.org/licenses/>.  */
+
+/* We do not use '#pragma once' because it may has bugs in some compiler. */
+#ifndef _CPPP_FLAT_MAP_HPP
+#define _CPPP_FLAT_MAP_HPP
+
+/* C++ Plus sorted vector map */
+
+#include "basedef.hpp"
+#include "flat_search.hpp"
+#include "type_traits.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace cppp
+{
+    namespace detail
+    {
+        namespace flat
+        {
+            /* 'operator->' of iterators whose reference is a pair of
+               references made on the fly. */
+            template<typename Reference>
+            struct arrow_proxy
+            {
+                Reference ref;
+
+                Reference* operator->() noexcept
+                {
+                    return &ref;
+                }
+            };
+
+            /* Reverse adaptor forwarding 'operator->' to the adapted
+               iterator.  Some 'std::reverse_iterator' implementations take
+               the address of '*it' instead, which a proxy does not have. */
+            template<typename Iterator>
+            class reverse_iterator
+            {
+            private:
+                Iterator current{};
+
+            public:
+                using iterator_type = Iterator;
+                using iterator_category = typename std::iterator_traits<Iterator>::iterator_category;
+                using value_type = typename std::iterator_traits<Iterator>::value_type;
+                using difference_type = typename std::iterator_traits<Iterator>::difference_type;
+                using reference = typename std::iterator_traits<Iterator>::reference;
+                using pointer = typename std::iterator_traits<Iterator>::pointer;
+
+                reverse_iterator() = default;
+
+                explicit reverse_iterator(Iterator it) : current(it)
+                {
+                }
+
+                template<typename Other, typename = typename std::enable_if<std::is_convertible<Other, Iterator>::value>::type>
+                reverse_iterator(const reverse_iterator<Other>& other) : current(other.base())
+                {
+                }
+
+                Iterator base() const
+                {
+                    return current;
+                }
+
+                reference operator*() const
+                {
+                    Iterator it = current;
+                    return *--it;
+                }
+
+                pointer operator->() const
+                {
+                    Iterator it = current;
+                    --it;
+                    return it.operator->();
+                }
+
+                reference operator[](difference_type n) const
+                {
+                    return current[-n - 1];
+                }
+
+                reverse_iterator& operator++()
+                {
+                    --current;
+                    return *this;
+                }
+
+                reverse_iterator operator++(int)
+                {
+                    reverse_iterator old = *this;
+                    --current;
+                    return old;
+                }
+
+                reverse_iterator& operator--()
+                {
+                    ++current;
+                    return *this;
+                }
+
+                reverse_iterator operator--(int)
+                {
+                    reverse_iterator old = *this;
+                    ++current;
+                    return old;
+                }
+
+                reverse_iterator& operator+=(difference_type n)
+                {
+                    current -= n;
+                    return *this;
+                }
+
+                reverse_iterator& operator-=(difference_type n)
+                {
+                    current += n;
+                    return *this;
+                }
+
+                friend reverse_iterator operator+(reverse_iterator it, difference_type n)
+                {
+                    return it += n;
+                }
+
+                friend reverse_iterator operator+(difference_type n, reverse_iterator it)
+                {
+                    return it += n;
+                }
+
+                friend reverse_iterator operator-(reverse_iterator it, difference_type n)
+                {
+                    return it -= n;
+                }
+
+                friend difference_type operator-(const reverse_iterator& a, const reverse_iterator& b)
+                {
+                    return b.current - a.current;
+                }
+
+                friend bool operator==(const reverse_iterator& a, const reverse_iterator& b)
+                {
+                    return a.current == b.current;
+                }
+
+                friend bool operator!=(const reverse_iterator& a, const reverse_iterator& b)
+                {
+                    return a.current != b.current;
+                }
+
+                friend bool operator<(const reverse_iterator& a, const reverse_iterator& b)
+                {
+                    return b.current < a.current;
+                }
+
+                friend bool operator>(const reverse_iterator& a, const reverse_iterator& b)
+                {
+                    return b.current > a.current;
+                }
+
+                friend bool operator<=(const reverse_iterator& a, const reverse_iterator& b)
+                {
+                    return b.current <= a.current;
+                }
+
+                friend bool operator>=(const reverse_iterator& a, const reverse_iterator& b)
+                {
+                    return b.current >= a.current;
+                }
+            };
+        } // namespace flat
+    } // namespace detail
+
+    /* An ordered map keeping its keys and values sorted in two separate
+       containers, 'std::vector' by default.  Lookups binary search the
+       keys only, so more of them fit in cache, and scans are contiguous;
+       for small to medium tables that are read far more often than they
+       change it beats node based maps on both time and memory.
+
+       Differences from 'std::map':
+       - Inserting or erasing a single element moves all elements after
+         it, O(n).  Insert ranges in bulk: 'insert(first, last)' and
+         'insert_range' sort the new elements and merge them in one pass,
+         O(n + m log m) for m new elements into n.
+       - Inserting and erasing invalidate all iterators, pointers and
+         references.
+       - Iterators dereference to 'std::pair<const Key&, T&>' proxies
+         rather than to references to 'value_type'.
+       - 'keys()', 'values()', 'extract' and 'replace' give access to the
+         underlying containers.
+       - Construction and insertion from 'sorted_unique' input skip the
+         sort.
+
+       Keys and values should have non-throwing moves: when a bulk insert
+       throws, the elements it added are removed, which only restores the
+       map as it was if merging did not move from its elements.
+
+       An 'eytzinger_index' built from 'keys()' is the other search
+       layout for large read-mostly tables, its ranks index the map from
+       'begin()'. */
+    template<typename Key, typename T, typename Compare = std::less<Key>,
+             typename KeyContainer = std::vector<Key>, typename MappedContainer = std::vector<T>>
+    class flat_map
+    {
+    public:
+        using key_type = Key;
+        using mapped_type = T;
+        using value_type = std::pair<Key, T>;
+        using key_compare = Compare;
+        using reference = std::pair<const Key&, T&>;
+        using const_reference = std::pair<const Key&, const T&>;
+        using size_type = size_t;
+        using difference_type = std::ptrdiff_t;
+        using key_container_type = KeyContainer;
+        using mapped_container_type = MappedContainer;
+
+        struct containers
+        {
+            KeyContainer keys;
+            MappedContainer values;
+        };
+
+        template<bool Const>
+        class basic_iterator
+        {
+        private:
+            friend class flat_map;
+
+            using key_iterator = typename KeyContainer::const_iterator;
+            using mapped_iterator = typename std::conditional<Const, typename MappedContainer::const_iterator,
+                                                              typename MappedContainer::iterator>::type;
+
+            key_iterator key_it{};
+            mapped_iterator mapped_it{};
+
+            basic_iterator(key_iterator k, mapped_iterator m) : key_it(k), mapped_it(m)
+            {
+            }
+
+        public:
+            using iterator_category = std::random_access_iterator_tag;
+            using value_type = typename flat_map::value_type;
+            using difference_type = std::ptrdiff_t;
+            using reference = typename std::conditional<Const, const_reference, typename flat_map::reference>::type;
+            using pointer = detail::flat::arrow_proxy<reference>;
+
+            basic_iterator() = default;
+
+            template<bool C = Const, typename = typename std::enable_if<C>::type>
+            basic_iterator(const basic_iterator<false>& other) : key_it(other.key_it), mapped_it(other.mapped_it)
+            {
+            }
+
+            reference operator*() const
+            {
+                return reference(*key_it, *mapped_it);
+            }
+
+            pointer operator->() const
+            {
+                return pointer{**this};
+            }
+
+            reference operator[](difference_type n) const
+            {
+                return reference(key_it[n], mapped_it[n]);
+            }
+
+            basic_iterator& operator++()
+            {
+                ++key_it;
+                ++mapped_it;
+                return *this;
+            }
+
+            basic_iterator operator++(int)
+            {
+                basic_iterator old = *this;
+                ++*this;
+                return old;
+            }
+
+            basic_iterator& operator--()
+            {
+                --key_it;
+                --mapped_it;
+                return *this;
+            }
+
+            basic_iterator operator--(int)
+            {
+                basic_iterator old = *this;
+                --*this;
+                return old;
+            }
+
+            basic_iterator& operator+=(difference_type n)
+            {
+                key_it += n;
+                mapped_it += n;
+                return *this;
+            }
+
+            basic_iterator& operator-=(difference_type n)
+            {
+                key_it -= n;
+                mapped_it -= n;
+                return *this;
+            }
+
+            friend basic_iterator operator+(basic_iterator it, difference_type n)
+            {
+                return it += n;
+            }
+
+            friend basic_iterator operator+(difference_type n, basic_iterator it)
+            {
+                return it += n;
+            }
+
+            friend basic_iterator operator-(basic_iterator it, difference_type n)
+            {
+                return it -= n;
+            }
+
+            friend difference_type operator-(const basic_iterator& a, const basic_iterator& b)
+            {
+                return a.key_it - b.key_it;
+            }
+
+            friend bool operator==(const basic_iterator& a, const basic_iterator& b)
+            {
+                return a.key_it == b.key_it;
+            }
+
+            friend bool operator!=(const basic_iterator& a, const basic_iterator& b)
+            {
+                return a.key_it != b.key_it;
+            }
+
+            friend bool operator<(const basic_iterator& a, const basic_iterator& b)
+            {
+                return a.key_it < b.key_it;
+            }
+
+            friend bool operator>(const basic_iterator& a, const basic_iterator& b)
+            {
+                return a.key_it > b.key_it;
+            }
+
+            friend bool operator<=(const basic_iterator& a, const basic_iterator& b)
+            {
+                return a.key_it <= b.key_it;
+            }
+
+            friend bool operator>=(const basic_iterator& a, const basic_iterator& b)
+            {
+                return a.key_it >= b.key_it;
+            }
+
+            template<bool>
+            friend class basic_iterator;
+        };
+
+        using iterator = basic_iterator<false>;
+        using const_iterator = basic_iterator<true>;
+        using reverse_iterator = detail::flat::reverse_iterator<iterator>;
+        using const_reverse_iterator = detail::flat::reverse_iterator<const_iterator>;
+
+    private:
+        containers c;
+        Compare comp;
+
+        static constexpr bool transparent = detail::is_transparent_helper<Compare>::value;
+
+        /* Lookup key type, any type with a transparent comparator. */
+        template<typename K>
+        using key_arg = typename detail::key_arg_helper<transparent>::template type<K, Key>;
+
+    public:
+        flat_map() : flat_map(Compare())
+        {
+        }
+
+        explicit flat_map(const Compare& cmp) : c(), comp(cmp)
+        {
+        }
+
+        /* Sorts the elements, keeping the first of equivalent keys. */
+        flat_map(key_container_type keys, mapped_container_type values, const Compare& cmp = Compare())
+            : c{std::move(keys), std::move(values)}, comp(cmp)
+        {
+            check_sizes();
+            merge_tail(0, false);
+        }
+
+        flat_map(sorted_unique_t, key_container_type keys, mapped_container_type values,
+                 const Compare& cmp = Compare())
+            : c{std::move(keys), std::move(values)}, comp(cmp)
+        {
+            check_sizes();
+        }
+
+        template<typename InputIt>
+        flat_map(InputIt from, InputIt to, const Compare& cmp = Compare()) : c(), comp(cmp)
+        {
+            insert(from, to);
+        }
+
+        template<typename InputIt>
+        flat_map(sorted_unique_t, InputIt from, InputIt to, const Compare& cmp = Compare()) : c(), comp(cmp)
+        {
+            insert(sorted_unique, from, to);
+        }
+
+        flat_map(std::initializer_list<value_type> list, const Compare& cmp = Compare())
+            : flat_map(list.begin(), list.end(), cmp)
+        {
+        }
+
+        flat_map(sorted_unique_t, std::initializer_list<value_type> list, const Compare& cmp = Compare())
+            : flat_map(sorted_unique, list.begin(), list.end(), cmp)
+        {
+        }
+
+        flat_map& operator=(std::initializer_list<value_type> list)
+        {
+            clear();
+            insert(list);
+            return *this;
+        }
+
+        /* Iterators */
+
+        iterator begin() noexcept
+        {
+            return iterator(c.keys.cbegin(), c.values.begin());
+        }
+
+        const_iterator begin() const noexcept
+        {
+            return const_iterator(c.keys.cbegin(), c.values.cbegin());
+        }
+
+        const_iterator cbegin() const noexcept
+        {
+            return begin();
+        }
+
+        iterator end() noexcept
+        {
+            return iterator(c.keys.cend(), c.values.end());
+        }
+
+        const_iterator end() const noexcept
+        {
+            return const_iterator(c.keys.cend(), c.values.cend());
+        }
+
+        const_iterator cend() const noexcept
+        {
+            return end();
+        }
+
+        reverse_iterator rbegin() noexcept
+        {
+            return reverse_iterator(end());
+        }
+
+        const_reverse_iterator rbegin() const noexcept
+        {
+            return const_reverse_iterator(end());
+        }
+
+        const_reverse_iterator crbegin() const noexcept
+        {
+            return rbegin();
+        }
+
+        reverse_iterator rend() noexcept
+        {
+            return reverse_iterator(begin());
+        }
+
+        const_reverse_iterator rend() const noexcept
+        {
+            return const_reverse_iterator(begin());
+        }
+
+        const_reverse_iterator crend() const noexcept
+        {
+            return rend();
+        }
+
+        /* Capacity */
+
+        bool empty() const noexcept
+        {
+            return c.keys.empty();
+        }
+
+        size_type size() const noexcept
+        {
+            return c.keys.size();
+        }
+
+        size_type max_size() const noexcept
+        {
+            return (std::min)(c.keys.max_size(), c.values.max_size());
+        }
+
+        void reserve(size_type n)
+        {
+            detail::flat::reserve(c.keys, n, 0);
+            detail::flat::reserve(c.values, n, 0);
+        }
+
+        /* Element access */
+
+        T& operator[](const key_type& key)
+        {
+            return try_emplace(key).first->second;
+        }
+
+        T& operator[](key_type&& key)
+        {
+            return try_emplace(std::move(key)).first->second;
+        }
+
+        template<typename K = key_type>
+        T& at(const key_arg<K>& key)
+        {
+            size_t pos = find_index(key);
+            if (pos == size())
+            {
+                throw std::out_of_range("cppp::flat_map::at");
+            }
+            return c.values[pos];
+        }
+
+        template<typename K = key_type>
+        const T& at(const key_arg<K>& key) const
+        {
+            size_t pos = find_index(key);
+            if (pos == size())
+            {
+                throw std::out_of_range("cppp::flat_map::at");
+            }
+            return c.values[pos];
+        }
+
+        /* Modifiers */
+
+        /* Construct the value first to learn its key. */
+        template<typename... Args>
+        std::pair<iterator, bool> emplace(Args&&... args)
+        {
+            value_type temp(std::forward<Args>(args)...);
+            return try_emplace(std::move(temp.first), std::move(temp.second));
+        }
+
+        template<typename... Args>
+        iterator emplace_hint(const_iterator hint, Args&&... args)
+        {
+            value_type temp(std::forward<Args>(args)...);
+            return try_emplace(hint, std::move(temp.first), std::move(temp.second));
+        }
+
+        std::pair<iterator, bool> insert(const value_type& value)
+        {
+            return try_emplace(value.first, value.second);
+        }
+
+        std::pair<iterator, bool> insert(value_type&& value)
+        {
+            return try_emplace(std::move(value.first), std::move(value.second));
+        }
+
+        iterator insert(const_iterator hint, const value_type& value)
+        {
+            return try_emplace(hint, value.first, value.second);
+        }
+
+        iterator insert(const_iterator hint, value_type&& value)
+        {
+            return try_emplace(hint, std::move(value.first), std::move(value.second));
+        }
+
+        /* Appends the elements, then sorts and merges them in one pass.
+           Of equivalent keys the one already present, else the first
+           one inserted, is kept. */
+        template<typename InputIt>
+        void insert(InputIt from, InputIt to)
+        {
+            insert_tail(from, to, false);
+        }
+
+        /* Skips the sort. */
+        template<typename InputIt>
+        void insert(sorted_unique_t, InputIt from, InputIt to)
+        {
+            insert_tail(from, to, true);
+        }
+
+        void insert(std::initializer_list<value_type> list)
+        {
+            insert(list.begin(), list.end());
+        }
+
+        void insert(sorted_unique_t, std::initializer_list<value_type> list)
+        {
+            insert(sorted_unique, list.begin(), list.end());
+        }
+
+        template<typename Range>
+        void insert_range(Range&& range)
+        {
+            using std::begin;
+            using std::end;
+            insert(begin(range), end(range));
+        }
+
+        template<typename Range>
+        void insert_range(sorted_unique_t, Range&& range)
+        {
+            using std::begin;
+            using std::end;
+            insert(sorted_unique, begin(range), end(range));
+        }
+
+        template<typename... Args>
+        std::pair<iterator, bool> try_emplace(const key_type& key, Args&&... args)
+        {
+            std::pair<size_t, bool> pos = locate(size(), key);
+            if (!pos.second)
+            {
+                return std::pair<iterator, bool>(nth(pos.first), false);
+            }
+            return std::pair<iterator, bool>(insert_at(pos.first, key, std::forward<Args>(args)...), true);
+        }
+
+        /* The key is moved only once it is known to be new. */
+        template<typename... Args>
+        std::pair<iterator, bool> try_emplace(key_type&& key, Args&&... args)
+        {
+            std::pair<size_t, bool> pos = locate(size(), key);
+            if (!pos.second)
+            {
+                return std::pair<iterator, bool>(nth(pos.first), false);
+            }
+            return std::pair<iterator, bool>(insert_at(pos.first, std::move(key), std::forward<Args>(args)...), true);
+        }
+
+        /* A correct hint saves the search. */
+        template<typename... Args>
+        iterator try_emplace(const_iterator hint, const key_type& key, Args&&... args)
+        {
+            std::pair<size_t, bool> pos = locate(static_cast<size_t>(hint - cbegin()), key);
+            return pos.second ? insert_at(pos.first, key, std::forward<Args>(args)...) : nth(pos.first);
+        }
+
+        template<typename... Args>
+        iterator try_emplace(const_iterator hint, key_type&& key, Args&&... args)
+        {
+            std::pair<size_t, bool> pos = locate(static_cast<size_t>(hint - cbegin()), key);
+            return pos.second ? insert_at(pos.first, std::move(key), std::forward<Args>(args)...) : nth(pos.first);
+        }
+
+        template<typename M>
+        std::pair<iterator, bool> insert_or_assign(const key_type& key, M&& value)
+        {
+            std::pair<iterator, bool> result = try_emplace(key, std::forward<M>(value));
+            if (!result.second)
+            {
+                result.first->second = std::forward<M>(value);
+            }
+            return result;
+        }
+
+        template<typename M>
+        std::pair<iterator, bool> insert_or_assign(key_type&& key, M&& value)
+        {
+            std::pair<iterator, bool> result = try_emplace(std::move(key), std::forward<M>(value));
+            if (!result.second)
+            {
+                result.first->second = std::forward<M>(value);
+            }
+            return result;
+        }
+
+        template<typename M>
+        iterator insert_or_assign(const_iterator hint, const key_type& key, M&& value)
+        {
+            std::pair<size_t, bool> pos = locate(static_cast<size_t>(hint - cbegin()), key);
+            if (pos.second)
+            {
+                return insert_at(pos.first, key, std::forward<M>(value));
+            }
+            c.values[pos.first] = std::forward<M>(value);
+            return nth(pos.first);
+        }
+
+        template<typename M>
+        iterator insert_or_assign(const_iterator hint, key_type&& key, M&& value)
+        {
+            std::pair<size_t, bool> pos = locate(static_cast<size_t>(hint - cbegin()), key);
+            if (pos.second)
+            {
+                return insert_at(pos.first, std::move(key), std::forward<M>(value));
+            }
+            c.values[pos.first] = std::forward<M>(value);
+            return nth(pos.first);
+        }
+
+        iterator erase(iterator pos)
+        {
+            return erase(const_iterator(pos));
+        }
+
+        iterator erase(const_iterator pos)
+        {
+            size_t index = static_cast<size_t>(pos - cbegin());
+            c.keys.erase(c.keys.begin() + index);
+            c.values.erase(c.values.begin() + index);
+            return nth(index);
+        }
+
+        iterator erase(const_iterator from, const_iterator to)
+        {
+            size_t first = static_cast<size_t>(from - cbegin());
+            size_t last = static_cast<size_t>(to - cbegin());
+            c.keys.erase(c.keys.begin() + first, c.keys.begin() + last);
+            c.values.erase(c.values.begin() + first, c.values.begin() + last);
+            return nth(first);
+        }
+
+        template<typename K = key_type>
+        size_type erase(const key_arg<K>& key)
+        {
+            size_t pos = find_index(key);
+            if (pos == size())
+            {
+                return 0;
+            }
+            erase(nth(pos));
+            return 1;
+        }
+
+        /* Moves the containers out, leaving the map empty. */
+        containers extract() &&
+        {
+            containers result{std::move(c.keys), std::move(c.values)};
+            clear();
+            return result;
+        }
+
+        /* Takes over containers already sorted and free of equivalent
+           keys. */
+        void replace(key_container_type&& keys, mapped_container_type&& values)
+        {
+            if (keys.size() != values.size())
+            {
+                throw std::invalid_argument("cppp::flat_map::replace");
+            }
+            c.keys = std::move(keys);
+            c.values = std::move(values);
+        }
+
+        void swap(flat_map& other) noexcept
+        {
+            using std::swap;
+            swap(c.keys, other.c.keys);
+            swap(c.values, other.c.values);
+            swap(comp, other.comp);
+        }
+
+        void clear() noexcept
+        {
+            c.keys.clear();
+            c.values.clear();
+        }
+
+        /* Observers */
+
+        key_compare key_comp() const
+        {
+            return comp;
+        }
+
+        const key_container_type& keys() const noexcept
+        {
+            return c.keys;
+        }
+
+        const mapped_container_type& values() const noexcept
+        {
+            return c.values;
+        }
+
+        /* Lookup */
+
+        template<typename K = key_type>
+        iterator find(const key_arg<K>& key)
+        {
+            return nth(find_index(key));
+        }
+
+        template<typename K = key_type>
+        const_iterator find(const key_arg<K>& key) const
+        {
+            return begin() + static_cast<difference_type>(find_index(key));
+        }
+
+        template<typename K = key_type>
+        bool contains(const key_arg<K>& key) const
+        {
+            return find_index(key) != size();
+        }
+
+        template<typename K = key_type>
+        size_type count(const key_arg<K>& key) const
+        {
+            return contains(key) ? 1 : 0;
+        }
+
+        template<typename K = key_type>
+        iterator lower_bound(const key_arg<K>& key)
+        {
+            return nth(bound<false>(key));
+        }
+
+        template<typename K = key_type>
+        const_iterator lower_bound(const key_arg<K>& key) const
+        {
+            return begin() + static_cast<difference_type>(bound<false>(key));
+        }
+
+        template<typename K = key_type>
+        iterator upper_bound(const key_arg<K>& key)
+        {
+            return nth(bound<true>(key));
+        }
+
+        template<typename K = key_type>
+        const_iterator upper_bound(const key_arg<K>& key) const
+        {
+            return begin() + static_cast<difference_type>(bound<true>(key));
+        }
+
+        template<typename K = key_type>
+        std::pair<iterator, iterator> equal_range(const key_arg<K>& key)
+        {
+            size_t pos = bound<false>(key);
+            size_t last = pos != size() && !comp(key, c.keys[pos]) ? pos + 1 : pos;
+            return std::pair<iterator, iterator>(nth(pos), nth(last));
+        }
+
+        template<typename K = key_type>
+        std::pair<const_iterator, const_iterator> equal_range(const key_arg<K>& key) const
+        {
+            std::pair<iterator, iterator> range = const_cast<flat_map*>(this)->equal_range(key);
+            return std::pair<const_iterator, const_iterator>(range.first, range.second);
+        }
+
+        friend bool operator==(const flat_map& a, const flat_map& b)
+        {
+            return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin());
+        }
+
+        friend bool operator!=(const flat_map& a, const flat_map& b)
+        {
+            return !(a == b);
+        }
+
+        friend bool operator<(const flat_map& a, const flat_map& b)
+        {
+            return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end());
+        }
+
+        friend bool operator>(const flat_map& a, const flat_map& b)
+        {
+            return b < a;
+        }
+
+        friend bool operator<=(const flat_map& a, const flat_map& b)
+        {
+            return !(b < a);
+        }
+
+        friend bool operator>=(const flat_map& a, const flat_map& b)
+        {
+            return !(a < b);
+        }
+
+    private:
+        iterator nth(size_t pos) noexcept
+        {
+            return begin() + static_cast<difference_type>(pos);
+        }
+
+        void check_sizes() const
+        {
+            if (c.keys.size() != c.values.size())
+            {
+                throw std::invalid_argument("cppp::flat_map");
+            }
+        }
+
+        template<bool Upper, typename K>
+        size_t bound(const K& key) const
+        {
+            return detail::flat::bound<Upper>(c.keys.begin(), c.keys.size(), key, comp);
+        }
+
+        /* Index of 'key', 'size()' when absent. */
+        template<typename K>
+        size_t find_index(const K& key) const
+        {
+            size_t pos = bound<false>(key);
+            return pos != size() && comp(key, c.keys[pos]) ? size() : pos;
+        }
+
+        /* Where 'key' is or would go, and whether it is absent.  'hint'
+           is tried first. */
+        std::pair<size_t, bool> locate(size_t hint, const key_type& key) const
+        {
+            size_t n = size();
+            if ((hint == n || comp(key, c.keys[hint])) && (hint == 0 || comp(c.keys[hint - 1], key)))
+            {
+                return std::pair<size_t, bool>(hint, true);
+            }
+            size_t pos = bound<false>(key);
+            return std::pair<size_t, bool>(pos, pos == n || comp(key, c.keys[pos]));
+        }
+
+        template<typename KeyArg, typename... Args>
+        iterator insert_at(size_t pos, KeyArg&& key, Args&&... args)
+        {
+            c.keys.emplace(c.keys.begin() + pos, std::forward<KeyArg>(key));
+            try
+            {
+                c.values.emplace(c.values.begin() + pos, std::forward<Args>(args)...);
+            }
+            catch (...)
+            {
+                c.keys.erase(c.keys.begin() + pos);
+                throw;
+            }
+            return nth(pos);
+        }
+
+        template<typename InputIt>
+        void insert_tail(InputIt from, InputIt to, bool sorted)
+        {
+            size_t old = size();
+            try
+            {
+                for (; from != to; ++from)
+                {
+                    append(*from);
+                }
+                merge_tail(old, sorted);
+            }
+            catch (...)
+            {
+                c.keys.erase(c.keys.begin() + old, c.keys.end());
+                c.values.erase(c.values.begin() + old, c.values.end());
+                throw;
+            }
+        }
+
+        template<typename Element>
+        void append(Element&& element)
+        {
+            c.keys.push_back(std::forward<Element>(element).first);
+            c.values.push_back(std::forward<Element>(element).second);
+        }
+
+        /* Sorts the elements from 'old' on, unless 'sorted', and merges
+           them with those before, dropping keys already present or
+           repeated.  The two containers are sorted together through a
+           permutation of the new elements, then merged into new
+           containers. */
+        void merge_tail(size_t old, bool sorted)
+        {
+            size_t n = size();
+            typename KeyContainer::iterator keys = c.keys.begin();
+            typename MappedContainer::iterator values = c.values.begin();
+
+            /* Appending increasing keys needs no merge. */
+            size_t i = old == 0 ? old + 1 : old;
+            while (i < n && comp(keys[i - 1], keys[i]))
+            {
+                ++i;
+            }
+            if (i >= n)
+            {
+                return;
+            }
+
+            std::vector<size_t> order(n - old);
+            for (size_t j = 0; j < order.size(); ++j)
+            {
+                order[j] = old + j;
+            }
+            if (!sorted)
+            {
+                /* Stable, the first of equivalent new keys is kept. */
+                std::stable_sort(order.begin(), order.end(),
+                                 [&](size_t a, size_t b) { return comp(keys[a], keys[b]); });
+            }
+
+            containers merged;
+            detail::flat::reserve(merged.keys, n, 0);
+            detail::flat::reserve(merged.values, n, 0);
+            i = 0;
+            for (size_t j = 0; j < order.size();)
+            {
+                size_t k = order[j];
+                size_t next = j + 1;
+                while (next < order.size() && !comp(keys[k], keys[order[next]]))
+                {
+                    ++next;
+                }
+                for (; i < old && comp(keys[i], keys[k]); ++i)
+                {
+                    merged.keys.push_back(std::move_if_noexcept(keys[i]));
+                    merged.values.push_back(std::move_if_noexcept(values[i]));
+                }
+                if (i == old || comp(keys[k], keys[i]))
+                {
+                    merged.keys.push_back(std::move_if_noexcept(keys[k]));
+                    merged.values.push_back(std::move_if_noexcept(values[k]));
+                }
+                j = next;
+            }
+            for (; i < old; ++i)
+            {
+                merged.keys.push_back(std::move_if_noexcept(keys[i]));
+                merged.values.push_back(std::move_if_noexcept(values[i]));
+            }
+            c.keys = std::move(merged.keys);
+            c.values = std::move(merged.values);
+        }
+    };
+
+    template<typename K, typename T, typename C, typename KC, typename MC>
+    constexpr bool flat_map<K, T, C, KC, MC>::transparent;
+
+    template<typename K, typename T, typename C, typename KC, typename MC>
+    void swap(flat_map<K, T, C, KC, MC>& lhs, flat_map<K, T, C, KC, MC>& rhs) noexcept
+    {
+        lhs.swap(rhs);
+    }
+} // namespace cppp
+
+#endif
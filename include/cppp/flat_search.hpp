@@ -0,0 +1,250 @@
+/* Copyright (C) 1999-2023 Free Software Foundation, Inc.
+   This file is part of the cppp-base library.
+
+   The cppp-base library is free software; you can redistribute it
+   and/or modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either version 3
+   of the License, or (at your option) any later version.
+
+   The cppp-base library is distributed in the hope that it will be
+   useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the cppp-base library; see the file COPYING.
+   If not, see <https://www.gnu.org/licenses/>.  */
+
+/* We do not use '#pragma once' because it may has bugs in some compiler. */
+#ifndef _CPPP_FLAT_SEARCH_HPP
+#define _CPPP_FLAT_SEARCH_HPP
+
+/* C++ Plus sorted array search */
+
+#include "basedef.hpp"
+#include "bits.hpp"
+#include "hardware.hpp"
+#include "type_traits.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace cppp
+{
+    namespace detail
+    {
+        namespace flat
+        {
+            /* Offset of the first element of sorted '[first, first + n)'
+               not below 'key' (above it when 'Upper').
+
+               The loop halves the range without branching on compares,
+               the compiler emits a conditional move, and prefetches both
+               possible middles of the next step: searches of large arrays
+               wait on memory rather than on mispredictions. */
+            template<bool Upper, typename RandomIt, typename K, typename Compare>
+            CPPP_FORCE_INLINE size_t bound(RandomIt first, size_t n, const K& key, const Compare& comp)
+            {
+                if (n == 0)
+                {
+                    return 0;
+                }
+                RandomIt base = first;
+                while (n > 1)
+                {
+                    size_t half = n / 2;
+                    CPPP_PREFETCH(std::addressof(base[half / 2]));
+                    CPPP_PREFETCH(std::addressof(base[half + half / 2]));
+                    bool below = Upper ? !comp(key, base[half]) : static_cast<bool>(comp(base[half], key));
+                    base = below ? base + half : base;
+                    n -= half;
+                }
+                bool below = Upper ? !comp(key, *base) : static_cast<bool>(comp(*base, key));
+                return static_cast<size_t>(base - first) + (below ? 1 : 0);
+            }
+
+            /* Call 'reserve' on containers that have it. */
+            template<typename Container>
+            auto reserve(Container& c, size_t n, int) -> decltype(c.reserve(n), void())
+            {
+                c.reserve(n);
+            }
+
+            template<typename Container>
+            void reserve(Container&, size_t, long)
+            {
+            }
+        } // namespace flat
+    } // namespace detail
+
+    /* A read-only search index over a sorted sequence, its keys stored in
+       Eytzinger (breadth-first) order: node 'k' has children '2k' and
+       '2k + 1'.  The top levels share a few cache lines, and as the
+       descendants of a node a few levels down are contiguous each step
+       prefetches the cache line of the level it will reach next.
+
+       Lookups return ranks in the sorted sequence, e.g. an index into the
+       'flat_map' or array the index was built from.  The index holds a
+       copy of the keys and does not follow later changes. */
+    template<typename Key, typename Compare = std::less<Key>>
+    class eytzinger_index
+    {
+    public:
+        using key_type = Key;
+        using key_compare = Compare;
+        using size_type = size_t;
+
+        static constexpr size_type npos = size_type(-1);
+
+    private:
+        /* Slot 0 is unused, it keeps the arithmetic 1-based. */
+        std::vector<Key> keys;
+        size_t count = 0;
+        Compare comp;
+
+        /* Descendants 'log2(fanout)' levels down fill a cache line. */
+        static constexpr size_t fanout = sizeof(Key) >= cache_line_size ? 1
+                                         : sizeof(Key) * 2 > cache_line_size ? 2
+                                         : sizeof(Key) * 4 > cache_line_size ? 4
+                                         : sizeof(Key) * 8 > cache_line_size ? 8 : 16;
+
+        static constexpr bool transparent = detail::is_transparent_helper<Compare>::value;
+
+        template<typename K>
+        using key_arg = typename detail::key_arg_helper<transparent>::template type<K, Key>;
+
+        template<typename It>
+        void fill(It& it, size_t node)
+        {
+            /* In-order over the implicit tree gives the sorted order. */
+            if (node > count)
+            {
+                return;
+            }
+            fill(it, 2 * node);
+            keys[node] = *it;
+            ++it;
+            fill(it, 2 * node + 1);
+        }
+
+        /* Node of the first key not below 'key' (above it when 'Upper'),
+           0 when there is none. */
+        template<bool Upper, typename K>
+        size_t search(const K& key) const
+        {
+            const Key* data = keys.data();
+            size_t node = 1;
+            while (node <= count)
+            {
+                if (fanout * node <= count)
+                {
+                    CPPP_PREFETCH(data + fanout * node);
+                }
+                bool below = Upper ? !comp(key, data[node]) : static_cast<bool>(comp(data[node], key));
+                node = 2 * node + (below ? 1 : 0);
+            }
+            /* Undo the right turns after the last left turn. */
+            return node >> (countr_zero(~static_cast<std::uint64_t>(node)) + 1);
+        }
+
+        /* The in-order position of 'node', without a table: its position
+           in the perfect tree of the same height, less the missing leaves
+           of the last level before it. */
+        size_t rank(size_t node) const noexcept
+        {
+            unsigned height = log2_floor(count) + 1;
+            unsigned depth = log2_floor(node);
+            size_t perfect = ((2 * (node - (size_t(1) << depth)) + 1) << (height - 1 - depth)) - 1;
+            size_t leaves = count - ((size_t(1) << (height - 1)) - 1);
+            size_t leaves_before = (perfect + 1) / 2;
+            return leaves_before > leaves ? perfect - (leaves_before - leaves) : perfect;
+        }
+
+    public:
+        eytzinger_index() = default;
+
+        /* From sorted '[from, to)', duplicates allowed. */
+        template<typename ForwardIt>
+        eytzinger_index(ForwardIt from, ForwardIt to, const Compare& cmp = Compare()) : comp(cmp)
+        {
+            assign(from, to);
+        }
+
+        template<typename ForwardIt>
+        void assign(ForwardIt from, ForwardIt to)
+        {
+            size_t n = static_cast<size_t>(std::distance(from, to));
+            keys.clear();
+            count = 0;
+            if (n == 0)
+            {
+                return;
+            }
+            keys.assign(n + 1, *from);
+            count = n;
+            fill(from, 1);
+        }
+
+        size_type size() const noexcept
+        {
+            return count;
+        }
+
+        bool empty() const noexcept
+        {
+            return count == 0;
+        }
+
+        /* Rank of the first key not below 'key', 'size()' when none. */
+        template<typename K = Key>
+        size_type lower_bound(const key_arg<K>& key) const
+        {
+            size_t node = search<false>(key);
+            return node == 0 ? count : rank(node);
+        }
+
+        /* Rank of the first key above 'key', 'size()' when none. */
+        template<typename K = Key>
+        size_type upper_bound(const key_arg<K>& key) const
+        {
+            size_t node = search<true>(key);
+            return node == 0 ? count : rank(node);
+        }
+
+        /* Rank of a key equivalent to 'key', 'npos' when none. */
+        template<typename K = Key>
+        size_type find(const key_arg<K>& key) const
+        {
+            size_t node = search<false>(key);
+            return node == 0 || comp(key, keys[node]) ? npos : rank(node);
+        }
+
+        template<typename K = Key>
+        bool contains(const key_arg<K>& key) const
+        {
+            size_t node = search<false>(key);
+            return node != 0 && !comp(key, keys[node]);
+        }
+
+        key_compare key_comp() const
+        {
+            return comp;
+        }
+    };
+
+    template<typename Key, typename Compare>
+    constexpr typename eytzinger_index<Key, Compare>::size_type eytzinger_index<Key, Compare>::npos;
+
+    template<typename Key, typename Compare>
+    constexpr size_t eytzinger_index<Key, Compare>::fanout;
+
+    template<typename Key, typename Compare>
+    constexpr bool eytzinger_index<Key, Compare>::transparent;
+} // namespace cppp
+
+#endif
@@ -0,0 +1,469 @@
+/* Copyright (C) 1999-2023 Free Software Foundation, Inc.
+   This file is part of the cppp-base library.
+
+   The cppp-base library is free software; you can redistribute it
+   and/or modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either version 3
+   of the License, or (at your option) any later version.
+
+   The cppp-base library is distributed in the hope that it will be
+   useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the cppp-base library; see the file COPYING.
+   If not, see <https://www.gnu.org/licenses/>.  */
+
+/* We do not use '#pragma once' because it may has bugs in some compiler. */
+#ifndef _CPPP_FLAT_SET_HPP
+#define _CPPP_FLAT_SET_HPP
+
+/* C++ Plus sorted vector set */
+
+#include "basedef.hpp"
+#include "flat_search.hpp"
+#include "type_traits.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+namespace cppp
+{
+    /* An ordered set keeping its keys sorted in a container, 'std::vector'
+       by default, see 'flat_map' for the differences from the standard
+       containers.  Iterators are those of the container, all constant. */
+    template<typename Key, typename Compare = std::less<Key>, typename KeyContainer = std::vector<Key>>
+    class flat_set
+    {
+    public:
+        using key_type = Key;
+        using value_type = Key;
+        using key_compare = Compare;
+        using value_compare = Compare;
+        using reference = Key&;
+        using const_reference = const Key&;
+        using size_type = size_t;
+        using difference_type = std::ptrdiff_t;
+        using container_type = KeyContainer;
+        using iterator = typename KeyContainer::const_iterator;
+        using const_iterator = iterator;
+        using reverse_iterator = std::reverse_iterator<iterator>;
+        using const_reverse_iterator = reverse_iterator;
+
+    private:
+        KeyContainer c;
+        Compare comp;
+
+        static constexpr bool transparent = detail::is_transparent_helper<Compare>::value;
+
+        /* Lookup key type, any type with a transparent comparator. */
+        template<typename K>
+        using key_arg = typename detail::key_arg_helper<transparent>::template type<K, Key>;
+
+    public:
+        flat_set() : flat_set(Compare())
+        {
+        }
+
+        explicit flat_set(const Compare& cmp) : c(), comp(cmp)
+        {
+        }
+
+        /* Sorts the keys, keeping the first of equivalent ones. */
+        explicit flat_set(container_type keys, const Compare& cmp = Compare()) : c(std::move(keys)), comp(cmp)
+        {
+            merge_tail(0, false);
+        }
+
+        flat_set(sorted_unique_t, container_type keys, const Compare& cmp = Compare()) : c(std::move(keys)), comp(cmp)
+        {
+        }
+
+        template<typename InputIt>
+        flat_set(InputIt from, InputIt to, const Compare& cmp = Compare()) : c(), comp(cmp)
+        {
+            insert(from, to);
+        }
+
+        template<typename InputIt>
+        flat_set(sorted_unique_t, InputIt from, InputIt to, const Compare& cmp = Compare()) : c(from, to), comp(cmp)
+        {
+        }
+
+        flat_set(std::initializer_list<value_type> list, const Compare& cmp = Compare())
+            : flat_set(list.begin(), list.end(), cmp)
+        {
+        }
+
+        flat_set(sorted_unique_t, std::initializer_list<value_type> list, const Compare& cmp = Compare())
+            : flat_set(sorted_unique, list.begin(), list.end(), cmp)
+        {
+        }
+
+        flat_set& operator=(std::initializer_list<value_type> list)
+        {
+            clear();
+            insert(list);
+            return *this;
+        }
+
+        /* Iterators */
+
+        iterator begin() const noexcept
+        {
+            return c.begin();
+        }
+
+        iterator cbegin() const noexcept
+        {
+            return c.begin();
+        }
+
+        iterator end() const noexcept
+        {
+            return c.end();
+        }
+
+        iterator cend() const noexcept
+        {
+            return c.end();
+        }
+
+        reverse_iterator rbegin() const noexcept
+        {
+            return reverse_iterator(end());
+        }
+
+        reverse_iterator crbegin() const noexcept
+        {
+            return rbegin();
+        }
+
+        reverse_iterator rend() const noexcept
+        {
+            return reverse_iterator(begin());
+        }
+
+        reverse_iterator crend() const noexcept
+        {
+            return rend();
+        }
+
+        /* Capacity */
+
+        bool empty() const noexcept
+        {
+            return c.empty();
+        }
+
+        size_type size() const noexcept
+        {
+            return c.size();
+        }
+
+        size_type max_size() const noexcept
+        {
+            return c.max_size();
+        }
+
+        void reserve(size_type n)
+        {
+            detail::flat::reserve(c, n, 0);
+        }
+
+        /* Modifiers */
+
+        template<typename... Args>
+        std::pair<iterator, bool> emplace(Args&&... args)
+        {
+            return insert(Key(std::forward<Args>(args)...));
+        }
+
+        template<typename... Args>
+        iterator emplace_hint(const_iterator hint, Args&&... args)
+        {
+            return insert(hint, Key(std::forward<Args>(args)...));
+        }
+
+        std::pair<iterator, bool> insert(const value_type& value)
+        {
+            return insert_at(size(), value);
+        }
+
+        std::pair<iterator, bool> insert(value_type&& value)
+        {
+            return insert_at(size(), std::move(value));
+        }
+
+        /* A correct hint saves the search. */
+        iterator insert(const_iterator hint, const value_type& value)
+        {
+            return insert_at(static_cast<size_t>(hint - begin()), value).first;
+        }
+
+        iterator insert(const_iterator hint, value_type&& value)
+        {
+            return insert_at(static_cast<size_t>(hint - begin()), std::move(value)).first;
+        }
+
+        /* Appends the keys, then sorts and merges them in one pass.  Of
+           equivalent keys the one already present, else the first one
+           inserted, is kept. */
+        template<typename InputIt>
+        void insert(InputIt from, InputIt to)
+        {
+            insert_tail(from, to, false);
+        }
+
+        /* Skips the sort. */
+        template<typename InputIt>
+        void insert(sorted_unique_t, InputIt from, InputIt to)
+        {
+            insert_tail(from, to, true);
+        }
+
+        void insert(std::initializer_list<value_type> list)
+        {
+            insert(list.begin(), list.end());
+        }
+
+        void insert(sorted_unique_t, std::initializer_list<value_type> list)
+        {
+            insert(sorted_unique, list.begin(), list.end());
+        }
+
+        template<typename Range>
+        void insert_range(Range&& range)
+        {
+            using std::begin;
+            using std::end;
+            insert(begin(range), end(range));
+        }
+
+        template<typename Range>
+        void insert_range(sorted_unique_t, Range&& range)
+        {
+            using std::begin;
+            using std::end;
+            insert(sorted_unique, begin(range), end(range));
+        }
+
+        iterator erase(const_iterator pos)
+        {
+            return c.erase(pos);
+        }
+
+        iterator erase(const_iterator from, const_iterator to)
+        {
+            return c.erase(from, to);
+        }
+
+        template<typename K = key_type>
+        size_type erase(const key_arg<K>& key)
+        {
+            iterator it = find(key);
+            if (it == end())
+            {
+                return 0;
+            }
+            c.erase(it);
+            return 1;
+        }
+
+        /* Moves the container out, leaving the set empty. */
+        container_type extract() &&
+        {
+            container_type result = std::move(c);
+            c.clear();
+            return result;
+        }
+
+        /* Takes over a container already sorted and free of equivalent
+           keys. */
+        void replace(container_type&& keys)
+        {
+            c = std::move(keys);
+        }
+
+        void swap(flat_set& other) noexcept
+        {
+            using std::swap;
+            swap(c, other.c);
+            swap(comp, other.comp);
+        }
+
+        void clear() noexcept
+        {
+            c.clear();
+        }
+
+        /* Observers */
+
+        key_compare key_comp() const
+        {
+            return comp;
+        }
+
+        value_compare value_comp() const
+        {
+            return comp;
+        }
+
+        /* Lookup */
+
+        template<typename K = key_type>
+        iterator find(const key_arg<K>& key) const
+        {
+            iterator it = lower_bound(key);
+            return it != end() && !comp(key, *it) ? it : end();
+        }
+
+        template<typename K = key_type>
+        bool contains(const key_arg<K>& key) const
+        {
+            return find(key) != end();
+        }
+
+        template<typename K = key_type>
+        size_type count(const key_arg<K>& key) const
+        {
+            return contains(key) ? 1 : 0;
+        }
+
+        template<typename K = key_type>
+        iterator lower_bound(const key_arg<K>& key) const
+        {
+            return begin() + static_cast<difference_type>(detail::flat::bound<false>(c.begin(), c.size(), key, comp));
+        }
+
+        template<typename K = key_type>
+        iterator upper_bound(const key_arg<K>& key) const
+        {
+            return begin() + static_cast<difference_type>(detail::flat::bound<true>(c.begin(), c.size(), key, comp));
+        }
+
+        template<typename K = key_type>
+        std::pair<iterator, iterator> equal_range(const key_arg<K>& key) const
+        {
+            iterator it = lower_bound(key);
+            iterator last = it != end() && !comp(key, *it) ? it + 1 : it;
+            return std::pair<iterator, iterator>(it, last);
+        }
+
+        friend bool operator==(const flat_set& a, const flat_set& b)
+        {
+            return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin());
+        }
+
+        friend bool operator!=(const flat_set& a, const flat_set& b)
+        {
+            return !(a == b);
+        }
+
+        friend bool operator<(const flat_set& a, const flat_set& b)
+        {
+            return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end());
+        }
+
+        friend bool operator>(const flat_set& a, const flat_set& b)
+        {
+            return b < a;
+        }
+
+        friend bool operator<=(const flat_set& a, const flat_set& b)
+        {
+            return !(b < a);
+        }
+
+        friend bool operator>=(const flat_set& a, const flat_set& b)
+        {
+            return !(a < b);
+        }
+
+    private:
+        /* Inserts 'value' unless present, trying position 'hint' first. */
+        template<typename Value>
+        std::pair<iterator, bool> insert_at(size_t hint, Value&& value)
+        {
+            size_t n = size();
+            size_t pos = hint;
+            if ((hint != n && !comp(value, c[hint])) || (hint != 0 && !comp(c[hint - 1], value)))
+            {
+                pos = detail::flat::bound<false>(c.begin(), n, value, comp);
+                if (pos != n && !comp(value, c[pos]))
+                {
+                    return std::pair<iterator, bool>(begin() + static_cast<difference_type>(pos), false);
+                }
+            }
+            return std::pair<iterator, bool>(c.insert(c.begin() + pos, std::forward<Value>(value)), true);
+        }
+
+        template<typename InputIt>
+        void insert_tail(InputIt from, InputIt to, bool sorted)
+        {
+            size_t old = size();
+            try
+            {
+                c.insert(c.end(), from, to);
+            }
+            catch (...)
+            {
+                c.erase(c.begin() + old, c.end());
+                throw;
+            }
+            try
+            {
+                merge_tail(old, sorted);
+            }
+            catch (...)
+            {
+                /* Sorting and merging shuffle the keys. */
+                c.clear();
+                throw;
+            }
+        }
+
+        /* Sorts the keys from 'old' on, unless 'sorted', and merges them
+           in place with those before, dropping keys already present or
+           repeated.  Merging is stable, of equivalent keys the old one
+           comes first and is kept. */
+        void merge_tail(size_t old, bool sorted)
+        {
+            typename KeyContainer::iterator first = c.begin();
+            typename KeyContainer::iterator middle = first + static_cast<difference_type>(old);
+            typename KeyContainer::iterator last = c.end();
+            const Compare& cmp = comp;
+            auto equivalent = [&cmp](const Key& a, const Key& b) { return !cmp(a, b); };
+
+            if (!sorted)
+            {
+                std::stable_sort(middle, last, comp);
+                last = c.erase(std::unique(middle, last, equivalent), last);
+                first = c.begin();
+                middle = first + static_cast<difference_type>(old);
+            }
+            if (old == 0 || middle == last || comp(middle[-1], *middle))
+            {
+                return;
+            }
+            std::inplace_merge(first, middle, last, comp);
+            c.erase(std::unique(first, last, equivalent), last);
+        }
+    };
+
+    template<typename K, typename C, typename KC>
+    constexpr bool flat_set<K, C, KC>::transparent;
+
+    template<typename K, typename C, typename KC>
+    void swap(flat_set<K, C, KC>& lhs, flat_set<K, C, KC>& rhs) noexcept
+    {
+        lhs.swap(rhs);
+    }
+} // namespace cppp
+
+#endif
@@ -0,0 +1,229 @@
+/* Copyright (C) 1999-2023 Free Software Foundation, Inc.
+   This file is part of the cppp-base library.
+
+   The cppp-base library is free software; you can redistribute it
+   and/or modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either version 3
+   of the License, or (at your option) any later version.
+
+   The cppp-base library is distributed in the hope that it will be
+   useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the cppp-base library; see the file COPYING.
+   If not, see <https://www.gnu.org/licenses/>.  */
+
+/* We do not use '#pragma once' because it may has bugs in some compiler. */
+#ifndef _CPPP_HARDWARE_HPP
+#define _CPPP_HARDWARE_HPP
+
+/* C++ Plus hardware topology constants */
+
+#include "basedef.hpp"
+
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+
+/* Cache line size of the target, in bytes.
+   Can be overridden on the command line, e.g. '-DCPPP_CACHE_LINE_SIZE=128'. */
+#ifndef CPPP_CACHE_LINE_SIZE
+#if defined(__APPLE__) && defined(CPPP_ARCH_ARM64)
+#define CPPP_CACHE_LINE_SIZE 128
+#elif defined(__powerpc64__)
+#define CPPP_CACHE_LINE_SIZE 128
+#else
+#define CPPP_CACHE_LINE_SIZE 64
+#endif
+#endif
+
+/* Minimum distance between two objects written by different threads.
+   x86-64 and most ARM64 cores prefetch cache lines in adjacent pairs,
+   so two lines are needed there to really avoid false sharing. */
+#ifndef CPPP_DESTRUCTIVE_INTERFERENCE_SIZE
+#if defined(CPPP_ARCH_X86_64) || defined(CPPP_ARCH_ARM64)
+#define CPPP_DESTRUCTIVE_INTERFERENCE_SIZE (2 * CPPP_CACHE_LINE_SIZE > 128 ? 2 * CPPP_CACHE_LINE_SIZE : 128)
+#else
+#define CPPP_DESTRUCTIVE_INTERFERENCE_SIZE CPPP_CACHE_LINE_SIZE
+#endif
+#endif
+
+/* Default virtual memory page size of the target, in bytes. */
+#ifndef CPPP_PAGE_SIZE
+#if defined(__APPLE__) && defined(CPPP_ARCH_ARM64)
+#define CPPP_PAGE_SIZE 16384
+#else
+#define CPPP_PAGE_SIZE 4096
+#endif
+#endif
+
+namespace cppp
+{
+    /* Size of a cache line, also the maximum size of contiguous memory
+       that promotes true sharing. */
+    constexpr size_t cache_line_size = CPPP_CACHE_LINE_SIZE;
+
+    /* Minimum offset between two objects to avoid false sharing.
+       We do not use 'std::hardware_destructive_interference_size' because
+       it is missing on some standard libraries and GCC warns when it is
+       used in a header, since its value may change between compilations. */
+    constexpr size_t destructive_interference_size = CPPP_DESTRUCTIVE_INTERFERENCE_SIZE;
+
+    /* Compile-time default page size, use 'query_page_size' when the real
+       value matters (e.g. for 'mmap' offsets). */
+    constexpr size_t page_size = CPPP_PAGE_SIZE;
+
+    /* Get the page size of the running system.
+       The value is queried once and cached. */
+    inline size_t query_page_size() noexcept
+    {
+        static const size_t size = []() noexcept -> size_t
+        {
+#if defined(_WIN32)
+            SYSTEM_INFO info;
+            GetSystemInfo(&info);
+            return static_cast<size_t>(info.dwPageSize);
+#elif defined(__unix__) || defined(__APPLE__)
+            long result = sysconf(_SC_PAGESIZE);
+            return result > 0 ? static_cast<size_t>(result) : page_size;
+#else
+            return page_size;
+#endif
+        }();
+        return size;
+    }
+
+    /* Allocate 'size' bytes aligned to 'alignment', a power of two, in
+       every language mode: 'operator new' only honours extended alignment
+       since C++17.  Throws 'std::bad_alloc'.  Free with 'aligned_free'. */
+    inline void* aligned_allocate(size_t size, size_t alignment)
+    {
+        if (alignment < alignof(void*))
+        {
+            alignment = alignof(void*);
+        }
+        /* The original pointer is kept just below the aligned block. */
+        void* raw = ::operator new(size + alignment + sizeof(void*));
+        std::uintptr_t aligned = (reinterpret_cast<std::uintptr_t>(raw) + sizeof(void*) + alignment - 1) &
+                                 ~static_cast<std::uintptr_t>(alignment - 1);
+        reinterpret_cast<void**>(aligned)[-1] = raw;
+        return reinterpret_cast<void*>(aligned);
+    }
+
+    inline void aligned_free(void* p) noexcept
+    {
+        if (p != nullptr)
+        {
+            ::operator delete(static_cast<void**>(p)[-1]);
+        }
+    }
+
+    /* A wrapper that gives 'T' its own destructive interference range,
+       so that it never shares a cache line with its neighbours.
+       Use it for per-thread counters and for the head and tail of queues.
+       Objects and arrays of it made with 'new' are aligned in every
+       language mode. */
+    template<typename T>
+    struct alignas(destructive_interference_size) cache_aligned
+    {
+        T value;
+
+        cache_aligned() = default;
+
+        static void* operator new(size_t size)
+        {
+            return aligned_allocate(size, alignof(cache_aligned));
+        }
+
+        static void operator delete(void* p) noexcept
+        {
+            aligned_free(p);
+        }
+
+        static void* operator new[](size_t size)
+        {
+            return aligned_allocate(size, alignof(cache_aligned));
+        }
+
+        static void operator delete[](void* p) noexcept
+        {
+            aligned_free(p);
+        }
+
+        /* The allocation functions above hide the global placement forms,
+           storage the caller aligned is still usable. */
+        static void* operator new(size_t, void* p) noexcept
+        {
+            return p;
+        }
+
+        static void operator delete(void*, void*) noexcept
+        {
+        }
+
+        static void* operator new[](size_t, void* p) noexcept
+        {
+            return p;
+        }
+
+        static void operator delete[](void*, void*) noexcept
+        {
+        }
+
+        /* Construct the value in place, copy and move are left to the
+           implicitly declared constructors. */
+        template<typename Arg, typename... Args,
+                 typename = typename std::enable_if<!std::is_same<typename std::decay<Arg>::type, cache_aligned>::value>::type>
+        explicit cache_aligned(Arg&& arg, Args&&... args)
+            : value(std::forward<Arg>(arg), std::forward<Args>(args)...)
+        {
+        }
+
+        T& get() noexcept
+        {
+            return value;
+        }
+
+        const T& get() const noexcept
+        {
+            return value;
+        }
+
+        T& operator*() noexcept
+        {
+            return value;
+        }
+
+        const T& operator*() const noexcept
+        {
+            return value;
+        }
+
+        T* operator->() noexcept
+        {
+            return &value;
+        }
+
+        const T* operator->() const noexcept
+        {
+            return &value;
+        }
+    };
+} // namespace cppp
+
+#endif
@@ -0,0 +1,523 @@
+/* Copyright (C) 1999-2023 Free Software Foundation, Inc.
+   This file is part of the cppp-base library.
+
+   The cppp-base library is free software; you can redistribute it
+   and/or modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either version 3
+   of the License, or (at your option) any later version.
+
+   The cppp-base library is distributed in the hope that it will be
+   useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the cppp-base library; see the file COPYING.
+   If not, see <https://www.gnu.org/licenses/>.  */
+
+/* We do not use '#pragma once' because it may has bugs in some compiler. */
+#ifndef _CPPP_HASH_HPP
+#define _CPPP_HASH_HPP
+
+/* C++ Plus fast non-cryptographic hashing
+
+   Short inputs (up to 256 bytes) use a wyhash style mixer built on
+   64x64->128 bit multiplications.  Longer inputs are cut into 64-byte
+   stripes accumulated into eight 64-bit lanes with 32x32->64 bit
+   multiplications, the same arithmetic SSE2 and AVX2 do natively, so
+   the vector and scalar paths produce identical values.
+
+   The values are stable across platforms and releases of the same major
+   version, but must not be persisted or used where an attacker benefits
+   from collisions unless a secret seed is used (see 'random_hash_seed'). */
+
+#include "basedef.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <string>
+#include <type_traits>
+
+#if CPPP_CPLUSPLUS >= 201703L
+#include <string_view>
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define CPPP_HASH_AVX2 1
+#elif defined(__SSE2__) || defined(CPPP_ARCH_X86_64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CPPP_HASH_SSE2 1
+#endif
+
+namespace cppp
+{
+    /* Seed used when none is given. */
+    constexpr std::uint64_t default_hash_seed = 0x243F6A8885A308D3ULL;
+
+    namespace detail
+    {
+        namespace hashing
+        {
+            constexpr std::uint64_t p0 = 0xA0761D6478BD642FULL;
+            constexpr std::uint64_t p1 = 0xE7037ED1A0B428DBULL;
+            constexpr std::uint64_t p2 = 0x8EBC6AF09C88C6E3ULL;
+            constexpr std::uint64_t p3 = 0x589965CC75374CC3ULL;
+            constexpr std::uint64_t prime32 = 0x9E3779B1ULL;
+            constexpr size_t short_limit = 256;
+            constexpr size_t stripe = 64;
+            constexpr size_t stripes_per_block = 16;
+
+            /* Keys of the bulk path: words 0..22 feed the stripes,
+               16..23 the scrambles and the final merge. */
+            template<typename = void>
+            struct secret
+            {
+                static constexpr std::uint64_t words[24] = {
+                    0x2CB0F69F4ABEA221ULL, 0x9417034723148989ULL, 0xDD555950609DFE03ULL,
+                    0xDBAFB150DEB12801ULL, 0x7E789B2E6C442CB7ULL, 0xF41E5636C7E4F8C5ULL,
+                    0x0959D150F8FBA7E5ULL, 0xA97316F13CDB9EEBULL, 0x74CD8258F9520069ULL,
+                    0x55C74A62E116868BULL, 0xD2F4C799A2023CBDULL, 0xDF98CB79A37B51B9ULL,
+                    0x396F5885524F3905ULL, 0xAF1D56386CA3B277ULL, 0xA9FFBE6B5104E85BULL,
+                    0x6BD0C51B9FD533B3ULL, 0x980CE91C50AB4B57ULL, 0x28AC395780FE62C5ULL,
+                    0x768912E3A6BCEDC7ULL, 0x50B3E8C9332C7C89ULL, 0xCE3BBFE520BD47DBULL,
+                    0xCBA6C8E8E0BB7C4FULL, 0xBF194DB8434A346DULL, 0x7D8F2A7B60416D7FULL,
+                };
+            };
+
+            template<typename T>
+            constexpr std::uint64_t secret<T>::words[24];
+
+            /* Full 64x64->128 bit product. */
+            CPPP_CONSTEXPR14 void mul128(std::uint64_t a, std::uint64_t b, std::uint64_t& lo, std::uint64_t& hi) noexcept
+            {
+#if defined(__SIZEOF_INT128__)
+                __uint128_t r = static_cast<__uint128_t>(a) * b;
+                lo = static_cast<std::uint64_t>(r);
+                hi = static_cast<std::uint64_t>(r >> 64);
+#else
+                std::uint64_t a_lo = a & 0xFFFFFFFFULL, a_hi = a >> 32;
+                std::uint64_t b_lo = b & 0xFFFFFFFFULL, b_hi = b >> 32;
+                std::uint64_t ll = a_lo * b_lo, lh = a_lo * b_hi, hl = a_hi * b_lo, hh = a_hi * b_hi;
+                std::uint64_t mid = (ll >> 32) + (lh & 0xFFFFFFFFULL) + (hl & 0xFFFFFFFFULL);
+                lo = (ll & 0xFFFFFFFFULL) | (mid << 32);
+                hi = hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+#endif
+            }
+
+            /* Multiply and fold the halves. */
+            CPPP_CONSTEXPR14 std::uint64_t mum(std::uint64_t a, std::uint64_t b) noexcept
+            {
+                std::uint64_t lo = 0, hi = 0;
+                mul128(a, b, lo, hi);
+                return lo ^ hi;
+            }
+
+            /* Little-endian loads spelled out byte by byte, so they work in
+               constant expressions; compilers turn them into one load. */
+            CPPP_CONSTEXPR14 std::uint64_t read64(const char* p) noexcept
+            {
+                return static_cast<std::uint64_t>(static_cast<unsigned char>(p[0])) |
+                       static_cast<std::uint64_t>(static_cast<unsigned char>(p[1])) << 8 |
+                       static_cast<std::uint64_t>(static_cast<unsigned char>(p[2])) << 16 |
+                       static_cast<std::uint64_t>(static_cast<unsigned char>(p[3])) << 24 |
+                       static_cast<std::uint64_t>(static_cast<unsigned char>(p[4])) << 32 |
+                       static_cast<std::uint64_t>(static_cast<unsigned char>(p[5])) << 40 |
+                       static_cast<std::uint64_t>(static_cast<unsigned char>(p[6])) << 48 |
+                       static_cast<std::uint64_t>(static_cast<unsigned char>(p[7])) << 56;
+            }
+
+            CPPP_CONSTEXPR14 std::uint64_t read32(const char* p) noexcept
+            {
+                return static_cast<std::uint64_t>(static_cast<unsigned char>(p[0])) |
+                       static_cast<std::uint64_t>(static_cast<unsigned char>(p[1])) << 8 |
+                       static_cast<std::uint64_t>(static_cast<unsigned char>(p[2])) << 16 |
+                       static_cast<std::uint64_t>(static_cast<unsigned char>(p[3])) << 24;
+            }
+
+            CPPP_CONSTEXPR14 std::uint64_t avalanche(std::uint64_t h) noexcept
+            {
+                h ^= h >> 37;
+                h *= 0x165667919E3779F9ULL;
+                return h ^ (h >> 32);
+            }
+
+            /* One stripe into the accumulators, reference implementation. */
+            CPPP_CONSTEXPR14 void accumulate_scalar(std::uint64_t* acc, const char* p, size_t key) noexcept
+            {
+                for (size_t j = 0; j < 8; ++j)
+                {
+                    std::uint64_t data = read64(p + 8 * j);
+                    std::uint64_t keyed = data ^ secret<>::words[key + j];
+                    acc[j ^ 1] += data;
+                    acc[j] += (keyed & 0xFFFFFFFFULL) * (keyed >> 32);
+                }
+            }
+
+            CPPP_CONSTEXPR14 void scramble_scalar(std::uint64_t* acc) noexcept
+            {
+                for (size_t j = 0; j < 8; ++j)
+                {
+                    std::uint64_t a = acc[j];
+                    a ^= a >> 47;
+                    a ^= secret<>::words[16 + j];
+                    acc[j] = a * prime32;
+                }
+            }
+
+            CPPP_CONSTEXPR14 std::uint64_t merge(const std::uint64_t* acc, size_t n, std::uint64_t seed) noexcept
+            {
+                std::uint64_t h = static_cast<std::uint64_t>(n) * p0 ^ seed;
+                for (size_t j = 0; j < 8; j += 2)
+                {
+                    h += mum(acc[j] ^ secret<>::words[16 + j], acc[j + 1] ^ secret<>::words[17 + j]);
+                }
+                return avalanche(h);
+            }
+
+            CPPP_CONSTEXPR14 std::uint64_t bulk_scalar(const char* p, size_t n, std::uint64_t seed) noexcept
+            {
+                std::uint64_t acc[8] = {p0 ^ seed, p1, p2, p3, prime32, p0, p1 ^ seed, p2};
+                size_t stripes = (n - 1) / stripe;
+                size_t s = 0;
+                for (; s < stripes; ++s)
+                {
+                    accumulate_scalar(acc, p + s * stripe, s % stripes_per_block);
+                    if (s % stripes_per_block == stripes_per_block - 1)
+                    {
+                        scramble_scalar(acc);
+                    }
+                }
+                /* The last stripe, overlapping the previous one if needed. */
+                accumulate_scalar(acc, p + n - stripe, 9);
+                return merge(acc, n, seed);
+            }
+
+#if defined(CPPP_HASH_AVX2)
+            inline std::uint64_t bulk_vector(const char* p, size_t n, std::uint64_t seed) noexcept
+            {
+                alignas(32) std::uint64_t acc[8] = {p0 ^ seed, p1, p2, p3, prime32, p0, p1 ^ seed, p2};
+                __m256i a0 = _mm256_load_si256(reinterpret_cast<const __m256i*>(acc));
+                __m256i a1 = _mm256_load_si256(reinterpret_cast<const __m256i*>(acc + 4));
+                const std::uint64_t* words = secret<>::words;
+                const __m256i prime = _mm256_set1_epi32(static_cast<int>(prime32));
+                auto accumulate = [&](const char* data, size_t key)
+                {
+                    __m256i d0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+                    __m256i d1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + 32));
+                    __m256i k0 = _mm256_xor_si256(d0, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(words + key)));
+                    __m256i k1 = _mm256_xor_si256(d1, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(words + key + 4)));
+                    __m256i m0 = _mm256_mul_epu32(k0, _mm256_srli_epi64(k0, 32));
+                    __m256i m1 = _mm256_mul_epu32(k1, _mm256_srli_epi64(k1, 32));
+                    a0 = _mm256_add_epi64(a0, _mm256_add_epi64(_mm256_shuffle_epi32(d0, 0x4E), m0));
+                    a1 = _mm256_add_epi64(a1, _mm256_add_epi64(_mm256_shuffle_epi32(d1, 0x4E), m1));
+                };
+                auto scramble = [&]()
+                {
+                    __m256i* lanes[2] = {&a0, &a1};
+                    for (int i = 0; i < 2; ++i)
+                    {
+                        __m256i a = *lanes[i];
+                        a = _mm256_xor_si256(a, _mm256_srli_epi64(a, 47));
+                        a = _mm256_xor_si256(a, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(words + 16 + 4 * i)));
+                        __m256i lo = _mm256_mul_epu32(a, prime);
+                        __m256i hi = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), prime);
+                        *lanes[i] = _mm256_add_epi64(lo, _mm256_slli_epi64(hi, 32));
+                    }
+                };
+                size_t stripes = (n - 1) / stripe;
+                for (size_t s = 0; s < stripes; ++s)
+                {
+                    accumulate(p + s * stripe, s % stripes_per_block);
+                    if (s % stripes_per_block == stripes_per_block - 1)
+                    {
+                        scramble();
+                    }
+                }
+                accumulate(p + n - stripe, 9);
+                _mm256_store_si256(reinterpret_cast<__m256i*>(acc), a0);
+                _mm256_store_si256(reinterpret_cast<__m256i*>(acc + 4), a1);
+                return merge(acc, n, seed);
+            }
+#elif defined(CPPP_HASH_SSE2)
+            inline std::uint64_t bulk_vector(const char* p, size_t n, std::uint64_t seed) noexcept
+            {
+                alignas(16) std::uint64_t acc[8] = {p0 ^ seed, p1, p2, p3, prime32, p0, p1 ^ seed, p2};
+                __m128i a[4];
+                for (int i = 0; i < 4; ++i)
+                {
+                    a[i] = _mm_load_si128(reinterpret_cast<const __m128i*>(acc + 2 * i));
+                }
+                const std::uint64_t* words = secret<>::words;
+                const __m128i prime = _mm_set1_epi32(static_cast<int>(prime32));
+                size_t stripes = (n - 1) / stripe;
+                for (size_t s = 0; s <= stripes; ++s)
+                {
+                    bool last = s == stripes;
+                    const char* data = last ? p + n - stripe : p + s * stripe;
+                    size_t key = last ? 9 : s % stripes_per_block;
+                    for (int i = 0; i < 4; ++i)
+                    {
+                        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16 * i));
+                        __m128i k = _mm_xor_si128(d, _mm_loadu_si128(reinterpret_cast<const __m128i*>(words + key + 2 * i)));
+                        __m128i m = _mm_mul_epu32(k, _mm_srli_epi64(k, 32));
+                        a[i] = _mm_add_epi64(a[i], _mm_add_epi64(_mm_shuffle_epi32(d, 0x4E), m));
+                    }
+                    if (!last && s % stripes_per_block == stripes_per_block - 1)
+                    {
+                        for (int i = 0; i < 4; ++i)
+                        {
+                            __m128i v = _mm_xor_si128(a[i], _mm_srli_epi64(a[i], 47));
+                            v = _mm_xor_si128(v, _mm_loadu_si128(reinterpret_cast<const __m128i*>(words + 16 + 2 * i)));
+                            __m128i lo = _mm_mul_epu32(v, prime);
+                            __m128i hi = _mm_mul_epu32(_mm_srli_epi64(v, 32), prime);
+                            a[i] = _mm_add_epi64(lo, _mm_slli_epi64(hi, 32));
+                        }
+                    }
+                }
+                for (int i = 0; i < 4; ++i)
+                {
+                    _mm_store_si128(reinterpret_cast<__m128i*>(acc + 2 * i), a[i]);
+                }
+                return merge(acc, n, seed);
+            }
+#else
+            inline std::uint64_t bulk_vector(const char* p, size_t n, std::uint64_t seed) noexcept
+            {
+                return bulk_scalar(p, n, seed);
+            }
+#endif
+
+            /* Inputs up to 'short_limit' bytes, and the final step. */
+            CPPP_CONSTEXPR14 std::uint64_t hash_short(const char* p, size_t n, std::uint64_t seed) noexcept
+            {
+                seed ^= mum(seed ^ p0, p1);
+                std::uint64_t a = 0, b = 0;
+                if (n <= 16)
+                {
+                    if (n >= 4)
+                    {
+                        size_t mid = (n >> 3) << 2;
+                        a = read32(p) << 32 | read32(p + mid);
+                        b = read32(p + n - 4) << 32 | read32(p + n - 4 - mid);
+                    }
+                    else if (n > 0)
+                    {
+                        a = static_cast<std::uint64_t>(static_cast<unsigned char>(p[0])) << 16 |
+                            static_cast<std::uint64_t>(static_cast<unsigned char>(p[n >> 1])) << 8 |
+                            static_cast<std::uint64_t>(static_cast<unsigned char>(p[n - 1]));
+                    }
+                }
+                else
+                {
+                    size_t i = n;
+                    if (i > 48)
+                    {
+                        std::uint64_t s1 = seed, s2 = seed;
+                        do
+                        {
+                            seed = mum(read64(p) ^ p1, read64(p + 8) ^ seed);
+                            s1 = mum(read64(p + 16) ^ p2, read64(p + 24) ^ s1);
+                            s2 = mum(read64(p + 32) ^ p3, read64(p + 40) ^ s2);
+                            p += 48;
+                            i -= 48;
+                        } while (i > 48);
+                        seed ^= s1 ^ s2;
+                    }
+                    while (i > 16)
+                    {
+                        seed = mum(read64(p) ^ p1, read64(p + 8) ^ seed);
+                        i -= 16;
+                        p += 16;
+                    }
+                    a = read64(p + i - 16);
+                    b = read64(p + i - 8);
+                }
+                std::uint64_t lo = 0, hi = 0;
+                mul128(a ^ p1, b ^ seed, lo, hi);
+                return mum(lo ^ p0 ^ static_cast<std::uint64_t>(n), hi ^ p1);
+            }
+
+            CPPP_CONSTEXPR14 std::uint64_t hash_integer(std::uint64_t value, std::uint64_t seed) noexcept
+            {
+                return mum(value ^ seed ^ p0, p1 ^ (seed >> 1));
+            }
+        } // namespace hashing
+    } // namespace detail
+
+    /* Hash 'n' bytes at 'data'.  Usable in constant expressions (C++14),
+       where it always takes the scalar path; the result is the same. */
+    CPPP_CONSTEXPR14 std::uint64_t hash_bytes_constexpr(const char* data, size_t n,
+                                                        std::uint64_t seed = default_hash_seed) noexcept
+    {
+        return n <= detail::hashing::short_limit ? detail::hashing::hash_short(data, n, seed)
+                                                 : detail::hashing::bulk_scalar(data, n, seed);
+    }
+
+    /* Hash 'n' bytes at 'data', using SIMD for long inputs when available. */
+    CPPP_FORCE_INLINE std::uint64_t hash_bytes(const void* data, size_t n, std::uint64_t seed = default_hash_seed) noexcept
+    {
+        const char* p = static_cast<const char*>(data);
+        if (CPPP_LIKELY(n <= detail::hashing::short_limit))
+        {
+            return detail::hashing::hash_short(p, n, seed);
+        }
+        return detail::hashing::bulk_vector(p, n, seed);
+    }
+
+    /* A seed unpredictable from outside the process, for tables keyed by
+       untrusted input (HashDoS).  Computed once per process. */
+    inline std::uint64_t random_hash_seed()
+    {
+        static const std::uint64_t seed = []()
+        {
+            std::random_device device;
+            std::uint64_t value = static_cast<std::uint64_t>(device()) << 32 ^ device();
+            /* Mix in an address in case 'random_device' is deterministic. */
+            static const int anchor = 0;
+            value ^= static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(&anchor));
+            return detail::hashing::hash_integer(value, default_hash_seed);
+        }();
+        return seed;
+    }
+
+    /* Hash functor.
+
+       Unlike 'std::hash' every result is well mixed, so it can be used with
+       power-of-two tables directly ('is_avalanching').  Supports integral,
+       enumeration, floating-point and pointer types and strings, string
+       hashers are transparent so 'std::string' tables accept string views.
+       Construct it with a seed, e.g. 'random_hash_seed()', to make
+       collisions unpredictable. */
+    template<typename T, typename = void>
+    struct hash;
+
+    namespace detail
+    {
+        namespace hashing
+        {
+            class seeded
+            {
+            protected:
+                std::uint64_t seed;
+
+            public:
+                using is_avalanching = void;
+
+                constexpr seeded() noexcept : seed(default_hash_seed)
+                {
+                }
+
+                explicit constexpr seeded(std::uint64_t s) noexcept : seed(s)
+                {
+                }
+
+                constexpr std::uint64_t get_seed() const noexcept
+                {
+                    return seed;
+                }
+            };
+        } // namespace hashing
+    } // namespace detail
+
+    template<typename T>
+    struct hash<T, typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type>
+        : detail::hashing::seeded
+    {
+        using seeded::seeded;
+
+        CPPP_CONSTEXPR14 size_t operator()(T value) const noexcept
+        {
+            return static_cast<size_t>(detail::hashing::hash_integer(static_cast<std::uint64_t>(value), seed));
+        }
+    };
+
+    template<typename T>
+    struct hash<T*> : detail::hashing::seeded
+    {
+        using seeded::seeded;
+
+        size_t operator()(T* value) const noexcept
+        {
+            return static_cast<size_t>(
+                detail::hashing::hash_integer(static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(value)), seed));
+        }
+    };
+
+    template<typename T>
+    struct hash<T, typename std::enable_if<std::is_floating_point<T>::value>::type> : detail::hashing::seeded
+    {
+        using seeded::seeded;
+
+        size_t operator()(T value) const noexcept
+        {
+            /* +0.0 and -0.0 compare equal and must hash equal. */
+            if (value == T(0))
+            {
+                value = T(0);
+            }
+            return static_cast<size_t>(hash_bytes(&value, sizeof(value), seed));
+        }
+    };
+
+    template<typename CharT, typename Traits, typename Alloc>
+    struct hash<std::basic_string<CharT, Traits, Alloc>> : detail::hashing::seeded
+    {
+        using seeded::seeded;
+        using is_transparent = void;
+
+        size_t operator()(const std::basic_string<CharT, Traits, Alloc>& value) const noexcept
+        {
+            return static_cast<size_t>(hash_bytes(value.data(), value.size() * sizeof(CharT), seed));
+        }
+
+        size_t operator()(const CharT* value) const noexcept
+        {
+            return static_cast<size_t>(hash_bytes(value, Traits::length(value) * sizeof(CharT), seed));
+        }
+
+#if CPPP_CPLUSPLUS >= 201703L
+        size_t operator()(std::basic_string_view<CharT, Traits> value) const noexcept
+        {
+            return static_cast<size_t>(hash_bytes(value.data(), value.size() * sizeof(CharT), seed));
+        }
+#endif
+    };
+
+#if CPPP_CPLUSPLUS >= 201703L
+    template<typename CharT, typename Traits>
+    struct hash<std::basic_string_view<CharT, Traits>> : detail::hashing::seeded
+    {
+        using seeded::seeded;
+        using is_transparent = void;
+
+        constexpr size_t operator()(std::basic_string_view<CharT, Traits> value) const noexcept
+        {
+#if defined(__cpp_lib_is_constant_evaluated)
+            if constexpr (std::is_same<CharT, char>::value)
+            {
+                if (std::is_constant_evaluated())
+                {
+                    return static_cast<size_t>(hash_bytes_constexpr(value.data(), value.size(), seed));
+                }
+            }
+#endif
+            return static_cast<size_t>(hash_bytes(value.data(), value.size() * sizeof(CharT), seed));
+        }
+    };
+#endif
+
+    namespace literals
+    {
+        /* Compile-time hash of a string literal, equal to hashing the same
+           characters at runtime with the default seed:
+           'case "GET"_hash:' in a switch over 'hash_bytes' values. */
+        CPPP_CONSTEXPR14 std::uint64_t operator""_hash(const char* data, size_t n) noexcept
+        {
+            return hash_bytes_constexpr(data, n);
+        }
+    } // namespace literals
+} // namespace cppp
+
+#endif
@@ -0,0 +1,1398 @@
+/* Copyright (C) 1999-2023 Free Software Foundation, Inc.
+   This file is part of the cppp-base library.
+
+   The cppp-base library is free software; you can redistribute it
+   and/or modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either version 3
+   of the License, or (at your option) any later version.
+
+   The cppp-base library is distributed in the hope that it will be
+   useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the cppp-base library; see the file COPYING.
+   If not, see <https://www.gnu.org/licenses/>.  */
+
+/* We do not use '#pragma once' because it may has bugs in some compiler. */
+#ifndef _CPPP_IO_CONTEXT_HPP
+#define _CPPP_IO_CONTEXT_HPP
+
+/* C++ Plus completion-based I/O for Linux
+
+   'io_context' queues reads, writes, socket operations and fsync, and
+   reports their results as completions. On io_uring, operations become
+   submission queue entries that go to the kernel in one 'io_uring_enter'
+   per loop iteration. The kernel then runs them without one syscall per
+   operation. Registered files and buffers skip the per-operation fd
+   lookup and page pinning, and multishot accept/recv post many
+   completions for one submission.
+
+   When io_uring is missing (old kernel, seccomp) or disabled, the same
+   interface runs on an epoll reactor. Socket and pipe operations wait
+   for readiness and regular file operations run synchronously inside
+   the loop.
+
+   Results follow io_uring: a non-negative value on success, '-errno' on
+   failure. Completions are delivered only by 'poll', 'run_once' and
+   'run', on the thread that calls them. One 'io_context' must be used by
+   one thread at a time. */
+
+#include "basedef.hpp"
+
+#if defined(__linux__)
+
+#include "coroutine.hpp"
+#include "flat_hash_map.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>) && defined(__NR_io_uring_setup)
+#include <linux/io_uring.h>
+#if defined(IORING_ACCEPT_MULTISHOT) && defined(IORING_RECV_MULTISHOT) && defined(IORING_ASYNC_CANCEL_FD)
+#define CPPP_IO_HAVE_URING 1
+#endif
+#endif
+#endif
+
+namespace cppp
+{
+    /* Result of one operation. Multishot operations deliver several, and
+       'more()' is false on the last one. */
+    struct io_completion
+    {
+        /* Same encoding as io_uring's 'cqe->flags'. */
+        static constexpr std::uint32_t flag_buffer = 1u << 0;
+        static constexpr std::uint32_t flag_more = 1u << 1;
+        static constexpr unsigned buffer_shift = 16;
+
+        int result;
+        std::uint32_t flags;
+
+        bool more() const noexcept
+        {
+            return (flags & flag_more) != 0;
+        }
+
+        /* Whether a provided buffer was consumed, see
+           'io_context::provide_buffers'. */
+        bool has_buffer() const noexcept
+        {
+            return (flags & flag_buffer) != 0;
+        }
+
+        std::uint16_t buffer_id() const noexcept
+        {
+            return static_cast<std::uint16_t>(flags >> buffer_shift);
+        }
+    };
+
+    /* A file descriptor, or an index into the table given to
+       'io_context::register_files'. */
+    struct io_fd
+    {
+        int value;
+        bool fixed;
+
+        constexpr io_fd(int fd) noexcept
+            : value(fd), fixed(false)
+        {
+        }
+
+        static constexpr io_fd registered(unsigned index) noexcept
+        {
+            return io_fd(static_cast<int>(index), true);
+        }
+
+    private:
+        constexpr io_fd(int v, bool f) noexcept
+            : value(v), fixed(f)
+        {
+        }
+    };
+
+    struct io_context_options
+    {
+        /* Submission queue size, rounded up to a power of two by the
+           kernel. */
+        unsigned entries = 256;
+        /* Let a kernel thread poll the submission queue, which removes the
+           submit syscall at the cost of a busy core. */
+        bool sqpoll = false;
+        unsigned sqpoll_idle_ms = 1000;
+        /* Use the epoll reactor even when io_uring is available. */
+        bool force_epoll = false;
+    };
+
+    namespace detail
+    {
+        namespace io
+        {
+            enum class opcode : std::uint8_t
+            {
+                read,
+                write,
+                read_fixed,
+                write_fixed,
+                recv,
+                send,
+                accept,
+                fsync,
+                accept_multishot,
+                recv_multishot
+            };
+
+            /* One operation in flight. Callback operations allocate it,
+               awaitables embed it in the coroutine frame. */
+            struct request
+            {
+                using complete_function = void (*)(request*, int, std::uint32_t) noexcept;
+
+                complete_function complete = nullptr;
+                opcode code = opcode::read;
+                bool fixed_file = false;
+                /* Registered buffer index, or buffer group of a multishot
+                   recv. */
+                std::uint16_t buffer = 0;
+                int fd = -1;
+                void* data = nullptr;
+                std::uint32_t length = 0;
+                int msg_flags = 0;
+                std::uint64_t offset = 0;
+                /* Reactor wait lists. */
+                request* next = nullptr;
+            };
+
+            template<typename Function>
+            struct callback_request final : request
+            {
+                Function function;
+
+                explicit callback_request(Function&& f)
+                    : function(std::move(f))
+                {
+                    complete = &on_complete;
+                }
+
+                explicit callback_request(const Function& f)
+                    : function(f)
+                {
+                    complete = &on_complete;
+                }
+
+                static void on_complete(request* r, int result, std::uint32_t flags) noexcept
+                {
+                    callback_request* self = static_cast<callback_request*>(r);
+                    if ((flags & io_completion::flag_more) != 0)
+                    {
+                        self->function(io_completion{result, flags});
+                    }
+                    else
+                    {
+                        std::unique_ptr<callback_request> owner(self);
+                        self->function(io_completion{result, flags});
+                    }
+                }
+            };
+
+            struct buffer_group
+            {
+                unsigned char* base;
+                unsigned size;
+                unsigned count;
+                /* Free buffer ids, reactor only. */
+                std::vector<std::uint16_t> free_ids;
+            };
+
+            inline std::uint32_t clamp_length(size_t length) noexcept
+            {
+                return length > UINT32_MAX ? UINT32_MAX : static_cast<std::uint32_t>(length);
+            }
+
+            [[noreturn]] inline void throw_errno(int error, const char* what)
+            {
+                throw std::system_error(error, std::system_category(), what);
+            }
+
+#if defined(CPPP_IO_HAVE_URING)
+            /* io_uring through the raw system calls. */
+            class uring
+            {
+            private:
+                int ring_fd = -1;
+                bool polling = false;
+
+                void* sq_ring = MAP_FAILED;
+                void* cq_ring = MAP_FAILED;
+                size_t sq_ring_size = 0;
+                size_t cq_ring_size = 0;
+                io_uring_sqe* sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+                size_t sqes_size = 0;
+
+                unsigned* sq_head = nullptr;
+                unsigned* sq_tail = nullptr;
+                unsigned* sq_flags = nullptr;
+                unsigned sq_mask = 0;
+                unsigned sq_entries = 0;
+                /* Entries filled but not yet handed to the kernel. */
+                unsigned local_tail = 0;
+                unsigned submitted_tail = 0;
+
+                unsigned* cq_head = nullptr;
+                unsigned* cq_tail = nullptr;
+                unsigned cq_mask = 0;
+                io_uring_cqe* cqes = nullptr;
+
+            public:
+                /* Throws 'std::system_error' when the kernel refuses. */
+                explicit uring(const io_context_options& options)
+                {
+                    io_uring_params params;
+                    std::memset(&params, 0, sizeof(params));
+                    if (options.sqpoll)
+                    {
+                        params.flags |= IORING_SETUP_SQPOLL;
+                        params.sq_thread_idle = options.sqpoll_idle_ms;
+                        polling = true;
+                    }
+                    ring_fd = static_cast<int>(syscall(__NR_io_uring_setup, options.entries, &params));
+                    if (ring_fd < 0)
+                    {
+                        throw_errno(errno, "io_uring_setup");
+                    }
+                    try
+                    {
+                        map_rings(params);
+                    }
+                    catch (...)
+                    {
+                        unmap();
+                        throw;
+                    }
+                }
+
+                uring(const uring&) = delete;
+                uring& operator=(const uring&) = delete;
+
+                ~uring()
+                {
+                    unmap();
+                }
+
+                void register_resource(unsigned opcode, const void* arg, unsigned count, const char* what)
+                {
+                    if (syscall(__NR_io_uring_register, ring_fd, opcode, arg, count) < 0)
+                    {
+                        throw_errno(errno, what);
+                    }
+                }
+
+                /* Queue one operation, nothing reaches the kernel before
+                   'enter'. */
+                void start(request* r)
+                {
+                    io_uring_sqe* sqe = next_sqe();
+                    sqe->fd = r->fd;
+                    sqe->user_data = reinterpret_cast<std::uint64_t>(r);
+                    if (r->fixed_file)
+                    {
+                        sqe->flags |= IOSQE_FIXED_FILE;
+                    }
+                    switch (r->code)
+                    {
+                    case opcode::read:
+                    case opcode::write:
+                        sqe->opcode = r->code == opcode::read ? IORING_OP_READ : IORING_OP_WRITE;
+                        sqe->addr = reinterpret_cast<std::uint64_t>(r->data);
+                        sqe->len = r->length;
+                        sqe->off = r->offset;
+                        break;
+                    case opcode::read_fixed:
+                    case opcode::write_fixed:
+                        sqe->opcode = r->code == opcode::read_fixed ? IORING_OP_READ_FIXED : IORING_OP_WRITE_FIXED;
+                        sqe->addr = reinterpret_cast<std::uint64_t>(r->data);
+                        sqe->len = r->length;
+                        sqe->off = r->offset;
+                        sqe->buf_index = r->buffer;
+                        break;
+                    case opcode::recv:
+                    case opcode::send:
+                        sqe->opcode = r->code == opcode::recv ? IORING_OP_RECV : IORING_OP_SEND;
+                        sqe->addr = reinterpret_cast<std::uint64_t>(r->data);
+                        sqe->len = r->length;
+                        sqe->msg_flags = static_cast<std::uint32_t>(r->msg_flags);
+                        break;
+                    case opcode::accept:
+                    case opcode::accept_multishot:
+                        sqe->opcode = IORING_OP_ACCEPT;
+                        sqe->accept_flags = SOCK_CLOEXEC;
+                        if (r->code == opcode::accept_multishot)
+                        {
+                            sqe->ioprio |= IORING_ACCEPT_MULTISHOT;
+                        }
+                        break;
+                    case opcode::recv_multishot:
+                        sqe->opcode = IORING_OP_RECV;
+                        sqe->ioprio |= IORING_RECV_MULTISHOT;
+                        sqe->flags |= IOSQE_BUFFER_SELECT;
+                        sqe->buf_group = r->buffer;
+                        sqe->msg_flags = static_cast<std::uint32_t>(r->msg_flags);
+                        break;
+                    case opcode::fsync:
+                        sqe->opcode = IORING_OP_FSYNC;
+                        break;
+                    }
+                }
+
+                /* Hand 'count' buffers of 'size' bytes at 'base' to group
+                   'group', ids 'first_id' onwards. No completion is
+                   reported. */
+                void provide_buffers(std::uint16_t group, void* base, unsigned size, unsigned count, std::uint16_t first_id)
+                {
+                    io_uring_sqe* sqe = next_sqe();
+                    sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+                    sqe->fd = static_cast<int>(count);
+                    sqe->addr = reinterpret_cast<std::uint64_t>(base);
+                    sqe->len = size;
+                    sqe->off = first_id;
+                    sqe->buf_group = group;
+                    sqe->user_data = 0;
+                }
+
+                void cancel_fd(int fd, bool fixed)
+                {
+                    io_uring_sqe* sqe = next_sqe();
+                    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+                    sqe->fd = fd;
+                    sqe->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+                    if (fixed)
+                    {
+                        sqe->cancel_flags |= IORING_ASYNC_CANCEL_FD_FIXED;
+                    }
+                    sqe->user_data = 0;
+                }
+
+                /* Submit the queued entries and, when 'wait', block until at
+                   least one completion is available. Returns the number of
+                   entries submitted. */
+                unsigned enter(bool wait)
+                {
+                    unsigned count = local_tail - submitted_tail;
+                    __atomic_store_n(sq_tail, local_tail, __ATOMIC_RELEASE);
+                    submitted_tail = local_tail;
+                    unsigned flags = 0;
+                    unsigned to_submit = count;
+                    if (polling)
+                    {
+                        /* The kernel thread picks the entries up by itself
+                           unless it went to sleep. */
+                        to_submit = 0;
+                        std::atomic_thread_fence(std::memory_order_seq_cst);
+                        if (count != 0 && (__atomic_load_n(sq_flags, __ATOMIC_RELAXED) & IORING_SQ_NEED_WAKEUP) != 0)
+                        {
+                            flags |= IORING_ENTER_SQ_WAKEUP;
+                        }
+                    }
+                    if (wait)
+                    {
+                        flags |= IORING_ENTER_GETEVENTS;
+                    }
+                    if (to_submit == 0 && flags == 0)
+                    {
+                        return count;
+                    }
+                    for (;;)
+                    {
+                        long result = syscall(__NR_io_uring_enter, ring_fd, to_submit, wait ? 1u : 0u, flags, nullptr, 0);
+                        if (result >= 0)
+                        {
+                            break;
+                        }
+                        if (errno == EINTR)
+                        {
+                            continue;
+                        }
+                        if (errno == EAGAIN || errno == EBUSY)
+                        {
+                            /* Completion queue is full, let the caller reap. */
+                            break;
+                        }
+                        throw_errno(errno, "io_uring_enter");
+                    }
+                    return count;
+                }
+
+                /* Call 'dispatch(request*, result, flags)' for every
+                   completion, return how many user completions there were. */
+                template<typename Dispatch>
+                size_t reap(Dispatch&& dispatch)
+                {
+                    size_t count = 0;
+                    unsigned head = *cq_head;
+                    for (;;)
+                    {
+                        unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+                        if (head == tail)
+                        {
+                            break;
+                        }
+                        const io_uring_cqe& cqe = cqes[head & cq_mask];
+                        request* r = reinterpret_cast<request*>(cqe.user_data);
+                        int result = cqe.res;
+                        std::uint32_t flags = cqe.flags;
+                        /* Free the entry before the callback, which may queue
+                           more work. */
+                        __atomic_store_n(cq_head, ++head, __ATOMIC_RELEASE);
+                        if (r != nullptr)
+                        {
+                            dispatch(r, result, flags);
+                            ++count;
+                        }
+                    }
+                    return count;
+                }
+
+            private:
+                void map_rings(const io_uring_params& params)
+                {
+                    sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+                    cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+                    bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+                    if (single)
+                    {
+                        sq_ring_size = cq_ring_size = sq_ring_size > cq_ring_size ? sq_ring_size : cq_ring_size;
+                    }
+                    sq_ring = mmap(nullptr, sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+                    if (sq_ring == MAP_FAILED)
+                    {
+                        throw_errno(errno, "mmap io_uring");
+                    }
+                    if (single)
+                    {
+                        cq_ring = sq_ring;
+                    }
+                    else
+                    {
+                        cq_ring = mmap(nullptr, cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+                        if (cq_ring == MAP_FAILED)
+                        {
+                            throw_errno(errno, "mmap io_uring");
+                        }
+                    }
+                    sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+                    sqes = static_cast<io_uring_sqe*>(
+                        mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES));
+                    if (sqes == MAP_FAILED)
+                    {
+                        throw_errno(errno, "mmap io_uring");
+                    }
+
+                    unsigned char* sq = static_cast<unsigned char*>(sq_ring);
+                    sq_head = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+                    sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+                    sq_flags = reinterpret_cast<unsigned*>(sq + params.sq_off.flags);
+                    sq_mask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+                    sq_entries = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_entries);
+                    /* Entry 'i' of the index array always points at sqe 'i'. */
+                    unsigned* array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+                    for (unsigned i = 0; i < sq_entries; ++i)
+                    {
+                        array[i] = i;
+                    }
+                    local_tail = submitted_tail = *sq_tail;
+
+                    unsigned char* cq = static_cast<unsigned char*>(cq_ring);
+                    cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+                    cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+                    cq_mask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+                    cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+                }
+
+                void unmap() noexcept
+                {
+                    if (sqes != MAP_FAILED)
+                    {
+                        munmap(sqes, sqes_size);
+                    }
+                    if (cq_ring != MAP_FAILED && cq_ring != sq_ring)
+                    {
+                        munmap(cq_ring, cq_ring_size);
+                    }
+                    if (sq_ring != MAP_FAILED)
+                    {
+                        munmap(sq_ring, sq_ring_size);
+                    }
+                    if (ring_fd >= 0)
+                    {
+                        close(ring_fd);
+                    }
+                }
+
+                io_uring_sqe* next_sqe()
+                {
+                    while (local_tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE) >= sq_entries)
+                    {
+                        /* Full, push the pending entries to the kernel. */
+                        enter(false);
+                        if (polling)
+                        {
+                            std::this_thread::yield();
+                        }
+                    }
+                    io_uring_sqe* sqe = &sqes[local_tail & sq_mask];
+                    std::memset(sqe, 0, sizeof(*sqe));
+                    ++local_tail;
+                    return sqe;
+                }
+            };
+#endif
+
+            /* Operations waiting for readiness, in start order. */
+            struct wait_list
+            {
+                request* head = nullptr;
+                request* tail = nullptr;
+
+                bool empty() const noexcept
+                {
+                    return head == nullptr;
+                }
+
+                void push(request* r) noexcept
+                {
+                    r->next = nullptr;
+                    if (tail != nullptr)
+                    {
+                        tail->next = r;
+                    }
+                    else
+                    {
+                        head = r;
+                    }
+                    tail = r;
+                }
+
+                request* pop() noexcept
+                {
+                    request* r = head;
+                    head = r->next;
+                    if (head == nullptr)
+                    {
+                        tail = nullptr;
+                    }
+                    return r;
+                }
+            };
+
+            /* Reactor state of one descriptor. */
+            struct fd_state
+            {
+                wait_list readers;
+                wait_list writers;
+                std::uint32_t events = 0;
+            };
+
+            /* Readiness-based fallback. */
+            class reactor
+            {
+            private:
+                struct completion
+                {
+                    request* r;
+                    int result;
+                    std::uint32_t flags;
+                };
+
+                int epoll_fd;
+                flat_hash_map<int, fd_state> fds;
+                /* Operations run synchronously by 'process': fsync, and
+                   those on descriptors epoll refused (regular files).  The
+                   refusal is not remembered, the number may be reused for
+                   a socket by the time of the next operation. */
+                std::deque<request*> deferred;
+                std::vector<completion> completions;
+                const std::vector<int>* files;
+                flat_hash_map<std::uint16_t, buffer_group>* groups;
+
+            public:
+                reactor(const std::vector<int>& registered_files, flat_hash_map<std::uint16_t, buffer_group>& buffer_groups)
+                    : epoll_fd(epoll_create1(EPOLL_CLOEXEC)), files(&registered_files), groups(&buffer_groups)
+                {
+                    if (epoll_fd < 0)
+                    {
+                        throw_errno(errno, "epoll_create1");
+                    }
+                }
+
+                reactor(const reactor&) = delete;
+                reactor& operator=(const reactor&) = delete;
+
+                ~reactor()
+                {
+                    close(epoll_fd);
+                }
+
+                void start(request* r)
+                {
+                    if (r->fixed_file)
+                    {
+                        size_t index = static_cast<size_t>(r->fd);
+                        if (index >= files->size())
+                        {
+                            completions.push_back(completion{r, -EBADF, 0});
+                            return;
+                        }
+                        r->fd = (*files)[index];
+                        r->fixed_file = false;
+                    }
+                    if (r->code == opcode::fsync)
+                    {
+                        deferred.push_back(r);
+                        return;
+                    }
+                    bool reading = r->code == opcode::read || r->code == opcode::read_fixed || r->code == opcode::recv ||
+                                   r->code == opcode::accept || r->code == opcode::accept_multishot ||
+                                   r->code == opcode::recv_multishot;
+                    fd_state& state = fds[r->fd];
+                    (reading ? state.readers : state.writers).push(r);
+                    int error = update_interest(r->fd);
+                    if (error == EPERM)
+                    {
+                        /* Regular files are always ready, epoll refuses
+                           them. */
+                        drain(r->fd, [this](request* q) { deferred.push_back(q); });
+                    }
+                    else if (error != 0)
+                    {
+                        drain(r->fd, [this, error](request* q) { completions.push_back(completion{q, -error, 0}); });
+                    }
+                }
+
+                void cancel_fd(int fd)
+                {
+                    drain(fd, [this](request* q) { completions.push_back(completion{q, -ECANCELED, 0}); });
+                    std::deque<request*> kept;
+                    for (request* r : deferred)
+                    {
+                        if (r->fd == fd && r->code != opcode::fsync)
+                        {
+                            completions.push_back(completion{r, -ECANCELED, 0});
+                        }
+                        else
+                        {
+                            kept.push_back(r);
+                        }
+                    }
+                    deferred.swap(kept);
+                }
+
+                /* Run deferred operations, wait for readiness when 'wait'
+                   and nothing completed yet, then deliver completions. */
+                template<typename Dispatch>
+                size_t process(bool wait, Dispatch&& dispatch)
+                {
+                    std::deque<request*> batch;
+                    batch.swap(deferred);
+                    for (request* r : batch)
+                    {
+                        std::uint32_t flags = 0;
+                        int result = perform(r, flags);
+                        if (result == -EAGAIN || result == -EWOULDBLOCK)
+                        {
+                            /* Pollable after all, wait for readiness. */
+                            start(r);
+                        }
+                        else if (more(r, result))
+                        {
+                            /* Multishot on an always ready descriptor,
+                               runs again on the next round. */
+                            completions.push_back(completion{r, result, flags | io_completion::flag_more});
+                            deferred.push_back(r);
+                        }
+                        else
+                        {
+                            completions.push_back(completion{r, result, flags});
+                        }
+                    }
+                    if (!fds.empty())
+                    {
+                        epoll_event events[64];
+                        int timeout = wait && completions.empty() ? -1 : 0;
+                        int n = epoll_wait(epoll_fd, events, 64, timeout);
+                        for (int i = 0; i < n; ++i)
+                        {
+                            ready(events[i].data.fd, events[i].events);
+                        }
+                    }
+                    std::vector<completion> done;
+                    done.swap(completions);
+                    for (const completion& c : done)
+                    {
+                        dispatch(c.r, c.result, c.flags);
+                    }
+                    return done.size();
+                }
+
+            private:
+                template<typename Function>
+                void drain(int fd, Function&& function)
+                {
+                    auto it = fds.find(fd);
+                    if (it == fds.end())
+                    {
+                        return;
+                    }
+                    while (!it->second.readers.empty())
+                    {
+                        function(it->second.readers.pop());
+                    }
+                    while (!it->second.writers.empty())
+                    {
+                        function(it->second.writers.pop());
+                    }
+                    update_interest(fd);
+                }
+
+                /* Make the epoll registration match the wait lists, returns
+                   an errno value. */
+                int update_interest(int fd)
+                {
+                    auto it = fds.find(fd);
+                    if (it == fds.end())
+                    {
+                        return 0;
+                    }
+                    fd_state& state = it->second;
+                    std::uint32_t wanted = (state.readers.empty() ? 0u : static_cast<std::uint32_t>(EPOLLIN)) |
+                                           (state.writers.empty() ? 0u : static_cast<std::uint32_t>(EPOLLOUT));
+                    if (wanted == state.events)
+                    {
+                        if (wanted == 0)
+                        {
+                            fds.erase(it);
+                        }
+                        return 0;
+                    }
+                    epoll_event event;
+                    std::memset(&event, 0, sizeof(event));
+                    event.events = wanted;
+                    event.data.fd = fd;
+                    int op = wanted == 0 ? EPOLL_CTL_DEL : state.events == 0 ? EPOLL_CTL_ADD : EPOLL_CTL_MOD;
+                    int error = epoll_ctl(epoll_fd, op, fd, &event) == 0 ? 0 : errno;
+                    if (error == 0)
+                    {
+                        state.events = wanted;
+                    }
+                    if (wanted == 0 || error != 0)
+                    {
+                        if (state.readers.empty() && state.writers.empty())
+                        {
+                            fds.erase(it);
+                        }
+                    }
+                    return error;
+                }
+
+                void ready(int fd, std::uint32_t events)
+                {
+                    auto it = fds.find(fd);
+                    if (it == fds.end())
+                    {
+                        return;
+                    }
+                    std::uint32_t failure = EPOLLERR | EPOLLHUP;
+                    /* One operation per list and event, level triggering
+                       reports the descriptor again if it is still ready.
+                       This keeps a blocking descriptor from blocking the
+                       loop. */
+                    if ((events & (EPOLLIN | failure)) != 0)
+                    {
+                        advance(it->second.readers);
+                    }
+                    if ((events & (EPOLLOUT | failure)) != 0)
+                    {
+                        advance(it->second.writers);
+                    }
+                    update_interest(fd);
+                }
+
+                void advance(wait_list& list)
+                {
+                    if (list.empty())
+                    {
+                        return;
+                    }
+                    request* r = list.head;
+                    std::uint32_t flags = 0;
+                    int result = perform(r, flags);
+                    if (result == -EAGAIN || result == -EWOULDBLOCK)
+                    {
+                        return;
+                    }
+                    if (more(r, result))
+                    {
+                        completions.push_back(completion{r, result, flags | io_completion::flag_more});
+                        return;
+                    }
+                    list.pop();
+                    completions.push_back(completion{r, result, flags});
+                }
+
+                /* Whether a multishot operation continues after 'result'.
+                   Multishot accept ends on an error, multishot recv also on
+                   end of stream. */
+                static bool more(const request* r, int result) noexcept
+                {
+                    switch (r->code)
+                    {
+                    case opcode::accept_multishot:
+                        return result >= 0;
+                    case opcode::recv_multishot:
+                        return result > 0;
+                    default:
+                        return false;
+                    }
+                }
+
+                int perform(request* r, std::uint32_t& flags)
+                {
+                    ssize_t result = -1;
+                    switch (r->code)
+                    {
+                    case opcode::read:
+                    case opcode::read_fixed:
+                        result = r->offset == static_cast<std::uint64_t>(-1)
+                                     ? ::read(r->fd, r->data, r->length)
+                                     : ::pread(r->fd, r->data, r->length, static_cast<off_t>(r->offset));
+                        break;
+                    case opcode::write:
+                    case opcode::write_fixed:
+                        result = r->offset == static_cast<std::uint64_t>(-1)
+                                     ? ::write(r->fd, r->data, r->length)
+                                     : ::pwrite(r->fd, r->data, r->length, static_cast<off_t>(r->offset));
+                        break;
+                    case opcode::recv:
+                        result = ::recv(r->fd, r->data, r->length, r->msg_flags | MSG_DONTWAIT);
+                        break;
+                    case opcode::send:
+                        result = ::send(r->fd, r->data, r->length, r->msg_flags | MSG_DONTWAIT);
+                        break;
+                    case opcode::accept:
+                    case opcode::accept_multishot:
+                        result = ::accept4(r->fd, nullptr, nullptr, SOCK_CLOEXEC);
+                        break;
+                    case opcode::fsync:
+                        result = ::fsync(r->fd);
+                        break;
+                    case opcode::recv_multishot:
+                        return recv_selected(r, flags);
+                    }
+                    return result < 0 ? -errno : static_cast<int>(result);
+                }
+
+                /* Multishot recv into a buffer of the request's group. */
+                int recv_selected(request* r, std::uint32_t& flags)
+                {
+                    auto group = groups->find(r->buffer);
+                    if (group == groups->end() || group->second.free_ids.empty())
+                    {
+                        return -ENOBUFS;
+                    }
+                    buffer_group& g = group->second;
+                    std::uint16_t id = g.free_ids.back();
+                    ssize_t result = ::recv(r->fd, g.base + static_cast<size_t>(id) * g.size, g.size, r->msg_flags | MSG_DONTWAIT);
+                    if (result <= 0)
+                    {
+                        return result < 0 ? -errno : 0;
+                    }
+                    g.free_ids.pop_back();
+                    flags = io_completion::flag_buffer | (static_cast<std::uint32_t>(id) << io_completion::buffer_shift);
+                    return static_cast<int>(result);
+                }
+            };
+        } // namespace io
+    } // namespace detail
+
+    /* Completion-based I/O loop, see the top of this file. */
+    class io_context
+    {
+    private:
+        using request = detail::io::request;
+        using opcode = detail::io::opcode;
+
+        std::vector<int> files;
+        flat_hash_map<std::uint16_t, detail::io::buffer_group> groups;
+#if defined(CPPP_IO_HAVE_URING)
+        std::unique_ptr<detail::io::uring> ring;
+#endif
+        std::unique_ptr<detail::io::reactor> fallback;
+        /* Operations started and not finished, multishot ones count once. */
+        size_t in_flight = 0;
+
+    public:
+        /* Offset meaning "the current file position" for streams such as
+           pipes and sockets. */
+        static constexpr std::uint64_t current_position = static_cast<std::uint64_t>(-1);
+
+        /* Throws 'std::system_error' when neither io_uring nor epoll can be
+           set up. */
+        explicit io_context(const io_context_options& options = io_context_options())
+        {
+#if defined(CPPP_IO_HAVE_URING)
+            if (!options.force_epoll)
+            {
+                try
+                {
+                    ring.reset(new detail::io::uring(options));
+                }
+                catch (const std::system_error& e)
+                {
+                    /* ENOSYS: old kernel, EPERM: disabled by policy. */
+                    if (e.code().value() != ENOSYS && e.code().value() != EPERM && e.code().value() != EINVAL)
+                    {
+                        throw;
+                    }
+                }
+            }
+            if (ring)
+            {
+                return;
+            }
+#else
+            (void)options;
+#endif
+            fallback.reset(new detail::io::reactor(files, groups));
+        }
+
+        io_context(const io_context&) = delete;
+        io_context& operator=(const io_context&) = delete;
+
+        /* Every operation must have completed, see 'run'. */
+        ~io_context() = default;
+
+        bool uses_io_uring() const noexcept
+        {
+#if defined(CPPP_IO_HAVE_URING)
+            return ring != nullptr;
+#else
+            return false;
+#endif
+        }
+
+        /* Operations in flight. */
+        size_t pending() const noexcept
+        {
+            return in_flight;
+        }
+
+        /* Registration, call before starting operations that use it. */
+
+        /* Pin 'count' buffers once so that 'read_fixed' and 'write_fixed'
+           do not map pages per operation. */
+        void register_buffers(const iovec* buffers, unsigned count)
+        {
+#if defined(CPPP_IO_HAVE_URING)
+            if (ring)
+            {
+                ring->register_resource(IORING_REGISTER_BUFFERS, buffers, count, "io_uring_register buffers");
+            }
+#endif
+            (void)buffers;
+            (void)count;
+        }
+
+        /* Give descriptors fixed indexes, use them with
+           'io_fd::registered(index)'. */
+        void register_files(const int* fds, unsigned count)
+        {
+#if defined(CPPP_IO_HAVE_URING)
+            if (ring)
+            {
+                ring->register_resource(IORING_REGISTER_FILES, fds, count, "io_uring_register files");
+            }
+#endif
+            files.assign(fds, fds + count);
+        }
+
+        /* Give 'count' buffers of 'size' bytes at 'base' to buffer group
+           'group' for 'recv_multishot'. Each completion with a buffer
+           reports its id, return the buffer with 'recycle_buffer' once it
+           is consumed. */
+        void provide_buffers(std::uint16_t group, void* base, unsigned size, unsigned count)
+        {
+            if (count == 0 || count > 65536 || size == 0)
+            {
+                throw std::invalid_argument("io_context::provide_buffers: bad buffer count or size");
+            }
+            detail::io::buffer_group& g = groups[group];
+            g.base = static_cast<unsigned char*>(base);
+            g.size = size;
+            g.count = count;
+            g.free_ids.clear();
+#if defined(CPPP_IO_HAVE_URING)
+            if (ring)
+            {
+                ring->provide_buffers(group, base, size, count, 0);
+                return;
+            }
+#endif
+            for (unsigned i = count; i-- != 0;)
+            {
+                g.free_ids.push_back(static_cast<std::uint16_t>(i));
+            }
+        }
+
+        void* buffer_address(std::uint16_t group, std::uint16_t id) const
+        {
+            auto it = groups.find(group);
+            if (it == groups.end() || id >= it->second.count)
+            {
+                throw std::out_of_range("io_context::buffer_address");
+            }
+            return it->second.base + static_cast<size_t>(id) * it->second.size;
+        }
+
+        void recycle_buffer(std::uint16_t group, std::uint16_t id)
+        {
+#if defined(CPPP_IO_HAVE_URING)
+            if (ring)
+            {
+                ring->provide_buffers(group, buffer_address(group, id), groups.find(group)->second.size, 1, id);
+                return;
+            }
+#endif
+            buffer_address(group, id);
+            groups.find(group)->second.free_ids.push_back(id);
+        }
+
+        /* Callback operations. 'callback' is called with an
+           'io_completion' and must not throw. */
+
+        template<typename Function>
+        void read(io_fd file, void* buffer, size_t length, std::uint64_t offset, Function&& callback)
+        {
+            start_callback(make(opcode::read, file, buffer, length, offset), std::forward<Function>(callback));
+        }
+
+        template<typename Function>
+        void write(io_fd file, const void* buffer, size_t length, std::uint64_t offset, Function&& callback)
+        {
+            start_callback(make(opcode::write, file, const_cast<void*>(buffer), length, offset), std::forward<Function>(callback));
+        }
+
+        /* 'buffer' must lie inside registered buffer 'buffer_index'. */
+        template<typename Function>
+        void read_fixed(io_fd file, void* buffer, size_t length, std::uint64_t offset, unsigned buffer_index, Function&& callback)
+        {
+            request r = make(opcode::read_fixed, file, buffer, length, offset);
+            r.buffer = static_cast<std::uint16_t>(buffer_index);
+            start_callback(r, std::forward<Function>(callback));
+        }
+
+        template<typename Function>
+        void write_fixed(io_fd file, const void* buffer, size_t length, std::uint64_t offset, unsigned buffer_index,
+                         Function&& callback)
+        {
+            request r = make(opcode::write_fixed, file, const_cast<void*>(buffer), length, offset);
+            r.buffer = static_cast<std::uint16_t>(buffer_index);
+            start_callback(r, std::forward<Function>(callback));
+        }
+
+        template<typename Function>
+        void recv(io_fd socket, void* buffer, size_t length, int flags, Function&& callback)
+        {
+            request r = make(opcode::recv, socket, buffer, length, 0);
+            r.msg_flags = flags;
+            start_callback(r, std::forward<Function>(callback));
+        }
+
+        template<typename Function>
+        void send(io_fd socket, const void* buffer, size_t length, int flags, Function&& callback)
+        {
+            request r = make(opcode::send, socket, const_cast<void*>(buffer), length, 0);
+            r.msg_flags = flags;
+            start_callback(r, std::forward<Function>(callback));
+        }
+
+        /* The result is the accepted descriptor, opened with
+           'SOCK_CLOEXEC'. */
+        template<typename Function>
+        void accept(io_fd socket, Function&& callback)
+        {
+            start_callback(make(opcode::accept, socket, nullptr, 0, 0), std::forward<Function>(callback));
+        }
+
+        template<typename Function>
+        void fsync(io_fd file, Function&& callback)
+        {
+            start_callback(make(opcode::fsync, file, nullptr, 0, 0), std::forward<Function>(callback));
+        }
+
+        /* One completion per accepted connection until an error or
+           'cancel_fd'. */
+        template<typename Function>
+        void accept_multishot(io_fd socket, Function&& callback)
+        {
+            start_callback(make(opcode::accept_multishot, socket, nullptr, 0, 0), std::forward<Function>(callback));
+        }
+
+        /* One completion per received chunk, each in a buffer of 'group'
+           (see 'provide_buffers'), until end of stream, an error, running
+           out of buffers ('-ENOBUFS') or 'cancel_fd'. */
+        template<typename Function>
+        void recv_multishot(io_fd socket, std::uint16_t group, int flags, Function&& callback)
+        {
+            request r = make(opcode::recv_multishot, socket, nullptr, 0, 0);
+            r.buffer = group;
+            r.msg_flags = flags;
+            start_callback(r, std::forward<Function>(callback));
+        }
+
+        /* Complete every operation waiting on 'file' with '-ECANCELED'
+           (operations the kernel already finished still report their
+           result). */
+        void cancel_fd(io_fd file)
+        {
+#if defined(CPPP_IO_HAVE_URING)
+            if (ring)
+            {
+                ring->cancel_fd(file.value, file.fixed);
+                return;
+            }
+#endif
+            fallback->cancel_fd(file.fixed ? files.at(static_cast<size_t>(file.value)) : file.value);
+        }
+
+        /* Event loop. */
+
+        /* Submit queued operations without waiting. */
+        void submit()
+        {
+#if defined(CPPP_IO_HAVE_URING)
+            if (ring)
+            {
+                ring->enter(false);
+            }
+#endif
+        }
+
+        /* Submit, then deliver the completions that are ready without
+           blocking. Returns the number delivered. */
+        size_t poll()
+        {
+            return step(false);
+        }
+
+        /* Submit, then wait until at least one completion is delivered,
+           unless nothing is in flight. */
+        size_t run_once()
+        {
+            if (in_flight == 0)
+            {
+                submit();
+                return 0;
+            }
+            size_t count;
+            while ((count = step(true)) == 0 && in_flight != 0)
+            {
+            }
+            return count;
+        }
+
+        /* Run until no operation is in flight. */
+        void run()
+        {
+            while (in_flight != 0)
+            {
+                run_once();
+            }
+        }
+
+#if defined(CPPP_HAVE_COROUTINES)
+        /* Awaitable operation, 'co_await' gives the result. The coroutine
+           is resumed from the event loop. */
+        class operation : private request
+        {
+        private:
+            friend class io_context;
+
+            io_context* context;
+            std::coroutine_handle<> waiter;
+            int result = 0;
+
+            operation(io_context& c, const request& r) noexcept
+                : request(r), context(&c)
+            {
+                complete = &on_complete;
+            }
+
+            static void on_complete(request* r, int res, std::uint32_t) noexcept
+            {
+                operation* self = static_cast<operation*>(r);
+                self->result = res;
+                self->waiter.resume();
+            }
+
+        public:
+            operation(const operation&) = delete;
+            operation& operator=(const operation&) = delete;
+
+            bool await_ready() const noexcept
+            {
+                return false;
+            }
+
+            void await_suspend(std::coroutine_handle<> h)
+            {
+                waiter = h;
+                context->start(this);
+            }
+
+            int await_resume() const noexcept
+            {
+                return result;
+            }
+        };
+
+        operation async_read(io_fd file, void* buffer, size_t length, std::uint64_t offset)
+        {
+            return operation(*this, make(opcode::read, file, buffer, length, offset));
+        }
+
+        operation async_write(io_fd file, const void* buffer, size_t length, std::uint64_t offset)
+        {
+            return operation(*this, make(opcode::write, file, const_cast<void*>(buffer), length, offset));
+        }
+
+        operation async_read_fixed(io_fd file, void* buffer, size_t length, std::uint64_t offset, unsigned buffer_index)
+        {
+            request r = make(opcode::read_fixed, file, buffer, length, offset);
+            r.buffer = static_cast<std::uint16_t>(buffer_index);
+            return operation(*this, r);
+        }
+
+        operation async_write_fixed(io_fd file, const void* buffer, size_t length, std::uint64_t offset, unsigned buffer_index)
+        {
+            request r = make(opcode::write_fixed, file, const_cast<void*>(buffer), length, offset);
+            r.buffer = static_cast<std::uint16_t>(buffer_index);
+            return operation(*this, r);
+        }
+
+        operation async_recv(io_fd socket, void* buffer, size_t length, int flags = 0)
+        {
+            request r = make(opcode::recv, socket, buffer, length, 0);
+            r.msg_flags = flags;
+            return operation(*this, r);
+        }
+
+        operation async_send(io_fd socket, const void* buffer, size_t length, int flags = 0)
+        {
+            request r = make(opcode::send, socket, const_cast<void*>(buffer), length, 0);
+            r.msg_flags = flags;
+            return operation(*this, r);
+        }
+
+        operation async_accept(io_fd socket)
+        {
+            return operation(*this, make(opcode::accept, socket, nullptr, 0, 0));
+        }
+
+        operation async_fsync(io_fd file)
+        {
+            return operation(*this, make(opcode::fsync, file, nullptr, 0, 0));
+        }
+#endif
+
+    private:
+        static request make(opcode code, io_fd file, void* buffer, size_t length, std::uint64_t offset) noexcept
+        {
+            request r;
+            r.code = code;
+            r.fd = file.value;
+            r.fixed_file = file.fixed;
+            r.data = buffer;
+            r.length = detail::io::clamp_length(length);
+            r.offset = offset;
+            return r;
+        }
+
+        template<typename Function>
+        void start_callback(const request& description, Function&& callback)
+        {
+            using node_type = detail::io::callback_request<typename std::decay<Function>::type>;
+            std::unique_ptr<node_type> node(new node_type(std::forward<Function>(callback)));
+            request& r = *node;
+            request::complete_function complete = r.complete;
+            r = description;
+            r.complete = complete;
+            start(node.get());
+            node.release();
+        }
+
+        void start(request* r)
+        {
+#if defined(CPPP_IO_HAVE_URING)
+            if (ring)
+            {
+                ring->start(r);
+                ++in_flight;
+                return;
+            }
+#endif
+            fallback->start(r);
+            ++in_flight;
+        }
+
+        size_t step(bool wait)
+        {
+            auto dispatch = [this](request* r, int result, std::uint32_t flags)
+            {
+                if ((flags & io_completion::flag_more) == 0)
+                {
+                    --in_flight;
+                }
+                r->complete(r, result, flags);
+            };
+#if defined(CPPP_IO_HAVE_URING)
+            if (ring)
+            {
+                size_t count = ring->reap(dispatch);
+                if (count != 0)
+                {
+                    ring->enter(false);
+                    return count;
+                }
+                ring->enter(wait && in_flight != 0);
+                return ring->reap(dispatch);
+            }
+#endif
+            return fallback->process(wait && in_flight != 0, dispatch);
+        }
+    };
+} // namespace cppp
+
+#endif
+
+#endif
@@ -0,0 +1,446 @@
+/* Copyright (C) 1999-2023 Free Software Foundation, Inc.
+   This file is part of the cppp-base library.
+
+   The cppp-base library is free software; you can redistribute it
+   and/or modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either version 3
+   of the License, or (at your option) any later version.
+
+   The cppp-base library is distributed in the hope that it will be
+   useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the cppp-base library; see the file COPYING.
+   If not, see <https://www.gnu.org/licenses/>.  */
+
+/* We do not use '#pragma once' because it may has bugs in some compiler. */
+#ifndef _CPPP_ISTRING_HPP
+#define _CPPP_ISTRING_HPP
+
+/* C++ Plus interned immutable string */
+
+#include "arena.hpp"
+#include "basedef.hpp"
+#include "hardware.hpp"
+#include "hash.hpp"
+#include "string.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <ostream>
+#include <string>
+#if CPPP_CPLUSPLUS >= 201703L
+#include <string_view>
+#endif
+
+namespace cppp
+{
+    namespace detail
+    {
+        namespace interning
+        {
+            /* An interned string, with its characters right after it. */
+            struct entry
+            {
+                std::uint64_t hash;
+                size_t size;
+
+                const char* data() const noexcept
+                {
+                    return reinterpret_cast<const char*>(this + 1);
+                }
+            };
+
+            /* Open addressing with linear probing. Slots go from null to
+               an entry once and never change again. */
+            struct slot_array
+            {
+                size_t mask;
+                std::atomic<const entry*>* slots;
+            };
+
+            /* Lookups of interned strings take no lock: they read the
+               current slot array and its slots with acquire loads. Inserts
+               take the shard lock, fill a slot with a release store, and
+               on growth publish a rehashed copy. Slot arrays and entries
+               live in the shard's arena and are never freed, so a replaced
+               array stays valid for readers still probing it. */
+            struct alignas(destructive_interference_size) shard
+            {
+                std::atomic<slot_array*> table{nullptr};
+                std::mutex lock;
+                size_t count = 0;
+                arena storage{arena_growth_policy(16 * 1024, 1024 * 1024)};
+            };
+
+            class intern_table
+            {
+            private:
+                static constexpr size_t shard_bits = 6;
+                static constexpr size_t initial_slots = 64;
+
+                shard shards[size_t(1) << shard_bits];
+                std::uint64_t seed = random_hash_seed();
+
+            public:
+                /* Created on first use and never destroyed, so strings
+                   interned by static objects outlive every user. */
+                static intern_table& instance()
+                {
+                    alignas(intern_table) static unsigned char storage[sizeof(intern_table)];
+                    static intern_table* const table = new (storage) intern_table();
+                    return *table;
+                }
+
+                std::uint64_t hash(const char* s, size_t n) const noexcept
+                {
+                    return hash_bytes(s, n, seed);
+                }
+
+                const entry* find(const char* s, size_t n, std::uint64_t h) const noexcept
+                {
+                    const slot_array* t = shard_of(h).table.load(std::memory_order_acquire);
+                    return t != nullptr ? probe(t, s, n, h) : nullptr;
+                }
+
+                const entry* intern(const char* s, size_t n)
+                {
+                    std::uint64_t h = hash(s, n);
+                    const entry* found = find(s, n, h);
+                    return found != nullptr ? found : insert(s, n, h);
+                }
+
+                size_t size()
+                {
+                    size_t total = 0;
+                    for (shard& sh : shards)
+                    {
+                        std::lock_guard<std::mutex> guard(sh.lock);
+                        total += sh.count;
+                    }
+                    return total;
+                }
+
+            private:
+                intern_table() = default;
+
+                shard& shard_of(std::uint64_t h) noexcept
+                {
+                    return shards[h >> (64 - shard_bits)];
+                }
+
+                const shard& shard_of(std::uint64_t h) const noexcept
+                {
+                    return shards[h >> (64 - shard_bits)];
+                }
+
+                static const entry* probe(const slot_array* t, const char* s, size_t n, std::uint64_t h) noexcept
+                {
+                    for (size_t i = static_cast<size_t>(h) & t->mask;; i = (i + 1) & t->mask)
+                    {
+                        const entry* e = t->slots[i].load(std::memory_order_acquire);
+                        if (e == nullptr)
+                        {
+                            return nullptr;
+                        }
+                        if (e->hash == h && e->size == n && std::memcmp(e->data(), s, n) == 0)
+                        {
+                            return e;
+                        }
+                    }
+                }
+
+                static void place(slot_array* t, const entry* e) noexcept
+                {
+                    size_t i = static_cast<size_t>(e->hash) & t->mask;
+                    while (t->slots[i].load(std::memory_order_relaxed) != nullptr)
+                    {
+                        i = (i + 1) & t->mask;
+                    }
+                    t->slots[i].store(e, std::memory_order_release);
+                }
+
+                /* A slot array in the shard's arena, all slots null. */
+                static slot_array* make_array(shard& sh, size_t slots)
+                {
+                    slot_array* t = sh.storage.create<slot_array>();
+                    t->mask = slots - 1;
+                    t->slots = sh.storage.allocate_array<std::atomic<const entry*>>(slots);
+                    for (size_t i = 0; i < slots; ++i)
+                    {
+                        new (&t->slots[i]) std::atomic<const entry*>(nullptr);
+                    }
+                    return t;
+                }
+
+                CPPP_NOINLINE const entry* insert(const char* s, size_t n, std::uint64_t h)
+                {
+                    shard& sh = shard_of(h);
+                    std::lock_guard<std::mutex> guard(sh.lock);
+                    slot_array* t = sh.table.load(std::memory_order_relaxed);
+                    if (t != nullptr)
+                    {
+                        /* Another thread may have won the race. */
+                        const entry* found = probe(t, s, n, h);
+                        if (found != nullptr)
+                        {
+                            return found;
+                        }
+                    }
+                    /* Keep the load factor at or below one half. */
+                    if (t == nullptr || (sh.count + 1) * 2 > t->mask + 1)
+                    {
+                        slot_array* grown = make_array(sh, t == nullptr ? initial_slots : (t->mask + 1) * 2);
+                        if (t != nullptr)
+                        {
+                            for (size_t i = 0; i <= t->mask; ++i)
+                            {
+                                const entry* e = t->slots[i].load(std::memory_order_relaxed);
+                                if (e != nullptr)
+                                {
+                                    place(grown, e);
+                                }
+                            }
+                        }
+                        sh.table.store(grown, std::memory_order_release);
+                        t = grown;
+                    }
+                    void* memory = sh.storage.allocate(sizeof(entry) + n + 1, alignof(entry));
+                    entry* e = new (memory) entry{h, n};
+                    char* text = reinterpret_cast<char*>(e + 1);
+                    std::memcpy(text, s, n);
+                    text[n] = '\0';
+                    place(t, e);
+                    ++sh.count;
+                    return e;
+                }
+            };
+        } // namespace interning
+    } // namespace detail
+
+    /* An immutable string stored once per process.
+
+       Constructing an 'istring' looks the characters up in a global
+       table and stores a pointer to the shared copy, adding one if
+       needed. Equal strings then share that pointer: comparison is a
+       pointer compare, and 'hash' is computed at interning time.
+       Interning a string already in the table takes no lock.
+
+       Interned strings are never freed. Use it for the bounded
+       vocabularies of a program, such as field names, metric labels and
+       symbols, and not for arbitrary input.
+
+       An 'istring' is one pointer and trivially copyable. The empty
+       string is the null pointer and needs no table. */
+    class istring
+    {
+    private:
+        const detail::interning::entry* entry = nullptr;
+
+        explicit istring(const detail::interning::entry* e) noexcept : entry(e)
+        {
+        }
+
+        static const detail::interning::entry* intern(const char* s, size_t n)
+        {
+            return n == 0 ? nullptr : detail::interning::intern_table::instance().intern(s, n);
+        }
+
+    public:
+        using size_type = size_t;
+        using const_iterator = const char*;
+
+        constexpr istring() noexcept = default;
+
+        istring(const char* s, size_t n) : entry(intern(s, n))
+        {
+        }
+
+        explicit istring(const char* s) : entry(intern(s, std::strlen(s)))
+        {
+        }
+
+        explicit istring(const std::string& s) : entry(intern(s.data(), s.size()))
+        {
+        }
+
+        explicit istring(const string& s) : entry(intern(s.data(), s.size()))
+        {
+        }
+
+#if CPPP_CPLUSPLUS >= 201703L
+        explicit istring(std::string_view s) : entry(intern(s.data(), s.size()))
+        {
+        }
+#endif
+
+        /* The interned copy of 's' if there is one, else false, without
+           adding it. For checking untrusted input against a vocabulary. */
+        static bool find(const char* s, size_t n, istring& result)
+        {
+            if (n == 0)
+            {
+                result = istring();
+                return true;
+            }
+            detail::interning::intern_table& table = detail::interning::intern_table::instance();
+            const detail::interning::entry* e = table.find(s, n, table.hash(s, n));
+            if (e == nullptr)
+            {
+                return false;
+            }
+            result = istring(e);
+            return true;
+        }
+
+        /* Number of distinct strings interned so far. */
+        static size_t interned_count()
+        {
+            return detail::interning::intern_table::instance().size();
+        }
+
+        const char* data() const noexcept
+        {
+            return entry != nullptr ? entry->data() : "";
+        }
+
+        const char* c_str() const noexcept
+        {
+            return data();
+        }
+
+        size_type size() const noexcept
+        {
+            return entry != nullptr ? entry->size : 0;
+        }
+
+        size_type length() const noexcept
+        {
+            return size();
+        }
+
+        bool empty() const noexcept
+        {
+            return entry == nullptr;
+        }
+
+        const_iterator begin() const noexcept
+        {
+            return data();
+        }
+
+        const_iterator end() const noexcept
+        {
+            return data() + size();
+        }
+
+        char operator[](size_type pos) const noexcept
+        {
+            return data()[pos];
+        }
+
+        /* Precomputed, well mixed hash of the characters. Stable within a
+           process only, the table uses a random seed. */
+        size_t hash() const noexcept
+        {
+            return entry != nullptr ? static_cast<size_t>(entry->hash) : 0;
+        }
+
+        /* A number unique to the characters, for use as an integer key. */
+        std::uintptr_t id() const noexcept
+        {
+            return reinterpret_cast<std::uintptr_t>(entry);
+        }
+
+#if CPPP_CPLUSPLUS >= 201703L
+        operator std::string_view() const noexcept
+        {
+            return std::string_view(data(), size());
+        }
+#endif
+
+        std::string str() const
+        {
+            return std::string(data(), size());
+        }
+
+        int compare(const istring& other) const noexcept
+        {
+            if (entry == other.entry)
+            {
+                return 0;
+            }
+            size_type a = size(), b = other.size();
+            int result = std::memcmp(data(), other.data(), a < b ? a : b);
+            return result != 0 ? result : a < b ? -1 : 1;
+        }
+
+        friend bool operator==(const istring& a, const istring& b) noexcept
+        {
+            return a.entry == b.entry;
+        }
+
+        friend bool operator!=(const istring& a, const istring& b) noexcept
+        {
+            return a.entry != b.entry;
+        }
+
+        /* Ordered by characters, so sorted output does not depend on
+           interning order. */
+        friend bool operator<(const istring& a, const istring& b) noexcept
+        {
+            return a.compare(b) < 0;
+        }
+
+        friend bool operator<=(const istring& a, const istring& b) noexcept
+        {
+            return a.compare(b) <= 0;
+        }
+
+        friend bool operator>(const istring& a, const istring& b) noexcept
+        {
+            return a.compare(b) > 0;
+        }
+
+        friend bool operator>=(const istring& a, const istring& b) noexcept
+        {
+            return a.compare(b) >= 0;
+        }
+    };
+
+    inline std::ostream& operator<<(std::ostream& os, const istring& s)
+    {
+        return os.write(s.data(), static_cast<std::streamsize>(s.size()));
+    }
+
+    template<>
+    struct hash<istring> : detail::hashing::seeded
+    {
+        using seeded::seeded;
+
+        size_t operator()(const istring& value) const noexcept
+        {
+            return seed == default_hash_seed ? value.hash()
+                                             : static_cast<size_t>(detail::hashing::hash_integer(value.hash(), seed));
+        }
+    };
+} // namespace cppp
+
+namespace std
+{
+    template<>
+    struct hash<cppp::istring>
+    {
+        size_t operator()(const cppp::istring& value) const noexcept
+        {
+            return value.hash();
+        }
+    };
+} // namespace std
+
+#endif
@@ -0,0 +1,459 @@
+/* Copyright (C) 1999-2023 Free Software Foundation, Inc.
+   This file is part of the cppp-base library.
+
+   The cppp-base library is free software; you can redistribute it
+   and/or modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either version 3
+   of the License, or (at your option) any later version.
+
+   The cppp-base library is distributed in the hope that it will be
+   useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the cppp-base library; see the file COPYING.
+   If not, see <https://www.gnu.org/licenses/>.  */
+
+/* We do not use '#pragma once' because it may has bugs in some compiler. */
+#ifndef _CPPP_MAPPED_FILE_HPP
+#define _CPPP_MAPPED_FILE_HPP
+
+/* C++ Plus memory-mapped files */
+
+#include "basedef.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+
+#include "hardware.hpp"
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+#if CPPP_CPLUSPLUS >= 202002L && defined(__has_include)
+#if __has_include(<span>)
+#include <span>
+#endif
+#endif
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* A mapping gives the bytes of a file without a 'read' copy: pages are
+   faulted in from the page cache on first touch. Large scans should use
+   'advise_sequential' so the kernel reads ahead aggressively and drops
+   pages behind the reader. Random lookups should use 'advise_random',
+   which stops read-ahead from pulling in pages nobody asked for.
+   'populate' (Linux) faults in the whole file during mapping, so a
+   latency-sensitive path takes no page faults later. */
+
+namespace cppp
+{
+    enum class map_mode
+    {
+        /* Shared read-only mapping. */
+        read_only,
+        /* Shared writable mapping, stores reach the file. The file is
+           created if missing. */
+        read_write,
+        /* Private writable mapping, stores stay in this process. */
+        copy_on_write
+    };
+
+    enum class huge_page_mode
+    {
+        none,
+        /* Ask for transparent huge pages with 'madvise(MADV_HUGEPAGE)'.
+           This is a hint and is silently ignored when unsupported. */
+        transparent,
+        /* Map with 'MAP_HUGETLB'. The file must live on hugetlbfs,
+           otherwise mapping fails. */
+        hugetlb
+    };
+
+    struct mapped_file_options
+    {
+        /* Fault in every page while mapping ('MAP_POPULATE', Linux only). */
+        bool populate = false;
+        huge_page_mode huge_pages = huge_page_mode::none;
+    };
+
+    namespace detail
+    {
+        namespace mapping
+        {
+            [[noreturn]] inline void throw_errno(const char* what)
+            {
+                throw std::system_error(errno, std::system_category(), what);
+            }
+
+            /* Widen [offset, offset + length) to whole pages inside a
+               mapping of 'size' bytes. Returns false when it is empty. */
+            inline bool page_range(size_t size, size_t offset, size_t length, size_t& begin, size_t& count) noexcept
+            {
+                if (offset >= size)
+                {
+                    return false;
+                }
+                if (length > size - offset)
+                {
+                    length = size - offset;
+                }
+                if (length == 0)
+                {
+                    return false;
+                }
+                begin = offset & ~(query_page_size() - 1);
+                count = offset + length - begin;
+                return true;
+            }
+        } // namespace mapping
+    } // namespace detail
+
+    /* An open file mapped into memory. Moving transfers the mapping, and
+       the destructor unmaps it and closes the file. Errors throw
+       'std::system_error'. An empty file gives an empty view with a null
+       'data()'. */
+    class mapped_file
+    {
+    private:
+        int fd = -1;
+        unsigned char* base = nullptr;
+        size_t length = 0;
+        map_mode mode = map_mode::read_only;
+        mapped_file_options options;
+
+    public:
+        static constexpr size_t npos = static_cast<size_t>(-1);
+
+        mapped_file() noexcept = default;
+
+        explicit mapped_file(const char* path, map_mode m = map_mode::read_only,
+                             const mapped_file_options& o = mapped_file_options())
+            : mode(m), options(o)
+        {
+            fd = ::open(path, (m == map_mode::read_write ? O_RDWR | O_CREAT : O_RDONLY) | O_CLOEXEC, 0644);
+            if (fd < 0)
+            {
+                detail::mapping::throw_errno("mapped_file: open");
+            }
+            try
+            {
+                struct stat info;
+                if (::fstat(fd, &info) != 0)
+                {
+                    detail::mapping::throw_errno("mapped_file: fstat");
+                }
+                map(static_cast<size_t>(info.st_size));
+            }
+            catch (...)
+            {
+                ::close(fd);
+                throw;
+            }
+        }
+
+        mapped_file(mapped_file&& other) noexcept
+            : fd(other.fd), base(other.base), length(other.length), mode(other.mode), options(other.options)
+        {
+            other.fd = -1;
+            other.base = nullptr;
+            other.length = 0;
+        }
+
+        mapped_file& operator=(mapped_file&& other) noexcept
+        {
+            if (this != &other)
+            {
+                close();
+                fd = other.fd;
+                base = other.base;
+                length = other.length;
+                mode = other.mode;
+                options = other.options;
+                other.fd = -1;
+                other.base = nullptr;
+                other.length = 0;
+            }
+            return *this;
+        }
+
+        mapped_file(const mapped_file&) = delete;
+        mapped_file& operator=(const mapped_file&) = delete;
+
+        ~mapped_file()
+        {
+            close();
+        }
+
+        /* Unmap and close, stores of a 'read_write' mapping are left to the
+           kernel to write back (see 'sync'). */
+        void close() noexcept
+        {
+            if (base != nullptr)
+            {
+                ::munmap(base, length);
+                base = nullptr;
+            }
+            length = 0;
+            if (fd >= 0)
+            {
+                ::close(fd);
+                fd = -1;
+            }
+        }
+
+        bool is_open() const noexcept
+        {
+            return fd >= 0;
+        }
+
+        map_mode get_mode() const noexcept
+        {
+            return mode;
+        }
+
+        int native_handle() const noexcept
+        {
+            return fd;
+        }
+
+        /* Writable for 'read_write' and 'copy_on_write' only. */
+        unsigned char* data() noexcept
+        {
+            return base;
+        }
+
+        const unsigned char* data() const noexcept
+        {
+            return base;
+        }
+
+        size_t size() const noexcept
+        {
+            return length;
+        }
+
+        bool empty() const noexcept
+        {
+            return length == 0;
+        }
+
+        unsigned char* begin() noexcept
+        {
+            return base;
+        }
+
+        unsigned char* end() noexcept
+        {
+            return base + length;
+        }
+
+        const unsigned char* begin() const noexcept
+        {
+            return base;
+        }
+
+        const unsigned char* end() const noexcept
+        {
+            return base + length;
+        }
+
+#if defined(__cpp_lib_span)
+        std::span<unsigned char> bytes() noexcept
+        {
+            return std::span<unsigned char>(base, length);
+        }
+
+        std::span<const unsigned char> bytes() const noexcept
+        {
+            return std::span<const unsigned char>(base, length);
+        }
+#endif
+
+        /* Access pattern hints for [offset, offset + count), which is
+           widened to whole pages. */
+
+        /* Read ahead aggressively and free pages behind the reader. */
+        void advise_sequential(size_t offset = 0, size_t count = npos) const
+        {
+            advise(MADV_SEQUENTIAL, offset, count, "mapped_file: madvise sequential");
+        }
+
+        /* Disable read-ahead. */
+        void advise_random(size_t offset = 0, size_t count = npos) const
+        {
+            advise(MADV_RANDOM, offset, count, "mapped_file: madvise random");
+        }
+
+        /* Start reading the range in the background. */
+        void advise_willneed(size_t offset = 0, size_t count = npos) const
+        {
+            advise(MADV_WILLNEED, offset, count, "mapped_file: madvise willneed");
+        }
+
+        /* Drop the range from this process. A private mapping loses its
+           changes there and sees the file again. */
+        void advise_dontneed(size_t offset = 0, size_t count = npos) const
+        {
+            advise(MADV_DONTNEED, offset, count, "mapped_file: madvise dontneed");
+        }
+
+        /* Write dirty pages of [offset, offset + count) back to the file.
+           Synchronous unless 'async', which only schedules the write. Does
+           nothing for other modes than 'read_write'. */
+        void sync(size_t offset = 0, size_t count = npos, bool async = false) const
+        {
+            size_t begin, bytes;
+            if (mode != map_mode::read_write || !detail::mapping::page_range(length, offset, count, begin, bytes))
+            {
+                return;
+            }
+            if (::msync(base + begin, bytes, async ? MS_ASYNC : MS_SYNC) != 0)
+            {
+                detail::mapping::throw_errno("mapped_file: msync");
+            }
+        }
+
+        /* Change the mapped size. 'read_write' mappings resize the file
+           too, other modes can grow only up to the current file size (to
+           follow a file that another writer appends to). On Linux the
+           mapping grows in place with 'mremap' when the address space
+           allows, otherwise it moves, so pointers into it are invalidated
+           either way. */
+        void resize(size_t new_size)
+        {
+            if (fd < 0)
+            {
+                throw std::logic_error("mapped_file::resize: no file is open");
+            }
+            if (new_size == length)
+            {
+                return;
+            }
+            if (mode == map_mode::read_write)
+            {
+                if (::ftruncate(fd, static_cast<off_t>(new_size)) != 0)
+                {
+                    detail::mapping::throw_errno("mapped_file: ftruncate");
+                }
+            }
+            else
+            {
+                struct stat info;
+                if (::fstat(fd, &info) != 0)
+                {
+                    detail::mapping::throw_errno("mapped_file: fstat");
+                }
+                if (new_size > static_cast<size_t>(info.st_size))
+                {
+                    throw std::length_error("mapped_file::resize: beyond the end of a file that is not writable");
+                }
+            }
+            if (base == nullptr || new_size == 0)
+            {
+                if (base != nullptr)
+                {
+                    ::munmap(base, length);
+                    base = nullptr;
+                    length = 0;
+                }
+                map(new_size);
+                return;
+            }
+#if defined(__linux__) && defined(MREMAP_MAYMOVE)
+            if (options.huge_pages != huge_page_mode::hugetlb)
+            {
+                void* moved = ::mremap(base, length, new_size, MREMAP_MAYMOVE);
+                if (moved == MAP_FAILED)
+                {
+                    detail::mapping::throw_errno("mapped_file: mremap");
+                }
+                size_t old_size = length;
+                base = static_cast<unsigned char*>(moved);
+                length = new_size;
+                if (new_size > old_size)
+                {
+                    apply_huge_page_hint(old_size);
+                }
+                return;
+            }
+#endif
+            ::munmap(base, length);
+            base = nullptr;
+            length = 0;
+            map(new_size);
+        }
+
+    private:
+        void map(size_t size)
+        {
+            if (size == 0)
+            {
+                return;
+            }
+            int protection = mode == map_mode::read_only ? PROT_READ : PROT_READ | PROT_WRITE;
+            int flags = mode == map_mode::copy_on_write ? MAP_PRIVATE : MAP_SHARED;
+#if defined(MAP_POPULATE)
+            if (options.populate)
+            {
+                flags |= MAP_POPULATE;
+            }
+#endif
+            if (options.huge_pages == huge_page_mode::hugetlb)
+            {
+#if defined(MAP_HUGETLB)
+                flags |= MAP_HUGETLB;
+#else
+                throw std::system_error(ENOTSUP, std::system_category(), "mapped_file: MAP_HUGETLB");
+#endif
+            }
+            void* result = ::mmap(nullptr, size, protection, flags, fd, 0);
+            if (result == MAP_FAILED)
+            {
+                detail::mapping::throw_errno("mapped_file: mmap");
+            }
+            base = static_cast<unsigned char*>(result);
+            length = size;
+            apply_huge_page_hint(0);
+        }
+
+        void apply_huge_page_hint(size_t from) noexcept
+        {
+#if defined(MADV_HUGEPAGE)
+            size_t begin, bytes;
+            if (options.huge_pages == huge_page_mode::transparent &&
+                detail::mapping::page_range(length, from, npos, begin, bytes))
+            {
+                /* Only a hint: kernels without file THP refuse it. */
+                (void)::madvise(base + begin, bytes, MADV_HUGEPAGE);
+            }
+#else
+            (void)from;
+#endif
+        }
+
+        void advise(int advice, size_t offset, size_t count, const char* what) const
+        {
+            size_t begin, bytes;
+            if (!detail::mapping::page_range(length, offset, count, begin, bytes))
+            {
+                return;
+            }
+            if (::madvise(base + begin, bytes, advice) != 0)
+            {
+                detail::mapping::throw_errno(what);
+            }
+        }
+    };
+} // namespace cppp
+
+#endif
+
+#endif
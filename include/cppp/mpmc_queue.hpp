@@ -0,0 +1,400 @@
+/* Copyright (C) 1999-2023 Free Software Foundation, Inc.
+   This file is part of the cppp-base library.
+
+   The cppp-base library is free software; you can redistribute it
+   and/or modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either version 3
+   of the License, or (at your option) any later version.
+
+   The cppp-base library is distributed in the hope that it will be
+   useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the cppp-base library; see the file COPYING.
+   If not, see <https://www.gnu.org/licenses/>.  */
+
+/* We do not use '#pragma once' because it may has bugs in some compiler. */
+#ifndef _CPPP_MPMC_QUEUE_HPP
+#define _CPPP_MPMC_QUEUE_HPP
+
+/* C++ Plus bounded lock-free multi-producer multi-consumer queue
+
+   This is Dmitry Vyukov's ring. Every slot has a sequence number that
+   says whose turn it is. A producer at position 'pos' owns the slot once
+   its sequence equals 'pos'. A consumer owns it once it equals 'pos + 1',
+   and hands it back by storing 'pos + capacity'. Producers only contend
+   on 'head' and consumers on 'tail', and each counter has its own
+   destructive interference range. */
+
+#include "basedef.hpp"
+#include "bits.hpp"
+#include "hardware.hpp"
+#include "wait_strategy.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace cppp
+{
+    /* Bounded MPMC queue of 'T'.
+       The capacity is rounded up to a power of two. The blocking
+       operations wait with 'WaitStrategy' (see 'wait_strategy.hpp'), and
+       the 'try_' operations never wait.
+       'T' must be nothrow move constructible. A throwing move would leave
+       a claimed slot that is never published. */
+    template<typename T, typename WaitStrategy = spin_wait>
+    class mpmc_queue
+    {
+        static_assert(std::is_nothrow_move_constructible<T>::value, "mpmc_queue requires a nothrow move constructor");
+        static_assert(std::is_nothrow_destructible<T>::value, "mpmc_queue requires a nothrow destructor");
+
+    public:
+        using value_type = T;
+        using size_type = size_t;
+        using wait_strategy = WaitStrategy;
+
+    private:
+        struct slot
+        {
+            std::atomic<size_t> sequence;
+            alignas(T) unsigned char storage[sizeof(T)];
+
+            T* value() noexcept
+            {
+                return reinterpret_cast<T*>(storage);
+            }
+        };
+
+        /* Read-mostly members first, then each written member on its own
+           cache lines. */
+        size_t mask;
+        std::unique_ptr<slot[]> slots;
+        cache_aligned<std::atomic<size_t>> head;
+        cache_aligned<std::atomic<size_t>> tail;
+        cache_aligned<WaitStrategy> not_empty;
+        cache_aligned<WaitStrategy> not_full;
+
+    public:
+        explicit mpmc_queue(size_t capacity)
+            : mask(normalize_capacity(capacity) - 1), slots(new slot[mask + 1]), head(size_t(0)), tail(size_t(0))
+        {
+            for (size_t i = 0; i <= mask; ++i)
+            {
+                slots[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        mpmc_queue(const mpmc_queue&) = delete;
+        mpmc_queue& operator=(const mpmc_queue&) = delete;
+
+        /* No other thread may use the queue any more. */
+        ~mpmc_queue()
+        {
+            if (!std::is_trivially_destructible<T>::value)
+            {
+                size_t end = head->load(std::memory_order_relaxed);
+                for (size_t pos = tail->load(std::memory_order_relaxed); pos != end; ++pos)
+                {
+                    slots[pos & mask].value()->~T();
+                }
+            }
+        }
+
+        size_t capacity() const noexcept
+        {
+            return mask + 1;
+        }
+
+        /* The element count is exact only while no other thread pushes or
+           pops. */
+        size_t size_approx() const noexcept
+        {
+            size_t t = tail->load(std::memory_order_relaxed);
+            size_t h = head->load(std::memory_order_relaxed);
+            return h > t ? h - t : 0;
+        }
+
+        bool empty_approx() const noexcept
+        {
+            return size_approx() == 0;
+        }
+
+        /* Non-blocking operations. They return false when the queue is full
+           (push) or empty (pop). */
+        bool try_push(const T& value)
+        {
+            return try_emplace(value);
+        }
+
+        bool try_push(T&& value) noexcept
+        {
+            return try_emplace(std::move(value));
+        }
+
+        /* When 'T' may throw while being constructed from 'args', a
+           temporary is built before a slot is claimed. The arguments are
+           then consumed even when the queue is full. */
+        template<typename... Args>
+        bool try_emplace(Args&&... args) noexcept(std::is_nothrow_constructible<T, Args&&...>::value)
+        {
+            return emplace_dispatch(std::integral_constant<bool, std::is_nothrow_constructible<T, Args&&...>::value>(),
+                                    std::forward<Args>(args)...);
+        }
+
+        bool try_pop(T& out) noexcept(std::is_nothrow_move_assignable<T>::value)
+        {
+            size_t pos;
+            if (claim(*tail, 1, 1, pos) == 0)
+            {
+                return false;
+            }
+            out = take(pos);
+            not_full->notify_all();
+            return true;
+        }
+
+        /* Blocking operations. They wait with 'WaitStrategy' until there is
+           room or an element. */
+        void push(const T& value)
+        {
+            emplace(value);
+        }
+
+        void push(T&& value)
+        {
+            emplace(std::move(value));
+        }
+
+        template<typename... Args>
+        void emplace(Args&&... args)
+        {
+            emplace_blocking(std::integral_constant<bool, std::is_nothrow_constructible<T, Args&&...>::value>(),
+                             std::forward<Args>(args)...);
+        }
+
+        T pop()
+        {
+            size_t pos;
+            while (claim(*tail, 1, 1, pos) == 0)
+            {
+                wait_for_element();
+            }
+            T result(take(pos));
+            not_full->notify_all();
+            return result;
+        }
+
+        void pop(T& out) noexcept(std::is_nothrow_move_assignable<T>::value)
+        {
+            while (!try_pop(out))
+            {
+                wait_for_element();
+            }
+        }
+
+        /* Batch operations. They claim up to 'count' consecutive slots with
+           one compare-and-swap and notify the other side once.
+           'try_push_bulk' moves from 'first' onwards and returns how many
+           elements were pushed. */
+        template<typename InputIt>
+        size_t try_push_bulk(InputIt first, size_t count)
+        {
+            size_t pos;
+            size_t claimed = claim(*head, count, 0, pos);
+            for (size_t i = 0; i < claimed; ++i, ++first)
+            {
+                put(pos + i, std::move(*first));
+            }
+            if (claimed != 0)
+            {
+                not_empty->notify_all();
+            }
+            return claimed;
+        }
+
+        /* Move up to 'max_count' elements to 'out' and return the count. */
+        template<typename OutputIt>
+        size_t try_pop_bulk(OutputIt out, size_t max_count)
+        {
+            size_t pos;
+            size_t claimed = claim(*tail, max_count, 1, pos);
+            for (size_t i = 0; i < claimed; ++i, ++out)
+            {
+                *out = take(pos + i);
+            }
+            if (claimed != 0)
+            {
+                not_full->notify_all();
+            }
+            return claimed;
+        }
+
+        /* Push all 'count' elements and wait for room when needed. */
+        template<typename InputIt>
+        void push_bulk(InputIt first, size_t count)
+        {
+            while (count != 0)
+            {
+                size_t pushed = try_push_bulk(first, count);
+                if (pushed == 0)
+                {
+                    wait_for_room();
+                    continue;
+                }
+                std::advance(first, static_cast<typename std::iterator_traits<InputIt>::difference_type>(pushed));
+                count -= pushed;
+            }
+        }
+
+        /* Wait for at least one element, then pop up to 'max_count'. */
+        template<typename OutputIt>
+        size_t pop_bulk(OutputIt out, size_t max_count)
+        {
+            if (max_count == 0)
+            {
+                return 0;
+            }
+            size_t popped;
+            while ((popped = try_pop_bulk(out, max_count)) == 0)
+            {
+                wait_for_element();
+            }
+            return popped;
+        }
+
+    private:
+        static size_t normalize_capacity(size_t capacity)
+        {
+            if (capacity > (static_cast<size_t>(1) << (sizeof(size_t) * 8 - 2)) / sizeof(slot))
+            {
+                throw std::length_error("mpmc_queue capacity is too large");
+            }
+            return capacity < 2 ? 2 : static_cast<size_t>(ceil_pow2(capacity));
+        }
+
+        /* Claim up to 'count' consecutive slots of 'counter'. A slot is
+           ready when its sequence equals its position plus 'offset' (0 for
+           producers, 1 for consumers). The first claimed position goes to
+           'pos'. */
+        size_t claim(std::atomic<size_t>& counter, size_t count, size_t offset, size_t& pos) noexcept
+        {
+            if (count == 0)
+            {
+                return 0;
+            }
+            pos = counter.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                size_t sequence = slots[pos & mask].sequence.load(std::memory_order_acquire);
+                std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(sequence - (pos + offset));
+                if (diff < 0)
+                {
+                    /* Full for producers, empty for consumers. */
+                    return 0;
+                }
+                if (diff > 0)
+                {
+                    /* Another thread claimed this position. */
+                    pos = counter.load(std::memory_order_relaxed);
+                    continue;
+                }
+                size_t ready = 1;
+                while (ready < count && ready <= mask &&
+                       slots[(pos + ready) & mask].sequence.load(std::memory_order_acquire) == pos + ready + offset)
+                {
+                    ++ready;
+                }
+                if (counter.compare_exchange_weak(pos, pos + ready, std::memory_order_relaxed, std::memory_order_relaxed))
+                {
+                    return ready;
+                }
+            }
+        }
+
+        template<typename... Args>
+        void put(size_t pos, Args&&... args) noexcept
+        {
+            slot& s = slots[pos & mask];
+            ::new (static_cast<void*>(s.value())) T(std::forward<Args>(args)...);
+            s.sequence.store(pos + 1, std::memory_order_release);
+        }
+
+        T take(size_t pos) noexcept
+        {
+            slot& s = slots[pos & mask];
+            T result(std::move(*s.value()));
+            s.value()->~T();
+            s.sequence.store(pos + mask + 1, std::memory_order_release);
+            return result;
+        }
+
+        template<typename... Args>
+        bool emplace_dispatch(std::true_type, Args&&... args) noexcept
+        {
+            size_t pos;
+            if (claim(*head, 1, 0, pos) == 0)
+            {
+                return false;
+            }
+            put(pos, std::forward<Args>(args)...);
+            not_empty->notify_all();
+            return true;
+        }
+
+        template<typename... Args>
+        bool emplace_dispatch(std::false_type, Args&&... args)
+        {
+            return emplace_dispatch(std::true_type(), T(std::forward<Args>(args)...));
+        }
+
+        template<typename... Args>
+        void emplace_blocking(std::true_type, Args&&... args)
+        {
+            /* A failed 'try_emplace' leaves the arguments untouched, so
+               forwarding them again is safe. */
+            while (!emplace_dispatch(std::true_type(), std::forward<Args>(args)...))
+            {
+                wait_for_room();
+            }
+        }
+
+        template<typename... Args>
+        void emplace_blocking(std::false_type, Args&&... args)
+        {
+            T value(std::forward<Args>(args)...);
+            emplace_blocking(std::true_type(), std::move(value));
+        }
+
+        void wait_for_room()
+        {
+            not_full->wait_until(
+                [this]() noexcept
+                {
+                    size_t pos = head->load(std::memory_order_relaxed);
+                    size_t sequence = slots[pos & mask].sequence.load(std::memory_order_acquire);
+                    return static_cast<std::ptrdiff_t>(sequence - pos) >= 0;
+                });
+        }
+
+        void wait_for_element()
+        {
+            not_empty->wait_until(
+                [this]() noexcept
+                {
+                    size_t pos = tail->load(std::memory_order_relaxed);
+                    size_t sequence = slots[pos & mask].sequence.load(std::memory_order_acquire);
+                    return static_cast<std::ptrdiff_t>(sequence - (pos + 1)) >= 0;
+                });
+        }
+    };
+} // namespace cppp
+
+#endif
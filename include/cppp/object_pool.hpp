@@ -0,0 +1,457 @@
+/* Copyright (C) 1999-2023 Free Software Foundation, Inc.
+   This file is part of the cppp-base library.
+
+   The cppp-base library is free software; you can redistribute it
+   and/or modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either version 3
+   of the License, or (at your option) any later version.
+
+   The cppp-base library is distributed in the hope that it will be
+   useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the cppp-base library; see the file COPYING.
+   If not, see <https://www.gnu.org/licenses/>.  */
+
+/* We do not use '#pragma once' because it may has bugs in some compiler. */
+#ifndef _CPPP_OBJECT_POOL_HPP
+#define _CPPP_OBJECT_POOL_HPP
+
+/* C++ Plus fixed-size object pool */
+
+#include "basedef.hpp"
+#include "bits.hpp"
+#include "hardware.hpp"
+#include "thread_index.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <utility>
+
+namespace cppp
+{
+    /* Statistics of an object pool, see 'object_pool::stats'.
+       Values are gathered without stopping other threads, so they are only
+       a consistent snapshot when the pool is quiescent. */
+    struct object_pool_stats
+    {
+        /* Objects currently handed out. */
+        size_t in_use;
+        /* Slots carved from slabs so far, i.e. the peak number of objects
+           alive or cached at the same time. */
+        size_t high_water;
+        /* Slots the allocated slabs can hold. */
+        size_t capacity;
+        /* Number of slabs allocated from the system. */
+        size_t slabs;
+    };
+
+    /* A pool of fixed-size slots for objects of type 'T'.
+
+       Slots live in slabs that are allocated on demand and only returned to
+       the system when the pool is destroyed.  Each thread keeps two
+       magazines of up to 'MagazineSize' free slots, so allocate and free
+       normally touch thread-private memory only.  Full magazines are
+       exchanged with the other threads through a lock-free stack; a lock
+       is only taken to allocate a new slab.
+
+       Up to 'max_threads' threads (by 'this_thread_index') get a cache,
+       further threads go to the shared stack for every operation.
+       Destroying the pool does not run destructors of live objects. */
+    template<typename T, size_t MagazineSize = 64>
+    class object_pool
+    {
+        static_assert(MagazineSize > 0 && is_pow2(MagazineSize), "MagazineSize must be a power of two");
+
+    private:
+        static constexpr std::uint32_t npos = 0xFFFFFFFFu;
+
+        /* The first slab holds this many slots, slab 'k' holds
+           'first_slab_slots << k', so a magazine never spans two slabs. */
+        static constexpr size_t first_slab_slots = MagazineSize * 16;
+        static constexpr size_t max_slabs = 32;
+
+        /* Header written into a slot while it is free. */
+        struct free_node
+        {
+            /* Next slot in the same magazine. */
+            std::uint32_t next;
+            /* Number of slots in the magazine, valid on its first slot. */
+            std::uint32_t count;
+            /* Next magazine on the shared stack, valid on its first slot. */
+            std::atomic<std::uint32_t> next_magazine;
+        };
+
+        static constexpr size_t slot_size_raw = sizeof(T) > sizeof(free_node) ? sizeof(T) : sizeof(free_node);
+        static constexpr size_t slot_align = alignof(T) > alignof(free_node) ? alignof(T) : alignof(free_node);
+        static constexpr size_t slot_size = (slot_size_raw + slot_align - 1) / slot_align * slot_align;
+
+        struct magazine
+        {
+            std::uint32_t head = npos;
+            std::uint32_t count = 0;
+        };
+
+        struct thread_cache
+        {
+            magazine loaded;
+            magazine previous;
+            /* Written by the owner only, read by 'stats'. */
+            std::atomic<size_t> allocations{0};
+            std::atomic<size_t> deallocations{0};
+        };
+
+        std::atomic<unsigned char*> slabs[max_slabs];
+        std::mutex slab_lock;
+        size_t thread_limit;
+        std::atomic<cache_aligned<thread_cache>*>* caches;
+
+        /* Shared stack of magazines, 'tag << 32 | index', tagged against ABA. */
+        cache_aligned<std::atomic<std::uint64_t>> shared_head;
+        /* Next never used slot index. */
+        cache_aligned<std::atomic<std::uint64_t>> carved;
+        /* Counters for threads without a cache. */
+        cache_aligned<std::atomic<std::ptrdiff_t>> uncached_in_use;
+
+    public:
+        using value_type = T;
+
+        explicit object_pool(size_t max_threads = 256)
+            : thread_limit(max_threads), caches(new std::atomic<cache_aligned<thread_cache>*>[max_threads])
+        {
+            for (size_t i = 0; i < max_slabs; ++i)
+            {
+                slabs[i].store(nullptr, std::memory_order_relaxed);
+            }
+            for (size_t i = 0; i < thread_limit; ++i)
+            {
+                caches[i].store(nullptr, std::memory_order_relaxed);
+            }
+            shared_head->store(npos, std::memory_order_relaxed);
+            carved->store(0, std::memory_order_relaxed);
+            uncached_in_use->store(0, std::memory_order_relaxed);
+        }
+
+        object_pool(const object_pool&) = delete;
+        object_pool& operator=(const object_pool&) = delete;
+
+        ~object_pool()
+        {
+            for (size_t i = 0; i < thread_limit; ++i)
+            {
+                delete caches[i].load(std::memory_order_relaxed);
+            }
+            delete[] caches;
+            for (size_t i = 0; i < max_slabs; ++i)
+            {
+                std::free(slabs[i].load(std::memory_order_relaxed));
+            }
+        }
+
+        /* Get storage for one 'T'.  Throws 'std::bad_alloc' when the system
+           is out of memory or the pool reached 2^32 - 1 slots. */
+        CPPP_HOT void* allocate()
+        {
+            thread_cache* cache = local_cache();
+            if (CPPP_UNLIKELY(cache == nullptr))
+            {
+                return allocate_uncached();
+            }
+            if (CPPP_UNLIKELY(cache->loaded.count == 0))
+            {
+                refill(*cache);
+            }
+            std::uint32_t index = cache->loaded.head;
+            free_node* node = node_at(index);
+            cache->loaded.head = node->next;
+            --cache->loaded.count;
+            bump(cache->allocations);
+            return node;
+        }
+
+        /* Return storage obtained from 'allocate' of this pool. */
+        CPPP_HOT void deallocate(void* p) noexcept
+        {
+            std::uint32_t index = index_of(p);
+            free_node* node = ::new (p) free_node;
+            thread_cache* cache = local_cache();
+            if (CPPP_UNLIKELY(cache == nullptr))
+            {
+                node->next = npos;
+                node->count = 1;
+                push_shared(index);
+                uncached_in_use->fetch_sub(1, std::memory_order_relaxed);
+                return;
+            }
+            if (CPPP_UNLIKELY(cache->loaded.count == MagazineSize))
+            {
+                spill(*cache);
+            }
+            node->next = cache->loaded.head;
+            cache->loaded.head = index;
+            ++cache->loaded.count;
+            bump(cache->deallocations);
+        }
+
+        /* Allocate and construct a 'T'. */
+        template<typename... Args>
+        T* create(Args&&... args)
+        {
+            void* p = allocate();
+            try
+            {
+                return ::new (p) T(std::forward<Args>(args)...);
+            }
+            catch (...)
+            {
+                deallocate(p);
+                throw;
+            }
+        }
+
+        /* Destroy and deallocate an object made by 'create'. */
+        void destroy(T* object) noexcept
+        {
+            if (object != nullptr)
+            {
+                object->~T();
+                deallocate(object);
+            }
+        }
+
+        /* Take a snapshot of the pool statistics. */
+        object_pool_stats stats() const noexcept
+        {
+            std::ptrdiff_t in_use = uncached_in_use->load(std::memory_order_relaxed);
+            for (size_t i = 0; i < thread_limit; ++i)
+            {
+                const cache_aligned<thread_cache>* cache = caches[i].load(std::memory_order_acquire);
+                if (cache != nullptr)
+                {
+                    in_use += static_cast<std::ptrdiff_t>((*cache)->allocations.load(std::memory_order_relaxed));
+                    in_use -= static_cast<std::ptrdiff_t>((*cache)->deallocations.load(std::memory_order_relaxed));
+                }
+            }
+            object_pool_stats result;
+            result.in_use = in_use > 0 ? static_cast<size_t>(in_use) : 0;
+            result.high_water = static_cast<size_t>(carved->load(std::memory_order_relaxed));
+            result.capacity = 0;
+            result.slabs = 0;
+            for (size_t i = 0; i < max_slabs; ++i)
+            {
+                if (slabs[i].load(std::memory_order_relaxed) != nullptr)
+                {
+                    result.capacity += first_slab_slots << i;
+                    ++result.slabs;
+                }
+            }
+            if (result.high_water > result.capacity)
+            {
+                result.high_water = result.capacity;
+            }
+            return result;
+        }
+
+    private:
+        static void bump(std::atomic<size_t>& counter) noexcept
+        {
+            /* Only the owner writes, a plain load and store is enough. */
+            counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+
+        thread_cache* local_cache()
+        {
+            size_t index = this_thread_index();
+            if (CPPP_UNLIKELY(index >= thread_limit))
+            {
+                return nullptr;
+            }
+            cache_aligned<thread_cache>* cache = caches[index].load(std::memory_order_relaxed);
+            if (CPPP_UNLIKELY(cache == nullptr))
+            {
+                /* The index is ours alone, no other thread races here. */
+                cache = new cache_aligned<thread_cache>();
+                caches[index].store(cache, std::memory_order_release);
+            }
+            return &cache->get();
+        }
+
+        static void slab_of(std::uint64_t index, size_t& slab, size_t& offset) noexcept
+        {
+            std::uint64_t q = index / first_slab_slots + 1;
+            slab = log2_floor(q);
+            offset = static_cast<size_t>(index - first_slab_slots * ((std::uint64_t(1) << slab) - 1));
+        }
+
+        free_node* node_at(std::uint32_t index) const noexcept
+        {
+            size_t slab, offset;
+            slab_of(index, slab, offset);
+            unsigned char* base = slabs[slab].load(std::memory_order_acquire);
+            return reinterpret_cast<free_node*>(base + offset * slot_size);
+        }
+
+        std::uint32_t index_of(void* p) const noexcept
+        {
+            unsigned char* bytes = static_cast<unsigned char*>(p);
+            for (size_t slab = 0; slab < max_slabs; ++slab)
+            {
+                unsigned char* base = slabs[slab].load(std::memory_order_acquire);
+                size_t slots = first_slab_slots << slab;
+                if (base != nullptr && bytes >= base && bytes < base + slots * slot_size)
+                {
+                    size_t offset = static_cast<size_t>(bytes - base) / slot_size;
+                    return static_cast<std::uint32_t>(first_slab_slots * ((size_t(1) << slab) - 1) + offset);
+                }
+            }
+            CPPP_ASSUME(false);
+            return npos;
+        }
+
+        void push_shared(std::uint32_t first) noexcept
+        {
+            free_node* node = node_at(first);
+            std::uint64_t old = shared_head->load(std::memory_order_relaxed);
+            std::uint64_t desired;
+            do
+            {
+                node->next_magazine.store(static_cast<std::uint32_t>(old), std::memory_order_relaxed);
+                desired = ((old >> 32) + 1) << 32 | first;
+            } while (!shared_head->compare_exchange_weak(old, desired, std::memory_order_release, std::memory_order_relaxed));
+        }
+
+        /* Pop a magazine, returns npos when the stack is empty. */
+        std::uint32_t pop_shared() noexcept
+        {
+            std::uint64_t old = shared_head->load(std::memory_order_acquire);
+            for (;;)
+            {
+                std::uint32_t first = static_cast<std::uint32_t>(old);
+                if (first == npos)
+                {
+                    return npos;
+                }
+                /* The node may be popped and reused concurrently, then the
+                   value read is garbage and the tag makes the CAS fail. */
+                std::uint32_t next = node_at(first)->next_magazine.load(std::memory_order_relaxed);
+                std::uint64_t desired = ((old >> 32) + 1) << 32 | next;
+                if (shared_head->compare_exchange_weak(old, desired, std::memory_order_acquire, std::memory_order_acquire))
+                {
+                    return first;
+                }
+            }
+        }
+
+        /* Carve a fresh magazine out of the slabs. */
+        CPPP_NOINLINE magazine carve()
+        {
+            std::uint64_t first = carved->fetch_add(MagazineSize, std::memory_order_relaxed);
+            if (CPPP_UNLIKELY(first + MagazineSize >= npos))
+            {
+                throw std::bad_alloc();
+            }
+            size_t slab, offset;
+            slab_of(first, slab, offset);
+            unsigned char* base = slabs[slab].load(std::memory_order_acquire);
+            if (base == nullptr)
+            {
+                std::lock_guard<std::mutex> guard(slab_lock);
+                base = slabs[slab].load(std::memory_order_relaxed);
+                if (base == nullptr)
+                {
+                    base = static_cast<unsigned char*>(aligned_slab((first_slab_slots << slab) * slot_size));
+                    slabs[slab].store(base, std::memory_order_release);
+                }
+            }
+            magazine result;
+            for (size_t i = MagazineSize; i-- > 0;)
+            {
+                free_node* node = ::new (base + (offset + i) * slot_size) free_node;
+                node->next = result.head;
+                result.head = static_cast<std::uint32_t>(first + i);
+            }
+            result.count = MagazineSize;
+            return result;
+        }
+
+        static void* aligned_slab(size_t bytes)
+        {
+            /* malloc already aligns to max_align_t, over-aligned types get
+               rounded up slot sizes and an over-aligned slab. */
+            void* memory;
+#if CPPP_CPLUSPLUS >= 201703L && !defined(_WIN32)
+            size_t alignment = slot_align > alignof(std::max_align_t) ? slot_align : alignof(std::max_align_t);
+            bytes = (bytes + alignment - 1) / alignment * alignment;
+            memory = std::aligned_alloc(alignment, bytes);
+#else
+            static_assert(slot_align <= alignof(std::max_align_t), "over-aligned types need C++17");
+            memory = std::malloc(bytes);
+#endif
+            if (memory == nullptr)
+            {
+                throw std::bad_alloc();
+            }
+            return memory;
+        }
+
+        CPPP_NOINLINE void refill(thread_cache& cache)
+        {
+            if (cache.previous.count != 0)
+            {
+                std::swap(cache.loaded, cache.previous);
+                return;
+            }
+            std::uint32_t first = pop_shared();
+            if (first != npos)
+            {
+                cache.loaded.head = first;
+                cache.loaded.count = node_at(first)->count;
+                return;
+            }
+            cache.loaded = carve();
+        }
+
+        CPPP_NOINLINE void spill(thread_cache& cache) noexcept
+        {
+            if (cache.previous.count != 0)
+            {
+                free_node* first = node_at(cache.previous.head);
+                first->count = cache.previous.count;
+                push_shared(cache.previous.head);
+            }
+            cache.previous = cache.loaded;
+            cache.loaded = magazine();
+        }
+
+        void* allocate_uncached()
+        {
+            std::uint32_t first = pop_shared();
+            magazine taken;
+            if (first != npos)
+            {
+                taken.head = first;
+                taken.count = node_at(first)->count;
+            }
+            else
+            {
+                taken = carve();
+            }
+            free_node* node = node_at(taken.head);
+            if (taken.count > 1)
+            {
+                free_node* rest = node_at(node->next);
+                rest->count = taken.count - 1;
+                push_shared(node->next);
+            }
+            uncached_in_use->fetch_add(1, std::memory_order_relaxed);
+            return node;
+        }
+    };
+} // namespace cppp
+
+#endif
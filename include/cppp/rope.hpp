@@ -0,0 +1,1129 @@
+/* Copyright (C) 1999-2023 Free Software Foundation, Inc.
+   This file is part of the cppp-base library.
+
+   The cppp-base library is free software; you can redistribute it
+   and/or modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either version 3
+   of the License, or (at your option) any later version.
+
+   The cppp-base library is distributed in the hope that it will be
+   useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the cppp-base library; see the file COPYING.
+   If not, see <https://www.gnu.org/licenses/>.  */
+
+/* We do not use '#pragma once' because it may has bugs in some compiler. */
+#ifndef _CPPP_ROPE_HPP
+#define _CPPP_ROPE_HPP
+
+/* C++ Plus rope */
+
+#include "basedef.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#if CPPP_CPLUSPLUS >= 201703L
+#include <string_view>
+#endif
+
+namespace cppp
+{
+    namespace detail
+    {
+        namespace roping
+        {
+            /* Tree nodes are immutable once shared. A node with a count
+               of one, reached from the root through other such nodes,
+               belongs to a single rope and may be edited in place. */
+            struct node
+            {
+                std::atomic<size_t> refs;
+                size_t length;
+                std::uint32_t height;   /* 0 for leaves */
+                std::uint32_t count;    /* bytes or children */
+                std::uint32_t capacity; /* bytes, leaves only */
+
+                char* text() noexcept
+                {
+                    return reinterpret_cast<char*>(this + 1);
+                }
+
+                node** children() noexcept
+                {
+                    return reinterpret_cast<node**>(this + 1);
+                }
+
+                size_t* lengths() noexcept;
+
+                bool unique() const noexcept
+                {
+                    return refs.load(std::memory_order_acquire) == 1;
+                }
+            };
+
+            /* Leaves of a page, and a fan-out that keeps a gigabyte
+               within five levels. Nodes other than the root hold at least
+               half of the maximum, except along the seams of recent
+               edits. */
+            constexpr size_t max_leaf = 4096 - sizeof(node);
+            constexpr size_t min_leaf = max_leaf / 2;
+            constexpr size_t max_children = 16;
+            constexpr size_t min_children = max_children / 2;
+
+            /* Internal nodes keep the children's lengths next to the
+               pointers, so a descent reads one node per level. */
+            constexpr size_t internal_size = sizeof(node) + max_children * (sizeof(node*) + sizeof(size_t));
+
+            inline size_t* node::lengths() noexcept
+            {
+                return reinterpret_cast<size_t*>(children() + max_children);
+            }
+
+            inline void retain(node* n) noexcept
+            {
+                n->refs.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            inline void free_node(node* n) noexcept
+            {
+                size_t bytes = sizeof(node) + (n->height == 0 ? n->capacity : internal_size - sizeof(node));
+                n->~node();
+#if defined(__cpp_sized_deallocation)
+                ::operator delete(n, bytes);
+#else
+                static_cast<void>(bytes);
+                ::operator delete(n);
+#endif
+            }
+
+            inline void release(node* n) noexcept
+            {
+                if (n != nullptr && n->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                {
+                    if (n->height != 0)
+                    {
+                        for (std::uint32_t i = 0; i < n->count; ++i)
+                        {
+                            release(n->children()[i]);
+                        }
+                    }
+                    free_node(n);
+                }
+            }
+
+            /* An owning pointer to a node. */
+            class node_ref
+            {
+            private:
+                node* ptr = nullptr;
+
+            public:
+                node_ref() noexcept = default;
+
+                explicit node_ref(node* n) noexcept : ptr(n)
+                {
+                }
+
+                node_ref(const node_ref& other) noexcept : ptr(other.ptr)
+                {
+                    if (ptr != nullptr)
+                    {
+                        retain(ptr);
+                    }
+                }
+
+                node_ref(node_ref&& other) noexcept : ptr(other.ptr)
+                {
+                    other.ptr = nullptr;
+                }
+
+                ~node_ref()
+                {
+                    release(ptr);
+                }
+
+                node_ref& operator=(node_ref other) noexcept
+                {
+                    std::swap(ptr, other.ptr);
+                    return *this;
+                }
+
+                node* get() const noexcept
+                {
+                    return ptr;
+                }
+
+                node* operator->() const noexcept
+                {
+                    return ptr;
+                }
+
+                explicit operator bool() const noexcept
+                {
+                    return ptr != nullptr;
+                }
+
+                node* detach() noexcept
+                {
+                    node* n = ptr;
+                    ptr = nullptr;
+                    return n;
+                }
+            };
+
+            inline node_ref make_leaf(const char* s, size_t n, size_t capacity)
+            {
+                void* memory = ::operator new(sizeof(node) + capacity);
+                node* leaf = new (memory) node{{1}, n, 0, static_cast<std::uint32_t>(n), static_cast<std::uint32_t>(capacity)};
+                std::memcpy(leaf->text(), s, n);
+                return node_ref(leaf);
+            }
+
+            /* Leaves get some room to grow in place, up to a page. */
+            inline node_ref make_leaf(const char* s, size_t n)
+            {
+                size_t capacity = std::min(max_leaf, std::max<size_t>(64, (n + n / 4 + 15) & ~size_t(15)));
+                return make_leaf(s, n, capacity);
+            }
+
+            struct child_list
+            {
+                node_ref items[max_children];
+                size_t count = 0;
+
+                void push(node_ref n) noexcept
+                {
+                    items[count++] = std::move(n);
+                }
+            };
+
+            /* Takes the references in 'children[0, count)'. */
+            inline node_ref make_internal(node_ref* children, size_t count)
+            {
+                void* memory = ::operator new(internal_size);
+                std::uint32_t height = children[0]->height + 1;
+                node* n = new (memory) node{{1}, 0, height, static_cast<std::uint32_t>(count), 0};
+                for (size_t i = 0; i < count; ++i)
+                {
+                    n->length += children[i]->length;
+                    n->lengths()[i] = children[i]->length;
+                    n->children()[i] = children[i].detach();
+                }
+                return node_ref(n);
+            }
+
+            inline bool is_ok_child(const node_ref& n) noexcept
+            {
+                return n->height == 0 ? n->count >= min_leaf : n->count >= min_children;
+            }
+
+            /* The children of 'n', stolen when nobody else holds it. */
+            inline child_list take_children(node_ref n)
+            {
+                child_list list;
+                node* p = n.get();
+                if (p->unique())
+                {
+                    for (std::uint32_t i = 0; i < p->count; ++i)
+                    {
+                        list.push(node_ref(p->children()[i]));
+                    }
+                    p->count = 0;
+                }
+                else
+                {
+                    for (std::uint32_t i = 0; i < p->count; ++i)
+                    {
+                        retain(p->children()[i]);
+                        list.push(node_ref(p->children()[i]));
+                    }
+                }
+                return list;
+            }
+
+            /* One node over both lists, or two over halves when they do
+               not fit. */
+            inline node_ref merge_nodes(child_list& a, size_t a_first, child_list& b, size_t b_first)
+            {
+                node_ref all[2 * max_children];
+                size_t n = 0;
+                for (size_t i = a_first; i < a.count; ++i)
+                {
+                    all[n++] = std::move(a.items[i]);
+                }
+                for (size_t i = b_first; i < b.count; ++i)
+                {
+                    all[n++] = std::move(b.items[i]);
+                }
+                if (n <= max_children)
+                {
+                    return make_internal(all, n);
+                }
+                size_t half = (n + 1) / 2;
+                node_ref pair[2] = {make_internal(all, half), make_internal(all + half, n - half)};
+                return make_internal(pair, 2);
+            }
+
+            inline node_ref merge_leaves(node_ref a, node_ref b)
+            {
+                size_t total = a->length + b->length;
+                if (total <= max_leaf)
+                {
+                    if (a->unique() && total <= a->capacity)
+                    {
+                        std::memcpy(a->text() + a->count, b->text(), b->count);
+                        a->count = static_cast<std::uint32_t>(total);
+                        a->length = total;
+                        return a;
+                    }
+                    node_ref leaf = make_leaf(a->text(), a->count, std::max<size_t>(total, 64));
+                    std::memcpy(leaf->text() + a->count, b->text(), b->count);
+                    leaf->count = static_cast<std::uint32_t>(total);
+                    leaf->length = total;
+                    return leaf;
+                }
+                /* One side is short, so both halves reach 'min_leaf'. */
+                char joined[2 * max_leaf];
+                std::memcpy(joined, a->text(), a->count);
+                std::memcpy(joined + a->count, b->text(), b->count);
+                size_t half = total / 2;
+                node_ref pair[2] = {make_leaf(joined, half), make_leaf(joined + half, total - half)};
+                return make_internal(pair, 2);
+            }
+
+            /* Join two trees of any heights, after the algorithm of the
+               xi-editor rope: hang the lower tree off the edge of the
+               higher one at its own height, splitting full nodes on the
+               way back up. */
+            inline node_ref concat(node_ref a, node_ref b)
+            {
+                if (!a || a->length == 0)
+                {
+                    return b;
+                }
+                if (!b || b->length == 0)
+                {
+                    return a;
+                }
+                std::uint32_t h1 = a->height, h2 = b->height;
+                if (h1 < h2)
+                {
+                    child_list right = take_children(std::move(b));
+                    child_list left;
+                    if (h1 == h2 - 1 && is_ok_child(a))
+                    {
+                        left.push(std::move(a));
+                        return merge_nodes(left, 0, right, 0);
+                    }
+                    node_ref merged = concat(std::move(a), std::move(right.items[0]));
+                    if (merged->height == h2 - 1)
+                    {
+                        left.push(std::move(merged));
+                    }
+                    else
+                    {
+                        left = take_children(std::move(merged));
+                    }
+                    return merge_nodes(left, 0, right, 1);
+                }
+                if (h1 > h2)
+                {
+                    child_list left = take_children(std::move(a));
+                    child_list right;
+                    if (h2 == h1 - 1 && is_ok_child(b))
+                    {
+                        right.push(std::move(b));
+                        return merge_nodes(left, 0, right, 0);
+                    }
+                    node_ref merged = concat(std::move(left.items[left.count - 1]), std::move(b));
+                    --left.count;
+                    if (merged->height == h1 - 1)
+                    {
+                        right.push(std::move(merged));
+                    }
+                    else
+                    {
+                        right = take_children(std::move(merged));
+                    }
+                    return merge_nodes(left, 0, right, 0);
+                }
+                if (is_ok_child(a) && is_ok_child(b))
+                {
+                    node_ref pair[2] = {std::move(a), std::move(b)};
+                    return make_internal(pair, 2);
+                }
+                if (h1 == 0)
+                {
+                    return merge_leaves(std::move(a), std::move(b));
+                }
+                child_list left = take_children(std::move(a));
+                child_list right = take_children(std::move(b));
+                return merge_nodes(left, 0, right, 0);
+            }
+
+            /* A balanced tree over 'n' bytes of text, leaves and nodes
+               filled evenly. */
+            inline node_ref build(const char* s, size_t n)
+            {
+                if (n == 0)
+                {
+                    return node_ref();
+                }
+                size_t leaves = (n + max_leaf - 1) / max_leaf;
+                if (leaves == 1)
+                {
+                    return make_leaf(s, n);
+                }
+                /* Two levels of arrays: 'level' holds the current nodes. */
+                node_ref* level = new node_ref[leaves];
+                try
+                {
+                    size_t offset = 0;
+                    for (size_t i = 0; i < leaves; ++i)
+                    {
+                        size_t size = n / leaves + (i < n % leaves ? 1 : 0);
+                        level[i] = make_leaf(s + offset, size, size);
+                        offset += size;
+                    }
+                    size_t count = leaves;
+                    while (count > 1)
+                    {
+                        size_t groups = (count + max_children - 1) / max_children;
+                        size_t first = 0;
+                        for (size_t g = 0; g < groups; ++g)
+                        {
+                            size_t size = count / groups + (g < count % groups ? 1 : 0);
+                            level[g] = make_internal(level + first, size);
+                            first += size;
+                        }
+                        count = groups;
+                    }
+                }
+                catch (...)
+                {
+                    delete[] level;
+                    throw;
+                }
+                node_ref root = std::move(level[0]);
+                delete[] level;
+                return root;
+            }
+
+            /* Collects pieces left to right into one tree. */
+            class builder
+            {
+            private:
+                node_ref root;
+
+            public:
+                void push(node_ref n)
+                {
+                    root = concat(std::move(root), std::move(n));
+                }
+
+                void push_text(const char* s, size_t n)
+                {
+                    if (n != 0)
+                    {
+                        push(build(s, n));
+                    }
+                }
+
+                /* Bytes '[first, last)' of 'n', sharing whole subtrees. */
+                void push_range(node* n, size_t first, size_t last)
+                {
+                    if (n == nullptr || first >= last)
+                    {
+                        return;
+                    }
+                    if (first == 0 && last == n->length)
+                    {
+                        retain(n);
+                        push(node_ref(n));
+                        return;
+                    }
+                    if (n->height == 0)
+                    {
+                        push(make_leaf(n->text() + first, last - first));
+                        return;
+                    }
+                    size_t offset = 0;
+                    for (std::uint32_t i = 0; i < n->count && offset < last; ++i)
+                    {
+                        size_t end = offset + n->lengths()[i];
+                        if (end > first)
+                        {
+                            push_range(n->children()[i], std::max(first, offset) - offset, std::min(last, end) - offset);
+                        }
+                        offset = end;
+                    }
+                }
+
+                node_ref finish() noexcept
+                {
+                    return std::move(root);
+                }
+            };
+
+            /* Far above the height of any tree that fits in memory. */
+            constexpr size_t max_height = 32;
+        } // namespace roping
+    } // namespace detail
+
+    /* A byte string stored as a B-tree of chunks, for large texts
+       under many edits.
+
+       - Insert, erase, substring and concatenation take O(log n) node
+         operations. They copy only the chunks at the edges of the range
+         and share the rest.
+       - Copying a rope is O(1): the copy shares the whole tree, and
+         either side copies nodes on its first edit of them (reference
+         counts are atomic, snapshots may go to other threads).
+       - Small edits into a chunk owned by one rope are done in place.
+       - 'chunks()' visits the contents as contiguous spans, for writev
+         or hashing without flattening.
+
+       Indexing is O(log n). Use 'chunks()' to walk the contents. */
+    class rope
+    {
+    private:
+        using node = detail::roping::node;
+        using node_ref = detail::roping::node_ref;
+
+        node_ref root;
+
+        explicit rope(node_ref n) noexcept : root(std::move(n))
+        {
+        }
+
+    public:
+        using size_type = size_t;
+
+        static constexpr size_type npos = size_type(-1);
+
+        /* A contiguous piece of the contents. */
+        struct chunk
+        {
+            const char* data;
+            size_t size;
+        };
+
+        /* Forward iterator over the chunks, in order. */
+        class chunk_iterator
+        {
+        private:
+            struct frame
+            {
+                node* n;
+                std::uint32_t index;
+            };
+
+            frame stack[detail::roping::max_height] = {};
+            size_t depth = 0;
+
+            /* Down the leftmost path from 'n'. */
+            void descend(node* n) noexcept
+            {
+                while (n->height != 0)
+                {
+                    stack[depth++] = frame{n, 0};
+                    n = n->children()[0];
+                }
+                stack[depth++] = frame{n, 0};
+            }
+
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = chunk;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const chunk*;
+            using reference = chunk;
+
+            chunk_iterator() noexcept = default;
+
+            explicit chunk_iterator(node* root) noexcept
+            {
+                if (root != nullptr && root->length != 0)
+                {
+                    descend(root);
+                }
+            }
+
+            chunk operator*() const noexcept
+            {
+                node* leaf = stack[depth - 1].n;
+                return chunk{leaf->text(), leaf->count};
+            }
+
+            chunk_iterator& operator++() noexcept
+            {
+                do
+                {
+                    --depth;
+                    while (depth != 0 && ++stack[depth - 1].index == stack[depth - 1].n->count)
+                    {
+                        --depth;
+                    }
+                    if (depth == 0)
+                    {
+                        return *this;
+                    }
+                    frame& parent = stack[depth - 1];
+                    descend(parent.n->children()[parent.index]);
+                } while (stack[depth - 1].n->count == 0);
+                return *this;
+            }
+
+            chunk_iterator operator++(int) noexcept
+            {
+                chunk_iterator old = *this;
+                ++*this;
+                return old;
+            }
+
+            friend bool operator==(const chunk_iterator& a, const chunk_iterator& b) noexcept
+            {
+                return a.depth == b.depth && (a.depth == 0 || a.stack[a.depth - 1].n == b.stack[b.depth - 1].n);
+            }
+
+            friend bool operator!=(const chunk_iterator& a, const chunk_iterator& b) noexcept
+            {
+                return !(a == b);
+            }
+        };
+
+        struct chunk_range
+        {
+            chunk_iterator first;
+
+            chunk_iterator begin() const noexcept
+            {
+                return first;
+            }
+
+            chunk_iterator end() const noexcept
+            {
+                return chunk_iterator();
+            }
+        };
+
+        rope() noexcept = default;
+
+        rope(const char* s, size_type n) : root(detail::roping::build(s, n))
+        {
+        }
+
+        explicit rope(const char* s) : rope(s, std::strlen(s))
+        {
+        }
+
+        explicit rope(const std::string& s) : rope(s.data(), s.size())
+        {
+        }
+
+#if CPPP_CPLUSPLUS >= 201703L
+        explicit rope(std::string_view s) : rope(s.data(), s.size())
+        {
+        }
+#endif
+
+        size_type size() const noexcept
+        {
+            return root ? root->length : 0;
+        }
+
+        size_type length() const noexcept
+        {
+            return size();
+        }
+
+        bool empty() const noexcept
+        {
+            return size() == 0;
+        }
+
+        char operator[](size_type pos) const noexcept
+        {
+            node* n = root.get();
+            while (n->height != 0)
+            {
+                const size_t* length = n->lengths();
+                while (pos >= *length)
+                {
+                    pos -= *length++;
+                }
+                n = n->children()[length - n->lengths()];
+            }
+            return n->text()[pos];
+        }
+
+        char at(size_type pos) const
+        {
+            if (pos >= size())
+            {
+                throw std::out_of_range("cppp::rope::at");
+            }
+            return (*this)[pos];
+        }
+
+        chunk_range chunks() const noexcept
+        {
+            return chunk_range{chunk_iterator(root.get())};
+        }
+
+        /* Copy up to 'count' bytes from 'pos' to 'out', returns the number
+           copied. */
+        size_type copy(char* out, size_type count, size_type pos = 0) const
+        {
+            size_type n = size();
+            if (pos > n)
+            {
+                throw std::out_of_range("cppp::rope::copy");
+            }
+            count = std::min(count, n - pos);
+            size_type copied = 0;
+            for (chunk c : chunks())
+            {
+                if (copied == count)
+                {
+                    break;
+                }
+                if (pos >= c.size)
+                {
+                    pos -= c.size;
+                    continue;
+                }
+                size_type take = std::min(c.size - pos, count - copied);
+                std::memcpy(out + copied, c.data + pos, take);
+                copied += take;
+                pos = 0;
+            }
+            return copied;
+        }
+
+        std::string str() const
+        {
+            std::string s;
+            s.reserve(size());
+            for (chunk c : chunks())
+            {
+                s.append(c.data, c.size);
+            }
+            return s;
+        }
+
+        rope substr(size_type pos = 0, size_type count = npos) const
+        {
+            size_type n = size();
+            check_position(pos, n, "cppp::rope::substr");
+            detail::roping::builder b;
+            b.push_range(root.get(), pos, pos + std::min(count, n - pos));
+            return rope(b.finish());
+        }
+
+        rope& insert(size_type pos, const char* s, size_type count)
+        {
+            check_position(pos, size(), "cppp::rope::insert");
+            if (count == 0 || insert_in_place(pos, s, count))
+            {
+                return *this;
+            }
+            detail::roping::builder b;
+            b.push_range(root.get(), 0, pos);
+            b.push_text(s, count);
+            b.push_range(root.get(), pos, size());
+            root = b.finish();
+            return *this;
+        }
+
+        rope& insert(size_type pos, const char* s)
+        {
+            return insert(pos, s, std::strlen(s));
+        }
+
+        rope& insert(size_type pos, const rope& other)
+        {
+            check_position(pos, size(), "cppp::rope::insert");
+            detail::roping::builder b;
+            b.push_range(root.get(), 0, pos);
+            b.push_range(other.root.get(), 0, other.size());
+            b.push_range(root.get(), pos, size());
+            root = b.finish();
+            return *this;
+        }
+
+        rope& append(const char* s, size_type count)
+        {
+            return insert(size(), s, count);
+        }
+
+        rope& append(const char* s)
+        {
+            return insert(size(), s, std::strlen(s));
+        }
+
+        rope& append(const rope& other)
+        {
+            node_ref tail = other.root;
+            root = detail::roping::concat(std::move(root), std::move(tail));
+            return *this;
+        }
+
+        rope& operator+=(const rope& other)
+        {
+            return append(other);
+        }
+
+        rope& operator+=(const char* s)
+        {
+            return append(s);
+        }
+
+        rope& erase(size_type pos = 0, size_type count = npos)
+        {
+            size_type n = size();
+            check_position(pos, n, "cppp::rope::erase");
+            count = std::min(count, n - pos);
+            if (count == 0 || erase_in_place(pos, count))
+            {
+                return *this;
+            }
+            detail::roping::builder b;
+            b.push_range(root.get(), 0, pos);
+            b.push_range(root.get(), pos + count, n);
+            root = b.finish();
+            return *this;
+        }
+
+        rope& replace(size_type pos, size_type count, const char* s, size_type length)
+        {
+            size_type n = size();
+            check_position(pos, n, "cppp::rope::replace");
+            count = std::min(count, n - pos);
+            detail::roping::builder b;
+            b.push_range(root.get(), 0, pos);
+            b.push_text(s, length);
+            b.push_range(root.get(), pos + count, n);
+            root = b.finish();
+            return *this;
+        }
+
+        void clear() noexcept
+        {
+            root = node_ref();
+        }
+
+        void swap(rope& other) noexcept
+        {
+            std::swap(root, other.root);
+        }
+
+        /* Levels of the tree, 0 when empty. */
+        size_type height() const noexcept
+        {
+            return root ? root->height + 1 : 0;
+        }
+
+        int compare(const rope& other) const noexcept
+        {
+            chunk_iterator i = chunks().begin(), j = other.chunks().begin(), end;
+            size_type a_pos = 0, b_pos = 0;
+            while (i != end && j != end)
+            {
+                chunk a = *i, b = *j;
+                size_type take = std::min(a.size - a_pos, b.size - b_pos);
+                int result = std::memcmp(a.data + a_pos, b.data + b_pos, take);
+                if (result != 0)
+                {
+                    return result;
+                }
+                a_pos += take;
+                b_pos += take;
+                if (a_pos == a.size)
+                {
+                    ++i;
+                    a_pos = 0;
+                }
+                if (b_pos == b.size)
+                {
+                    ++j;
+                    b_pos = 0;
+                }
+            }
+            return i != end ? 1 : j != end ? -1 : 0;
+        }
+
+        friend bool operator==(const rope& a, const rope& b) noexcept
+        {
+            return a.size() == b.size() && (a.root.get() == b.root.get() || a.compare(b) == 0);
+        }
+
+        friend bool operator!=(const rope& a, const rope& b) noexcept
+        {
+            return !(a == b);
+        }
+
+        friend bool operator<(const rope& a, const rope& b) noexcept
+        {
+            return a.compare(b) < 0;
+        }
+
+        friend rope operator+(const rope& a, const rope& b)
+        {
+            return rope(detail::roping::concat(a.root, b.root));
+        }
+
+    private:
+        static void check_position(size_type pos, size_type size, const char* what)
+        {
+            if (pos > size)
+            {
+                throw std::out_of_range(what);
+            }
+        }
+
+        /* The path to the leaf holding 'pos', or to the end of the leaf
+           before it, when every node on it is owned by this rope. 'slots'
+           gets the parent's pointer to each node below the root. */
+        size_t unique_path(size_type& pos, node** path, node*** slots) const noexcept
+        {
+            size_t depth = 0;
+            node* n = root.get();
+            for (;;)
+            {
+                if (!n->unique())
+                {
+                    return 0;
+                }
+                path[depth++] = n;
+                if (n->height == 0)
+                {
+                    return depth;
+                }
+                const size_t* length = n->lengths();
+                const size_t* last = length + n->count - 1;
+                while (length != last && pos > *length)
+                {
+                    pos -= *length++;
+                }
+                node** child = n->children() + (length - n->lengths());
+                slots[depth] = child;
+                n = *child;
+            }
+        }
+
+        bool insert_in_place(size_type pos, const char* s, size_type count)
+        {
+            using namespace detail::roping;
+            if (!root || count > max_leaf)
+            {
+                return false;
+            }
+            node* path[max_height];
+            node** slots[max_height];
+            size_t depth = unique_path(pos, path, slots);
+            if (depth == 0)
+            {
+                return false;
+            }
+            node* leaf = path[depth - 1];
+            size_t total = leaf->count + count;
+            /* Text from inside the leaf would move under our feet. */
+            if (s >= leaf->text() && s < leaf->text() + leaf->capacity)
+            {
+                return false;
+            }
+            if (total > max_leaf)
+            {
+                return depth > 1 && split_leaf(path, slots, depth, pos, s, count);
+            }
+            if (total > leaf->capacity)
+            {
+                size_t capacity = std::min(max_leaf, std::max(total, 2 * size_t(leaf->capacity)));
+                node_ref grown = make_leaf(leaf->text(), leaf->count, capacity);
+                leaf = grown.get();
+                if (depth == 1)
+                {
+                    root = std::move(grown);
+                }
+                else
+                {
+                    release(*slots[depth - 1]);
+                    *slots[depth - 1] = grown.detach();
+                }
+                path[depth - 1] = leaf;
+            }
+            char* text = leaf->text();
+            std::memmove(text + pos + count, text + pos, leaf->count - pos);
+            std::memcpy(text + pos, s, count);
+            leaf->count = static_cast<std::uint32_t>(total);
+            adjust_lengths(path, slots, depth, count);
+            return true;
+        }
+
+        /* Add 'delta', modulo the size type, to the lengths along a path
+           from 'unique_path'. */
+        static void adjust_lengths(node** path, node*** slots, size_t depth, size_type delta) noexcept
+        {
+            for (size_t i = 0; i < depth; ++i)
+            {
+                path[i]->length += delta;
+                if (i != 0)
+                {
+                    path[i - 1]->lengths()[slots[i] - path[i - 1]->children()] += delta;
+                }
+            }
+        }
+
+        /* Overflow of a full leaf: two half leaves in its place, when the
+           parent has room for one more child. */
+        bool split_leaf(node** path, node*** slots, size_t depth, size_type pos, const char* s, size_type count)
+        {
+            using namespace detail::roping;
+            node* parent = path[depth - 2];
+            if (parent->count == max_children)
+            {
+                return false;
+            }
+            node* leaf = path[depth - 1];
+            char joined[2 * max_leaf];
+            std::memcpy(joined, leaf->text(), pos);
+            std::memcpy(joined + pos, s, count);
+            std::memcpy(joined + pos + count, leaf->text() + pos, leaf->count - pos);
+            size_t total = leaf->count + count, half = total / 2;
+            node_ref left = make_leaf(joined, half);
+            node_ref right = make_leaf(joined + half, total - half);
+            node** slot = slots[depth - 1];
+            size_t index = static_cast<size_t>(slot - parent->children());
+            size_t* lengths = parent->lengths() + index;
+            size_t after = parent->count - index - 1;
+            std::memmove(slot + 2, slot + 1, after * sizeof(node*));
+            std::memmove(lengths + 2, lengths + 1, after * sizeof(size_t));
+            release(leaf);
+            lengths[0] = left->length;
+            lengths[1] = right->length;
+            slot[0] = left.detach();
+            slot[1] = right.detach();
+            ++parent->count;
+            adjust_lengths(path, slots, depth - 1, count);
+            return true;
+        }
+
+        bool erase_in_place(size_type pos, size_type count)
+        {
+            using namespace detail::roping;
+            size_type offset = pos + 1;
+            node* path[max_height];
+            node** slots[max_height];
+            size_t depth = unique_path(offset, path, slots);
+            if (depth == 0)
+            {
+                return false;
+            }
+            node* leaf = path[depth - 1];
+            size_type start = offset - 1;
+            if (start + count > leaf->count)
+            {
+                return false;
+            }
+            if (depth > 1 && leaf->count - count < min_leaf)
+            {
+                return merge_leaf(path, slots, depth, start, count);
+            }
+            char* text = leaf->text();
+            std::memmove(text + start, text + start + count, leaf->count - start - count);
+            leaf->count -= static_cast<std::uint32_t>(count);
+            adjust_lengths(path, slots, depth, size_type(0) - count);
+            return true;
+        }
+
+        /* Underflow of a leaf: it and a neighbour become one leaf, or two
+           even ones when that is too long. */
+        bool merge_leaf(node** path, node*** slots, size_t depth, size_type start, size_type count)
+        {
+            using namespace detail::roping;
+            node* parent = path[depth - 2];
+            node** slot = slots[depth - 1];
+            node** first = slot != parent->children() ? slot - 1 : slot;
+            node** second = first + 1;
+            if (second == parent->children() + parent->count || !(*first)->unique() || !(*second)->unique() ||
+                (*first)->height != 0)
+            {
+                return false;
+            }
+            node* leaf = *slot;
+            char joined[2 * max_leaf];
+            size_t total = 0;
+            for (node** side = first; side <= second; ++side)
+            {
+                node* n = *side;
+                if (n == leaf)
+                {
+                    std::memcpy(joined + total, n->text(), start);
+                    std::memcpy(joined + total + start, n->text() + start + count, n->count - start - count);
+                    total += n->count - count;
+                }
+                else
+                {
+                    std::memcpy(joined + total, n->text(), n->count);
+                    total += n->count;
+                }
+            }
+            if (total <= max_leaf && parent->count == 2 && depth > 2)
+            {
+                return false;
+            }
+            size_t index = static_cast<size_t>(first - parent->children());
+            size_t* lengths = parent->lengths() + index;
+            if (total <= max_leaf)
+            {
+                node_ref merged = make_leaf(joined, total);
+                release(*first);
+                release(*second);
+                lengths[0] = total;
+                *first = merged.detach();
+                size_t after = parent->count - index - 2;
+                std::memmove(second, second + 1, after * sizeof(node*));
+                std::memmove(lengths + 1, lengths + 2, after * sizeof(size_t));
+                --parent->count;
+            }
+            else
+            {
+                size_t half = total / 2;
+                node_ref left = make_leaf(joined, half);
+                node_ref right = make_leaf(joined + half, total - half);
+                release(*first);
+                release(*second);
+                lengths[0] = half;
+                lengths[1] = total - half;
+                *first = left.detach();
+                *second = right.detach();
+            }
+            adjust_lengths(path, slots, depth - 1, size_type(0) - count);
+            if (root->count == 1 && root->height != 0)
+            {
+                node* child = root->children()[0];
+                retain(child);
+                root = node_ref(child);
+            }
+            return true;
+        }
+    };
+
+    inline void swap(rope& a, rope& b) noexcept
+    {
+        a.swap(b);
+    }
+} // namespace cppp
+
+#endif
@@ -0,0 +1,874 @@
+/* Copyright (C) 1999-2023 Free Software Foundation, Inc.
+   This file is part of the cppp-base library.
+
+   The cppp-base library is free software; you can redistribute it
+   and/or modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either version 3
+   of the License, or (at your option) any later version.
+
+   The cppp-base library is distributed in the hope that it will be
+   useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the cppp-base library; see the file COPYING.
+   If not, see <https://www.gnu.org/licenses/>.  */
+
+/* We do not use '#pragma once' because it may has bugs in some compiler. */
+#ifndef _CPPP_SLAB_ALLOCATOR_HPP
+#define _CPPP_SLAB_ALLOCATOR_HPP
+
+/* C++ Plus size-class slab allocator */
+
+#include "basedef.hpp"
+#include "bits.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+/* Memory layout
+
+   Memory is mapped from the system in 4 MiB segments aligned to 4 MiB, so
+   the segment of any pointer is found by masking its low bits.  A segment
+   is cut into 64 KiB pages, page 0 holds the segment header.
+
+   - Small objects (up to 32 KiB) are rounded up to one of 44 size classes,
+     a page holds blocks of a single class.
+   - Medium objects (up to 1 MiB) get a run of contiguous pages.
+   - Large objects are mapped directly in a segment-aligned mapping of
+     their own and unmapped when freed.
+
+   Every thread owns a heap (picked by a dense thread index) and its
+   heap owns segments.  Only the owner carves pages and pops free blocks,
+   so the fast paths are plain loads and stores.  A block freed by another
+   thread is pushed onto a lock-free list of its page (small) or heap
+   (medium) and collected by the owner on its next slow path, which makes
+   cross-thread frees cost one CAS.  When a thread exits its heap is kept
+   as it is and adopted by the next new thread.  Threads beyond the heap
+   limit share one heap behind a spin lock. */
+
+namespace cppp
+{
+    /* Statistics of the slab allocator, see 'slab_stats'. */
+    struct slab_allocator_stats
+    {
+        /* Bytes handed out, rounded up to their size class. */
+        size_t bytes_in_use;
+        /* Bytes currently mapped from the system. */
+        size_t bytes_mapped;
+        /* Number of 4 MiB segments mapped. */
+        size_t segments;
+        /* Number of live large allocations. */
+        size_t large_allocations;
+        /* Fraction of mapped memory not in use, 0 to 1. */
+        double fragmentation;
+    };
+
+    namespace detail
+    {
+        namespace slab
+        {
+            constexpr size_t segment_shift = 22;
+            constexpr size_t segment_size = size_t(1) << segment_shift;
+            constexpr size_t page_shift = 16;
+            constexpr size_t page_size = size_t(1) << page_shift;
+            constexpr size_t pages_per_segment = segment_size / page_size;
+            constexpr std::uint64_t all_pages_free = ~std::uint64_t(1);
+            constexpr size_t small_max = 32768;
+            constexpr size_t medium_max = 1024 * 1024;
+            constexpr size_t class_count = 44;
+            constexpr size_t max_heaps = 256;
+            constexpr size_t large_header = 4096;
+            /* Pages scanned for remote frees before a new page is taken. */
+            constexpr size_t scan_limit = 8;
+
+            /* Size class of a small request, 'size' must be at most 'small_max'.
+               Classes are 16 bytes apart up to 128, then four per power of two. */
+            CPPP_FORCE_INLINE size_t size_class(size_t size) noexcept
+            {
+                if (size <= 128)
+                {
+                    return size <= 16 ? 0 : (size + 15) / 16 - 1;
+                }
+                unsigned p = log2_floor(size - 1);
+                return 8 + (p - 7) * 4 + (((size - 1) >> (p - 2)) & 3);
+            }
+
+            constexpr size_t class_size(size_t index) noexcept
+            {
+                return index < 8 ? (index + 1) * 16
+                                 : (size_t(1) << (7 + (index - 8) / 4)) + (((index - 8) % 4 + 1) << (5 + (index - 8) / 4));
+            }
+
+            enum page_kind : std::uint8_t
+            {
+                page_free = 0,
+                page_small,
+                page_medium
+            };
+
+            struct heap;
+
+            struct page
+            {
+                void* local_free;
+                std::atomic<void*> remote_free;
+                page* prev;
+                page* next;
+                std::uint32_t block_size;
+                std::uint32_t capacity;
+                std::uint32_t reserved;
+                std::uint32_t used;
+                std::uint32_t run_pages;
+                std::uint8_t kind;
+                std::uint8_t class_index;
+            };
+
+            enum segment_kind : std::uint32_t
+            {
+                segment_pages = 0x5345474Du,
+                segment_large = 0x4C524745u
+            };
+
+            struct segment
+            {
+                std::uint32_t kind;
+                heap* owner;
+                /* Large segments: mapped bytes and object offset. */
+                size_t mapped;
+                size_t offset;
+                std::uint64_t free_mask;
+                segment* prev;
+                segment* next;
+                page pages[pages_per_segment];
+            };
+
+            static_assert(sizeof(segment) <= page_size, "segment header must fit in page 0");
+
+            struct heap
+            {
+                page* classes[class_count] = {};
+                segment* segments = nullptr;
+                size_t segment_count = 0;
+                /* Medium blocks freed by other threads. */
+                std::atomic<void*> remote_medium{nullptr};
+                /* Written by the owner only. */
+                std::atomic<size_t> allocated{0};
+                std::atomic<size_t> freed{0};
+            };
+
+            struct global_state
+            {
+                heap heaps[max_heaps + 1] = {};
+                std::atomic<std::uint64_t> heap_in_use[max_heaps / 64] = {};
+                std::atomic<bool> shared_lock{false};
+                std::atomic<size_t> shared_freed{0};
+                std::atomic<size_t> mapped{0};
+                std::atomic<size_t> segments{0};
+                std::atomic<size_t> large_count{0};
+                std::atomic<size_t> large_bytes{0};
+            };
+
+            /* Constant initialized, so it is usable before any constructor
+               runs, e.g. from a replaced operator 'new'. */
+            inline global_state& state() noexcept
+            {
+                static global_state instance;
+                return instance;
+            }
+
+            inline heap* shared_heap() noexcept
+            {
+                return &state().heaps[max_heaps];
+            }
+
+            /* ---- System memory ---- */
+
+            inline void* os_map(size_t size, size_t alignment) noexcept
+            {
+#if defined(_WIN32)
+                for (int attempt = 0; attempt < 8; ++attempt)
+                {
+                    void* probe = VirtualAlloc(nullptr, size + alignment, MEM_RESERVE, PAGE_NOACCESS);
+                    if (probe == nullptr)
+                    {
+                        return nullptr;
+                    }
+                    std::uintptr_t base = (reinterpret_cast<std::uintptr_t>(probe) + alignment - 1) & ~(alignment - 1);
+                    VirtualFree(probe, 0, MEM_RELEASE);
+                    void* result = VirtualAlloc(reinterpret_cast<void*>(base), size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+                    if (result != nullptr)
+                    {
+                        return result;
+                    }
+                }
+                return nullptr;
+#else
+                size_t total = size + alignment;
+                void* raw = mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                if (raw == MAP_FAILED)
+                {
+                    return nullptr;
+                }
+                std::uintptr_t start = reinterpret_cast<std::uintptr_t>(raw);
+                std::uintptr_t base = (start + alignment - 1) & ~static_cast<std::uintptr_t>(alignment - 1);
+                if (base > start)
+                {
+                    munmap(raw, base - start);
+                }
+                size_t tail = start + total - (base + size);
+                if (tail > 0)
+                {
+                    munmap(reinterpret_cast<void*>(base + size), tail);
+                }
+                return reinterpret_cast<void*>(base);
+#endif
+            }
+
+            inline void os_unmap(void* p, size_t size) noexcept
+            {
+#if defined(_WIN32)
+                (void)size;
+                VirtualFree(p, 0, MEM_RELEASE);
+#else
+                munmap(p, size);
+#endif
+            }
+
+            /* ---- Thread heaps ---- */
+
+            struct heap_binding
+            {
+                heap* bound = nullptr;
+                size_t index = max_heaps;
+
+                ~heap_binding()
+                {
+                    if (index < max_heaps)
+                    {
+                        state().heap_in_use[index / 64].fetch_and(~(std::uint64_t(1) << (index % 64)),
+                                                                  std::memory_order_release);
+                    }
+                    /* Frees from later thread-exit code go to the shared path. */
+                    bound = shared_heap();
+                    index = max_heaps;
+                }
+            };
+
+            CPPP_NOINLINE inline heap* bind_heap(heap_binding& binding) noexcept
+            {
+                global_state& s = state();
+                for (size_t word = 0; word < max_heaps / 64; ++word)
+                {
+                    std::uint64_t bits = s.heap_in_use[word].load(std::memory_order_relaxed);
+                    while (bits != ~std::uint64_t(0))
+                    {
+                        unsigned bit = countr_zero(~bits);
+                        if (s.heap_in_use[word].compare_exchange_weak(bits, bits | (std::uint64_t(1) << bit),
+                                                                      std::memory_order_acquire, std::memory_order_relaxed))
+                        {
+                            binding.index = word * 64 + bit;
+                            binding.bound = &s.heaps[binding.index];
+                            return binding.bound;
+                        }
+                    }
+                }
+                binding.bound = shared_heap();
+                return binding.bound;
+            }
+
+            CPPP_FORCE_INLINE heap* local_heap() noexcept
+            {
+                static thread_local heap_binding binding;
+                heap* h = binding.bound;
+                return CPPP_LIKELY(h != nullptr) ? h : bind_heap(binding);
+            }
+
+            class shared_guard
+            {
+            public:
+                shared_guard() noexcept
+                {
+                    std::atomic<bool>& lock = state().shared_lock;
+                    while (lock.exchange(true, std::memory_order_acquire))
+                    {
+                        while (lock.load(std::memory_order_relaxed))
+                        {
+                        }
+                    }
+                }
+
+                ~shared_guard()
+                {
+                    state().shared_lock.store(false, std::memory_order_release);
+                }
+            };
+
+            CPPP_FORCE_INLINE void add_bytes(std::atomic<size_t>& counter, size_t bytes) noexcept
+            {
+                counter.store(counter.load(std::memory_order_relaxed) + bytes, std::memory_order_relaxed);
+            }
+
+            CPPP_FORCE_INLINE segment* segment_of(const void* p) noexcept
+            {
+                return reinterpret_cast<segment*>(reinterpret_cast<std::uintptr_t>(p) & ~(segment_size - 1));
+            }
+
+            CPPP_FORCE_INLINE page* page_of(segment* s, const void* p) noexcept
+            {
+                return &s->pages[(reinterpret_cast<std::uintptr_t>(p) - reinterpret_cast<std::uintptr_t>(s)) >> page_shift];
+            }
+
+            CPPP_FORCE_INLINE char* page_start(segment* s, page* pg) noexcept
+            {
+                return reinterpret_cast<char*>(s) + (static_cast<size_t>(pg - s->pages) << page_shift);
+            }
+
+            /* ---- Segments and page runs, owner only ---- */
+
+            inline segment* new_segment(heap* h) noexcept
+            {
+                void* memory = os_map(segment_size, segment_size);
+                if (memory == nullptr)
+                {
+                    return nullptr;
+                }
+                segment* s = static_cast<segment*>(memory);
+                /* Fresh mappings are zero filled, every page starts free. */
+                s->kind = segment_pages;
+                s->owner = h;
+                s->mapped = segment_size;
+                s->free_mask = all_pages_free;
+                s->prev = nullptr;
+                s->next = h->segments;
+                if (h->segments != nullptr)
+                {
+                    h->segments->prev = s;
+                }
+                h->segments = s;
+                ++h->segment_count;
+                state().mapped.fetch_add(segment_size, std::memory_order_relaxed);
+                state().segments.fetch_add(1, std::memory_order_relaxed);
+                return s;
+            }
+
+            inline void release_segment(heap* h, segment* s) noexcept
+            {
+                if (s->prev != nullptr)
+                {
+                    s->prev->next = s->next;
+                }
+                else
+                {
+                    h->segments = s->next;
+                }
+                if (s->next != nullptr)
+                {
+                    s->next->prev = s->prev;
+                }
+                --h->segment_count;
+                state().mapped.fetch_sub(segment_size, std::memory_order_relaxed);
+                state().segments.fetch_sub(1, std::memory_order_relaxed);
+                os_unmap(s, segment_size);
+            }
+
+            /* Find 'count' contiguous free pages, returns the first index or 0. */
+            inline size_t find_run(std::uint64_t free_mask, size_t count) noexcept
+            {
+                std::uint64_t run = free_mask;
+                for (size_t i = 1; i < count && run != 0; ++i)
+                {
+                    run &= free_mask >> i;
+                }
+                return run != 0 ? countr_zero(run) : 0;
+            }
+
+            inline page* take_pages(heap* h, size_t count) noexcept
+            {
+                segment* s = h->segments;
+                size_t first = 0;
+                for (; s != nullptr; s = s->next)
+                {
+                    first = find_run(s->free_mask, count);
+                    if (first != 0)
+                    {
+                        break;
+                    }
+                }
+                if (s == nullptr)
+                {
+                    s = new_segment(h);
+                    if (s == nullptr)
+                    {
+                        return nullptr;
+                    }
+                    first = 1;
+                }
+                std::uint64_t bits = (count == 64 ? ~std::uint64_t(0) : (std::uint64_t(1) << count) - 1) << first;
+                s->free_mask &= ~bits;
+                page* pg = &s->pages[first];
+                pg->run_pages = static_cast<std::uint32_t>(count);
+                return pg;
+            }
+
+            inline void give_pages(heap* h, page* pg) noexcept
+            {
+                segment* s = segment_of(pg);
+                size_t first = static_cast<size_t>(pg - s->pages);
+                std::uint64_t bits = ((std::uint64_t(1) << pg->run_pages) - 1) << first;
+                pg->kind = page_free;
+                s->free_mask |= bits;
+                /* Keep one empty segment around to avoid map/unmap ping-pong. */
+                if (s->free_mask == all_pages_free && h->segment_count > 1)
+                {
+                    release_segment(h, s);
+                }
+            }
+
+            /* ---- Small objects ---- */
+
+            inline void push_front(heap* h, size_t c, page* pg) noexcept
+            {
+                page* head = h->classes[c];
+                if (head == nullptr)
+                {
+                    pg->prev = pg->next = pg;
+                }
+                else
+                {
+                    pg->next = head;
+                    pg->prev = head->prev;
+                    head->prev->next = pg;
+                    head->prev = pg;
+                }
+                h->classes[c] = pg;
+            }
+
+            inline void unlink(heap* h, size_t c, page* pg) noexcept
+            {
+                if (pg->next == pg)
+                {
+                    h->classes[c] = nullptr;
+                    return;
+                }
+                pg->prev->next = pg->next;
+                pg->next->prev = pg->prev;
+                if (h->classes[c] == pg)
+                {
+                    h->classes[c] = pg->next;
+                }
+            }
+
+            /* Move blocks freed by other threads to the local free list. */
+            inline void collect(page* pg) noexcept
+            {
+                if (pg->remote_free.load(std::memory_order_relaxed) == nullptr)
+                {
+                    return;
+                }
+                void* list = pg->remote_free.exchange(nullptr, std::memory_order_acquire);
+                if (list == nullptr)
+                {
+                    return;
+                }
+                void* tail = list;
+                std::uint32_t n = 1;
+                while (*static_cast<void**>(tail) != nullptr)
+                {
+                    tail = *static_cast<void**>(tail);
+                    ++n;
+                }
+                *static_cast<void**>(tail) = pg->local_free;
+                pg->local_free = list;
+                pg->used -= n;
+            }
+
+            /* Thread never used blocks onto the free list, a few at a time
+               so a fresh page does not touch all of its memory at once. */
+            inline void extend(segment* s, page* pg) noexcept
+            {
+                std::uint32_t n = pg->capacity - pg->reserved;
+                if (n > 64)
+                {
+                    n = 64;
+                }
+                char* base = page_start(s, pg) + static_cast<size_t>(pg->reserved) * pg->block_size;
+                for (std::uint32_t i = n; i-- > 0;)
+                {
+                    void* block = base + static_cast<size_t>(i) * pg->block_size;
+                    *static_cast<void**>(block) = pg->local_free;
+                    pg->local_free = block;
+                }
+                pg->reserved += n;
+            }
+
+            inline void drain_medium(heap* h) noexcept;
+
+            CPPP_NOINLINE inline void* small_slow(heap* h, size_t c) noexcept
+            {
+                drain_medium(h);
+                page* head = h->classes[c];
+                page* pg = head;
+                page* found = nullptr;
+                for (size_t scanned = 0; pg != nullptr && scanned < scan_limit; ++scanned)
+                {
+                    collect(pg);
+                    if (pg->local_free == nullptr && pg->reserved < pg->capacity)
+                    {
+                        extend(segment_of(pg), pg);
+                    }
+                    if (pg->local_free != nullptr)
+                    {
+                        found = pg;
+                        break;
+                    }
+                    pg = pg->next;
+                    if (pg == head)
+                    {
+                        break;
+                    }
+                }
+                if (pg != nullptr)
+                {
+                    /* Scanned full pages rotate to the tail,
+                       so the next scan starts with unseen ones. */
+                    h->classes[c] = pg;
+                }
+                if (found == nullptr)
+                {
+                    found = take_pages(h, 1);
+                    if (found == nullptr)
+                    {
+                        return nullptr;
+                    }
+                    found->local_free = nullptr;
+                    found->remote_free.store(nullptr, std::memory_order_relaxed);
+                    found->kind = page_small;
+                    found->class_index = static_cast<std::uint8_t>(c);
+                    found->block_size = static_cast<std::uint32_t>(class_size(c));
+                    found->capacity = static_cast<std::uint32_t>(page_size / found->block_size);
+                    found->reserved = 0;
+                    found->used = 0;
+                    push_front(h, c, found);
+                    extend(segment_of(found), found);
+                }
+                pg = found;
+                void* block = pg->local_free;
+                pg->local_free = *static_cast<void**>(block);
+                ++pg->used;
+                add_bytes(h->allocated, pg->block_size);
+                return block;
+            }
+
+            CPPP_FORCE_INLINE void* small_alloc(heap* h, size_t c) noexcept
+            {
+                page* pg = h->classes[c];
+                if (CPPP_LIKELY(pg != nullptr && pg->local_free != nullptr))
+                {
+                    void* block = pg->local_free;
+                    pg->local_free = *static_cast<void**>(block);
+                    ++pg->used;
+                    add_bytes(h->allocated, pg->block_size);
+                    return block;
+                }
+                return small_slow(h, c);
+            }
+
+            inline void small_free_local(heap* h, page* pg, void* p) noexcept
+            {
+                *static_cast<void**>(p) = pg->local_free;
+                pg->local_free = p;
+                --pg->used;
+                if (CPPP_UNLIKELY(pg->used == 0) && h->classes[pg->class_index] != pg)
+                {
+                    /* Every block is back, return the page to its segment. */
+                    unlink(h, pg->class_index, pg);
+                    give_pages(h, pg);
+                }
+            }
+
+            CPPP_FORCE_INLINE void push_remote(std::atomic<void*>& list, void* p) noexcept
+            {
+                void* old = list.load(std::memory_order_relaxed);
+                do
+                {
+                    *static_cast<void**>(p) = old;
+                } while (!list.compare_exchange_weak(old, p, std::memory_order_release, std::memory_order_relaxed));
+            }
+
+            /* ---- Medium objects ---- */
+
+            inline void* medium_alloc(heap* h, size_t size) noexcept
+            {
+                drain_medium(h);
+                size_t count_pages = (size + page_size - 1) >> page_shift;
+                page* pg = take_pages(h, count_pages);
+                if (pg == nullptr)
+                {
+                    return nullptr;
+                }
+                pg->kind = page_medium;
+                add_bytes(h->allocated, count_pages << page_shift);
+                return page_start(segment_of(pg), pg);
+            }
+
+            inline void drain_medium(heap* h) noexcept
+            {
+                if (CPPP_LIKELY(h->remote_medium.load(std::memory_order_relaxed) == nullptr))
+                {
+                    return;
+                }
+                void* list = h->remote_medium.exchange(nullptr, std::memory_order_acquire);
+                while (list != nullptr)
+                {
+                    void* next = *static_cast<void**>(list);
+                    segment* s = segment_of(list);
+                    give_pages(h, page_of(s, list));
+                    list = next;
+                }
+            }
+
+            /* ---- Large objects ---- */
+
+            inline void* large_alloc(size_t size, size_t alignment) noexcept
+            {
+                size_t offset = alignment > large_header ? alignment : large_header;
+                if (size > ~size_t(0) - offset - segment_size)
+                {
+                    return nullptr;
+                }
+                size_t mapped = (offset + size + large_header - 1) & ~(large_header - 1);
+                void* memory = os_map(mapped, segment_size);
+                if (memory == nullptr)
+                {
+                    return nullptr;
+                }
+                segment* s = static_cast<segment*>(memory);
+                s->kind = segment_large;
+                s->owner = nullptr;
+                s->mapped = mapped;
+                s->offset = offset;
+                global_state& g = state();
+                g.mapped.fetch_add(mapped, std::memory_order_relaxed);
+                g.large_count.fetch_add(1, std::memory_order_relaxed);
+                g.large_bytes.fetch_add(mapped - offset, std::memory_order_relaxed);
+                return static_cast<char*>(memory) + offset;
+            }
+
+            inline void large_free(segment* s) noexcept
+            {
+                global_state& g = state();
+                g.mapped.fetch_sub(s->mapped, std::memory_order_relaxed);
+                g.large_count.fetch_sub(1, std::memory_order_relaxed);
+                g.large_bytes.fetch_sub(s->mapped - s->offset, std::memory_order_relaxed);
+                os_unmap(s, s->mapped);
+            }
+
+            /* ---- Dispatch ---- */
+
+            inline void* allocate_in(heap* h, size_t size) noexcept
+            {
+                if (CPPP_LIKELY(size <= small_max))
+                {
+                    return small_alloc(h, size_class(size));
+                }
+                return medium_alloc(h, size);
+            }
+
+            inline void* allocate(size_t size) noexcept
+            {
+                if (CPPP_UNLIKELY(size > medium_max))
+                {
+                    return large_alloc(size, 16);
+                }
+                heap* h = local_heap();
+                if (CPPP_UNLIKELY(h == shared_heap()))
+                {
+                    shared_guard guard;
+                    return allocate_in(h, size);
+                }
+                return allocate_in(h, size);
+            }
+
+            inline void deallocate(void* p) noexcept
+            {
+                segment* s = segment_of(p);
+                if (CPPP_UNLIKELY(s->kind == segment_large))
+                {
+                    large_free(s);
+                    return;
+                }
+                page* pg = page_of(s, p);
+                heap* h = local_heap();
+                bool shared = h == shared_heap();
+                size_t bytes = pg->kind == page_small ? pg->block_size : static_cast<size_t>(pg->run_pages) << page_shift;
+                if (CPPP_UNLIKELY(shared))
+                {
+                    state().shared_freed.fetch_add(bytes, std::memory_order_relaxed);
+                }
+                else
+                {
+                    add_bytes(h->freed, bytes);
+                }
+                if (CPPP_LIKELY(s->owner == h && !shared))
+                {
+                    if (CPPP_LIKELY(pg->kind == page_small))
+                    {
+                        small_free_local(h, pg, p);
+                    }
+                    else
+                    {
+                        give_pages(h, pg);
+                    }
+                    return;
+                }
+                if (pg->kind == page_small)
+                {
+                    push_remote(pg->remote_free, p);
+                }
+                else
+                {
+                    push_remote(s->owner->remote_medium, p);
+                }
+            }
+
+            inline size_t usable_size(const void* p) noexcept
+            {
+                segment* s = segment_of(p);
+                if (s->kind == segment_large)
+                {
+                    return s->mapped - s->offset;
+                }
+                page* pg = page_of(s, p);
+                return pg->kind == page_small ? pg->block_size : static_cast<size_t>(pg->run_pages) << page_shift;
+            }
+        } // namespace slab
+    } // namespace detail
+
+    /* Allocate 'size' bytes aligned to 16, returns nullptr on failure. */
+    inline void* slab_malloc(size_t size) noexcept
+    {
+        return detail::slab::allocate(size);
+    }
+
+    /* Allocate 'size' bytes aligned to 'alignment', a power of two.
+       Returns nullptr on failure or when 'alignment' exceeds 2 MiB. */
+    inline void* slab_aligned_alloc(size_t alignment, size_t size) noexcept
+    {
+        if (alignment <= 16)
+        {
+            return detail::slab::allocate(size);
+        }
+        /* The header of a large object must share its segment. */
+        if (alignment >= detail::slab::segment_size)
+        {
+            return nullptr;
+        }
+        /* Power of two size classes are aligned to their size,
+           and page runs to the page size. */
+        size_t rounded = size < alignment ? alignment : size;
+        if (rounded <= detail::slab::small_max)
+        {
+            return detail::slab::allocate(static_cast<size_t>(ceil_pow2(rounded)));
+        }
+        if (rounded <= detail::slab::medium_max && alignment <= detail::slab::page_size)
+        {
+            return detail::slab::allocate(rounded);
+        }
+        return detail::slab::large_alloc(size, alignment);
+    }
+
+    /* Free memory from 'slab_malloc' or 'slab_aligned_alloc',
+       from any thread.  'p' may be nullptr. */
+    inline void slab_free(void* p) noexcept
+    {
+        if (p != nullptr)
+        {
+            detail::slab::deallocate(p);
+        }
+    }
+
+    /* Number of usable bytes of the block at 'p'. */
+    inline size_t slab_usable_size(const void* p) noexcept
+    {
+        return p != nullptr ? detail::slab::usable_size(p) : 0;
+    }
+
+    /* Collect allocator statistics.  Counters of other threads are read
+       without synchronization, the result is approximate under load. */
+    inline slab_allocator_stats slab_stats() noexcept
+    {
+        detail::slab::global_state& g = detail::slab::state();
+        std::ptrdiff_t in_use = static_cast<std::ptrdiff_t>(g.large_bytes.load(std::memory_order_relaxed));
+        in_use -= static_cast<std::ptrdiff_t>(g.shared_freed.load(std::memory_order_relaxed));
+        for (size_t i = 0; i <= detail::slab::max_heaps; ++i)
+        {
+            in_use += static_cast<std::ptrdiff_t>(g.heaps[i].allocated.load(std::memory_order_relaxed));
+            in_use -= static_cast<std::ptrdiff_t>(g.heaps[i].freed.load(std::memory_order_relaxed));
+        }
+        slab_allocator_stats result;
+        result.bytes_in_use = in_use > 0 ? static_cast<size_t>(in_use) : 0;
+        result.bytes_mapped = g.mapped.load(std::memory_order_relaxed);
+        result.segments = g.segments.load(std::memory_order_relaxed);
+        result.large_allocations = g.large_count.load(std::memory_order_relaxed);
+        result.fragmentation = result.bytes_mapped == 0 || result.bytes_in_use >= result.bytes_mapped
+                                   ? 0.0
+                                   : 1.0 - static_cast<double>(result.bytes_in_use) / static_cast<double>(result.bytes_mapped);
+        return result;
+    }
+
+    /* Resident set size of the current process in bytes, 0 if unknown. */
+    inline size_t process_rss() noexcept
+    {
+#if defined(_WIN32)
+        PROCESS_MEMORY_COUNTERS counters;
+        if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        {
+            return static_cast<size_t>(counters.WorkingSetSize);
+        }
+        return 0;
+#elif defined(__linux__)
+        std::FILE* file = std::fopen("/proc/self/statm", "r");
+        if (file == nullptr)
+        {
+            return 0;
+        }
+        unsigned long total = 0, resident = 0;
+        int fields = std::fscanf(file, "%lu %lu", &total, &resident);
+        std::fclose(file);
+        return fields == 2 ? static_cast<size_t>(resident) * static_cast<size_t>(sysconf(_SC_PAGESIZE)) : 0;
+#else
+        /* Only the peak is portable, 'ru_maxrss' is in bytes on macOS. */
+        struct rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) != 0)
+        {
+            return 0;
+        }
+#if defined(__APPLE__)
+        return static_cast<size_t>(usage.ru_maxrss);
+#else
+        return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+    }
+} // namespace cppp
+
+#endif
@@ -0,0 +1,178 @@
+/* Copyright (C) 1999-2023 Free Software Foundation, Inc.
+   This file is part of the cppp-base library.
+
+   The cppp-base library is free software; you can redistribute it
+   and/or modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either version 3
+   of the License, or (at your option) any later version.
+
+   The cppp-base library is distributed in the hope that it will be
+   useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the cppp-base library; see the file COPYING.
+   If not, see <https://www.gnu.org/licenses/>.  */
+
+/* We do not use '#pragma once' because it may has bugs in some compiler. */
+#ifndef _CPPP_SLAB_NEW_HPP
+#define _CPPP_SLAB_NEW_HPP
+
+/* C++ Plus global operator new replacement
+
+   Include this file in exactly ONE translation unit of a program to route
+   every global 'new' and 'delete' through the slab allocator.  Replacement
+   allocation functions must not be inline, so including it twice breaks
+   the link with duplicate symbols. */
+
+#include "slab_allocator.hpp"
+
+#include <new>
+
+namespace cppp
+{
+    namespace detail
+    {
+        namespace slab
+        {
+            /* Call the new handler until memory is available,
+               as the standard requires from a throwing 'new'. */
+            inline void* new_or_throw(size_t size, size_t alignment)
+            {
+                for (;;)
+                {
+                    void* p = alignment <= 16 ? slab_malloc(size) : slab_aligned_alloc(alignment, size);
+                    if (CPPP_LIKELY(p != nullptr))
+                    {
+                        return p;
+                    }
+                    std::new_handler handler = std::get_new_handler();
+                    if (handler == nullptr)
+                    {
+                        throw std::bad_alloc();
+                    }
+                    handler();
+                }
+            }
+
+            inline void* new_or_null(size_t size, size_t alignment) noexcept
+            {
+                try
+                {
+                    return new_or_throw(size, alignment);
+                }
+                catch (...)
+                {
+                    return nullptr;
+                }
+            }
+        } // namespace slab
+    } // namespace detail
+} // namespace cppp
+
+void* operator new(std::size_t size)
+{
+    return cppp::detail::slab::new_or_throw(size, 16);
+}
+
+void* operator new[](std::size_t size)
+{
+    return cppp::detail::slab::new_or_throw(size, 16);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    return cppp::detail::slab::new_or_null(size, 16);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    return cppp::detail::slab::new_or_null(size, 16);
+}
+
+void operator delete(void* p) noexcept
+{
+    cppp::slab_free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    cppp::slab_free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept
+{
+    cppp::slab_free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept
+{
+    cppp::slab_free(p);
+}
+
+#if defined(__cpp_sized_deallocation)
+void operator delete(void* p, std::size_t) noexcept
+{
+    cppp::slab_free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+    cppp::slab_free(p);
+}
+#endif
+
+#if defined(__cpp_aligned_new)
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    return cppp::detail::slab::new_or_throw(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return cppp::detail::slab::new_or_throw(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return cppp::detail::slab::new_or_null(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return cppp::detail::slab::new_or_null(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* p, std::align_val_t) noexcept
+{
+    cppp::slab_free(p);
+}
+
+void operator delete[](void* p, std::align_val_t) noexcept
+{
+    cppp::slab_free(p);
+}
+
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept
+{
+    cppp::slab_free(p);
+}
+
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept
+{
+    cppp::slab_free(p);
+}
+
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept
+{
+    cppp::slab_free(p);
+}
+
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept
+{
+    cppp::slab_free(p);
+}
+#endif
+
+#endif
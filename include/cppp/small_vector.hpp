@@ -0,0 +1,890 @@
+/* Copyright (C) 1999-2023 Free Software Foundation, Inc.
+   This file is part of the cppp-base library.
+
+   The cppp-base library is free software; you can redistribute it
+   and/or modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either version 3
+   of the License, or (at your option) any later version.
+
+   The cppp-base library is distributed in the hope that it will be
+   useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the cppp-base library; see the file COPYING.
+   If not, see <https://www.gnu.org/licenses/>.  */
+
+/* We do not use '#pragma once' because it may has bugs in some compiler. */
+#ifndef _CPPP_SMALL_VECTOR_HPP
+#define _CPPP_SMALL_VECTOR_HPP
+
+/* C++ Plus small-buffer-optimized vector */
+
+#include "basedef.hpp"
+#include "type_traits.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace cppp
+{
+    /* A sequence container with the interface of 'std::vector' that keeps
+       up to 'N' elements inside the object and only allocates past that.
+
+       Elements that are 'is_trivially_relocatable' are moved with 'memcpy'
+       when the storage grows, and shifted with 'memmove' by insert and
+       erase.  Iterators are plain pointers and are invalidated like those
+       of 'std::vector', and additionally by moving or swapping the container
+       while its elements are inline. */
+    template<typename T, size_t N, typename Allocator = std::allocator<T>>
+    class small_vector : private Allocator
+    {
+    private:
+        using alloc_traits = std::allocator_traits<Allocator>;
+        static constexpr bool relocatable = is_trivially_relocatable<T>::value;
+
+    public:
+        using value_type = T;
+        using allocator_type = Allocator;
+        using size_type = size_t;
+        using difference_type = std::ptrdiff_t;
+        using reference = T&;
+        using const_reference = const T&;
+        using pointer = T*;
+        using const_pointer = const T*;
+        using iterator = T*;
+        using const_iterator = const T*;
+        using reverse_iterator = std::reverse_iterator<iterator>;
+        using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+        static constexpr size_type inline_capacity = N;
+
+    private:
+        T* first;
+        size_type count = 0;
+        size_type cap = N;
+        alignas(T) unsigned char buffer[(N > 0 ? N : 1) * sizeof(T)];
+
+    public:
+        small_vector() noexcept(noexcept(Allocator())) : Allocator(), first(inline_data())
+        {
+        }
+
+        explicit small_vector(const Allocator& alloc) noexcept : Allocator(alloc), first(inline_data())
+        {
+        }
+
+        explicit small_vector(size_type n, const Allocator& alloc = Allocator()) : small_vector(alloc)
+        {
+            resize(n);
+        }
+
+        small_vector(size_type n, const T& value, const Allocator& alloc = Allocator()) : small_vector(alloc)
+        {
+            assign(n, value);
+        }
+
+        template<typename InputIt, typename = typename std::enable_if<!std::is_integral<InputIt>::value>::type>
+        small_vector(InputIt from, InputIt to, const Allocator& alloc = Allocator()) : small_vector(alloc)
+        {
+            assign(from, to);
+        }
+
+        small_vector(std::initializer_list<T> list, const Allocator& alloc = Allocator()) : small_vector(alloc)
+        {
+            assign(list.begin(), list.end());
+        }
+
+        small_vector(const small_vector& other)
+            : small_vector(alloc_traits::select_on_container_copy_construction(other.get_allocator()))
+        {
+            assign(other.begin(), other.end());
+        }
+
+        small_vector(const small_vector& other, const Allocator& alloc) : small_vector(alloc)
+        {
+            assign(other.begin(), other.end());
+        }
+
+        small_vector(small_vector&& other) noexcept(std::is_nothrow_move_constructible<T>::value)
+            : Allocator(std::move(other.allocator())), first(inline_data())
+        {
+            take(other);
+        }
+
+        small_vector(small_vector&& other, const Allocator& alloc) : small_vector(alloc)
+        {
+            if (allocator() == other.allocator())
+            {
+                take(other);
+            }
+            else
+            {
+                assign(std::make_move_iterator(other.begin()), std::make_move_iterator(other.end()));
+                other.clear();
+            }
+        }
+
+        ~small_vector()
+        {
+            destroy_range(first, first + count);
+            deallocate_heap();
+        }
+
+        small_vector& operator=(const small_vector& other)
+        {
+            if (this != &other)
+            {
+                if (alloc_traits::propagate_on_container_copy_assignment::value && allocator() != other.allocator())
+                {
+                    clear();
+                    shrink_to_inline();
+                }
+                copy_allocator(other, typename alloc_traits::propagate_on_container_copy_assignment());
+                assign(other.begin(), other.end());
+            }
+            return *this;
+        }
+
+        small_vector& operator=(small_vector&& other) noexcept(
+            (alloc_traits::propagate_on_container_move_assignment::value || std::is_empty<Allocator>::value) &&
+            std::is_nothrow_move_constructible<T>::value)
+        {
+            if (this != &other)
+            {
+                if (alloc_traits::propagate_on_container_move_assignment::value || allocator() == other.allocator())
+                {
+                    clear();
+                    shrink_to_inline();
+                    move_allocator(other, typename alloc_traits::propagate_on_container_move_assignment());
+                    take(other);
+                }
+                else
+                {
+                    assign(std::make_move_iterator(other.begin()), std::make_move_iterator(other.end()));
+                    other.clear();
+                }
+            }
+            return *this;
+        }
+
+        small_vector& operator=(std::initializer_list<T> list)
+        {
+            assign(list.begin(), list.end());
+            return *this;
+        }
+
+        void assign(size_type n, const T& value)
+        {
+            if (n > cap)
+            {
+                /* 'value' may live in our storage, copy it before clearing. */
+                T copy(value);
+                clear();
+                reallocate(n);
+                append_fill(n, copy);
+                return;
+            }
+            size_type common = std::min(n, count);
+            std::fill(first, first + common, value);
+            if (n > count)
+            {
+                append_fill(n - count, value);
+            }
+            else
+            {
+                destroy_range(first + n, first + count);
+                count = n;
+            }
+        }
+
+        template<typename InputIt, typename = typename std::enable_if<!std::is_integral<InputIt>::value>::type>
+        void assign(InputIt from, InputIt to)
+        {
+            clear();
+            insert(end(), from, to);
+        }
+
+        void assign(std::initializer_list<T> list)
+        {
+            assign(list.begin(), list.end());
+        }
+
+        allocator_type get_allocator() const noexcept
+        {
+            return allocator();
+        }
+
+        /* Element access */
+
+        reference at(size_type pos)
+        {
+            if (pos >= count)
+            {
+                throw std::out_of_range("cppp::small_vector::at");
+            }
+            return first[pos];
+        }
+
+        const_reference at(size_type pos) const
+        {
+            if (pos >= count)
+            {
+                throw std::out_of_range("cppp::small_vector::at");
+            }
+            return first[pos];
+        }
+
+        reference operator[](size_type pos) noexcept
+        {
+            return first[pos];
+        }
+
+        const_reference operator[](size_type pos) const noexcept
+        {
+            return first[pos];
+        }
+
+        reference front() noexcept
+        {
+            return first[0];
+        }
+
+        const_reference front() const noexcept
+        {
+            return first[0];
+        }
+
+        reference back() noexcept
+        {
+            return first[count - 1];
+        }
+
+        const_reference back() const noexcept
+        {
+            return first[count - 1];
+        }
+
+        T* data() noexcept
+        {
+            return first;
+        }
+
+        const T* data() const noexcept
+        {
+            return first;
+        }
+
+        /* Iterators */
+
+        iterator begin() noexcept
+        {
+            return first;
+        }
+
+        const_iterator begin() const noexcept
+        {
+            return first;
+        }
+
+        const_iterator cbegin() const noexcept
+        {
+            return first;
+        }
+
+        iterator end() noexcept
+        {
+            return first + count;
+        }
+
+        const_iterator end() const noexcept
+        {
+            return first + count;
+        }
+
+        const_iterator cend() const noexcept
+        {
+            return first + count;
+        }
+
+        reverse_iterator rbegin() noexcept
+        {
+            return reverse_iterator(end());
+        }
+
+        const_reverse_iterator rbegin() const noexcept
+        {
+            return const_reverse_iterator(end());
+        }
+
+        const_reverse_iterator crbegin() const noexcept
+        {
+            return const_reverse_iterator(end());
+        }
+
+        reverse_iterator rend() noexcept
+        {
+            return reverse_iterator(begin());
+        }
+
+        const_reverse_iterator rend() const noexcept
+        {
+            return const_reverse_iterator(begin());
+        }
+
+        const_reverse_iterator crend() const noexcept
+        {
+            return const_reverse_iterator(begin());
+        }
+
+        /* Capacity */
+
+        bool empty() const noexcept
+        {
+            return count == 0;
+        }
+
+        size_type size() const noexcept
+        {
+            return count;
+        }
+
+        size_type max_size() const noexcept
+        {
+            return std::min<size_type>(alloc_traits::max_size(allocator()),
+                                       static_cast<size_type>(std::numeric_limits<difference_type>::max()) / sizeof(T));
+        }
+
+        size_type capacity() const noexcept
+        {
+            return cap;
+        }
+
+        /* Whether the elements are stored inside the object. */
+        bool is_inline() const noexcept
+        {
+            return first == inline_data();
+        }
+
+        void reserve(size_type n)
+        {
+            if (n > cap)
+            {
+                reallocate(n);
+            }
+        }
+
+        /* Move the elements back inline when they fit, or to a smaller
+           heap block otherwise. */
+        void shrink_to_fit()
+        {
+            if (is_inline() || count == cap)
+            {
+                return;
+            }
+            if (count <= N)
+            {
+                shrink_to_inline();
+            }
+            else
+            {
+                reallocate(count);
+            }
+        }
+
+        /* Modifiers */
+
+        void clear() noexcept
+        {
+            destroy_range(first, first + count);
+            count = 0;
+        }
+
+        iterator insert(const_iterator pos, const T& value)
+        {
+            return emplace(pos, value);
+        }
+
+        iterator insert(const_iterator pos, T&& value)
+        {
+            return emplace(pos, std::move(value));
+        }
+
+        iterator insert(const_iterator pos, size_type n, const T& value)
+        {
+            size_type index = static_cast<size_type>(pos - first);
+            if (n == 0)
+            {
+                return first + index;
+            }
+            T copy(value);
+            reserve_for(n);
+            append_fill(n, copy);
+            std::rotate(first + index, first + count - n, first + count);
+            return first + index;
+        }
+
+        template<typename InputIt, typename = typename std::enable_if<!std::is_integral<InputIt>::value>::type>
+        iterator insert(const_iterator pos, InputIt from, InputIt to)
+        {
+            size_type index = static_cast<size_type>(pos - first);
+            size_type old_count = count;
+            insert_range(from, to, typename std::iterator_traits<InputIt>::iterator_category());
+            std::rotate(first + index, first + old_count, first + count);
+            return first + index;
+        }
+
+        iterator insert(const_iterator pos, std::initializer_list<T> list)
+        {
+            return insert(pos, list.begin(), list.end());
+        }
+
+        template<typename... Args>
+        iterator emplace(const_iterator pos, Args&&... args)
+        {
+            size_type index = static_cast<size_type>(pos - first);
+            if (index == count)
+            {
+                emplace_back(std::forward<Args>(args)...);
+                return first + index;
+            }
+            if (count == cap)
+            {
+                grow_with_gap(index, std::forward<Args>(args)...);
+                return first + index;
+            }
+            /* Build the value first, 'args' may refer to our elements. */
+            T value(std::forward<Args>(args)...);
+            T* at_pos = first + index;
+            if (relocatable)
+            {
+                std::memmove(static_cast<void*>(at_pos + 1), static_cast<const void*>(at_pos), (count - index) * sizeof(T));
+                ++count;
+                construct(at_pos, std::move(value));
+            }
+            else
+            {
+                construct(first + count, std::move(first[count - 1]));
+                ++count;
+                std::move_backward(at_pos, first + count - 2, first + count - 1);
+                *at_pos = std::move(value);
+            }
+            return at_pos;
+        }
+
+        iterator erase(const_iterator pos)
+        {
+            return erase(pos, pos + 1);
+        }
+
+        iterator erase(const_iterator from, const_iterator to)
+        {
+            T* begin_erase = first + (from - first);
+            T* end_erase = first + (to - first);
+            if (begin_erase == end_erase)
+            {
+                return begin_erase;
+            }
+            if (relocatable)
+            {
+                destroy_range(begin_erase, end_erase);
+                std::memmove(static_cast<void*>(begin_erase), static_cast<const void*>(end_erase),
+                             static_cast<size_t>(first + count - end_erase) * sizeof(T));
+            }
+            else
+            {
+                T* new_end = std::move(end_erase, first + count, begin_erase);
+                destroy_range(new_end, first + count);
+            }
+            count -= static_cast<size_type>(end_erase - begin_erase);
+            return begin_erase;
+        }
+
+        CPPP_FORCE_INLINE void push_back(const T& value)
+        {
+            emplace_back(value);
+        }
+
+        CPPP_FORCE_INLINE void push_back(T&& value)
+        {
+            emplace_back(std::move(value));
+        }
+
+        template<typename... Args>
+        CPPP_FORCE_INLINE reference emplace_back(Args&&... args)
+        {
+            if (CPPP_UNLIKELY(count == cap))
+            {
+                grow_with_gap(count, std::forward<Args>(args)...);
+                return first[count - 1];
+            }
+            construct(first + count, std::forward<Args>(args)...);
+            return first[count++];
+        }
+
+        void pop_back() noexcept
+        {
+            --count;
+            destroy(first + count);
+        }
+
+        void resize(size_type n)
+        {
+            if (n < count)
+            {
+                destroy_range(first + n, first + count);
+                count = n;
+                return;
+            }
+            reserve(n);
+            while (count < n)
+            {
+                construct(first + count);
+                ++count;
+            }
+        }
+
+        void resize(size_type n, const T& value)
+        {
+            if (n < count)
+            {
+                destroy_range(first + n, first + count);
+                count = n;
+                return;
+            }
+            if (n > count)
+            {
+                T copy(value);
+                reserve(n);
+                append_fill(n - count, copy);
+            }
+        }
+
+        void swap(small_vector& other) noexcept(std::is_nothrow_move_constructible<T>::value)
+        {
+            if (this == &other)
+            {
+                return;
+            }
+            if (!is_inline() && !other.is_inline())
+            {
+                std::swap(first, other.first);
+                std::swap(count, other.count);
+                std::swap(cap, other.cap);
+            }
+            else
+            {
+                small_vector temp(std::move(*this));
+                clear();
+                shrink_to_inline();
+                take(other);
+                other.clear();
+                other.shrink_to_inline();
+                other.take(temp);
+            }
+            swap_allocator(other, typename alloc_traits::propagate_on_container_swap());
+        }
+
+    private:
+        Allocator& allocator() noexcept
+        {
+            return *this;
+        }
+
+        const Allocator& allocator() const noexcept
+        {
+            return *this;
+        }
+
+        T* inline_data() noexcept
+        {
+            return reinterpret_cast<T*>(buffer);
+        }
+
+        const T* inline_data() const noexcept
+        {
+            return reinterpret_cast<const T*>(buffer);
+        }
+
+        template<typename... Args>
+        void construct(T* p, Args&&... args)
+        {
+            alloc_traits::construct(allocator(), p, std::forward<Args>(args)...);
+        }
+
+        void destroy(T* p) noexcept
+        {
+            alloc_traits::destroy(allocator(), p);
+        }
+
+        void destroy_range(T* from, T* to) noexcept
+        {
+            if (!std::is_trivially_destructible<T>::value)
+            {
+                for (; from != to; ++from)
+                {
+                    destroy(from);
+                }
+            }
+        }
+
+        void deallocate_heap() noexcept
+        {
+            if (!is_inline())
+            {
+                alloc_traits::deallocate(allocator(), first, cap);
+            }
+        }
+
+        /* Move 'n' elements from 'from' to uninitialized 'to' and end the
+           lifetime of the originals. */
+        void relocate(T* from, size_type n, T* to)
+        {
+            if (relocatable)
+            {
+                if (n != 0)
+                {
+                    std::memcpy(static_cast<void*>(to), static_cast<const void*>(from), n * sizeof(T));
+                }
+                return;
+            }
+            size_type done = 0;
+            try
+            {
+                for (; done < n; ++done)
+                {
+                    construct(to + done, std::move_if_noexcept(from[done]));
+                }
+            }
+            catch (...)
+            {
+                destroy_range(to, to + done);
+                throw;
+            }
+            destroy_range(from, from + n);
+        }
+
+        size_type grown_capacity(size_type needed) const
+        {
+            if (needed > max_size())
+            {
+                throw std::length_error("cppp::small_vector");
+            }
+            size_type doubled = cap > max_size() / 2 ? max_size() : cap * 2;
+            return std::max(std::max(doubled, needed), size_type(N > 0 ? N : 1));
+        }
+
+        void reallocate(size_type new_cap)
+        {
+            T* memory = alloc_traits::allocate(allocator(), new_cap);
+            try
+            {
+                relocate(first, count, memory);
+            }
+            catch (...)
+            {
+                alloc_traits::deallocate(allocator(), memory, new_cap);
+                throw;
+            }
+            deallocate_heap();
+            first = memory;
+            cap = new_cap;
+        }
+
+        void reserve_for(size_type extra)
+        {
+            if (extra > cap - count)
+            {
+                reallocate(grown_capacity(count + extra));
+            }
+        }
+
+        /* Grow and construct a new element at 'index' in one pass,
+           so the old elements are only moved once. */
+        template<typename... Args>
+        CPPP_NOINLINE void grow_with_gap(size_type index, Args&&... args)
+        {
+            size_type new_cap = grown_capacity(count + 1);
+            T* memory = alloc_traits::allocate(allocator(), new_cap);
+            try
+            {
+                construct(memory + index, std::forward<Args>(args)...);
+            }
+            catch (...)
+            {
+                alloc_traits::deallocate(allocator(), memory, new_cap);
+                throw;
+            }
+            try
+            {
+                relocate(first, index, memory);
+                try
+                {
+                    relocate(first + index, count - index, memory + index + 1);
+                }
+                catch (...)
+                {
+                    /* Put the prefix back where it came from. */
+                    relocate(memory, index, first);
+                    throw;
+                }
+            }
+            catch (...)
+            {
+                destroy(memory + index);
+                alloc_traits::deallocate(allocator(), memory, new_cap);
+                throw;
+            }
+            deallocate_heap();
+            first = memory;
+            cap = new_cap;
+            ++count;
+        }
+
+        void append_fill(size_type n, const T& value)
+        {
+            reserve_for(n);
+            for (size_type i = 0; i < n; ++i)
+            {
+                construct(first + count, value);
+                ++count;
+            }
+        }
+
+        template<typename InputIt>
+        void insert_range(InputIt from, InputIt to, std::input_iterator_tag)
+        {
+            for (; from != to; ++from)
+            {
+                emplace_back(*from);
+            }
+        }
+
+        template<typename ForwardIt>
+        void insert_range(ForwardIt from, ForwardIt to, std::forward_iterator_tag)
+        {
+            reserve_for(static_cast<size_type>(std::distance(from, to)));
+            for (; from != to; ++from)
+            {
+                construct(first + count, *from);
+                ++count;
+            }
+        }
+
+        /* Move the inline elements back inline, 'count' must fit. */
+        void shrink_to_inline()
+        {
+            if (is_inline())
+            {
+                return;
+            }
+            T* heap = first;
+            size_type heap_cap = cap;
+            relocate(heap, count, inline_data());
+            alloc_traits::deallocate(allocator(), heap, heap_cap);
+            first = inline_data();
+            cap = N;
+        }
+
+        /* Take the elements of 'other', which must share our allocator.
+           We must be empty and inline. */
+        void take(small_vector& other)
+        {
+            if (other.is_inline())
+            {
+                relocate(other.first, other.count, first);
+                count = other.count;
+                other.count = 0;
+            }
+            else
+            {
+                first = other.first;
+                count = other.count;
+                cap = other.cap;
+                other.first = other.inline_data();
+                other.count = 0;
+                other.cap = N;
+            }
+        }
+
+        void copy_allocator(const small_vector& other, std::true_type)
+        {
+            allocator() = other.allocator();
+        }
+
+        void copy_allocator(const small_vector&, std::false_type)
+        {
+        }
+
+        void move_allocator(small_vector& other, std::true_type)
+        {
+            allocator() = std::move(other.allocator());
+        }
+
+        void move_allocator(small_vector&, std::false_type)
+        {
+        }
+
+        void swap_allocator(small_vector& other, std::true_type)
+        {
+            using std::swap;
+            swap(allocator(), other.allocator());
+        }
+
+        void swap_allocator(small_vector&, std::false_type)
+        {
+        }
+    };
+
+    template<typename T, size_t N, typename A>
+    bool operator==(const small_vector<T, N, A>& lhs, const small_vector<T, N, A>& rhs)
+    {
+        return lhs.size() == rhs.size() && std::equal(lhs.begin(), lhs.end(), rhs.begin());
+    }
+
+    template<typename T, size_t N, typename A>
+    bool operator!=(const small_vector<T, N, A>& lhs, const small_vector<T, N, A>& rhs)
+    {
+        return !(lhs == rhs);
+    }
+
+    template<typename T, size_t N, typename A>
+    bool operator<(const small_vector<T, N, A>& lhs, const small_vector<T, N, A>& rhs)
+    {
+        return std::lexicographical_compare(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+    }
+
+    template<typename T, size_t N, typename A>
+    bool operator>(const small_vector<T, N, A>& lhs, const small_vector<T, N, A>& rhs)
+    {
+        return rhs < lhs;
+    }
+
+    template<typename T, size_t N, typename A>
+    bool operator<=(const small_vector<T, N, A>& lhs, const small_vector<T, N, A>& rhs)
+    {
+        return !(rhs < lhs);
+    }
+
+    template<typename T, size_t N, typename A>
+    bool operator>=(const small_vector<T, N, A>& lhs, const small_vector<T, N, A>& rhs)
+    {
+        return !(lhs < rhs);
+    }
+
+    template<typename T, size_t N, typename A>
+    void swap(small_vector<T, N, A>& lhs, small_vector<T, N, A>& rhs) noexcept(noexcept(lhs.swap(rhs)))
+    {
+        lhs.swap(rhs);
+    }
+} // namespace cppp
+
+#endif
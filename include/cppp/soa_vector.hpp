@@ -0,0 +1,1250 @@
+/* Copyright (C) 1999-2023 Free Software Foundation, Inc.
+   This file is part of the cppp-base library.
+
+   The cppp-base library is free software; you can redistribute it
+   and/or modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either version 3
+   of the License, or (at your option) any later version.
+
+   The cppp-base library is distributed in the hope that it will be
+   useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the cppp-base library; see the file COPYING.
+   If not, see <https://www.gnu.org/licenses/>.  */
+
+/* We do not use '#pragma once' because it may has bugs in some compiler. */
+#ifndef _CPPP_SOA_VECTOR_HPP
+#define _CPPP_SOA_VECTOR_HPP
+
+/* C++ Plus struct-of-arrays vector */
+
+#include "basedef.hpp"
+#include "hardware.hpp"
+#include "type_traits.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <new>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#if CPPP_CPLUSPLUS >= 202002L && defined(__has_include)
+#if __has_include(<span>)
+#include <span>
+#endif
+#endif
+
+namespace cppp
+{
+    /* A contiguous column of a 'soa_vector'. */
+    template<typename T>
+    class column_span
+    {
+    private:
+        T* first = nullptr;
+        size_t count = 0;
+
+    public:
+        using element_type = T;
+        using value_type = typename std::remove_cv<T>::type;
+        using size_type = size_t;
+        using iterator = T*;
+
+        column_span() noexcept = default;
+
+        column_span(T* data, size_t size) noexcept : first(data), count(size)
+        {
+        }
+
+        template<typename U, typename = typename std::enable_if<std::is_convertible<U*, T*>::value>::type>
+        column_span(const column_span<U>& other) noexcept : first(other.data()), count(other.size())
+        {
+        }
+
+        T* data() const noexcept
+        {
+            return first;
+        }
+
+        size_type size() const noexcept
+        {
+            return count;
+        }
+
+        bool empty() const noexcept
+        {
+            return count == 0;
+        }
+
+        T* begin() const noexcept
+        {
+            return first;
+        }
+
+        T* end() const noexcept
+        {
+            return first + count;
+        }
+
+        T& operator[](size_t i) const noexcept
+        {
+            return first[i];
+        }
+
+#if defined(__cpp_lib_span)
+        operator std::span<T>() const noexcept
+        {
+            return std::span<T>(first, count);
+        }
+#endif
+    };
+
+    namespace detail
+    {
+        namespace soa
+        {
+            template<size_t... Is>
+            struct index_sequence
+            {
+            };
+
+            template<size_t N, size_t... Is>
+            struct make_index_sequence : make_index_sequence<N - 1, N - 1, Is...>
+            {
+            };
+
+            template<size_t... Is>
+            struct make_index_sequence<0, Is...> : index_sequence<Is...>
+            {
+            };
+
+            template<size_t I>
+            using index = std::integral_constant<size_t, I>;
+
+            template<size_t... Vs>
+            struct sum : std::integral_constant<size_t, 0>
+            {
+            };
+
+            template<size_t V, size_t... Vs>
+            struct sum<V, Vs...> : std::integral_constant<size_t, V + sum<Vs...>::value>
+            {
+            };
+
+            template<size_t... Vs>
+            struct max : std::integral_constant<size_t, 1>
+            {
+            };
+
+            template<size_t V, size_t... Vs>
+            struct max<V, Vs...> : std::integral_constant<size_t, (V > max<Vs...>::value ? V : max<Vs...>::value)>
+            {
+            };
+
+            /* Column arrays start on their own cache line, so vector loads
+               over a column are aligned and columns never share a line. */
+            template<typename T>
+            struct column_align : std::integral_constant<size_t, (alignof(T) > cache_line_size ? alignof(T)
+                                                                                                : cache_line_size)>
+            {
+            };
+
+            template<typename T>
+            CPPP_FORCE_INLINE T* assume_aligned(T* p) noexcept
+            {
+#if defined(CPPP_COMPILER_GNU_LIKE)
+                return static_cast<T*>(__builtin_assume_aligned(p, column_align<T>::value));
+#else
+                return p;
+#endif
+            }
+
+            /* A row of a 'soa_vector': the column pointers and an index. */
+            template<bool Const, typename... Ts>
+            class row
+            {
+            private:
+                template<bool, typename...>
+                friend class row;
+
+                const std::tuple<Ts*...>* columns = nullptr;
+                size_t index = 0;
+
+                template<size_t I>
+                using field_type = typename std::tuple_element<I, std::tuple<Ts...>>::type;
+
+                template<size_t... Is>
+                std::tuple<Ts...> load(index_sequence<Is...>) const
+                {
+                    return std::tuple<Ts...>(get<Is>()...);
+                }
+
+                template<typename Tuple, size_t... Is>
+                void store(Tuple&& values, index_sequence<Is...>) const
+                {
+                    int expand[] = {0, (static_cast<void>(get<Is>() = std::get<Is>(std::forward<Tuple>(values))), 0)...};
+                    static_cast<void>(expand);
+                }
+
+            public:
+                row(const std::tuple<Ts*...>* c, size_t i) noexcept : columns(c), index(i)
+                {
+                }
+
+                template<bool C = Const, typename = typename std::enable_if<C>::type>
+                row(const row<false, Ts...>& other) noexcept : columns(other.columns), index(other.index)
+                {
+                }
+
+                row(const row&) noexcept = default;
+
+                /* Assigns the fields, not the reference. */
+                const row& operator=(const row& other) const
+                {
+                    store(other.tuple(), make_index_sequence<sizeof...(Ts)>());
+                    return *this;
+                }
+
+                template<bool C, bool Mutable = !Const, typename = typename std::enable_if<Mutable>::type>
+                const row& operator=(const row<C, Ts...>& other) const
+                {
+                    store(other.tuple(), make_index_sequence<sizeof...(Ts)>());
+                    return *this;
+                }
+
+                template<bool C = Const, typename = typename std::enable_if<!C>::type>
+                const row& operator=(const std::tuple<Ts...>& values) const
+                {
+                    store(values, make_index_sequence<sizeof...(Ts)>());
+                    return *this;
+                }
+
+                template<bool C = Const, typename = typename std::enable_if<!C>::type>
+                const row& operator=(std::tuple<Ts...>&& values) const
+                {
+                    store(std::move(values), make_index_sequence<sizeof...(Ts)>());
+                    return *this;
+                }
+
+                template<size_t I>
+                typename std::conditional<Const, const field_type<I>&, field_type<I>&>::type get() const noexcept
+                {
+                    return std::get<I>(*columns)[index];
+                }
+
+                /* Copies the fields. */
+                std::tuple<Ts...> tuple() const
+                {
+                    return load(make_index_sequence<sizeof...(Ts)>());
+                }
+
+                operator std::tuple<Ts...>() const
+                {
+                    return tuple();
+                }
+            };
+
+            template<size_t I, bool Const, typename... Ts>
+            auto get(const row<Const, Ts...>& r) noexcept -> decltype(r.template get<I>())
+            {
+                return r.template get<I>();
+            }
+        } // namespace soa
+    } // namespace detail
+
+    /* A sequence of rows of 'Ts...' stored as one array per field, all in a
+       single allocation with each array on its own cache line.  Loops that
+       read two fields of a wide row load only those two arrays, and a
+       column is a plain aligned array the compiler can vectorize over.
+
+       Rows are accessed through proxies: 'v[i].get<1>()' is a reference to
+       field 1 of row i, and rows work with structured bindings.  Hot loops
+       should take 'column<I>()' once and index it.  Fields that are
+       'is_trivially_relocatable' are moved with 'memcpy' when the storage
+       grows.  Iterators and column spans are invalidated like those of
+       'std::vector'. */
+    template<typename... Ts>
+    class soa_vector
+    {
+        static_assert(sizeof...(Ts) > 0, "soa_vector needs at least one field");
+
+    public:
+        static constexpr size_t column_count = sizeof...(Ts);
+
+        template<size_t I>
+        using column_type = typename std::tuple_element<I, std::tuple<Ts...>>::type;
+
+        using value_type = std::tuple<Ts...>;
+        using size_type = size_t;
+        using difference_type = std::ptrdiff_t;
+        using reference = detail::soa::row<false, Ts...>;
+        using const_reference = detail::soa::row<true, Ts...>;
+
+        template<bool Const>
+        class basic_iterator
+        {
+        private:
+            friend class soa_vector;
+
+            const std::tuple<Ts*...>* columns = nullptr;
+            size_t index = 0;
+
+            basic_iterator(const std::tuple<Ts*...>* c, size_t i) noexcept : columns(c), index(i)
+            {
+            }
+
+        public:
+            using iterator_category = std::random_access_iterator_tag;
+            using value_type = typename soa_vector::value_type;
+            using difference_type = std::ptrdiff_t;
+            using reference = typename std::conditional<Const, const_reference, typename soa_vector::reference>::type;
+            using pointer = void;
+
+            basic_iterator() noexcept = default;
+
+            template<bool C = Const, typename = typename std::enable_if<C>::type>
+            basic_iterator(const basic_iterator<false>& other) noexcept : columns(other.columns), index(other.index)
+            {
+            }
+
+            reference operator*() const noexcept
+            {
+                return reference(columns, index);
+            }
+
+            reference operator[](difference_type n) const noexcept
+            {
+                return reference(columns, index + static_cast<size_t>(n));
+            }
+
+            basic_iterator& operator++() noexcept
+            {
+                ++index;
+                return *this;
+            }
+
+            basic_iterator operator++(int) noexcept
+            {
+                basic_iterator old = *this;
+                ++index;
+                return old;
+            }
+
+            basic_iterator& operator--() noexcept
+            {
+                --index;
+                return *this;
+            }
+
+            basic_iterator operator--(int) noexcept
+            {
+                basic_iterator old = *this;
+                --index;
+                return old;
+            }
+
+            basic_iterator& operator+=(difference_type n) noexcept
+            {
+                index += static_cast<size_t>(n);
+                return *this;
+            }
+
+            basic_iterator& operator-=(difference_type n) noexcept
+            {
+                index -= static_cast<size_t>(n);
+                return *this;
+            }
+
+            friend basic_iterator operator+(basic_iterator it, difference_type n) noexcept
+            {
+                return it += n;
+            }
+
+            friend basic_iterator operator+(difference_type n, basic_iterator it) noexcept
+            {
+                return it += n;
+            }
+
+            friend basic_iterator operator-(basic_iterator it, difference_type n) noexcept
+            {
+                return it -= n;
+            }
+
+            friend difference_type operator-(const basic_iterator& a, const basic_iterator& b) noexcept
+            {
+                return static_cast<difference_type>(a.index - b.index);
+            }
+
+            friend bool operator==(const basic_iterator& a, const basic_iterator& b) noexcept
+            {
+                return a.index == b.index;
+            }
+
+            friend bool operator!=(const basic_iterator& a, const basic_iterator& b) noexcept
+            {
+                return a.index != b.index;
+            }
+
+            friend bool operator<(const basic_iterator& a, const basic_iterator& b) noexcept
+            {
+                return a.index < b.index;
+            }
+
+            friend bool operator>(const basic_iterator& a, const basic_iterator& b) noexcept
+            {
+                return a.index > b.index;
+            }
+
+            friend bool operator<=(const basic_iterator& a, const basic_iterator& b) noexcept
+            {
+                return a.index <= b.index;
+            }
+
+            friend bool operator>=(const basic_iterator& a, const basic_iterator& b) noexcept
+            {
+                return a.index >= b.index;
+            }
+
+            template<bool>
+            friend class basic_iterator;
+        };
+
+        using iterator = basic_iterator<false>;
+        using const_iterator = basic_iterator<true>;
+        using reverse_iterator = std::reverse_iterator<iterator>;
+        using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+    private:
+        using columns_type = std::tuple<Ts*...>;
+        using all_columns = detail::soa::make_index_sequence<column_count>;
+        using end_column = detail::soa::index<column_count>;
+
+        template<size_t I>
+        using index = detail::soa::index<I>;
+
+        columns_type columns;
+        /* The allocation, 'columns' start at aligned offsets into it. */
+        void* block = nullptr;
+        size_type count = 0;
+        size_type cap = 0;
+
+    public:
+        soa_vector() noexcept : columns()
+        {
+        }
+
+        /* 'n' value-initialized rows. */
+        explicit soa_vector(size_type n) : soa_vector()
+        {
+            resize(n);
+        }
+
+        soa_vector(std::initializer_list<value_type> rows) : soa_vector()
+        {
+            reserve(rows.size());
+            for (const value_type& r : rows)
+            {
+                push_back(r);
+            }
+        }
+
+        soa_vector(const soa_vector& other) : soa_vector()
+        {
+            if (other.count == 0)
+            {
+                return;
+            }
+            storage memory = allocate(other.count);
+            try
+            {
+                copy_op op{other.columns, memory.columns, other.count};
+                for_each_column(op, index<0>());
+            }
+            catch (...)
+            {
+                deallocate(memory);
+                throw;
+            }
+            adopt(memory, other.count);
+            count = other.count;
+        }
+
+        soa_vector(soa_vector&& other) noexcept
+            : columns(other.columns), block(other.block), count(other.count), cap(other.cap)
+        {
+            other.columns = columns_type();
+            other.block = nullptr;
+            other.count = 0;
+            other.cap = 0;
+        }
+
+        ~soa_vector()
+        {
+            destroy_rows(0, count);
+            release();
+        }
+
+        soa_vector& operator=(const soa_vector& other)
+        {
+            if (this != &other)
+            {
+                soa_vector copy(other);
+                swap(copy);
+            }
+            return *this;
+        }
+
+        soa_vector& operator=(soa_vector&& other) noexcept
+        {
+            soa_vector moved(std::move(other));
+            swap(moved);
+            return *this;
+        }
+
+        /* Columns */
+
+        /* Field 'I' of every row, an array aligned to at least a cache
+           line. */
+        template<size_t I>
+        column_span<column_type<I>> column() noexcept
+        {
+            return column_span<column_type<I>>(data<I>(), count);
+        }
+
+        template<size_t I>
+        column_span<const column_type<I>> column() const noexcept
+        {
+            return column_span<const column_type<I>>(data<I>(), count);
+        }
+
+        template<size_t I>
+        column_type<I>* data() noexcept
+        {
+            return detail::soa::assume_aligned(std::get<I>(columns));
+        }
+
+        template<size_t I>
+        const column_type<I>* data() const noexcept
+        {
+            return detail::soa::assume_aligned(static_cast<const column_type<I>*>(std::get<I>(columns)));
+        }
+
+        /* Element access */
+
+        reference operator[](size_type i) noexcept
+        {
+            return reference(&columns, i);
+        }
+
+        const_reference operator[](size_type i) const noexcept
+        {
+            return const_reference(&columns, i);
+        }
+
+        reference at(size_type i)
+        {
+            if (i >= count)
+            {
+                throw std::out_of_range("cppp::soa_vector::at");
+            }
+            return (*this)[i];
+        }
+
+        const_reference at(size_type i) const
+        {
+            if (i >= count)
+            {
+                throw std::out_of_range("cppp::soa_vector::at");
+            }
+            return (*this)[i];
+        }
+
+        reference front() noexcept
+        {
+            return (*this)[0];
+        }
+
+        const_reference front() const noexcept
+        {
+            return (*this)[0];
+        }
+
+        reference back() noexcept
+        {
+            return (*this)[count - 1];
+        }
+
+        const_reference back() const noexcept
+        {
+            return (*this)[count - 1];
+        }
+
+        /* Iterators */
+
+        iterator begin() noexcept
+        {
+            return iterator(&columns, 0);
+        }
+
+        const_iterator begin() const noexcept
+        {
+            return const_iterator(&columns, 0);
+        }
+
+        const_iterator cbegin() const noexcept
+        {
+            return begin();
+        }
+
+        iterator end() noexcept
+        {
+            return iterator(&columns, count);
+        }
+
+        const_iterator end() const noexcept
+        {
+            return const_iterator(&columns, count);
+        }
+
+        const_iterator cend() const noexcept
+        {
+            return end();
+        }
+
+        reverse_iterator rbegin() noexcept
+        {
+            return reverse_iterator(end());
+        }
+
+        const_reverse_iterator rbegin() const noexcept
+        {
+            return const_reverse_iterator(end());
+        }
+
+        reverse_iterator rend() noexcept
+        {
+            return reverse_iterator(begin());
+        }
+
+        const_reverse_iterator rend() const noexcept
+        {
+            return const_reverse_iterator(begin());
+        }
+
+        /* Capacity */
+
+        bool empty() const noexcept
+        {
+            return count == 0;
+        }
+
+        size_type size() const noexcept
+        {
+            return count;
+        }
+
+        size_type capacity() const noexcept
+        {
+            return cap;
+        }
+
+        size_type max_size() const noexcept
+        {
+            return ((std::numeric_limits<size_t>::max)() / 2 - column_count * max_align) / row_size;
+        }
+
+        void reserve(size_type n)
+        {
+            if (n > cap)
+            {
+                if (n > max_size())
+                {
+                    throw std::length_error("cppp::soa_vector");
+                }
+                reallocate(n);
+            }
+        }
+
+        void shrink_to_fit()
+        {
+            if (count == 0)
+            {
+                release();
+            }
+            else if (count < cap)
+            {
+                reallocate(count);
+            }
+        }
+
+        /* Modifiers */
+
+        /* One argument per field, each field is constructed from its
+           argument. */
+        template<typename... Args>
+        reference emplace_back(Args&&... args)
+        {
+            static_assert(sizeof...(Args) == column_count, "soa_vector::emplace_back takes one argument per field");
+            if (count == cap)
+            {
+                grow_and_emplace(std::forward<Args>(args)...);
+            }
+            else
+            {
+                construct_op<Args...> op{columns, count, std::forward_as_tuple(std::forward<Args>(args)...)};
+                for_each_column(op, index<0>());
+                ++count;
+            }
+            return back();
+        }
+
+        void push_back(const value_type& row)
+        {
+            push_tuple(row, all_columns());
+        }
+
+        void push_back(value_type&& row)
+        {
+            push_tuple(std::move(row), all_columns());
+        }
+
+        void pop_back() noexcept
+        {
+            destroy_rows(count - 1, count);
+            --count;
+        }
+
+        iterator erase(const_iterator pos)
+        {
+            return erase(pos, pos + 1);
+        }
+
+        /* Shifts the rows after the range down, column by column. */
+        iterator erase(const_iterator from, const_iterator to)
+        {
+            size_t first = from.index;
+            size_t last = to.index;
+            if (first != last)
+            {
+                shift_down(first, last, all_columns());
+                destroy_rows(count - (last - first), count);
+                count -= last - first;
+            }
+            return iterator(&columns, first);
+        }
+
+        /* Rows past 'n' are destroyed, new rows are value-initialized. */
+        void resize(size_type n)
+        {
+            if (n <= count)
+            {
+                destroy_rows(n, count);
+                count = n;
+                return;
+            }
+            reserve(n);
+            value_fill_op op{columns, count, n};
+            for_each_column(op, index<0>());
+            count = n;
+        }
+
+        /* New rows are copies of 'values', one per field. */
+        void resize(size_type n, const Ts&... values)
+        {
+            if (n <= count)
+            {
+                destroy_rows(n, count);
+                count = n;
+                return;
+            }
+            /* Copied first, 'values' may be fields of this vector. */
+            value_type row(values...);
+            reserve(n);
+            copy_fill_op op{columns, count, n, row};
+            for_each_column(op, index<0>());
+            count = n;
+        }
+
+        void clear() noexcept
+        {
+            destroy_rows(0, count);
+            count = 0;
+        }
+
+        void swap(soa_vector& other) noexcept
+        {
+            using std::swap;
+            swap(columns, other.columns);
+            swap(block, other.block);
+            swap(count, other.count);
+            swap(cap, other.cap);
+        }
+
+        friend bool operator==(const soa_vector& a, const soa_vector& b)
+        {
+            return a.count == b.count && a.equal_columns(b, all_columns());
+        }
+
+        friend bool operator!=(const soa_vector& a, const soa_vector& b)
+        {
+            return !(a == b);
+        }
+
+    private:
+        static constexpr size_t row_size = detail::soa::sum<sizeof(Ts)...>::value;
+        static constexpr size_t max_align = detail::soa::max<detail::soa::column_align<Ts>::value...>::value;
+
+        struct storage
+        {
+            columns_type columns;
+            void* block;
+        };
+
+        /* Byte offsets of the columns for 'n' rows, returns the size. */
+        static size_t layout(size_t n, size_t* offsets) noexcept
+        {
+            const size_t sizes[] = {sizeof(Ts)...};
+            const size_t aligns[] = {detail::soa::column_align<Ts>::value...};
+            size_t offset = 0;
+            for (size_t i = 0; i < column_count; ++i)
+            {
+                offset = (offset + aligns[i] - 1) / aligns[i] * aligns[i];
+                offsets[i] = offset;
+                offset += n * sizes[i];
+            }
+            return offset;
+        }
+
+        template<size_t... Is>
+        static columns_type make_columns(unsigned char* base, const size_t* offsets, detail::soa::index_sequence<Is...>)
+        {
+            return columns_type(reinterpret_cast<Ts*>(base + offsets[Is])...);
+        }
+
+        static storage allocate(size_t n)
+        {
+            size_t offsets[column_count];
+            size_t bytes = layout(n, offsets);
+            void* block = ::operator new(bytes + max_align);
+            std::uintptr_t base = (reinterpret_cast<std::uintptr_t>(block) + max_align - 1) / max_align * max_align;
+            return storage{make_columns(reinterpret_cast<unsigned char*>(base), offsets, all_columns()), block};
+        }
+
+        static void deallocate(const storage& memory) noexcept
+        {
+            ::operator delete(memory.block);
+        }
+
+        /* Frees the storage, the rows must be destroyed. */
+        void release() noexcept
+        {
+            ::operator delete(block);
+            columns = columns_type();
+            block = nullptr;
+            cap = 0;
+        }
+
+        void adopt(const storage& memory, size_t n) noexcept
+        {
+            release();
+            columns = memory.columns;
+            block = memory.block;
+            cap = n;
+        }
+
+        size_type grown_capacity(size_type needed) const
+        {
+            if (needed > max_size())
+            {
+                throw std::length_error("cppp::soa_vector");
+            }
+            size_type doubled = cap > max_size() / 2 ? max_size() : cap * 2;
+            return (std::max)((std::max)(doubled, needed), size_type(16));
+        }
+
+        /* Column helpers */
+
+        template<typename T>
+        static void destroy_range(T* first, T* last) noexcept
+        {
+            if (!std::is_trivially_destructible<T>::value)
+            {
+                for (; first != last; ++first)
+                {
+                    first->~T();
+                }
+            }
+        }
+
+        template<typename T>
+        static void copy_range(const T* from, size_t n, T* to)
+        {
+            if (std::is_trivially_copyable<T>::value)
+            {
+                if (n != 0)
+                {
+                    std::memcpy(static_cast<void*>(to), static_cast<const void*>(from), n * sizeof(T));
+                }
+                return;
+            }
+            size_t done = 0;
+            try
+            {
+                for (; done < n; ++done)
+                {
+                    ::new (static_cast<void*>(to + done)) T(from[done]);
+                }
+            }
+            catch (...)
+            {
+                destroy_range(to, to + done);
+                throw;
+            }
+        }
+
+        /* Moves 'n' fields to uninitialized 'to', the originals are ended
+           by 'end_moved' once every column has moved. */
+        template<typename T>
+        static void move_range(T* from, size_t n, T* to)
+        {
+            if (is_trivially_relocatable<T>::value)
+            {
+                if (n != 0)
+                {
+                    std::memcpy(static_cast<void*>(to), static_cast<const void*>(from), n * sizeof(T));
+                }
+                return;
+            }
+            size_t done = 0;
+            try
+            {
+                for (; done < n; ++done)
+                {
+                    ::new (static_cast<void*>(to + done)) T(std::move_if_noexcept(from[done]));
+                }
+            }
+            catch (...)
+            {
+                destroy_range(to, to + done);
+                throw;
+            }
+        }
+
+        template<typename T>
+        static void end_moved(T* first, T* last) noexcept
+        {
+            if (!is_trivially_relocatable<T>::value)
+            {
+                destroy_range(first, last);
+            }
+        }
+
+        /* Applies 'op' to the columns in order.  If a column throws, the
+           columns before it are undone in reverse. */
+        template<typename Op>
+        static void for_each_column(Op&, end_column)
+        {
+        }
+
+        template<typename Op, size_t I>
+        static void for_each_column(Op& op, index<I>)
+        {
+            op(index<I>());
+            try
+            {
+                for_each_column(op, index<I + 1>());
+            }
+            catch (...)
+            {
+                op.undo(index<I>());
+                throw;
+            }
+        }
+
+        struct copy_op
+        {
+            const columns_type& from;
+            const columns_type& to;
+            size_t n;
+
+            template<size_t I>
+            void operator()(index<I>) const
+            {
+                copy_range(std::get<I>(from), n, std::get<I>(to));
+            }
+
+            template<size_t I>
+            void undo(index<I>) const noexcept
+            {
+                destroy_range(std::get<I>(to), std::get<I>(to) + n);
+            }
+        };
+
+        struct move_op
+        {
+            const columns_type& from;
+            const columns_type& to;
+            size_t n;
+
+            template<size_t I>
+            void operator()(index<I>) const
+            {
+                move_range(std::get<I>(from), n, std::get<I>(to));
+            }
+
+            /* A later column threw while copying, fields moved out of
+               this one go back. */
+            template<size_t I>
+            void undo(index<I>) const noexcept
+            {
+                using T = column_type<I>;
+                T* source = std::get<I>(from);
+                T* target = std::get<I>(to);
+                if (is_trivially_relocatable<T>::value)
+                {
+                    return;
+                }
+                if (std::is_nothrow_move_constructible<T>::value)
+                {
+                    for (size_t i = 0; i < n; ++i)
+                    {
+                        source[i].~T();
+                        ::new (static_cast<void*>(source + i)) T(std::move(target[i]));
+                    }
+                }
+                destroy_range(target, target + n);
+            }
+        };
+
+        /* Constructs row 'pos' from one argument per field. */
+        template<typename... Args>
+        struct construct_op
+        {
+            const columns_type& to;
+            size_t pos;
+            std::tuple<Args&&...> args;
+
+            template<size_t I>
+            void operator()(index<I>)
+            {
+                using arg = typename std::tuple_element<I, std::tuple<Args...>>::type;
+                ::new (static_cast<void*>(std::get<I>(to) + pos)) column_type<I>(std::forward<arg>(std::get<I>(args)));
+            }
+
+            template<size_t I>
+            void undo(index<I>) const noexcept
+            {
+                std::get<I>(to)[pos].~column_type<I>();
+            }
+        };
+
+        /* Value-initializes rows '[from, to)'. */
+        struct value_fill_op
+        {
+            const columns_type& columns;
+            size_t from;
+            size_t to;
+
+            template<size_t I>
+            void operator()(index<I>) const
+            {
+                column_type<I>* column = std::get<I>(columns);
+                size_t i = from;
+                try
+                {
+                    for (; i < to; ++i)
+                    {
+                        ::new (static_cast<void*>(column + i)) column_type<I>();
+                    }
+                }
+                catch (...)
+                {
+                    destroy_range(column + from, column + i);
+                    throw;
+                }
+            }
+
+            template<size_t I>
+            void undo(index<I>) const noexcept
+            {
+                destroy_range(std::get<I>(columns) + from, std::get<I>(columns) + to);
+            }
+        };
+
+        /* Copies 'row' into rows '[from, to)'. */
+        struct copy_fill_op
+        {
+            const columns_type& columns;
+            size_t from;
+            size_t to;
+            const value_type& row;
+
+            template<size_t I>
+            void operator()(index<I>) const
+            {
+                column_type<I>* column = std::get<I>(columns);
+                size_t i = from;
+                try
+                {
+                    for (; i < to; ++i)
+                    {
+                        ::new (static_cast<void*>(column + i)) column_type<I>(std::get<I>(row));
+                    }
+                }
+                catch (...)
+                {
+                    destroy_range(column + from, column + i);
+                    throw;
+                }
+            }
+
+            template<size_t I>
+            void undo(index<I>) const noexcept
+            {
+                destroy_range(std::get<I>(columns) + from, std::get<I>(columns) + to);
+            }
+        };
+
+        template<size_t... Is>
+        static void end_moved_rows(const columns_type& c, size_t n, detail::soa::index_sequence<Is...>) noexcept
+        {
+            int expand[] = {0, (end_moved(std::get<Is>(c), std::get<Is>(c) + n), 0)...};
+            static_cast<void>(expand);
+        }
+
+        void destroy_rows(size_t from, size_t to) noexcept
+        {
+            destroy_rows(from, to, all_columns());
+        }
+
+        template<size_t... Is>
+        void destroy_rows(size_t from, size_t to, detail::soa::index_sequence<Is...>) noexcept
+        {
+            int expand[] = {0, (destroy_range(std::get<Is>(columns) + from, std::get<Is>(columns) + to), 0)...};
+            static_cast<void>(expand);
+        }
+
+        template<size_t... Is>
+        void shift_down(size_t first, size_t last, detail::soa::index_sequence<Is...>)
+        {
+            int expand[] = {0, (std::move(std::get<Is>(columns) + last, std::get<Is>(columns) + count,
+                                          std::get<Is>(columns) + first),
+                                0)...};
+            static_cast<void>(expand);
+        }
+
+        template<size_t... Is>
+        bool equal_columns(const soa_vector& other, detail::soa::index_sequence<Is...>) const
+        {
+            const bool equal[] = {true, std::equal(std::get<Is>(columns), std::get<Is>(columns) + count,
+                                                   std::get<Is>(other.columns))...};
+            return std::find(std::begin(equal), std::end(equal), false) == std::end(equal);
+        }
+
+        template<typename Tuple, size_t... Is>
+        void push_tuple(Tuple&& row, detail::soa::index_sequence<Is...>)
+        {
+            emplace_back(std::get<Is>(std::forward<Tuple>(row))...);
+        }
+
+        void reallocate(size_t new_cap)
+        {
+            storage memory = allocate(new_cap);
+            try
+            {
+                move_op op{columns, memory.columns, count};
+                for_each_column(op, index<0>());
+            }
+            catch (...)
+            {
+                deallocate(memory);
+                throw;
+            }
+            end_moved_rows(columns, count, all_columns());
+            adopt(memory, new_cap);
+        }
+
+        /* Grow and construct the new row in one pass, the arguments may
+           be fields of this vector so they are used before the old rows
+           move. */
+        template<typename... Args>
+        CPPP_NOINLINE void grow_and_emplace(Args&&... args)
+        {
+            size_t new_cap = grown_capacity(count + 1);
+            storage memory = allocate(new_cap);
+            construct_op<Args...> row{memory.columns, count, std::forward_as_tuple(std::forward<Args>(args)...)};
+            try
+            {
+                for_each_column(row, index<0>());
+            }
+            catch (...)
+            {
+                deallocate(memory);
+                throw;
+            }
+            try
+            {
+                move_op op{columns, memory.columns, count};
+                for_each_column(op, index<0>());
+            }
+            catch (...)
+            {
+                destroy_new_row(memory.columns, count, all_columns());
+                deallocate(memory);
+                throw;
+            }
+            end_moved_rows(columns, count, all_columns());
+            adopt(memory, new_cap);
+            ++count;
+        }
+
+        template<size_t... Is>
+        static void destroy_new_row(const columns_type& c, size_t pos, detail::soa::index_sequence<Is...>) noexcept
+        {
+            int expand[] = {0, (destroy_range(std::get<Is>(c) + pos, std::get<Is>(c) + pos + 1), 0)...};
+            static_cast<void>(expand);
+        }
+    };
+
+    template<typename... Ts>
+    constexpr size_t soa_vector<Ts...>::column_count;
+
+    template<typename... Ts>
+    constexpr size_t soa_vector<Ts...>::row_size;
+
+    template<typename... Ts>
+    constexpr size_t soa_vector<Ts...>::max_align;
+
+    template<typename... Ts>
+    void swap(soa_vector<Ts...>& lhs, soa_vector<Ts...>& rhs) noexcept
+    {
+        lhs.swap(rhs);
+    }
+} // namespace cppp
+
+/* Rows are tuple-like, for structured bindings. */
+namespace std
+{
+    template<bool Const, typename... Ts>
+    struct tuple_size<cppp::detail::soa::row<Const, Ts...>> : std::integral_constant<size_t, sizeof...(Ts)>
+    {
+    };
+
+    template<size_t I, bool Const, typename... Ts>
+    struct tuple_element<I, cppp::detail::soa::row<Const, Ts...>>
+    {
+        using field = typename tuple_element<I, tuple<Ts...>>::type;
+        using type = typename conditional<Const, const field&, field&>::type;
+    };
+} // namespace std
+
+#endif
@@ -0,0 +1,404 @@
+/* Copyright (C) 1999-2023 Free Software Foundation, Inc.
+   This file is part of the cppp-base library.
+
+   The cppp-base library is free software; you can redistribute it
+   and/or modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either version 3
+   of the License, or (at your option) any later version.
+
+   The cppp-base library is distributed in the hope that it will be
+   useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the cppp-base library; see the file COPYING.
+   If not, see <https://www.gnu.org/licenses/>.  */
+
+/* We do not use '#pragma once' because it may has bugs in some compiler. */
+#ifndef _CPPP_SPSC_RING_HPP
+#define _CPPP_SPSC_RING_HPP
+
+/* C++ Plus wait-free single-producer single-consumer rings
+
+   Each side owns one index and keeps a cached copy of the other side's
+   index. It reloads the remote index, which costs a cache miss, only when
+   the cached value says the ring is full (producer) or empty (consumer).
+   In steady state each side touches the other's cache line once per lap
+   instead of once per element. */
+
+#include "basedef.hpp"
+#include "bits.hpp"
+#include "hardware.hpp"
+#include "wait_strategy.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace cppp
+{
+    namespace detail
+    {
+        namespace spsc
+        {
+            /* The index written by one side and that side's cache of the
+               other side's index, together on their own cache lines. */
+            struct endpoint
+            {
+                std::atomic<size_t> index{0};
+                size_t cached_remote = 0;
+            };
+        } // namespace spsc
+    } // namespace detail
+
+    /* Ring of 'T' for exactly one producer thread and one consumer thread.
+       The capacity is rounded up to a power of two. Elements are built in
+       place by 'try_emplace', and the consumer can use them in place through
+       'front' before calling 'pop'. The blocking 'push' and 'pop_wait' wait
+       with 'WaitStrategy'. */
+    template<typename T, typename WaitStrategy = spin_wait>
+    class spsc_ring
+    {
+        static_assert(std::is_nothrow_destructible<T>::value, "spsc_ring requires a nothrow destructor");
+
+    public:
+        using value_type = T;
+        using size_type = size_t;
+        using wait_strategy = WaitStrategy;
+
+    private:
+        struct slot
+        {
+            alignas(T) unsigned char storage[sizeof(T)];
+
+            T* value() noexcept
+            {
+                return reinterpret_cast<T*>(storage);
+            }
+        };
+
+        size_t mask;
+        std::unique_ptr<slot[]> slots;
+        /* 'producer.index' counts pushes and 'consumer.index' counts pops,
+           neither wraps at the capacity. */
+        cache_aligned<detail::spsc::endpoint> producer;
+        cache_aligned<detail::spsc::endpoint> consumer;
+        cache_aligned<WaitStrategy> not_empty;
+        cache_aligned<WaitStrategy> not_full;
+
+    public:
+        explicit spsc_ring(size_t capacity)
+            : mask(normalize_capacity(capacity) - 1), slots(new slot[mask + 1])
+        {
+        }
+
+        spsc_ring(const spsc_ring&) = delete;
+        spsc_ring& operator=(const spsc_ring&) = delete;
+
+        ~spsc_ring()
+        {
+            while (front() != nullptr)
+            {
+                pop();
+            }
+        }
+
+        size_t capacity() const noexcept
+        {
+            return mask + 1;
+        }
+
+        /* Exact from either side, approximate from any other thread. */
+        size_t size_approx() const noexcept
+        {
+            return producer->index.load(std::memory_order_acquire) - consumer->index.load(std::memory_order_acquire);
+        }
+
+        bool empty_approx() const noexcept
+        {
+            return size_approx() == 0;
+        }
+
+        /* Producer side. */
+
+        bool try_push(const T& value)
+        {
+            return try_emplace(value);
+        }
+
+        bool try_push(T&& value)
+        {
+            return try_emplace(std::move(value));
+        }
+
+        /* The arguments are not touched when the ring is full. If the
+           constructor throws, the ring is left unchanged. */
+        template<typename... Args>
+        bool try_emplace(Args&&... args)
+        {
+            size_t head = producer->index.load(std::memory_order_relaxed);
+            if (CPPP_UNLIKELY(head - producer->cached_remote > mask))
+            {
+                producer->cached_remote = consumer->index.load(std::memory_order_acquire);
+                if (head - producer->cached_remote > mask)
+                {
+                    return false;
+                }
+            }
+            ::new (static_cast<void*>(slots[head & mask].value())) T(std::forward<Args>(args)...);
+            producer->index.store(head + 1, std::memory_order_release);
+            not_empty->notify_all();
+            return true;
+        }
+
+        void push(const T& value)
+        {
+            emplace(value);
+        }
+
+        void push(T&& value)
+        {
+            emplace(std::move(value));
+        }
+
+        template<typename... Args>
+        void emplace(Args&&... args)
+        {
+            while (!try_emplace(std::forward<Args>(args)...))
+            {
+                not_full->wait_until(
+                    [this]() noexcept
+                    {
+                        return producer->index.load(std::memory_order_relaxed) -
+                                   consumer->index.load(std::memory_order_acquire) <=
+                               mask;
+                    });
+            }
+        }
+
+        /* Consumer side. */
+
+        /* The oldest element, or null when the ring is empty. It stays
+           valid until 'pop'. */
+        T* front() noexcept
+        {
+            size_t tail = consumer->index.load(std::memory_order_relaxed);
+            if (CPPP_UNLIKELY(tail == consumer->cached_remote))
+            {
+                consumer->cached_remote = producer->index.load(std::memory_order_acquire);
+                if (tail == consumer->cached_remote)
+                {
+                    return nullptr;
+                }
+            }
+            return slots[tail & mask].value();
+        }
+
+        /* Destroy the oldest element. The ring must not be empty, so call
+           'front' first. */
+        void pop() noexcept
+        {
+            size_t tail = consumer->index.load(std::memory_order_relaxed);
+            slots[tail & mask].value()->~T();
+            consumer->index.store(tail + 1, std::memory_order_release);
+            not_full->notify_all();
+        }
+
+        bool try_pop(T& out) noexcept(std::is_nothrow_move_assignable<T>::value)
+        {
+            T* value = front();
+            if (value == nullptr)
+            {
+                return false;
+            }
+            out = std::move(*value);
+            pop();
+            return true;
+        }
+
+        /* Wait until an element is available and return it. Use it in
+           place, then call 'pop'. */
+        T& pop_wait()
+        {
+            T* value;
+            while ((value = front()) == nullptr)
+            {
+                not_empty->wait_until(
+                    [this]() noexcept
+                    {
+                        return producer->index.load(std::memory_order_acquire) !=
+                               consumer->index.load(std::memory_order_relaxed);
+                    });
+            }
+            return *value;
+        }
+
+    private:
+        static size_t normalize_capacity(size_t capacity)
+        {
+            if (capacity > (static_cast<size_t>(1) << (sizeof(size_t) * 8 - 2)) / sizeof(slot))
+            {
+                throw std::length_error("spsc_ring capacity is too large");
+            }
+            return capacity < 2 ? 2 : static_cast<size_t>(ceil_pow2(capacity));
+        }
+    };
+
+    /* Byte ring for one producer and one consumer, with contiguous regions.
+       The producer calls 'reserve' to get 'n' contiguous bytes, writes them
+       in place and publishes them with 'commit'. The consumer gets the
+       published bytes with 'peek' and frees them with 'release'.
+       When a reservation does not fit before the end of the buffer, the
+       producer wraps to the start and records a watermark. The consumer
+       then skips the unused bytes after the watermark (a bip buffer).
+       So a region committed in one piece is always read in one piece. */
+    class spsc_byte_ring
+    {
+    private:
+        size_t length;
+        std::unique_ptr<unsigned char[]> buffer;
+        /* Offsets in [0, length]. The ring is empty when they are equal.
+           When 'write' < 'read', the producer has wrapped and the
+           consumer's data ends at 'watermark'. */
+        cache_aligned<detail::spsc::endpoint> producer;
+        cache_aligned<detail::spsc::endpoint> consumer;
+        std::atomic<size_t> watermark{0};
+        /* Producer-only state of the last 'reserve'. */
+        bool wrap_pending = false;
+
+    public:
+        explicit spsc_byte_ring(size_t capacity)
+            : length(capacity), buffer(new unsigned char[capacity])
+        {
+        }
+
+        spsc_byte_ring(const spsc_byte_ring&) = delete;
+        spsc_byte_ring& operator=(const spsc_byte_ring&) = delete;
+
+        size_t capacity() const noexcept
+        {
+            return length;
+        }
+
+        /* Producer side. */
+
+        /* Get 'n' contiguous writable bytes, or null when they do not fit
+           right now. Nothing is visible to the consumer until 'commit'. */
+        void* reserve(size_t n) noexcept
+        {
+            size_t w = producer->index.load(std::memory_order_relaxed);
+            void* result = reserve_with(w, producer->cached_remote, n);
+            if (result == nullptr)
+            {
+                producer->cached_remote = consumer->index.load(std::memory_order_acquire);
+                result = reserve_with(w, producer->cached_remote, n);
+            }
+            return result;
+        }
+
+        /* Publish the first 'n' bytes of the last reservation. */
+        void commit(size_t n) noexcept
+        {
+            if (wrap_pending)
+            {
+                wrap_pending = false;
+                watermark.store(producer->index.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                producer->index.store(n, std::memory_order_release);
+            }
+            else
+            {
+                producer->index.store(producer->index.load(std::memory_order_relaxed) + n, std::memory_order_release);
+            }
+        }
+
+        /* Copy 'n' bytes in one contiguous region, false when they do not
+           fit. */
+        bool try_write(const void* data, size_t n) noexcept
+        {
+            void* target = reserve(n);
+            if (target == nullptr)
+            {
+                return false;
+            }
+            if (n != 0)
+            {
+                std::memcpy(target, data, n);
+            }
+            commit(n);
+            return true;
+        }
+
+        /* Consumer side. */
+
+        /* Get the published bytes that can be read contiguously and store
+           their count in 'available'. Returns null when there are none. */
+        const unsigned char* peek(size_t& available) noexcept
+        {
+            size_t r = consumer->index.load(std::memory_order_relaxed);
+            size_t w = consumer->cached_remote;
+            if (w == r)
+            {
+                w = consumer->cached_remote = producer->index.load(std::memory_order_acquire);
+            }
+            if (w < r)
+            {
+                /* The producer wrapped and the 'acquire' load above is
+                   ordered after its watermark store. */
+                size_t end = watermark.load(std::memory_order_relaxed);
+                if (r == end)
+                {
+                    r = 0;
+                    consumer->index.store(0, std::memory_order_release);
+                }
+                else
+                {
+                    available = end - r;
+                    return buffer.get() + r;
+                }
+            }
+            available = w - r;
+            return available == 0 ? nullptr : buffer.get() + r;
+        }
+
+        /* Free the first 'n' bytes returned by the last 'peek'. */
+        void release(size_t n) noexcept
+        {
+            consumer->index.store(consumer->index.load(std::memory_order_relaxed) + n, std::memory_order_release);
+        }
+
+    private:
+        void* reserve_with(size_t w, size_t r, size_t n) noexcept
+        {
+            if (w >= r)
+            {
+                /* Free: [w, length) and [0, r - 1). 'write' may reach
+                   'length', but after a wrap it must stay below 'read',
+                   otherwise the ring would look empty. */
+                if (length - w >= n)
+                {
+                    wrap_pending = false;
+                    return buffer.get() + w;
+                }
+                if (n < r)
+                {
+                    wrap_pending = true;
+                    return buffer.get();
+                }
+            }
+            else if (r - w > n)
+            {
+                wrap_pending = false;
+                return buffer.get() + w;
+            }
+            return nullptr;
+        }
+    };
+} // namespace cppp
+
+#endif
@@ -0,0 +1,1022 @@
+/* Copyright (C) 1999-2023 Free Software Foundation, Inc.
+   This file is part of the cppp-base library.
+
+   The cppp-base library is free software; you can redistribute it
+   and/or modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either version 3
+   of the License, or (at your option) any later version.
+
+   The cppp-base library is distributed in the hope that it will be
+   useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the cppp-base library; see the file COPYING.
+   If not, see <https://www.gnu.org/licenses/>.  */
+
+/* We do not use '#pragma once' because it may has bugs in some compiler. */
+#ifndef _CPPP_STRING_HPP
+#define _CPPP_STRING_HPP
+
+/* C++ Plus small-string-optimized string */
+
+#include "basedef.hpp"
+#include "hash.hpp"
+#include "string_search.hpp"
+#include "type_traits.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <initializer_list>
+#include <iterator>
+#include <new>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#if CPPP_CPLUSPLUS >= 201703L
+#include <string_view>
+#endif
+
+namespace cppp
+{
+    /* A byte string with the interface of 'std::string' that keeps up to
+       23 characters inside its 24 bytes (11 in 12 bytes on 32-bit
+       targets). libstdc++ is 32 bytes with 15 inline.
+
+       The last byte of the object tells the two modes apart. Inline, it
+       holds '23 - size()', so a full inline string ends in its own null
+       terminator. On the heap it is the top byte of the capacity word,
+       with the high bit set.
+
+       The object holds no pointer to itself, so it is trivially
+       relocatable. Iterators are plain pointers. */
+    class string
+    {
+    public:
+        using value_type = char;
+        using traits_type = std::char_traits<char>;
+        using size_type = size_t;
+        using difference_type = std::ptrdiff_t;
+        using reference = char&;
+        using const_reference = const char&;
+        using pointer = char*;
+        using const_pointer = const char*;
+        using iterator = char*;
+        using const_iterator = const char*;
+        using reverse_iterator = std::reverse_iterator<iterator>;
+        using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+        static constexpr size_type npos = size_type(-1);
+
+    private:
+        struct heap_rep
+        {
+            char* data;
+            size_type size;
+            size_type capacity;
+        };
+
+    public:
+        static constexpr size_type inline_capacity = sizeof(heap_rep) - 1;
+
+    private:
+        union rep
+        {
+            heap_rep heap;
+            char small[sizeof(heap_rep)];
+        };
+
+        static constexpr unsigned char heap_marker = 0x80;
+
+        rep r;
+
+    public:
+        string() noexcept
+        {
+            set_inline_size(0);
+        }
+
+        string(const char* s, size_type count)
+        {
+            init(s, count);
+        }
+
+        string(const char* s) : string(s, traits_type::length(s))
+        {
+        }
+
+        string(size_type count, char c)
+        {
+            init(nullptr, count);
+            std::memset(data(), c, count);
+        }
+
+        /* Delegating makes the object complete before the loop, so the
+           destructor frees the buffer if an append or the iterator
+           throws. */
+        template<typename InputIt, typename = typename std::enable_if<!std::is_integral<InputIt>::value>::type>
+        string(InputIt first, InputIt last) : string()
+        {
+            for (; first != last; ++first)
+            {
+                push_back(*first);
+            }
+        }
+
+        string(std::initializer_list<char> chars) : string(chars.begin(), chars.size())
+        {
+        }
+
+        string(const std::string& s) : string(s.data(), s.size())
+        {
+        }
+
+#if CPPP_CPLUSPLUS >= 201703L
+        explicit string(std::string_view s) : string(s.data(), s.size())
+        {
+        }
+#endif
+
+        string(const string& other)
+        {
+            if (other.is_inline())
+            {
+                r = other.r;
+            }
+            else
+            {
+                init(other.r.heap.data, other.r.heap.size);
+            }
+        }
+
+        string(string&& other) noexcept : r(other.r)
+        {
+            other.set_inline_size(0);
+        }
+
+        ~string()
+        {
+            release();
+        }
+
+        string& operator=(const string& other)
+        {
+            if (this != &other)
+            {
+                assign(other.data(), other.size());
+            }
+            return *this;
+        }
+
+        string& operator=(string&& other) noexcept
+        {
+            if (this != &other)
+            {
+                release();
+                r = other.r;
+                other.set_inline_size(0);
+            }
+            return *this;
+        }
+
+        string& operator=(const char* s)
+        {
+            return assign(s, traits_type::length(s));
+        }
+
+        string& operator=(char c)
+        {
+            return assign(&c, 1);
+        }
+
+        string& assign(const char* s, size_type count)
+        {
+            if (count > capacity())
+            {
+                /* Fresh storage, 's' may point into the old one. */
+                string copy(s, count);
+                swap(copy);
+            }
+            else
+            {
+                char* p = data();
+                std::memmove(p, s, count);
+                set_size(count);
+            }
+            return *this;
+        }
+
+        string& assign(const char* s)
+        {
+            return assign(s, traits_type::length(s));
+        }
+
+        string& assign(size_type count, char c)
+        {
+            clear();
+            return append(count, c);
+        }
+
+        /* ---- Access ---- */
+
+        reference at(size_type pos)
+        {
+            if (pos >= size())
+            {
+                throw std::out_of_range("cppp::string::at");
+            }
+            return data()[pos];
+        }
+
+        const_reference at(size_type pos) const
+        {
+            if (pos >= size())
+            {
+                throw std::out_of_range("cppp::string::at");
+            }
+            return data()[pos];
+        }
+
+        reference operator[](size_type pos) noexcept
+        {
+            return data()[pos];
+        }
+
+        const_reference operator[](size_type pos) const noexcept
+        {
+            return data()[pos];
+        }
+
+        reference front() noexcept
+        {
+            return data()[0];
+        }
+
+        const_reference front() const noexcept
+        {
+            return data()[0];
+        }
+
+        reference back() noexcept
+        {
+            return data()[size() - 1];
+        }
+
+        const_reference back() const noexcept
+        {
+            return data()[size() - 1];
+        }
+
+        char* data() noexcept
+        {
+            return is_inline() ? r.small : r.heap.data;
+        }
+
+        const char* data() const noexcept
+        {
+            return is_inline() ? r.small : r.heap.data;
+        }
+
+        const char* c_str() const noexcept
+        {
+            return data();
+        }
+
+#if CPPP_CPLUSPLUS >= 201703L
+        operator std::string_view() const noexcept
+        {
+            return std::string_view(data(), size());
+        }
+#endif
+
+        std::string str() const
+        {
+            return std::string(data(), size());
+        }
+
+        /* ---- Iterators ---- */
+
+        iterator begin() noexcept
+        {
+            return data();
+        }
+
+        const_iterator begin() const noexcept
+        {
+            return data();
+        }
+
+        const_iterator cbegin() const noexcept
+        {
+            return data();
+        }
+
+        iterator end() noexcept
+        {
+            return data() + size();
+        }
+
+        const_iterator end() const noexcept
+        {
+            return data() + size();
+        }
+
+        const_iterator cend() const noexcept
+        {
+            return end();
+        }
+
+        reverse_iterator rbegin() noexcept
+        {
+            return reverse_iterator(end());
+        }
+
+        const_reverse_iterator rbegin() const noexcept
+        {
+            return const_reverse_iterator(end());
+        }
+
+        reverse_iterator rend() noexcept
+        {
+            return reverse_iterator(begin());
+        }
+
+        const_reverse_iterator rend() const noexcept
+        {
+            return const_reverse_iterator(begin());
+        }
+
+        /* ---- Capacity ---- */
+
+        bool empty() const noexcept
+        {
+            return size() == 0;
+        }
+
+        size_type size() const noexcept
+        {
+            return is_inline() ? inline_capacity - marker() : r.heap.size;
+        }
+
+        size_type length() const noexcept
+        {
+            return size();
+        }
+
+        /* One byte of the capacity word is the marker. */
+        size_type max_size() const noexcept
+        {
+            return (size_type(1) << (sizeof(size_type) * CHAR_BIT - 8)) - 2;
+        }
+
+        size_type capacity() const noexcept
+        {
+            return is_inline() ? inline_capacity : decode_capacity(r.heap.capacity);
+        }
+
+        bool is_inline() const noexcept
+        {
+            return marker() < heap_marker;
+        }
+
+        void reserve(size_type new_cap)
+        {
+            if (new_cap > capacity())
+            {
+                reallocate(grown_capacity(new_cap));
+            }
+        }
+
+        /* Move back inline when the characters fit. */
+        void shrink_to_fit()
+        {
+            if (is_inline())
+            {
+                return;
+            }
+            size_type count = r.heap.size;
+            if (count <= inline_capacity)
+            {
+                heap_rep heap = r.heap;
+                std::memcpy(r.small, heap.data, count);
+                set_inline_size(count);
+                deallocate(heap.data, decode_capacity(heap.capacity));
+            }
+            else if (count < decode_capacity(r.heap.capacity))
+            {
+                reallocate(count);
+            }
+        }
+
+        /* ---- Modifiers ---- */
+
+        void clear() noexcept
+        {
+            set_size(0);
+        }
+
+        void push_back(char c)
+        {
+            size_type count = size();
+            if (CPPP_UNLIKELY(count == capacity()))
+            {
+                reallocate(grown_capacity(count + 1));
+            }
+            char* p = data();
+            p[count] = c;
+            set_size(count + 1);
+        }
+
+        void pop_back() noexcept
+        {
+            set_size(size() - 1);
+        }
+
+        string& append(const char* s, size_type count)
+        {
+            size_type old_size = size();
+            if (count > capacity() - old_size)
+            {
+                if (count > max_size() - old_size)
+                {
+                    throw std::length_error("cppp::string");
+                }
+                /* 's' may point into the old storage. */
+                string grown;
+                grown.allocate(grown_capacity(old_size + count));
+                std::memcpy(grown.r.heap.data, data(), old_size);
+                std::memcpy(grown.r.heap.data + old_size, s, count);
+                grown.set_size(old_size + count);
+                swap(grown);
+                return *this;
+            }
+            char* p = data();
+            std::memmove(p + old_size, s, count);
+            set_size(old_size + count);
+            return *this;
+        }
+
+        string& append(const char* s)
+        {
+            return append(s, traits_type::length(s));
+        }
+
+        string& append(const string& s)
+        {
+            return append(s.data(), s.size());
+        }
+
+        string& append(size_type count, char c)
+        {
+            size_type old_size = size();
+            reserve_more(count);
+            char* p = data();
+            std::memset(p + old_size, c, count);
+            set_size(old_size + count);
+            return *this;
+        }
+
+        string& operator+=(const string& s)
+        {
+            return append(s.data(), s.size());
+        }
+
+        string& operator+=(const char* s)
+        {
+            return append(s, traits_type::length(s));
+        }
+
+        string& operator+=(char c)
+        {
+            push_back(c);
+            return *this;
+        }
+
+#if CPPP_CPLUSPLUS >= 201703L
+        string& append(std::string_view s)
+        {
+            return append(s.data(), s.size());
+        }
+
+        string& operator+=(std::string_view s)
+        {
+            return append(s.data(), s.size());
+        }
+#endif
+
+        string& insert(size_type pos, const char* s, size_type count)
+        {
+            size_type old_size = size();
+            check_position(pos, old_size, "cppp::string::insert");
+            if (count > capacity() - old_size)
+            {
+                string grown;
+                grown.allocate(grown_capacity(old_size + count));
+                const char* p = data();
+                std::memcpy(grown.r.heap.data, p, pos);
+                std::memcpy(grown.r.heap.data + pos, s, count);
+                std::memcpy(grown.r.heap.data + pos + count, p + pos, old_size - pos);
+                grown.set_size(old_size + count);
+                swap(grown);
+                return *this;
+            }
+            char* p = data();
+            /* Shift first, then find 's' where the shift left it. */
+            bool inside = s >= p && s <= p + old_size;
+            std::memmove(p + pos + count, p + pos, old_size - pos);
+            if (inside && s + count > p + pos)
+            {
+                if (s >= p + pos)
+                {
+                    s += count;
+                    std::memcpy(p + pos, s, count);
+                }
+                else
+                {
+                    size_type before = static_cast<size_type>(p + pos - s);
+                    std::memmove(p + pos, s, before);
+                    std::memcpy(p + pos + before, p + pos + count, count - before);
+                }
+            }
+            else
+            {
+                std::memmove(p + pos, s, count);
+            }
+            set_size(old_size + count);
+            return *this;
+        }
+
+        string& insert(size_type pos, const char* s)
+        {
+            return insert(pos, s, traits_type::length(s));
+        }
+
+        string& insert(size_type pos, const string& s)
+        {
+            return insert(pos, s.data(), s.size());
+        }
+
+        string& insert(size_type pos, size_type count, char c)
+        {
+            size_type old_size = size();
+            check_position(pos, old_size, "cppp::string::insert");
+            reserve_more(count);
+            char* p = data();
+            std::memmove(p + pos + count, p + pos, old_size - pos);
+            std::memset(p + pos, c, count);
+            set_size(old_size + count);
+            return *this;
+        }
+
+        string& erase(size_type pos = 0, size_type count = npos)
+        {
+            size_type old_size = size();
+            check_position(pos, old_size, "cppp::string::erase");
+            count = std::min(count, old_size - pos);
+            char* p = data();
+            std::memmove(p + pos, p + pos + count, old_size - pos - count);
+            set_size(old_size - count);
+            return *this;
+        }
+
+        iterator erase(const_iterator position) noexcept
+        {
+            size_type pos = static_cast<size_type>(position - begin());
+            erase(pos, 1);
+            return begin() + pos;
+        }
+
+        iterator erase(const_iterator first, const_iterator last) noexcept
+        {
+            size_type pos = static_cast<size_type>(first - begin());
+            erase(pos, static_cast<size_type>(last - first));
+            return begin() + pos;
+        }
+
+        void resize(size_type count, char c = '\0')
+        {
+            size_type old_size = size();
+            if (count > old_size)
+            {
+                append(count - old_size, c);
+            }
+            else
+            {
+                set_size(count);
+            }
+        }
+
+        void swap(string& other) noexcept
+        {
+            rep temp = r;
+            r = other.r;
+            other.r = temp;
+        }
+
+        /* ---- Operations ---- */
+
+        string substr(size_type pos = 0, size_type count = npos) const
+        {
+            size_type n = size();
+            check_position(pos, n, "cppp::string::substr");
+            return string(data() + pos, std::min(count, n - pos));
+        }
+
+        int compare(const char* s, size_type count) const noexcept
+        {
+            size_type n = size();
+            int result = traits_type::compare(data(), s, std::min(n, count));
+            return result != 0 ? result : n < count ? -1 : n > count ? 1 : 0;
+        }
+
+        int compare(const string& other) const noexcept
+        {
+            return compare(other.data(), other.size());
+        }
+
+        int compare(const char* s) const noexcept
+        {
+            return compare(s, traits_type::length(s));
+        }
+
+        bool starts_with(const char* s, size_type count) const noexcept
+        {
+            return size() >= count && traits_type::compare(data(), s, count) == 0;
+        }
+
+        bool ends_with(const char* s, size_type count) const noexcept
+        {
+            size_type n = size();
+            return n >= count && traits_type::compare(data() + n - count, s, count) == 0;
+        }
+
+        /* Searches use the SIMD kernels of 'string_search.hpp'. */
+        size_type find(const char* s, size_type pos, size_type count) const noexcept
+        {
+            size_type n = size();
+            if (pos > n)
+            {
+                return npos;
+            }
+            const char* p = data();
+            const char* found = find_substring(p + pos, p + n, s, count);
+            return found == p + n && (count != 0 || pos != n) ? npos : static_cast<size_type>(found - p);
+        }
+
+        size_type find(const char* s, size_type pos = 0) const noexcept
+        {
+            return find(s, pos, traits_type::length(s));
+        }
+
+        size_type find(const string& s, size_type pos = 0) const noexcept
+        {
+            return find(s.data(), pos, s.size());
+        }
+
+        size_type find(char c, size_type pos = 0) const noexcept
+        {
+            size_type n = size();
+            if (pos >= n)
+            {
+                return npos;
+            }
+            const char* p = data();
+            const char* found = find_byte(p + pos, p + n, c);
+            return found == p + n ? npos : static_cast<size_type>(found - p);
+        }
+
+        size_type rfind(char c, size_type pos = npos) const noexcept
+        {
+            size_type n = size();
+            if (n == 0)
+            {
+                return npos;
+            }
+            const char* p = data();
+            for (size_type i = std::min(pos, n - 1) + 1; i-- > 0;)
+            {
+                if (p[i] == c)
+                {
+                    return i;
+                }
+            }
+            return npos;
+        }
+
+        size_type find_first_of(const char* s, size_type pos, size_type count) const noexcept
+        {
+            size_type n = size();
+            if (pos >= n)
+            {
+                return npos;
+            }
+            const char* p = data();
+            const char* found = find_any_of(p + pos, p + n, byte_set(s, count));
+            return found == p + n ? npos : static_cast<size_type>(found - p);
+        }
+
+        size_type find_first_of(const char* s, size_type pos = 0) const noexcept
+        {
+            return find_first_of(s, pos, traits_type::length(s));
+        }
+
+    private:
+        unsigned char marker() const noexcept
+        {
+            return reinterpret_cast<const unsigned char*>(&r)[inline_capacity];
+        }
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        static size_type encode_capacity(size_type cap) noexcept
+        {
+            return cap << 8 | heap_marker;
+        }
+
+        static size_type decode_capacity(size_type word) noexcept
+        {
+            return word >> 8;
+        }
+#else
+        static size_type encode_capacity(size_type cap) noexcept
+        {
+            return cap | size_type(heap_marker) << (sizeof(size_type) * CHAR_BIT - 8);
+        }
+
+        static size_type decode_capacity(size_type word) noexcept
+        {
+            return word & ~(size_type(0xFF) << (sizeof(size_type) * CHAR_BIT - 8));
+        }
+#endif
+
+        void set_inline_size(size_type count) noexcept
+        {
+            CPPP_ASSUME(count <= inline_capacity);
+            r.small[count] = '\0';
+            r.small[inline_capacity] = static_cast<char>(inline_capacity - count);
+        }
+
+        void set_size(size_type count) noexcept
+        {
+            if (is_inline())
+            {
+                set_inline_size(count);
+            }
+            else
+            {
+                r.heap.size = count;
+                r.heap.data[count] = '\0';
+            }
+        }
+
+        static void deallocate(char* p, size_type cap) noexcept
+        {
+#if defined(__cpp_sized_deallocation)
+            ::operator delete(p, cap + 1);
+#else
+            static_cast<void>(cap);
+            ::operator delete(p);
+#endif
+        }
+
+        void release() noexcept
+        {
+            if (!is_inline())
+            {
+                deallocate(r.heap.data, decode_capacity(r.heap.capacity));
+            }
+        }
+
+        /* Switch an empty inline string to heap storage. */
+        void allocate(size_type cap)
+        {
+            r.heap.data = static_cast<char*>(::operator new(cap + 1));
+            r.heap.size = 0;
+            r.heap.capacity = encode_capacity(cap);
+            r.heap.data[0] = '\0';
+        }
+
+        /* Copy 'count' characters from 's', or leave them unset. */
+        void init(const char* s, size_type count)
+        {
+            if (count <= inline_capacity)
+            {
+                if (s != nullptr)
+                {
+                    std::memcpy(r.small, s, count);
+                }
+                set_inline_size(count);
+                return;
+            }
+            if (count > max_size())
+            {
+                throw std::length_error("cppp::string");
+            }
+            allocate(count);
+            if (s != nullptr)
+            {
+                std::memcpy(r.heap.data, s, count);
+            }
+            r.heap.size = count;
+            r.heap.data[count] = '\0';
+        }
+
+        size_type grown_capacity(size_type needed) const
+        {
+            if (needed > max_size())
+            {
+                throw std::length_error("cppp::string");
+            }
+            size_type cap = capacity();
+            size_type doubled = cap > max_size() / 2 ? max_size() : cap * 2;
+            return std::max(doubled, needed);
+        }
+
+        void reallocate(size_type new_cap)
+        {
+            char* memory = static_cast<char*>(::operator new(new_cap + 1));
+            size_type count;
+            if (is_inline())
+            {
+                count = inline_capacity - marker();
+                std::memcpy(memory, r.small, count + 1);
+            }
+            else
+            {
+                count = r.heap.size;
+                std::memcpy(memory, r.heap.data, count + 1);
+                deallocate(r.heap.data, decode_capacity(r.heap.capacity));
+            }
+            r.heap.data = memory;
+            r.heap.size = count;
+            r.heap.capacity = encode_capacity(new_cap);
+        }
+
+        void reserve_more(size_type count)
+        {
+            size_type old_size = size();
+            if (count > capacity() - old_size)
+            {
+                if (count > max_size() - old_size)
+                {
+                    throw std::length_error("cppp::string");
+                }
+                reallocate(grown_capacity(old_size + count));
+            }
+        }
+
+        static void check_position(size_type pos, size_type size, const char* what)
+        {
+            if (pos > size)
+            {
+                throw std::out_of_range(what);
+            }
+        }
+    };
+
+    inline string operator+(const string& a, const string& b)
+    {
+        string result;
+        result.reserve(a.size() + b.size());
+        result.append(a.data(), a.size());
+        result.append(b.data(), b.size());
+        return result;
+    }
+
+    inline string operator+(string&& a, const string& b)
+    {
+        a.append(b.data(), b.size());
+        return std::move(a);
+    }
+
+    inline string operator+(const string& a, const char* b)
+    {
+        string result(a);
+        result.append(b);
+        return result;
+    }
+
+    inline string operator+(string&& a, const char* b)
+    {
+        a.append(b);
+        return std::move(a);
+    }
+
+    inline string operator+(const string& a, char b)
+    {
+        string result(a);
+        result.push_back(b);
+        return result;
+    }
+
+    inline string operator+(string&& a, char b)
+    {
+        a.push_back(b);
+        return std::move(a);
+    }
+
+    inline bool operator==(const string& a, const string& b) noexcept
+    {
+        return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size()) == 0;
+    }
+
+    inline bool operator==(const string& a, const char* b) noexcept
+    {
+        return a.compare(b) == 0;
+    }
+
+    inline bool operator==(const char* a, const string& b) noexcept
+    {
+        return b.compare(a) == 0;
+    }
+
+    inline bool operator!=(const string& a, const string& b) noexcept
+    {
+        return !(a == b);
+    }
+
+    inline bool operator!=(const string& a, const char* b) noexcept
+    {
+        return !(a == b);
+    }
+
+    inline bool operator!=(const char* a, const string& b) noexcept
+    {
+        return !(a == b);
+    }
+
+    inline bool operator<(const string& a, const string& b) noexcept
+    {
+        return a.compare(b) < 0;
+    }
+
+    inline bool operator<=(const string& a, const string& b) noexcept
+    {
+        return a.compare(b) <= 0;
+    }
+
+    inline bool operator>(const string& a, const string& b) noexcept
+    {
+        return a.compare(b) > 0;
+    }
+
+    inline bool operator>=(const string& a, const string& b) noexcept
+    {
+        return a.compare(b) >= 0;
+    }
+
+    inline void swap(string& a, string& b) noexcept
+    {
+        a.swap(b);
+    }
+
+    inline std::ostream& operator<<(std::ostream& os, const string& s)
+    {
+        return os.write(s.data(), static_cast<std::streamsize>(s.size()));
+    }
+
+    template<>
+    struct is_trivially_relocatable<string> : std::true_type
+    {
+    };
+
+    template<>
+    struct hash<string> : detail::hashing::seeded
+    {
+        using seeded::seeded;
+        using is_transparent = void;
+
+        size_t operator()(const string& value) const noexcept
+        {
+            return static_cast<size_t>(hash_bytes(value.data(), value.size(), seed));
+        }
+
+        size_t operator()(const char* value) const noexcept
+        {
+            return static_cast<size_t>(hash_bytes(value, std::strlen(value), seed));
+        }
+
+#if CPPP_CPLUSPLUS >= 201703L
+        size_t operator()(std::string_view value) const noexcept
+        {
+            return static_cast<size_t>(hash_bytes(value.data(), value.size(), seed));
+        }
+#endif
+    };
+} // namespace cppp
+
+namespace std
+{
+    template<>
+    struct hash<cppp::string>
+    {
+        size_t operator()(const cppp::string& value) const noexcept
+        {
+            return static_cast<size_t>(cppp::hash_bytes(value.data(), value.size()));
+        }
+    };
+} // namespace std
+
+#endif
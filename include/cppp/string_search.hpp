@@ -0,0 +1,873 @@
+/* Copyright (C) 1999-2023 Free Software Foundation, Inc.
+   This file is part of the cppp-base library.
+
+   The cppp-base library is free software; you can redistribute it
+   and/or modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either version 3
+   of the License, or (at your option) any later version.
+
+   The cppp-base library is distributed in the hope that it will be
+   useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the cppp-base library; see the file COPYING.
+   If not, see <https://www.gnu.org/licenses/>.  */
+
+/* We do not use '#pragma once' because it may has bugs in some compiler. */
+#ifndef _CPPP_STRING_SEARCH_HPP
+#define _CPPP_STRING_SEARCH_HPP
+
+/* C++ Plus SIMD byte and substring search
+
+   The searches compare a whole vector of bytes at once and turn the
+   result into a bit mask, whose lowest set bit is the first match.
+   - SSE2 is the baseline on x86-64 and NEON on ARM64. AVX2 is picked at
+     runtime when the CPU has it.
+   - 'find_any_of' classifies bytes with two 16-entry nibble tables and
+     a byte shuffle (SSSE3 'pshufb', NEON 'tbl'). This matches sets
+     of any size. The set is exact when its bytes share at most eight
+     high or eight low nibbles, which covers every set of up to 8 bytes
+     and most real delimiter sets. Otherwise candidates are checked
+     against a bitmap.
+   - 'find_substring' compares the first and last needle bytes at every
+     position of a block, and only calls 'memcmp' where both match
+     (Wojciech Mula's SIMD-friendly substring search).
+
+   Ranges are '[first, last)' and a missing match returns 'last', as in
+   the standard algorithms. The case-insensitive functions fold ASCII
+   letters only. */
+
+#include "basedef.hpp"
+#include "bits.hpp"
+
+#include <cstdint>
+#include <cstring>
+
+/* The x86 kernels need either 'target' attributes or MSVC, which
+   compiles intrinsics of any ISA. Other compilers use the scalar code. */
+#if (defined(CPPP_COMPILER_GNU_LIKE) || defined(CPPP_COMPILER_MSVC)) && \
+    (defined(CPPP_ARCH_X86_64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#include <immintrin.h>
+#if defined(CPPP_COMPILER_MSVC)
+#include <intrin.h>
+#endif
+#define CPPP_SEARCH_X86 1
+#elif defined(CPPP_ARCH_ARM64) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define CPPP_SEARCH_NEON 1
+#endif
+
+/* Kernels are templates over a vector type. An ISA that is not enabled
+   for the whole program gets its own entry point with a 'target'
+   attribute. 'flatten' then inlines the kernel and the vector
+   operations into that entry point. */
+#if defined(CPPP_SEARCH_X86) && defined(CPPP_COMPILER_GNU_LIKE)
+#define CPPP_SEARCH_TARGET(isa) __attribute__((__target__(isa)))
+#define CPPP_SEARCH_ENTRY(isa) __attribute__((__target__(isa), __flatten__))
+#else
+#define CPPP_SEARCH_TARGET(isa)
+#define CPPP_SEARCH_ENTRY(isa)
+#endif
+
+/* Without optimization GCC and Clang ignore 'flatten', and the kernels
+   would pass AVX vectors to the operations in SSE registers. */
+#if defined(CPPP_SEARCH_X86) && (defined(__AVX2__) || defined(__OPTIMIZE__) || defined(CPPP_COMPILER_MSVC))
+#define CPPP_SEARCH_AVX2 1
+#endif
+
+#if defined(CPPP_COMPILER_GCC)
+/* Vector arguments of the AVX2 operations change the ABI of the kernel
+   instances, which never leave this header. */
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
+namespace cppp
+{
+    /* A set of bytes for 'find_any_of'. Building it costs a few hundred
+       instructions, keep it when the same set is searched repeatedly. */
+    class byte_set
+    {
+    private:
+        std::uint64_t bitmap[4] = {0, 0, 0, 0};
+
+    public:
+        /* Bucket masks by low and high nibble: byte 'b' is a candidate
+           when 'low_nibbles[b & 15] & high_nibbles[b >> 4]' is not
+           zero. */
+        alignas(16) unsigned char low_nibbles[16] = {};
+        alignas(16) unsigned char high_nibbles[16] = {};
+        /* Whether every candidate is a member. */
+        bool exact = true;
+
+        byte_set() noexcept = default;
+
+        byte_set(const char* bytes, size_t count) noexcept
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                unsigned char b = static_cast<unsigned char>(bytes[i]);
+                bitmap[b >> 6] |= std::uint64_t(1) << (b & 63);
+            }
+            build();
+        }
+
+        /* The bytes of a null-terminated string. */
+        explicit byte_set(const char* bytes) noexcept
+            : byte_set(bytes, std::strlen(bytes))
+        {
+        }
+
+        bool contains(unsigned char b) const noexcept
+        {
+            return ((bitmap[b >> 6] >> (b & 63)) & 1) != 0;
+        }
+
+    private:
+        /* Give every distinct high nibble a bucket, bytes 'h:l' with the
+           same 'h' then match exactly. With more than eight high nibbles
+           try the low nibbles, and failing that share buckets and let
+           the bitmap decide. */
+        void build() noexcept
+        {
+            std::uint16_t lows_of_high[16] = {};
+            std::uint16_t highs_of_low[16] = {};
+            for (unsigned b = 0; b < 256; ++b)
+            {
+                if (contains(static_cast<unsigned char>(b)))
+                {
+                    lows_of_high[b >> 4] |= static_cast<std::uint16_t>(1u << (b & 15));
+                    highs_of_low[b & 15] |= static_cast<std::uint16_t>(1u << (b >> 4));
+                }
+            }
+            unsigned used_high = 0, used_low = 0;
+            for (unsigned n = 0; n < 16; ++n)
+            {
+                used_high += lows_of_high[n] != 0 ? 1 : 0;
+                used_low += highs_of_low[n] != 0 ? 1 : 0;
+            }
+            bool by_low = used_high > 8 && used_low <= 8;
+            const std::uint16_t* groups = by_low ? highs_of_low : lows_of_high;
+            unsigned char* key = by_low ? low_nibbles : high_nibbles;
+            unsigned char* members = by_low ? high_nibbles : low_nibbles;
+            unsigned bucket = 0;
+            for (unsigned n = 0; n < 16; ++n)
+            {
+                if (groups[n] == 0)
+                {
+                    continue;
+                }
+                unsigned char bit = static_cast<unsigned char>(1u << (bucket++ & 7));
+                key[n] |= bit;
+                for (unsigned m = 0; m < 16; ++m)
+                {
+                    if ((groups[n] >> m) & 1)
+                    {
+                        members[m] |= bit;
+                    }
+                }
+            }
+            exact = bucket <= 8;
+        }
+    };
+
+    namespace detail
+    {
+        namespace search
+        {
+            /* ---- Portable fallbacks ---- */
+
+            inline unsigned char fold(unsigned char c) noexcept
+            {
+                return static_cast<unsigned char>(c - 'A') < 26 ? static_cast<unsigned char>(c | 0x20) : c;
+            }
+
+            inline const char* find_byte_scalar(const char* first, const char* last, char value) noexcept
+            {
+                if (first == last)
+                {
+                    return last;
+                }
+                const void* found = std::memchr(first, value, static_cast<size_t>(last - first));
+                return found != nullptr ? static_cast<const char*>(found) : last;
+            }
+
+            inline size_t count_byte_scalar(const char* first, const char* last, char value) noexcept
+            {
+                size_t count = 0;
+                for (; first != last; ++first)
+                {
+                    count += *first == value ? 1 : 0;
+                }
+                return count;
+            }
+
+            inline const char* find_any_scalar(const char* first, const char* last, const byte_set& set) noexcept
+            {
+                for (; first != last; ++first)
+                {
+                    if (set.contains(static_cast<unsigned char>(*first)))
+                    {
+                        return first;
+                    }
+                }
+                return last;
+            }
+
+            /* Positions [first, limit) as start of 'needle', 2 <= length. */
+            inline const char* find_substring_scalar(const char* first, const char* limit, const char* needle,
+                                                     size_t length) noexcept
+            {
+                for (; first < limit; ++first)
+                {
+                    first = find_byte_scalar(first, limit, needle[0]);
+                    if (first == limit)
+                    {
+                        break;
+                    }
+                    if (std::memcmp(first + 1, needle + 1, length - 1) == 0)
+                    {
+                        return first;
+                    }
+                }
+                return nullptr;
+            }
+
+            /* Index of the first byte that differs after folding. */
+            inline size_t mismatch_ignore_case_scalar(const char* a, const char* b, size_t length) noexcept
+            {
+                size_t i = 0;
+                for (; i < length; ++i)
+                {
+                    if (fold(static_cast<unsigned char>(a[i])) != fold(static_cast<unsigned char>(b[i])))
+                    {
+                        break;
+                    }
+                }
+                return i;
+            }
+
+            /* ---- Vector types ----
+
+               'mask' gives 'lane_bits' set bits per matching byte, 'sum'
+               adds the bytes of a counter vector. */
+
+#if defined(CPPP_SEARCH_X86)
+            struct sse2
+            {
+                typedef __m128i vector;
+                static constexpr size_t width = 16;
+                static constexpr unsigned lane_bits = 1;
+
+                static vector load(const char* p) noexcept
+                {
+                    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+                }
+
+                static vector splat(char c) noexcept
+                {
+                    return _mm_set1_epi8(c);
+                }
+
+                static vector zero() noexcept
+                {
+                    return _mm_setzero_si128();
+                }
+
+                static vector equal(vector a, vector b) noexcept
+                {
+                    return _mm_cmpeq_epi8(a, b);
+                }
+
+                static vector both(vector a, vector b) noexcept
+                {
+                    return _mm_and_si128(a, b);
+                }
+
+                static std::uint64_t mask(vector v) noexcept
+                {
+                    return static_cast<std::uint32_t>(_mm_movemask_epi8(v));
+                }
+
+                /* 'counter' minus each all-ones match byte. */
+                static vector count(vector counter, vector matches) noexcept
+                {
+                    return _mm_sub_epi8(counter, matches);
+                }
+
+                static std::uint64_t sum(vector counter) noexcept
+                {
+                    __m128i sums = _mm_sad_epu8(counter, _mm_setzero_si128());
+                    return static_cast<std::uint64_t>(_mm_cvtsi128_si32(sums)) +
+                           static_cast<std::uint64_t>(_mm_cvtsi128_si32(_mm_srli_si128(sums, 8)));
+                }
+
+                static vector to_lower(vector v) noexcept
+                {
+                    /* 'A'..'Z' move to -128..-103. */
+                    __m128i shifted = _mm_add_epi8(v, _mm_set1_epi8(0x3F));
+                    __m128i upper = _mm_cmpgt_epi8(_mm_set1_epi8(-128 + 26), shifted);
+                    return _mm_or_si128(v, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+                }
+
+                struct table
+                {
+                    vector low;
+                    vector high;
+                };
+
+                static table load_table(const byte_set& set) noexcept
+                {
+                    return table{_mm_load_si128(reinterpret_cast<const __m128i*>(set.low_nibbles)),
+                                 _mm_load_si128(reinterpret_cast<const __m128i*>(set.high_nibbles))};
+                }
+
+                /* All-ones bytes where the set may contain the byte. */
+                CPPP_SEARCH_TARGET("ssse3") static vector classify(vector v, const table& t) noexcept
+                {
+                    __m128i nibble = _mm_set1_epi8(0x0F);
+                    __m128i low = _mm_shuffle_epi8(t.low, _mm_and_si128(v, nibble));
+                    __m128i high = _mm_shuffle_epi8(t.high, _mm_and_si128(_mm_srli_epi16(v, 4), nibble));
+                    return _mm_xor_si128(_mm_cmpeq_epi8(_mm_and_si128(low, high), _mm_setzero_si128()),
+                                         _mm_set1_epi8(-1));
+                }
+            };
+
+#if defined(CPPP_SEARCH_AVX2)
+            struct avx2
+            {
+                typedef __m256i vector;
+                static constexpr size_t width = 32;
+                static constexpr unsigned lane_bits = 1;
+
+                CPPP_SEARCH_TARGET("avx2") static vector load(const char* p) noexcept
+                {
+                    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+                }
+
+                CPPP_SEARCH_TARGET("avx2") static vector splat(char c) noexcept
+                {
+                    return _mm256_set1_epi8(c);
+                }
+
+                CPPP_SEARCH_TARGET("avx2") static vector zero() noexcept
+                {
+                    return _mm256_setzero_si256();
+                }
+
+                CPPP_SEARCH_TARGET("avx2") static vector equal(vector a, vector b) noexcept
+                {
+                    return _mm256_cmpeq_epi8(a, b);
+                }
+
+                CPPP_SEARCH_TARGET("avx2") static vector both(vector a, vector b) noexcept
+                {
+                    return _mm256_and_si256(a, b);
+                }
+
+                CPPP_SEARCH_TARGET("avx2") static std::uint64_t mask(vector v) noexcept
+                {
+                    return static_cast<std::uint32_t>(_mm256_movemask_epi8(v));
+                }
+
+                CPPP_SEARCH_TARGET("avx2") static vector count(vector counter, vector matches) noexcept
+                {
+                    return _mm256_sub_epi8(counter, matches);
+                }
+
+                CPPP_SEARCH_TARGET("avx2") static std::uint64_t sum(vector counter) noexcept
+                {
+                    __m256i sums = _mm256_sad_epu8(counter, _mm256_setzero_si256());
+                    __m128i pair = _mm_add_epi64(_mm256_castsi256_si128(sums), _mm256_extracti128_si256(sums, 1));
+                    return static_cast<std::uint64_t>(_mm_cvtsi128_si32(pair)) +
+                           static_cast<std::uint64_t>(_mm_cvtsi128_si32(_mm_srli_si128(pair, 8)));
+                }
+
+                CPPP_SEARCH_TARGET("avx2") static vector to_lower(vector v) noexcept
+                {
+                    __m256i shifted = _mm256_add_epi8(v, _mm256_set1_epi8(0x3F));
+                    __m256i upper = _mm256_cmpgt_epi8(_mm256_set1_epi8(-128 + 26), shifted);
+                    return _mm256_or_si256(v, _mm256_and_si256(upper, _mm256_set1_epi8(0x20)));
+                }
+
+                struct table
+                {
+                    vector low;
+                    vector high;
+                };
+
+                CPPP_SEARCH_TARGET("avx2") static table load_table(const byte_set& set) noexcept
+                {
+                    return table{_mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(set.low_nibbles))),
+                                 _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(set.high_nibbles)))};
+                }
+
+                CPPP_SEARCH_TARGET("avx2") static vector classify(vector v, const table& t) noexcept
+                {
+                    __m256i nibble = _mm256_set1_epi8(0x0F);
+                    __m256i low = _mm256_shuffle_epi8(t.low, _mm256_and_si256(v, nibble));
+                    __m256i high = _mm256_shuffle_epi8(t.high, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble));
+                    return _mm256_xor_si256(_mm256_cmpeq_epi8(_mm256_and_si256(low, high), _mm256_setzero_si256()),
+                                            _mm256_set1_epi8(-1));
+                }
+            };
+
+            inline bool avx2_available() noexcept
+            {
+#if defined(__AVX2__)
+                return true;
+#elif defined(CPPP_COMPILER_GNU_LIKE)
+                return __builtin_cpu_supports("avx2");
+#elif defined(CPPP_COMPILER_MSVC)
+                int info[4];
+                __cpuid(info, 0);
+                if (info[0] < 7)
+                {
+                    return false;
+                }
+                __cpuid(info, 1);
+                /* OSXSAVE and AVX, then the OS must save the YMM state. */
+                if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0 || (_xgetbv(0) & 6) != 6)
+                {
+                    return false;
+                }
+                __cpuidex(info, 7, 0);
+                return (info[1] & (1 << 5)) != 0;
+#else
+                return false;
+#endif
+            }
+#endif
+
+            inline bool ssse3_available() noexcept
+            {
+#if defined(__SSSE3__)
+                return true;
+#elif defined(CPPP_COMPILER_GNU_LIKE)
+                return __builtin_cpu_supports("ssse3");
+#elif defined(CPPP_COMPILER_MSVC)
+                int info[4];
+                __cpuid(info, 1);
+                return (info[2] & (1 << 9)) != 0;
+#else
+                return false;
+#endif
+            }
+#elif defined(CPPP_SEARCH_NEON)
+            struct neon
+            {
+                typedef uint8x16_t vector;
+                static constexpr size_t width = 16;
+                static constexpr unsigned lane_bits = 4;
+
+                static vector load(const char* p) noexcept
+                {
+                    return vld1q_u8(reinterpret_cast<const std::uint8_t*>(p));
+                }
+
+                static vector splat(char c) noexcept
+                {
+                    return vdupq_n_u8(static_cast<std::uint8_t>(c));
+                }
+
+                static vector zero() noexcept
+                {
+                    return vdupq_n_u8(0);
+                }
+
+                static vector equal(vector a, vector b) noexcept
+                {
+                    return vceqq_u8(a, b);
+                }
+
+                static vector both(vector a, vector b) noexcept
+                {
+                    return vandq_u8(a, b);
+                }
+
+                /* No movemask: narrow every byte to a nibble. */
+                static std::uint64_t mask(vector v) noexcept
+                {
+                    uint8x8_t narrowed = vshrn_n_u16(vreinterpretq_u16_u8(v), 4);
+                    return vget_lane_u64(vreinterpret_u64_u8(narrowed), 0);
+                }
+
+                static vector count(vector counter, vector matches) noexcept
+                {
+                    return vsubq_u8(counter, matches);
+                }
+
+                static std::uint64_t sum(vector counter) noexcept
+                {
+                    return vaddlvq_u8(counter);
+                }
+
+                static vector to_lower(vector v) noexcept
+                {
+                    uint8x16_t upper = vcltq_u8(vsubq_u8(v, vdupq_n_u8('A')), vdupq_n_u8(26));
+                    return vorrq_u8(v, vandq_u8(upper, vdupq_n_u8(0x20)));
+                }
+
+                struct table
+                {
+                    vector low;
+                    vector high;
+                };
+
+                static table load_table(const byte_set& set) noexcept
+                {
+                    return table{vld1q_u8(set.low_nibbles), vld1q_u8(set.high_nibbles)};
+                }
+
+                static vector classify(vector v, const table& t) noexcept
+                {
+                    uint8x16_t low = vqtbl1q_u8(t.low, vandq_u8(v, vdupq_n_u8(0x0F)));
+                    uint8x16_t high = vqtbl1q_u8(t.high, vshrq_n_u8(v, 4));
+                    return vtstq_u8(low, high);
+                }
+            };
+#endif
+
+            /* ---- Kernels ---- */
+
+            /* Index of the first match in a mask. */
+            template<typename V>
+            inline size_t first_lane(std::uint64_t mask) noexcept
+            {
+                return countr_zero(mask) / V::lane_bits;
+            }
+
+            /* Drop the first 'lanes' lanes of a mask. */
+            template<typename V>
+            inline std::uint64_t skip_lanes(std::uint64_t mask, size_t lanes) noexcept
+            {
+                size_t bits = lanes * V::lane_bits;
+                return bits == 0 ? mask : bits >= 64 ? 0 : mask >> bits << bits;
+            }
+
+            template<typename V>
+            inline const char* find_byte(const char* first, const char* last, char value) noexcept
+            {
+                size_t size = static_cast<size_t>(last - first);
+                if (size < V::width)
+                {
+                    return find_byte_scalar(first, last, value);
+                }
+                typename V::vector needle = V::splat(value);
+                const char* p = first;
+                for (; p + V::width <= last; p += V::width)
+                {
+                    std::uint64_t m = V::mask(V::equal(V::load(p), needle));
+                    if (m != 0)
+                    {
+                        return p + first_lane<V>(m);
+                    }
+                }
+                if (p != last)
+                {
+                    /* Overlapping final block, ignore what was seen. */
+                    const char* tail = last - V::width;
+                    std::uint64_t m = skip_lanes<V>(V::mask(V::equal(V::load(tail), needle)), static_cast<size_t>(p - tail));
+                    if (m != 0)
+                    {
+                        return tail + first_lane<V>(m);
+                    }
+                }
+                return last;
+            }
+
+            template<typename V>
+            inline size_t count_byte(const char* first, const char* last, char value) noexcept
+            {
+                typename V::vector needle = V::splat(value);
+                size_t total = 0;
+                const char* p = first;
+                while (static_cast<size_t>(last - p) >= V::width)
+                {
+                    /* Byte counters overflow after 255 blocks. */
+                    size_t blocks = static_cast<size_t>(last - p) / V::width;
+                    if (blocks > 255)
+                    {
+                        blocks = 255;
+                    }
+                    typename V::vector counter = V::zero();
+                    for (size_t i = 0; i < blocks; ++i, p += V::width)
+                    {
+                        counter = V::count(counter, V::equal(V::load(p), needle));
+                    }
+                    total += static_cast<size_t>(V::sum(counter));
+                }
+                return total + count_byte_scalar(p, last, value);
+            }
+
+            template<typename V>
+            inline const char* find_any(const char* first, const char* last, const byte_set& set) noexcept
+            {
+                if (static_cast<size_t>(last - first) < V::width)
+                {
+                    return find_any_scalar(first, last, set);
+                }
+                typename V::table t = V::load_table(set);
+                const char* p = first;
+                for (;;)
+                {
+                    size_t skip = 0;
+                    if (p + V::width > last)
+                    {
+                        if (p == last)
+                        {
+                            return last;
+                        }
+                        skip = static_cast<size_t>(p - (last - V::width));
+                        p = last - V::width;
+                    }
+                    std::uint64_t m = skip_lanes<V>(V::mask(V::classify(V::load(p), t)), skip);
+                    while (m != 0)
+                    {
+                        size_t lane = first_lane<V>(m);
+                        if (set.exact || set.contains(static_cast<unsigned char>(p[lane])))
+                        {
+                            return p + lane;
+                        }
+                        m = skip_lanes<V>(m, lane + 1);
+                    }
+                    p += V::width;
+                }
+            }
+
+            template<typename V>
+            inline const char* find_substring(const char* first, const char* last, const char* needle, size_t length) noexcept
+            {
+                /* Starting positions are [first, limit). */
+                const char* limit = last - (length - 1);
+                typename V::vector head = V::splat(needle[0]);
+                typename V::vector tail = V::splat(needle[length - 1]);
+                const char* p = first;
+                for (; static_cast<size_t>(limit - p) >= V::width; p += V::width)
+                {
+                    std::uint64_t m = V::mask(
+                        V::both(V::equal(V::load(p), head), V::equal(V::load(p + length - 1), tail)));
+                    while (m != 0)
+                    {
+                        size_t lane = first_lane<V>(m);
+                        if (std::memcmp(p + lane + 1, needle + 1, length - 2) == 0)
+                        {
+                            return p + lane;
+                        }
+                        m = skip_lanes<V>(m, lane + 1);
+                    }
+                }
+                const char* found = find_substring_scalar(p, limit, needle, length);
+                return found != nullptr ? found : last;
+            }
+
+            template<typename V>
+            inline size_t mismatch_ignore_case(const char* a, const char* b, size_t length) noexcept
+            {
+                size_t i = 0;
+                for (; i + V::width <= length; i += V::width)
+                {
+                    std::uint64_t m = V::mask(V::equal(V::to_lower(V::load(a + i)), V::to_lower(V::load(b + i))));
+                    std::uint64_t all = V::width * V::lane_bits == 64 ? ~std::uint64_t(0)
+                                                                      : (std::uint64_t(1) << (V::width * V::lane_bits)) - 1;
+                    if (m != all)
+                    {
+                        return i + first_lane<V>(~m);
+                    }
+                }
+                return i + mismatch_ignore_case_scalar(a + i, b + i, length - i);
+            }
+
+            /* ---- Entry points and dispatch ---- */
+
+#if defined(CPPP_SEARCH_X86)
+#if defined(CPPP_SEARCH_AVX2)
+            CPPP_SEARCH_ENTRY("avx2") inline const char* find_byte_avx2(const char* first, const char* last, char value) noexcept
+            {
+                return find_byte<avx2>(first, last, value);
+            }
+
+            CPPP_SEARCH_ENTRY("avx2") inline size_t count_byte_avx2(const char* first, const char* last, char value) noexcept
+            {
+                return count_byte<avx2>(first, last, value);
+            }
+
+            CPPP_SEARCH_ENTRY("avx2") inline const char* find_any_avx2(const char* first, const char* last, const byte_set& set) noexcept
+            {
+                return find_any<avx2>(first, last, set);
+            }
+
+            CPPP_SEARCH_ENTRY("avx2") inline const char* find_substring_avx2(const char* first, const char* last, const char* needle,
+                                                                          size_t length) noexcept
+            {
+                return find_substring<avx2>(first, last, needle, length);
+            }
+
+            CPPP_SEARCH_ENTRY("avx2") inline size_t mismatch_ignore_case_avx2(const char* a, const char* b, size_t length) noexcept
+            {
+                return mismatch_ignore_case<avx2>(a, b, length);
+            }
+#endif
+
+            CPPP_SEARCH_ENTRY("ssse3") inline const char* find_any_ssse3(const char* first, const char* last, const byte_set& set) noexcept
+            {
+                return find_any<sse2>(first, last, set);
+            }
+
+            struct dispatch_table
+            {
+                const char* (*find_byte)(const char*, const char*, char) noexcept;
+                size_t (*count_byte)(const char*, const char*, char) noexcept;
+                const char* (*find_any)(const char*, const char*, const byte_set&) noexcept;
+                const char* (*find_substring)(const char*, const char*, const char*, size_t) noexcept;
+                size_t (*mismatch_ignore_case)(const char*, const char*, size_t) noexcept;
+                const char* name;
+            };
+
+            inline const dispatch_table& dispatch() noexcept
+            {
+                static const dispatch_table selected = []() noexcept -> dispatch_table
+                {
+#if defined(CPPP_SEARCH_AVX2)
+                    if (avx2_available())
+                    {
+                        return dispatch_table{&find_byte_avx2, &count_byte_avx2, &find_any_avx2, &find_substring_avx2,
+                                              &mismatch_ignore_case_avx2, "avx2"};
+                    }
+#endif
+                    return dispatch_table{&find_byte<sse2>,
+                                          &count_byte<sse2>,
+                                          ssse3_available() ? &find_any_ssse3 : &find_any_scalar,
+                                          &find_substring<sse2>,
+                                          &mismatch_ignore_case<sse2>,
+                                          ssse3_available() ? "ssse3" : "sse2"};
+                }();
+                return selected;
+            }
+#endif
+        } // namespace search
+    } // namespace detail
+
+    /* First byte equal to 'value'. */
+    inline const char* find_byte(const char* first, const char* last, char value) noexcept
+    {
+#if defined(CPPP_SEARCH_X86)
+        return detail::search::dispatch().find_byte(first, last, value);
+#elif defined(CPPP_SEARCH_NEON)
+        return detail::search::find_byte<detail::search::neon>(first, last, value);
+#else
+        return detail::search::find_byte_scalar(first, last, value);
+#endif
+    }
+
+    /* Number of bytes equal to 'value', e.g. lines in a buffer. */
+    inline size_t count_byte(const char* first, const char* last, char value) noexcept
+    {
+#if defined(CPPP_SEARCH_X86)
+        return detail::search::dispatch().count_byte(first, last, value);
+#elif defined(CPPP_SEARCH_NEON)
+        return detail::search::count_byte<detail::search::neon>(first, last, value);
+#else
+        return detail::search::count_byte_scalar(first, last, value);
+#endif
+    }
+
+    /* First byte that is in 'set'. */
+    inline const char* find_any_of(const char* first, const char* last, const byte_set& set) noexcept
+    {
+#if defined(CPPP_SEARCH_X86)
+        return detail::search::dispatch().find_any(first, last, set);
+#elif defined(CPPP_SEARCH_NEON)
+        return detail::search::find_any<detail::search::neon>(first, last, set);
+#else
+        return detail::search::find_any_scalar(first, last, set);
+#endif
+    }
+
+    /* First occurrence of the 'length' bytes at 'needle'. An empty needle
+       matches at 'first'. */
+    inline const char* find_substring(const char* first, const char* last, const char* needle, size_t length) noexcept
+    {
+        if (length == 0)
+        {
+            return first;
+        }
+        if (length > static_cast<size_t>(last - first))
+        {
+            return last;
+        }
+        if (length == 1)
+        {
+            return find_byte(first, last, needle[0]);
+        }
+#if defined(CPPP_SEARCH_X86)
+        return detail::search::dispatch().find_substring(first, last, needle, length);
+#elif defined(CPPP_SEARCH_NEON)
+        return detail::search::find_substring<detail::search::neon>(first, last, needle, length);
+#else
+        const char* found = detail::search::find_substring_scalar(first, last - (length - 1), needle, length);
+        return found != nullptr ? found : last;
+#endif
+    }
+
+    /* Whether 'length' bytes at 'a' and 'b' are equal ignoring ASCII
+       case, e.g. for HTTP header names. */
+    inline bool equal_ignore_case(const char* a, const char* b, size_t length) noexcept
+    {
+#if defined(CPPP_SEARCH_X86)
+        return detail::search::dispatch().mismatch_ignore_case(a, b, length) == length;
+#elif defined(CPPP_SEARCH_NEON)
+        return detail::search::mismatch_ignore_case<detail::search::neon>(a, b, length) == length;
+#else
+        return detail::search::mismatch_ignore_case_scalar(a, b, length) == length;
+#endif
+    }
+
+    /* Compare ignoring ASCII case, bytes as unsigned, like 'strncasecmp'
+       over the shorter length and then by length. Returns a negative
+       value, zero or a positive value. */
+    inline int compare_ignore_case(const char* a, size_t a_length, const char* b, size_t b_length) noexcept
+    {
+        size_t length = a_length < b_length ? a_length : b_length;
+#if defined(CPPP_SEARCH_X86)
+        size_t i = detail::search::dispatch().mismatch_ignore_case(a, b, length);
+#elif defined(CPPP_SEARCH_NEON)
+        size_t i = detail::search::mismatch_ignore_case<detail::search::neon>(a, b, length);
+#else
+        size_t i = detail::search::mismatch_ignore_case_scalar(a, b, length);
+#endif
+        if (i < length)
+        {
+            return static_cast<int>(detail::search::fold(static_cast<unsigned char>(a[i]))) -
+                   static_cast<int>(detail::search::fold(static_cast<unsigned char>(b[i])));
+        }
+        return a_length < b_length ? -1 : a_length > b_length ? 1 : 0;
+    }
+
+    /* Name of the kernels in use: "avx2", "ssse3", "sse2", "neon" or
+       "scalar". */
+    inline const char* string_search_implementation() noexcept
+    {
+#if defined(CPPP_SEARCH_X86)
+        return detail::search::dispatch().name;
+#elif defined(CPPP_SEARCH_NEON)
+        return "neon";
+#else
+        return "scalar";
+#endif
+    }
+} // namespace cppp
+
+#if defined(CPPP_COMPILER_GCC)
+#pragma GCC diagnostic pop
+#endif
+
+#undef CPPP_SEARCH_TARGET
+#undef CPPP_SEARCH_ENTRY
+#undef CPPP_SEARCH_X86
+#undef CPPP_SEARCH_NEON
+#undef CPPP_SEARCH_AVX2
+
+#endif
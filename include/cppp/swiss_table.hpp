@@ -0,0 +1,1324 @@
+/* Copyright (C) 1999-2023 Free Software Foundation, Inc.
+   This file is part of the cppp-base library.
+
+   The cppp-base library is free software; you can redistribute it
+   and/or modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either version 3
+   of the License, or (at your option) any later version.
+
+   The cppp-base library is distributed in the hope that it will be
+   useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the cppp-base library; see the file COPYING.
+   If not, see <https://www.gnu.org/licenses/>.  */
+
+/* We do not use '#pragma once' because it may has bugs in some compiler. */
+#ifndef _CPPP_SWISS_TABLE_HPP
+#define _CPPP_SWISS_TABLE_HPP
+
+/* C++ Plus open addressing hash table core
+
+   This is the engine of 'flat_hash_map' and 'flat_hash_set', include those
+   instead of this file.
+
+   The table is a power-of-two-minus-one array of slots and a parallel array
+   of control bytes, one per slot:
+     0b0hhhhhhh  full, 'h' are 7 bits of the hash (H2)
+     0b10000000  empty
+     0b11111110  deleted (tombstone)
+     0b11111111  sentinel, marks the end for iterators
+   The rest of the hash (H1) picks where probing starts.  Probing reads a
+   whole group of control bytes at once and compares all of them against
+   H2 with SIMD (SSE2 or AVX2 on x86, NEON on ARM) or with 64-bit SWAR
+   arithmetic elsewhere, so the slots are only touched for likely matches.
+   The first 'group_width - 1' control bytes are cloned after the sentinel,
+   so a group read starting anywhere never wraps. */
+
+#include "basedef.hpp"
+#include "bits.hpp"
+#include "type_traits.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+/* Define CPPP_SWISS_PORTABLE to use the SWAR group on every target. */
+#if defined(CPPP_SWISS_PORTABLE)
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#define CPPP_SWISS_AVX2 1
+#elif defined(__SSE2__) || defined(CPPP_ARCH_X86_64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CPPP_SWISS_SSE2 1
+#elif defined(__ARM_NEON) && defined(CPPP_ARCH_ARM64)
+#include <arm_neon.h>
+#define CPPP_SWISS_NEON 1
+#endif
+
+namespace cppp
+{
+    namespace detail
+    {
+        namespace swiss
+        {
+            using ctrl_t = signed char;
+
+            constexpr ctrl_t ctrl_empty = -128;
+            constexpr ctrl_t ctrl_deleted = -2;
+            constexpr ctrl_t ctrl_sentinel = -1;
+
+            CPPP_FORCE_INLINE bool is_full(ctrl_t c) noexcept
+            {
+                return c >= 0;
+            }
+
+            /* Positions of matching control bytes in a group, one bit per
+               byte ('Shift' == 0) or the top bit of one byte per position
+               ('Shift' == 3). */
+            template<unsigned Width, unsigned Shift>
+            class bitmask
+            {
+            private:
+                std::uint64_t mask;
+
+            public:
+                explicit bitmask(std::uint64_t m) noexcept : mask(m)
+                {
+                }
+
+                explicit operator bool() const noexcept
+                {
+                    return mask != 0;
+                }
+
+                unsigned lowest() const noexcept
+                {
+                    return countr_zero(mask) >> Shift;
+                }
+
+                unsigned trailing_zeros() const noexcept
+                {
+                    return mask == 0 ? Width : countr_zero(mask) >> Shift;
+                }
+
+                unsigned leading_zeros() const noexcept
+                {
+                    constexpr unsigned total_bits = Width << Shift;
+                    return mask == 0 ? Width : (countl_zero(mask) - (64 - total_bits)) >> Shift;
+                }
+
+                /* Iterate over the set positions with range-for. */
+                bitmask begin() const noexcept
+                {
+                    return *this;
+                }
+
+                bitmask end() const noexcept
+                {
+                    return bitmask(0);
+                }
+
+                unsigned operator*() const noexcept
+                {
+                    return lowest();
+                }
+
+                bitmask& operator++() noexcept
+                {
+                    mask &= mask - 1;
+                    return *this;
+                }
+
+                bool operator!=(const bitmask& other) const noexcept
+                {
+                    return mask != other.mask;
+                }
+            };
+
+#if defined(CPPP_SWISS_AVX2)
+            struct group
+            {
+                static constexpr unsigned width = 32;
+                using mask_type = bitmask<width, 0>;
+
+                __m256i ctrl;
+
+                explicit group(const ctrl_t* p) noexcept : ctrl(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)))
+                {
+                }
+
+                mask_type match(std::uint8_t h2) const noexcept
+                {
+                    __m256i target = _mm256_set1_epi8(static_cast<char>(h2));
+                    return mask_type(static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(target, ctrl))));
+                }
+
+                mask_type mask_empty() const noexcept
+                {
+                    __m256i target = _mm256_set1_epi8(ctrl_empty);
+                    return mask_type(static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(target, ctrl))));
+                }
+
+                mask_type mask_empty_or_deleted() const noexcept
+                {
+                    __m256i sentinel = _mm256_set1_epi8(ctrl_sentinel);
+                    return mask_type(static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpgt_epi8(sentinel, ctrl))));
+                }
+            };
+#elif defined(CPPP_SWISS_SSE2)
+            struct group
+            {
+                static constexpr unsigned width = 16;
+                using mask_type = bitmask<width, 0>;
+
+                __m128i ctrl;
+
+                explicit group(const ctrl_t* p) noexcept : ctrl(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)))
+                {
+                }
+
+                mask_type match(std::uint8_t h2) const noexcept
+                {
+                    __m128i target = _mm_set1_epi8(static_cast<char>(h2));
+                    return mask_type(static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(target, ctrl))));
+                }
+
+                mask_type mask_empty() const noexcept
+                {
+                    __m128i target = _mm_set1_epi8(ctrl_empty);
+                    return mask_type(static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(target, ctrl))));
+                }
+
+                mask_type mask_empty_or_deleted() const noexcept
+                {
+                    __m128i sentinel = _mm_set1_epi8(ctrl_sentinel);
+                    return mask_type(static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpgt_epi8(sentinel, ctrl))));
+                }
+            };
+#elif defined(CPPP_SWISS_NEON)
+            struct group
+            {
+                static constexpr unsigned width = 8;
+                using mask_type = bitmask<width, 3>;
+
+                int8x8_t ctrl;
+
+                explicit group(const ctrl_t* p) noexcept : ctrl(vld1_s8(p))
+                {
+                }
+
+                static std::uint64_t to_mask(uint8x8_t lanes) noexcept
+                {
+                    return vget_lane_u64(vreinterpret_u64_u8(lanes), 0) & 0x8080808080808080ULL;
+                }
+
+                mask_type match(std::uint8_t h2) const noexcept
+                {
+                    return mask_type(to_mask(vceq_s8(vdup_n_s8(static_cast<std::int8_t>(h2)), ctrl)));
+                }
+
+                mask_type mask_empty() const noexcept
+                {
+                    return mask_type(to_mask(vceq_s8(vdup_n_s8(ctrl_empty), ctrl)));
+                }
+
+                mask_type mask_empty_or_deleted() const noexcept
+                {
+                    return mask_type(to_mask(vcgt_s8(vdup_n_s8(ctrl_sentinel), ctrl)));
+                }
+            };
+#else
+            /* Portable 8-byte group using SWAR arithmetic. */
+            struct group
+            {
+                static constexpr unsigned width = 8;
+                using mask_type = bitmask<width, 3>;
+
+                static constexpr std::uint64_t msbs = 0x8080808080808080ULL;
+                static constexpr std::uint64_t lsbs = 0x0101010101010101ULL;
+
+                std::uint64_t ctrl;
+
+                explicit group(const ctrl_t* p) noexcept
+                {
+                    unsigned char bytes[8];
+                    std::memcpy(bytes, p, 8);
+                    ctrl = 0;
+                    for (unsigned i = 0; i < 8; ++i)
+                    {
+                        ctrl |= static_cast<std::uint64_t>(bytes[i]) << (i * 8);
+                    }
+                }
+
+                /* May report a false positive next to a real match,
+                   callers compare keys anyway. */
+                mask_type match(std::uint8_t h2) const noexcept
+                {
+                    std::uint64_t x = ctrl ^ (lsbs * h2);
+                    return mask_type((x - lsbs) & ~x & msbs);
+                }
+
+                mask_type mask_empty() const noexcept
+                {
+                    return mask_type((ctrl & (~ctrl << 6)) & msbs);
+                }
+
+                mask_type mask_empty_or_deleted() const noexcept
+                {
+                    return mask_type((ctrl & (~ctrl << 7)) & msbs);
+                }
+            };
+#endif
+
+            constexpr size_t cloned_bytes = group::width - 1;
+
+            /* Control bytes of a table that has never allocated,
+               every lookup stops at its first group. */
+            inline const ctrl_t* empty_group() noexcept
+            {
+                alignas(16) static const ctrl_t bytes[32] = {
+                    ctrl_sentinel, ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty,
+                    ctrl_empty,    ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty,
+                    ctrl_empty,    ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty,
+                    ctrl_empty,    ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty};
+                return bytes;
+            }
+
+            /* Spread the entropy of a user hash over all 64 bits,
+               'std::hash' of integers is often the identity. */
+            CPPP_FORCE_INLINE std::uint64_t mix(std::uint64_t h) noexcept
+            {
+                constexpr std::uint64_t k = 0x9E3779B97F4A7C15ULL;
+#if defined(__SIZEOF_INT128__)
+                __uint128_t m = static_cast<__uint128_t>(h) * k;
+                return static_cast<std::uint64_t>(m) ^ static_cast<std::uint64_t>(m >> 64);
+#else
+                h ^= h >> 33;
+                h *= k;
+                h ^= h >> 29;
+                return h;
+#endif
+            }
+
+            CPPP_FORCE_INLINE size_t h1(std::uint64_t hash) noexcept
+            {
+                return static_cast<size_t>(hash >> 7);
+            }
+
+            CPPP_FORCE_INLINE std::uint8_t h2(std::uint64_t hash) noexcept
+            {
+                return static_cast<std::uint8_t>(hash & 0x7F);
+            }
+
+            /* Triangular probing over groups, visits every group once
+               when the capacity is a power of two minus one. */
+            class probe_seq
+            {
+            private:
+                size_t mask;
+                size_t pos;
+                size_t step = 0;
+
+            public:
+                probe_seq(size_t hash, size_t capacity) noexcept : mask(capacity), pos(hash & capacity)
+                {
+                }
+
+                size_t offset() const noexcept
+                {
+                    return pos;
+                }
+
+                size_t offset(size_t i) const noexcept
+                {
+                    return (pos + i) & mask;
+                }
+
+                void next() noexcept
+                {
+                    step += group::width;
+                    pos = (pos + step) & mask;
+                }
+            };
+
+            /* Maximum number of elements before growing, 7/8 load factor. */
+            constexpr size_t capacity_to_growth(size_t capacity) noexcept
+            {
+                return group::width == 8 && capacity == 7 ? 6 : capacity - capacity / 8;
+            }
+
+            inline size_t normalize_capacity(size_t n) noexcept
+            {
+                return n == 0 ? 1 : static_cast<size_t>(~std::uint64_t(0) >> countl_zero(n));
+            }
+
+            /* Smallest capacity that holds 'n' elements without growing. */
+            inline size_t growth_to_capacity(size_t n) noexcept
+            {
+                if (group::width == 8 && n == 7)
+                {
+                    return 8;
+                }
+                return n + static_cast<size_t>((static_cast<std::int64_t>(n) - 1) / 7);
+            }
+
+            /* Hashers declaring 'is_avalanching' already mix their result
+               well, it is used as is. */
+            template<typename Hash, typename = void>
+            struct is_avalanching : std::false_type
+            {
+            };
+
+            template<typename Hash>
+            struct is_avalanching<Hash, typename std::conditional<true, void, typename Hash::is_avalanching>::type>
+                : std::true_type
+            {
+            };
+
+            /* Policy of a set, slots hold the keys themselves. */
+            template<typename Key>
+            struct set_policy
+            {
+                using key_type = Key;
+                using slot_type = Key;
+                using value_type = Key;
+                using reference = const Key&;
+                using const_reference = const Key&;
+
+                static const Key& key(const slot_type& slot) noexcept
+                {
+                    return slot;
+                }
+
+                static const value_type& element(const slot_type& slot) noexcept
+                {
+                    return slot;
+                }
+            };
+
+            /* Policy of a map.  Slots hold 'std::pair<Key, T>' so keys can be
+               moved on rehash, and are exposed as 'std::pair<const Key, T>',
+               which has the same layout. */
+            template<typename Key, typename T>
+            struct map_policy
+            {
+                using key_type = Key;
+                using slot_type = std::pair<Key, T>;
+                using value_type = std::pair<const Key, T>;
+                using reference = value_type&;
+                using const_reference = const value_type&;
+
+                static_assert(sizeof(slot_type) == sizeof(value_type) && alignof(slot_type) == alignof(value_type),
+                              "pair<const K, V> must be layout compatible with pair<K, V>");
+
+                static const Key& key(const slot_type& slot) noexcept
+                {
+                    return slot.first;
+                }
+
+                static value_type& element(slot_type& slot) noexcept
+                {
+                    return reinterpret_cast<value_type&>(slot);
+                }
+
+                static const value_type& element(const slot_type& slot) noexcept
+                {
+                    return reinterpret_cast<const value_type&>(slot);
+                }
+            };
+
+            template<typename Policy, typename Hash, typename KeyEqual, typename Allocator>
+            class raw_table
+            {
+            public:
+                using key_type = typename Policy::key_type;
+                using value_type = typename Policy::value_type;
+                using slot_type = typename Policy::slot_type;
+                using size_type = size_t;
+                using difference_type = std::ptrdiff_t;
+                using hasher = Hash;
+                using key_equal = KeyEqual;
+                using allocator_type = Allocator;
+                using reference = typename Policy::reference;
+                using const_reference = typename Policy::const_reference;
+
+            private:
+                using slot_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<slot_type>;
+                using slot_traits = std::allocator_traits<slot_allocator>;
+
+                static constexpr bool transparent =
+                    is_transparent_helper<Hash>::value && is_transparent_helper<KeyEqual>::value;
+
+            protected:
+                /* Lookup key type, any type with transparent functors. */
+                template<typename K>
+                using key_arg = typename key_arg_helper<transparent>::template type<K, key_type>;
+
+            public:
+                template<bool Const>
+                class basic_iterator
+                {
+                private:
+                    friend class raw_table;
+
+                    const ctrl_t* ctrl = nullptr;
+                    slot_type* slot = nullptr;
+
+                    basic_iterator(const ctrl_t* c, slot_type* s) noexcept : ctrl(c), slot(s)
+                    {
+                    }
+
+                    void skip_empty() noexcept
+                    {
+                        while (*ctrl < ctrl_sentinel)
+                        {
+                            ++ctrl;
+                            ++slot;
+                        }
+                        if (*ctrl == ctrl_sentinel)
+                        {
+                            ctrl = nullptr;
+                            slot = nullptr;
+                        }
+                    }
+
+                public:
+                    using iterator_category = std::forward_iterator_tag;
+                    using value_type = typename raw_table::value_type;
+                    using difference_type = std::ptrdiff_t;
+                    using reference = typename std::conditional<Const, const_reference, typename raw_table::reference>::type;
+                    using pointer = typename std::remove_reference<reference>::type*;
+
+                    basic_iterator() noexcept = default;
+
+                    template<bool C = Const, typename = typename std::enable_if<C>::type>
+                    basic_iterator(const basic_iterator<false>& other) noexcept : ctrl(other.ctrl), slot(other.slot)
+                    {
+                    }
+
+                    reference operator*() const noexcept
+                    {
+                        return Policy::element(*slot);
+                    }
+
+                    pointer operator->() const noexcept
+                    {
+                        return &Policy::element(*slot);
+                    }
+
+                    basic_iterator& operator++() noexcept
+                    {
+                        ++ctrl;
+                        ++slot;
+                        skip_empty();
+                        return *this;
+                    }
+
+                    basic_iterator operator++(int) noexcept
+                    {
+                        basic_iterator old = *this;
+                        ++*this;
+                        return old;
+                    }
+
+                    friend bool operator==(const basic_iterator& a, const basic_iterator& b) noexcept
+                    {
+                        return a.ctrl == b.ctrl;
+                    }
+
+                    friend bool operator!=(const basic_iterator& a, const basic_iterator& b) noexcept
+                    {
+                        return a.ctrl != b.ctrl;
+                    }
+
+                    template<bool>
+                    friend class basic_iterator;
+                };
+
+                using iterator = basic_iterator<std::is_same<reference, const_reference>::value>;
+                using const_iterator = basic_iterator<true>;
+
+            private:
+                ctrl_t* ctrl;
+                slot_type* slots = nullptr;
+                size_t element_count = 0;
+                size_t cap = 0;
+                size_t growth_left = 0;
+                /* Whether the slot claimed by the last 'prepare_insert' was
+                   empty rather than a tombstone, to undo the claim exactly. */
+                bool claimed_empty = false;
+                struct functors : Hash, KeyEqual, slot_allocator
+                {
+                    functors(const Hash& h, const KeyEqual& e, const slot_allocator& a) : Hash(h), KeyEqual(e), slot_allocator(a)
+                    {
+                    }
+                } fn;
+
+            public:
+                raw_table() : raw_table(0)
+                {
+                }
+
+                explicit raw_table(size_type bucket_count, const Hash& hash = Hash(), const KeyEqual& equal = KeyEqual(),
+                                   const Allocator& alloc = Allocator())
+                    : ctrl(const_cast<ctrl_t*>(empty_group())), fn(hash, equal, slot_allocator(alloc))
+                {
+                    if (bucket_count != 0)
+                    {
+                        resize(normalize_capacity(bucket_count));
+                    }
+                }
+
+                explicit raw_table(const Allocator& alloc) : raw_table(0, Hash(), KeyEqual(), alloc)
+                {
+                }
+
+                template<typename InputIt>
+                raw_table(InputIt from, InputIt to, size_type bucket_count = 0, const Hash& hash = Hash(),
+                          const KeyEqual& equal = KeyEqual(), const Allocator& alloc = Allocator())
+                    : raw_table(bucket_count, hash, equal, alloc)
+                {
+                    insert(from, to);
+                }
+
+                raw_table(std::initializer_list<value_type> list, size_type bucket_count = 0, const Hash& hash = Hash(),
+                          const KeyEqual& equal = KeyEqual(), const Allocator& alloc = Allocator())
+                    : raw_table(list.begin(), list.end(), bucket_count, hash, equal, alloc)
+                {
+                }
+
+                raw_table(const raw_table& other)
+                    : raw_table(0, other.hash_function(), other.key_eq(),
+                                slot_traits::select_on_container_copy_construction(other.slot_alloc()))
+                {
+                    copy_from(other);
+                }
+
+                raw_table(raw_table&& other) noexcept
+                    : ctrl(other.ctrl), slots(other.slots), element_count(other.element_count), cap(other.cap),
+                      growth_left(other.growth_left), fn(std::move(other.fn))
+                {
+                    other.reset_empty();
+                }
+
+                ~raw_table()
+                {
+                    destroy_all();
+                    deallocate();
+                }
+
+                raw_table& operator=(const raw_table& other)
+                {
+                    if (this != &other)
+                    {
+                        raw_table copy(0, other.hash_function(), other.key_eq(),
+                                       allocator_type(slot_traits::propagate_on_container_copy_assignment::value
+                                                          ? other.slot_alloc()
+                                                          : slot_alloc()));
+                        copy.copy_from(other);
+                        destroy_all();
+                        deallocate();
+                        reset_empty();
+                        static_cast<Hash&>(fn) = static_cast<const Hash&>(other.fn);
+                        static_cast<KeyEqual&>(fn) = static_cast<const KeyEqual&>(other.fn);
+                        copy_allocator(other, typename slot_traits::propagate_on_container_copy_assignment());
+                        take(copy);
+                    }
+                    return *this;
+                }
+
+                raw_table& operator=(raw_table&& other) noexcept(
+                    slot_traits::propagate_on_container_move_assignment::value || std::is_empty<slot_allocator>::value)
+                {
+                    if (this != &other)
+                    {
+                        if (slot_traits::propagate_on_container_move_assignment::value || slot_alloc() == other.slot_alloc())
+                        {
+                            destroy_all();
+                            deallocate();
+                            reset_empty();
+                            static_cast<Hash&>(fn) = std::move(static_cast<Hash&>(other.fn));
+                            static_cast<KeyEqual&>(fn) = std::move(static_cast<KeyEqual&>(other.fn));
+                            move_allocator(other, typename slot_traits::propagate_on_container_move_assignment());
+                            take(other);
+                        }
+                        else
+                        {
+                            /* The storage cannot change allocator, move the
+                               elements into this table's own. */
+                            clear();
+                            static_cast<Hash&>(fn) = std::move(static_cast<Hash&>(other.fn));
+                            static_cast<KeyEqual&>(fn) = std::move(static_cast<KeyEqual&>(other.fn));
+                            move_from(other);
+                            other.clear();
+                        }
+                    }
+                    return *this;
+                }
+
+                /* Iterators */
+
+                iterator begin() noexcept
+                {
+                    if (element_count == 0)
+                    {
+                        return end();
+                    }
+                    iterator it(ctrl, slots);
+                    it.skip_empty();
+                    return it;
+                }
+
+                const_iterator begin() const noexcept
+                {
+                    return const_cast<raw_table*>(this)->begin();
+                }
+
+                const_iterator cbegin() const noexcept
+                {
+                    return begin();
+                }
+
+                iterator end() noexcept
+                {
+                    return iterator();
+                }
+
+                const_iterator end() const noexcept
+                {
+                    return const_iterator();
+                }
+
+                const_iterator cend() const noexcept
+                {
+                    return end();
+                }
+
+                /* Capacity */
+
+                bool empty() const noexcept
+                {
+                    return element_count == 0;
+                }
+
+                size_type size() const noexcept
+                {
+                    return element_count;
+                }
+
+                size_type max_size() const noexcept
+                {
+                    return (std::numeric_limits<size_t>::max)() / sizeof(slot_type) / 2;
+                }
+
+                size_type capacity() const noexcept
+                {
+                    return cap;
+                }
+
+                size_type bucket_count() const noexcept
+                {
+                    return cap;
+                }
+
+                float load_factor() const noexcept
+                {
+                    return cap == 0 ? 0.0f : static_cast<float>(element_count) / static_cast<float>(cap);
+                }
+
+                float max_load_factor() const noexcept
+                {
+                    return 7.0f / 8.0f;
+                }
+
+                /* Modifiers */
+
+                void clear() noexcept
+                {
+                    destroy_all();
+                    if (cap != 0)
+                    {
+                        reset_ctrl();
+                    }
+                    element_count = 0;
+                    growth_left = capacity_to_growth(cap);
+                }
+
+                std::pair<iterator, bool> insert(const value_type& value)
+                {
+                    return emplace_key(Policy::key(as_slot(value)), value);
+                }
+
+                std::pair<iterator, bool> insert(value_type&& value)
+                {
+                    return emplace_key(Policy::key(as_slot(value)), std::move(value));
+                }
+
+                iterator insert(const_iterator, const value_type& value)
+                {
+                    return insert(value).first;
+                }
+
+                iterator insert(const_iterator, value_type&& value)
+                {
+                    return insert(std::move(value)).first;
+                }
+
+                template<typename InputIt>
+                void insert(InputIt from, InputIt to)
+                {
+                    for (; from != to; ++from)
+                    {
+                        emplace(*from);
+                    }
+                }
+
+                void insert(std::initializer_list<value_type> list)
+                {
+                    insert(list.begin(), list.end());
+                }
+
+                /* Construct the value first to learn its key,
+                   it is moved into its slot if the key is new. */
+                template<typename... Args>
+                std::pair<iterator, bool> emplace(Args&&... args)
+                {
+                    slot_type temp(std::forward<Args>(args)...);
+                    return emplace_key(Policy::key(temp), std::move(temp));
+                }
+
+                template<typename... Args>
+                iterator emplace_hint(const_iterator, Args&&... args)
+                {
+                    return emplace(std::forward<Args>(args)...).first;
+                }
+
+                iterator erase(const_iterator pos)
+                {
+                    iterator next(pos.ctrl, pos.slot);
+                    ++next;
+                    erase_at(static_cast<size_t>(pos.ctrl - ctrl));
+                    return next;
+                }
+
+                template<typename It = iterator,
+                         typename = typename std::enable_if<!std::is_same<It, const_iterator>::value>::type>
+                iterator erase(iterator pos)
+                {
+                    return erase(const_iterator(pos));
+                }
+
+                iterator erase(const_iterator from, const_iterator to)
+                {
+                    while (from != to)
+                    {
+                        from = erase(from);
+                    }
+                    return iterator(const_cast<ctrl_t*>(to.ctrl), to.slot);
+                }
+
+                template<typename K = key_type>
+                size_type erase(const key_arg<K>& key)
+                {
+                    size_t index;
+                    if (!find_index(key, index))
+                    {
+                        return 0;
+                    }
+                    erase_at(index);
+                    return 1;
+                }
+
+                void swap(raw_table& other) noexcept(slot_traits::propagate_on_container_swap::value ||
+                                                     std::is_empty<slot_allocator>::value)
+                {
+                    using std::swap;
+                    if (this == &other)
+                    {
+                        return;
+                    }
+                    if (slot_traits::propagate_on_container_swap::value || slot_alloc() == other.slot_alloc())
+                    {
+                        swap(ctrl, other.ctrl);
+                        swap(slots, other.slots);
+                        swap(element_count, other.element_count);
+                        swap(cap, other.cap);
+                        swap(growth_left, other.growth_left);
+                        swap_allocator(other, typename slot_traits::propagate_on_container_swap());
+                    }
+                    else
+                    {
+                        /* Each table keeps its allocator, rebuild both sides
+                           with the other's elements. */
+                        raw_table mine(0, hash_function(), key_eq(), allocator_type(other.slot_alloc()));
+                        mine.move_from(*this);
+                        raw_table theirs(0, other.hash_function(), other.key_eq(), allocator_type(slot_alloc()));
+                        theirs.move_from(other);
+                        destroy_all();
+                        deallocate();
+                        reset_empty();
+                        take(theirs);
+                        other.destroy_all();
+                        other.deallocate();
+                        other.reset_empty();
+                        other.take(mine);
+                    }
+                    swap(static_cast<Hash&>(fn), static_cast<Hash&>(other.fn));
+                    swap(static_cast<KeyEqual&>(fn), static_cast<KeyEqual&>(other.fn));
+                }
+
+                /* Lookup */
+
+                template<typename K = key_type>
+                iterator find(const key_arg<K>& key)
+                {
+                    size_t index;
+                    return find_index(key, index) ? iterator_at(index) : end();
+                }
+
+                template<typename K = key_type>
+                const_iterator find(const key_arg<K>& key) const
+                {
+                    return const_cast<raw_table*>(this)->find(key);
+                }
+
+                template<typename K = key_type>
+                bool contains(const key_arg<K>& key) const
+                {
+                    size_t index;
+                    return const_cast<raw_table*>(this)->find_index(key, index);
+                }
+
+                template<typename K = key_type>
+                size_type count(const key_arg<K>& key) const
+                {
+                    return contains(key) ? 1 : 0;
+                }
+
+                template<typename K = key_type>
+                std::pair<iterator, iterator> equal_range(const key_arg<K>& key)
+                {
+                    iterator it = find(key);
+                    if (it == end())
+                    {
+                        return std::make_pair(it, it);
+                    }
+                    iterator next = it;
+                    return std::make_pair(it, ++next);
+                }
+
+                template<typename K = key_type>
+                std::pair<const_iterator, const_iterator> equal_range(const key_arg<K>& key) const
+                {
+                    return const_cast<raw_table*>(this)->equal_range(key);
+                }
+
+                /* Bucket interface */
+
+                void rehash(size_type n)
+                {
+                    if (n == 0 && cap == 0)
+                    {
+                        return;
+                    }
+                    size_t wanted = normalize_capacity((std::max)(n, growth_to_capacity(element_count)));
+                    if (n == 0 || wanted > cap)
+                    {
+                        resize(wanted);
+                    }
+                }
+
+                void reserve(size_type n)
+                {
+                    if (n > element_count + growth_left)
+                    {
+                        resize(normalize_capacity(growth_to_capacity(n)));
+                    }
+                }
+
+                /* Observers */
+
+                hasher hash_function() const
+                {
+                    return static_cast<const Hash&>(fn);
+                }
+
+                key_equal key_eq() const
+                {
+                    return static_cast<const KeyEqual&>(fn);
+                }
+
+                allocator_type get_allocator() const
+                {
+                    return allocator_type(slot_alloc());
+                }
+
+                friend bool operator==(const raw_table& a, const raw_table& b)
+                {
+                    if (a.size() != b.size())
+                    {
+                        return false;
+                    }
+                    for (const_iterator it = a.begin(); it != a.end(); ++it)
+                    {
+                        const_iterator other = b.find(Policy::key(a.as_slot(*it)));
+                        if (other == b.end() || !(*it == *other))
+                        {
+                            return false;
+                        }
+                    }
+                    return true;
+                }
+
+                friend bool operator!=(const raw_table& a, const raw_table& b)
+                {
+                    return !(a == b);
+                }
+
+            protected:
+                /* Find 'key' or claim a slot for it.  On insertion the
+                   slot is marked full but not constructed yet. */
+                template<typename K>
+                CPPP_FORCE_INLINE std::pair<size_t, bool> find_or_prepare_insert(const K& key)
+                {
+                    std::uint64_t hash = hash_of(key);
+                    probe_seq seq(h1(hash), cap);
+                    for (;;)
+                    {
+                        group g(ctrl + seq.offset());
+                        for (unsigned i : g.match(h2(hash)))
+                        {
+                            size_t index = seq.offset(i);
+                            if (CPPP_LIKELY(equal(Policy::key(slots[index]), key)))
+                            {
+                                return std::make_pair(index, false);
+                            }
+                        }
+                        if (CPPP_LIKELY(static_cast<bool>(g.mask_empty())))
+                        {
+                            break;
+                        }
+                        seq.next();
+                    }
+                    return std::make_pair(prepare_insert(hash), true);
+                }
+
+                /* Construct the slot claimed by 'find_or_prepare_insert',
+                   releasing the claim if construction throws. */
+                template<typename... Args>
+                void construct_at(size_t index, Args&&... args)
+                {
+                    try
+                    {
+                        slot_traits::construct(slot_alloc(), slots + index, std::forward<Args>(args)...);
+                    }
+                    catch (...)
+                    {
+                        /* Nothing probed past the slot since the claim, it
+                           can go back to what it was. */
+                        set_ctrl(index, claimed_empty ? ctrl_empty : ctrl_deleted);
+                        growth_left += claimed_empty ? 1 : 0;
+                        --element_count;
+                        throw;
+                    }
+                }
+
+                iterator iterator_at(size_t index) noexcept
+                {
+                    return iterator(ctrl + index, slots + index);
+                }
+
+                slot_type& slot_at(size_t index) noexcept
+                {
+                    return slots[index];
+                }
+
+                template<typename K, typename... Args>
+                std::pair<iterator, bool> emplace_key(const K& key, Args&&... args)
+                {
+                    std::pair<size_t, bool> result = find_or_prepare_insert(key);
+                    if (result.second)
+                    {
+                        construct_at(result.first, std::forward<Args>(args)...);
+                    }
+                    return std::make_pair(iterator_at(result.first), result.second);
+                }
+
+            private:
+                static const slot_type& as_slot(const value_type& value) noexcept
+                {
+                    return reinterpret_cast<const slot_type&>(value);
+                }
+
+                slot_allocator& slot_alloc() noexcept
+                {
+                    return fn;
+                }
+
+                const slot_allocator& slot_alloc() const noexcept
+                {
+                    return fn;
+                }
+
+                template<typename K>
+                std::uint64_t hash_of(const K& key) const
+                {
+                    std::uint64_t hash = static_cast<std::uint64_t>(static_cast<const Hash&>(fn)(key));
+                    return is_avalanching<Hash>::value ? hash : mix(hash);
+                }
+
+                template<typename A, typename B>
+                bool equal(const A& a, const B& b) const
+                {
+                    return static_cast<const KeyEqual&>(fn)(a, b);
+                }
+
+                template<typename K>
+                bool find_index(const K& key, size_t& index)
+                {
+                    std::uint64_t hash = hash_of(key);
+                    probe_seq seq(h1(hash), cap);
+                    for (;;)
+                    {
+                        group g(ctrl + seq.offset());
+                        for (unsigned i : g.match(h2(hash)))
+                        {
+                            size_t candidate = seq.offset(i);
+                            if (CPPP_LIKELY(equal(Policy::key(slots[candidate]), key)))
+                            {
+                                index = candidate;
+                                return true;
+                            }
+                        }
+                        if (CPPP_LIKELY(static_cast<bool>(g.mask_empty())))
+                        {
+                            return false;
+                        }
+                        seq.next();
+                    }
+                }
+
+                size_t find_first_non_full(std::uint64_t hash) const noexcept
+                {
+                    probe_seq seq(h1(hash), cap);
+                    for (;;)
+                    {
+                        group g(ctrl + seq.offset());
+                        typename group::mask_type mask = g.mask_empty_or_deleted();
+                        if (mask)
+                        {
+                            return seq.offset(mask.lowest());
+                        }
+                        seq.next();
+                    }
+                }
+
+                CPPP_NOINLINE void rehash_and_grow()
+                {
+                    if (cap == 0)
+                    {
+                        resize(1);
+                    }
+                    else if (cap > group::width && element_count * 32 <= cap * 25)
+                    {
+                        /* Mostly tombstones, rebuild at the same size. */
+                        resize(cap);
+                    }
+                    else
+                    {
+                        resize(cap * 2 + 1);
+                    }
+                }
+
+                size_t prepare_insert(std::uint64_t hash)
+                {
+                    size_t target = find_first_non_full(hash);
+                    if (CPPP_UNLIKELY(growth_left == 0 && ctrl[target] != ctrl_deleted))
+                    {
+                        rehash_and_grow();
+                        target = find_first_non_full(hash);
+                    }
+                    ++element_count;
+                    claimed_empty = ctrl[target] == ctrl_empty;
+                    growth_left -= claimed_empty ? 1 : 0;
+                    set_ctrl(target, static_cast<ctrl_t>(h2(hash)));
+                    return target;
+                }
+
+                void set_ctrl(size_t index, ctrl_t value) noexcept
+                {
+                    ctrl[index] = value;
+                    ctrl[((index - cloned_bytes) & cap) + (cloned_bytes & cap)] = value;
+                }
+
+                /* Tombstones are only needed when a probe could have passed
+                   this slot, i.e. when its window of 'group::width' bytes
+                   has been completely full at some point. */
+                void erase_at(size_t index) noexcept
+                {
+                    slot_traits::destroy(slot_alloc(), slots + index);
+                    --element_count;
+                    size_t before = (index - group::width) & cap;
+                    typename group::mask_type empty_after = group(ctrl + index).mask_empty();
+                    typename group::mask_type empty_before = group(ctrl + before).mask_empty();
+                    bool was_never_full = empty_before && empty_after &&
+                                          empty_after.trailing_zeros() + empty_before.leading_zeros() < group::width;
+                    set_ctrl(index, was_never_full ? ctrl_empty : ctrl_deleted);
+                    growth_left += was_never_full ? 1 : 0;
+                }
+
+                size_t slot_units(size_t capacity) const noexcept
+                {
+                    size_t ctrl_size = capacity + 1 + cloned_bytes;
+                    return capacity + (ctrl_size + sizeof(slot_type) - 1) / sizeof(slot_type);
+                }
+
+                void reset_ctrl() noexcept
+                {
+                    std::memset(ctrl, static_cast<unsigned char>(ctrl_empty), cap + 1 + cloned_bytes);
+                    ctrl[cap] = ctrl_sentinel;
+                }
+
+                void resize(size_t new_cap)
+                {
+                    slot_type* new_slots = slot_traits::allocate(slot_alloc(), slot_units(new_cap));
+                    ctrl_t* old_ctrl = ctrl;
+                    slot_type* old_slots = slots;
+                    size_t old_cap = cap;
+                    ctrl = reinterpret_cast<ctrl_t*>(new_slots + new_cap);
+                    slots = new_slots;
+                    cap = new_cap;
+                    reset_ctrl();
+                    growth_left = capacity_to_growth(cap) - element_count;
+                    for (size_t i = 0; i != old_cap; ++i)
+                    {
+                        if (is_full(old_ctrl[i]))
+                        {
+                            std::uint64_t hash = hash_of(Policy::key(old_slots[i]));
+                            size_t target = find_first_non_full(hash);
+                            set_ctrl(target, static_cast<ctrl_t>(h2(hash)));
+                            slot_traits::construct(slot_alloc(), slots + target, std::move(old_slots[i]));
+                            slot_traits::destroy(slot_alloc(), old_slots + i);
+                        }
+                    }
+                    if (old_cap != 0)
+                    {
+                        slot_traits::deallocate(slot_alloc(), old_slots, slot_units(old_cap));
+                    }
+                }
+
+                void destroy_all() noexcept
+                {
+                    if (!std::is_trivially_destructible<slot_type>::value && element_count != 0)
+                    {
+                        for (size_t i = 0; i != cap; ++i)
+                        {
+                            if (is_full(ctrl[i]))
+                            {
+                                slot_traits::destroy(slot_alloc(), slots + i);
+                            }
+                        }
+                    }
+                }
+
+                void deallocate() noexcept
+                {
+                    if (cap != 0)
+                    {
+                        slot_traits::deallocate(slot_alloc(), slots, slot_units(cap));
+                    }
+                }
+
+                void reset_empty() noexcept
+                {
+                    ctrl = const_cast<ctrl_t*>(empty_group());
+                    slots = nullptr;
+                    element_count = 0;
+                    cap = 0;
+                    growth_left = 0;
+                }
+
+                /* Adopt the storage of 'other', which uses an equal
+                   allocator.  This table must own no storage. */
+                void take(raw_table& other) noexcept
+                {
+                    ctrl = other.ctrl;
+                    slots = other.slots;
+                    element_count = other.element_count;
+                    cap = other.cap;
+                    growth_left = other.growth_left;
+                    other.reset_empty();
+                }
+
+                void copy_allocator(const raw_table& other, std::true_type)
+                {
+                    slot_alloc() = other.slot_alloc();
+                }
+
+                void copy_allocator(const raw_table&, std::false_type)
+                {
+                }
+
+                void move_allocator(raw_table& other, std::true_type)
+                {
+                    slot_alloc() = std::move(other.slot_alloc());
+                }
+
+                void move_allocator(raw_table&, std::false_type)
+                {
+                }
+
+                void swap_allocator(raw_table& other, std::true_type)
+                {
+                    using std::swap;
+                    swap(slot_alloc(), other.slot_alloc());
+                }
+
+                void swap_allocator(raw_table&, std::false_type)
+                {
+                }
+
+                /* Move the elements of 'other' into this empty table,
+                   leaving moved-from elements behind. */
+                void move_from(raw_table& other)
+                {
+                    reserve(other.size());
+                    for (size_t i = 0; i != other.cap; ++i)
+                    {
+                        if (is_full(other.ctrl[i]))
+                        {
+                            std::uint64_t hash = hash_of(Policy::key(other.slots[i]));
+                            size_t target = prepare_insert(hash);
+                            construct_at(target, std::move(other.slots[i]));
+                        }
+                    }
+                }
+
+                void copy_from(const raw_table& other)
+                {
+                    reserve(other.size());
+                    for (const_iterator it = other.begin(); it != other.end(); ++it)
+                    {
+                        const slot_type& slot = as_slot(*it);
+                        std::uint64_t hash = hash_of(Policy::key(slot));
+                        size_t target = prepare_insert(hash);
+                        construct_at(target, slot);
+                    }
+                }
+            };
+        } // namespace swiss
+    } // namespace detail
+} // namespace cppp
+
+#endif
@@ -0,0 +1,103 @@
+/* Copyright (C) 1999-2023 Free Software Foundation, Inc.
+   This file is part of the cppp-base library.
+
+   The cppp-base library is free software; you can redistribute it
+   and/or modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either version 3
+   of the License, or (at your option) any later version.
+
+   The cppp-base library is distributed in the hope that it will be
+   useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the cppp-base library; see the file COPYING.
+   If not, see <https://www.gnu.org/licenses/>.  */
+
+/* We do not use '#pragma once' because it may has bugs in some compiler. */
+#ifndef _CPPP_THREAD_INDEX_HPP
+#define _CPPP_THREAD_INDEX_HPP
+
+/* C++ Plus dense thread indexes */
+
+#include "basedef.hpp"
+
+#include <mutex>
+#include <vector>
+
+namespace cppp
+{
+    namespace detail
+    {
+        /* Hands out the smallest free index, so indexes stay dense
+           even when threads come and go. */
+        class thread_index_registry
+        {
+        private:
+            std::mutex lock;
+            std::vector<size_t> released;
+            size_t next = 0;
+
+        public:
+            static thread_index_registry& instance()
+            {
+                static thread_index_registry registry;
+                return registry;
+            }
+
+            size_t acquire()
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                if (released.empty())
+                {
+                    return next++;
+                }
+                size_t best = 0;
+                for (size_t i = 1; i < released.size(); ++i)
+                {
+                    if (released[i] < released[best])
+                    {
+                        best = i;
+                    }
+                }
+                size_t index = released[best];
+                released[best] = released.back();
+                released.pop_back();
+                return index;
+            }
+
+            void release(size_t index)
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                released.push_back(index);
+            }
+        };
+
+        struct thread_index_holder
+        {
+            size_t index;
+
+            thread_index_holder() : index(thread_index_registry::instance().acquire())
+            {
+            }
+
+            ~thread_index_holder()
+            {
+                thread_index_registry::instance().release(index);
+            }
+        };
+    } // namespace detail
+
+    /* A small integer identifying the calling thread.
+       No two live threads share an index, and an exited thread's index is
+       reused by the next new thread.  Use it to pick per-thread slots in
+       arrays owned by a shared object. */
+    inline size_t this_thread_index()
+    {
+        static thread_local detail::thread_index_holder holder;
+        return holder.index;
+    }
+} // namespace cppp
+
+#endif
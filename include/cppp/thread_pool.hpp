@@ -0,0 +1,771 @@
+/* Copyright (C) 1999-2023 Free Software Foundation, Inc.
+   This file is part of the cppp-base library.
+
+   The cppp-base library is free software; you can redistribute it
+   and/or modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either version 3
+   of the License, or (at your option) any later version.
+
+   The cppp-base library is distributed in the hope that it will be
+   useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the cppp-base library; see the file COPYING.
+   If not, see <https://www.gnu.org/licenses/>.  */
+
+/* We do not use '#pragma once' because it may has bugs in some compiler. */
+#ifndef _CPPP_THREAD_POOL_HPP
+#define _CPPP_THREAD_POOL_HPP
+
+/* C++ Plus work-stealing thread pool
+
+   Every worker owns a Chase-Lev deque. The owner pushes and pops at the
+   bottom without atomic read-modify-write in the common case. Idle
+   workers steal from the top of a random victim's deque.
+   Tasks submitted from outside the pool go to a shared injection queue.
+   Tasks with an affinity hint go to the mailbox of the preferred worker,
+   which other workers may still take when the preferred worker is busy.
+   Workers with nothing to do sleep in a 'park_wait'. */
+
+#include "basedef.hpp"
+#include "hardware.hpp"
+#include "wait_strategy.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace cppp
+{
+    class thread_pool;
+
+    /* Counters of one worker, see 'thread_pool::stats'. */
+    struct thread_pool_worker_stats
+    {
+        /* Tasks run by the worker. */
+        size_t executed;
+        /* Tasks taken from other workers. */
+        size_t steals;
+        /* Steal attempts that found the victim empty or lost a race. */
+        size_t failed_steals;
+        /* Times the worker went to sleep for lack of work. */
+        size_t idle;
+    };
+
+    namespace detail
+    {
+        namespace pool
+        {
+            struct task
+            {
+                virtual ~task() = default;
+                virtual void run() noexcept = 0;
+            };
+
+            template<typename Function>
+            struct task_impl final : task
+            {
+                Function function;
+
+                explicit task_impl(Function&& f)
+                    : function(std::move(f))
+                {
+                }
+
+                explicit task_impl(const Function& f)
+                    : function(f)
+                {
+                }
+
+                void run() noexcept override
+                {
+                    function();
+                }
+            };
+
+            template<typename Function>
+            task* make_task(Function&& f)
+            {
+                return new task_impl<typename std::decay<Function>::type>(std::forward<Function>(f));
+            }
+
+            inline void execute(task* t) noexcept
+            {
+                t->run();
+                delete t;
+            }
+
+            /* Chase-Lev deque, with the memory orders of "Correct and
+               Efficient Work-Stealing for Weak Memory Models" (Le et al.).
+               Only the owner calls 'push' and 'take', any thread may call
+               'steal'. */
+            class work_deque
+            {
+            private:
+                struct ring
+                {
+                    std::int64_t mask;
+                    std::unique_ptr<std::atomic<task*>[]> slots;
+
+                    explicit ring(std::int64_t capacity)
+                        : mask(capacity - 1), slots(new std::atomic<task*>[static_cast<size_t>(capacity)])
+                    {
+                    }
+
+                    /* The slots themselves publish the task, so a thief sees
+                       the task fully built whatever the deque indexes say. */
+                    task* get(std::int64_t i) const noexcept
+                    {
+                        return slots[static_cast<size_t>(i & mask)].load(std::memory_order_acquire);
+                    }
+
+                    void put(std::int64_t i, task* t) noexcept
+                    {
+                        slots[static_cast<size_t>(i & mask)].store(t, std::memory_order_release);
+                    }
+                };
+
+                cache_aligned<std::atomic<std::int64_t>> top;
+                cache_aligned<std::atomic<std::int64_t>> bottom;
+                std::atomic<ring*> array;
+                /* Rings replaced by 'grow', a thief may still read them, so
+                   they live as long as the deque. */
+                std::vector<std::unique_ptr<ring>> rings;
+
+            public:
+                work_deque()
+                    : top(std::int64_t(0)), bottom(std::int64_t(0))
+                {
+                    rings.emplace_back(new ring(64));
+                    array.store(rings.back().get(), std::memory_order_relaxed);
+                }
+
+                work_deque(const work_deque&) = delete;
+                work_deque& operator=(const work_deque&) = delete;
+
+                bool empty_approx() const noexcept
+                {
+                    return bottom->load(std::memory_order_relaxed) <= top->load(std::memory_order_relaxed);
+                }
+
+                void push(task* t)
+                {
+                    std::int64_t b = bottom->load(std::memory_order_relaxed);
+                    std::int64_t tp = top->load(std::memory_order_acquire);
+                    ring* a = array.load(std::memory_order_relaxed);
+                    if (CPPP_UNLIKELY(b - tp > a->mask))
+                    {
+                        a = grow(a, tp, b);
+                    }
+                    a->put(b, t);
+                    std::atomic_thread_fence(std::memory_order_release);
+                    bottom->store(b + 1, std::memory_order_relaxed);
+                }
+
+                task* take() noexcept
+                {
+                    std::int64_t b = bottom->load(std::memory_order_relaxed) - 1;
+                    ring* a = array.load(std::memory_order_relaxed);
+                    bottom->store(b, std::memory_order_relaxed);
+                    std::atomic_thread_fence(std::memory_order_seq_cst);
+                    std::int64_t t = top->load(std::memory_order_relaxed);
+                    if (t > b)
+                    {
+                        bottom->store(b + 1, std::memory_order_relaxed);
+                        return nullptr;
+                    }
+                    task* result = a->get(b);
+                    if (t == b)
+                    {
+                        /* Last element, race the thieves for it. */
+                        if (!top->compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                        {
+                            result = nullptr;
+                        }
+                        bottom->store(b + 1, std::memory_order_relaxed);
+                    }
+                    return result;
+                }
+
+                /* Null when empty or when another thread won the race,
+                   'contended' tells the two apart. */
+                task* steal(bool& contended) noexcept
+                {
+                    std::int64_t t = top->load(std::memory_order_acquire);
+                    std::atomic_thread_fence(std::memory_order_seq_cst);
+                    std::int64_t b = bottom->load(std::memory_order_acquire);
+                    contended = false;
+                    if (t >= b)
+                    {
+                        return nullptr;
+                    }
+                    ring* a = array.load(std::memory_order_acquire);
+                    task* result = a->get(t);
+                    if (!top->compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                    {
+                        contended = true;
+                        return nullptr;
+                    }
+                    return result;
+                }
+
+            private:
+                ring* grow(ring* old, std::int64_t t, std::int64_t b)
+                {
+                    rings.emplace_back(new ring((old->mask + 1) * 2));
+                    ring* a = rings.back().get();
+                    for (std::int64_t i = t; i < b; ++i)
+                    {
+                        a->put(i, old->get(i));
+                    }
+                    array.store(a, std::memory_order_release);
+                    return a;
+                }
+            };
+
+            /* Mutex-protected FIFO for submissions from outside the pool
+               and affinity mailboxes, the size is readable without the
+               lock. */
+            class locked_queue
+            {
+            private:
+                std::mutex lock;
+                std::deque<task*> tasks;
+                std::atomic<size_t> count{0};
+
+            public:
+                bool empty_approx() const noexcept
+                {
+                    return count.load(std::memory_order_relaxed) == 0;
+                }
+
+                void push(task* t)
+                {
+                    std::lock_guard<std::mutex> guard(lock);
+                    tasks.push_back(t);
+                    count.store(tasks.size(), std::memory_order_relaxed);
+                }
+
+                task* pop() noexcept
+                {
+                    if (empty_approx())
+                    {
+                        return nullptr;
+                    }
+                    std::lock_guard<std::mutex> guard(lock);
+                    if (tasks.empty())
+                    {
+                        return nullptr;
+                    }
+                    task* t = tasks.front();
+                    tasks.pop_front();
+                    count.store(tasks.size(), std::memory_order_relaxed);
+                    return t;
+                }
+            };
+
+            struct worker
+            {
+                work_deque deque;
+                locked_queue mailbox;
+                std::uint64_t random_state = 0;
+                std::atomic<size_t> executed{0};
+                std::atomic<size_t> steals{0};
+                std::atomic<size_t> failed_steals{0};
+                std::atomic<size_t> idle{0};
+            };
+
+            /* The pool and worker index of the calling thread. */
+            struct current_worker
+            {
+                const thread_pool* pool = nullptr;
+                size_t index = 0;
+            };
+
+            inline current_worker& current() noexcept
+            {
+                static thread_local current_worker instance;
+                return instance;
+            }
+
+            /* Counters have a single writer, so a plain increment is
+               enough. */
+            inline void bump(std::atomic<size_t>& counter) noexcept
+            {
+                counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            }
+        } // namespace pool
+    } // namespace detail
+
+    /* Fixed-size pool of worker threads with work stealing.
+       Tasks must not throw, an escaping exception calls 'std::terminate'.
+       Use 'task_group' to get exceptions back in the waiting thread.
+       The destructor runs every task that is still queued before it joins
+       the workers. */
+    class thread_pool
+    {
+    private:
+        using worker = detail::pool::worker;
+        using task = detail::pool::task;
+
+        size_t worker_count;
+        std::unique_ptr<cache_aligned<worker>[]> workers;
+        detail::pool::locked_queue injection;
+        cache_aligned<park_wait> sleepers;
+        std::atomic<bool> stopping{false};
+        std::vector<std::thread> threads;
+
+        friend class task_group;
+
+    public:
+        static constexpr size_t npos = static_cast<size_t>(-1);
+
+        /* Start 'threads' workers, by default one per hardware thread. */
+        explicit thread_pool(size_t threads_count = std::thread::hardware_concurrency())
+            : worker_count(threads_count == 0 ? 1 : threads_count), workers(new cache_aligned<worker>[worker_count])
+        {
+            for (size_t i = 0; i < worker_count; ++i)
+            {
+                workers[i]->random_state = 0x9E3779B97F4A7C15ULL * (i + 1);
+            }
+            threads.reserve(worker_count);
+            try
+            {
+                for (size_t i = 0; i < worker_count; ++i)
+                {
+                    threads.emplace_back(&thread_pool::worker_main, this, i);
+                }
+            }
+            catch (...)
+            {
+                shutdown();
+                throw;
+            }
+        }
+
+        thread_pool(const thread_pool&) = delete;
+        thread_pool& operator=(const thread_pool&) = delete;
+
+        ~thread_pool()
+        {
+            shutdown();
+        }
+
+        size_t size() const noexcept
+        {
+            return worker_count;
+        }
+
+        /* Index of the calling worker in this pool, 'npos' for threads that
+           are not workers of this pool. */
+        size_t current_worker() const noexcept
+        {
+            const detail::pool::current_worker& self = detail::pool::current();
+            if (self.pool != this)
+            {
+                return npos;
+            }
+            return self.index;
+        }
+
+        /* Queue 'f' for execution. A worker pushes to its own deque (LIFO
+           for itself, FIFO for thieves), other threads push to the shared
+           injection queue. */
+        template<typename Function>
+        void submit(Function&& f)
+        {
+            spawn(detail::pool::make_task(std::forward<Function>(f)));
+        }
+
+        /* Queue 'f' with a preference for worker 'worker_hint % size()',
+           e.g. the worker whose cache holds the data. Other workers take
+           the task when the preferred one is busy. */
+        template<typename Function>
+        void submit_to(size_t worker_hint, Function&& f)
+        {
+            task* t = detail::pool::make_task(std::forward<Function>(f));
+            try
+            {
+                workers[worker_hint % worker_count]->mailbox.push(t);
+            }
+            catch (...)
+            {
+                delete t;
+                throw;
+            }
+            sleepers->notify_all();
+        }
+
+        /* Snapshot of the per-worker counters. */
+        std::vector<thread_pool_worker_stats> stats() const
+        {
+            std::vector<thread_pool_worker_stats> result(worker_count);
+            for (size_t i = 0; i < worker_count; ++i)
+            {
+                const worker& w = *workers[i];
+                result[i].executed = w.executed.load(std::memory_order_relaxed);
+                result[i].steals = w.steals.load(std::memory_order_relaxed);
+                result[i].failed_steals = w.failed_steals.load(std::memory_order_relaxed);
+                result[i].idle = w.idle.load(std::memory_order_relaxed);
+            }
+            return result;
+        }
+
+    private:
+        void spawn(task* t)
+        {
+            try
+            {
+                size_t self = current_worker();
+                if (self != npos)
+                {
+                    workers[self]->deque.push(t);
+                }
+                else
+                {
+                    injection.push(t);
+                }
+            }
+            catch (...)
+            {
+                delete t;
+                throw;
+            }
+            sleepers->notify_all();
+        }
+
+        /* Run one queued task on the calling thread, used by 'task_group'
+           to help instead of blocking. */
+        bool run_one() noexcept
+        {
+            size_t self = current_worker();
+            task* t = self != npos ? find_work(self) : find_work_external();
+            if (t == nullptr)
+            {
+                return false;
+            }
+            if (self != npos)
+            {
+                detail::pool::bump(workers[self]->executed);
+            }
+            detail::pool::execute(t);
+            return true;
+        }
+
+        task* find_work(size_t self) noexcept
+        {
+            worker& w = *workers[self];
+            task* t = w.deque.take();
+            if (t == nullptr)
+            {
+                t = w.mailbox.pop();
+            }
+            if (t == nullptr)
+            {
+                t = injection.pop();
+            }
+            if (t == nullptr && worker_count > 1)
+            {
+                t = steal(w, self);
+            }
+            return t;
+        }
+
+        task* find_work_external() noexcept
+        {
+            task* t = injection.pop();
+            for (size_t i = 0; t == nullptr && i < worker_count; ++i)
+            {
+                bool contended;
+                t = workers[i]->deque.steal(contended);
+                if (t == nullptr)
+                {
+                    t = workers[i]->mailbox.pop();
+                }
+            }
+            return t;
+        }
+
+        /* Visit every other worker once, starting at a random one. */
+        task* steal(worker& w, size_t self) noexcept
+        {
+            /* xorshift64 */
+            std::uint64_t x = w.random_state;
+            x ^= x << 13;
+            x ^= x >> 7;
+            x ^= x << 17;
+            w.random_state = x;
+            size_t start = static_cast<size_t>(x % worker_count);
+            for (size_t i = 0; i < worker_count; ++i)
+            {
+                size_t victim = (start + i) % worker_count;
+                if (victim == self)
+                {
+                    continue;
+                }
+                bool contended;
+                task* t = workers[victim]->deque.steal(contended);
+                if (t == nullptr)
+                {
+                    t = workers[victim]->mailbox.pop();
+                }
+                if (t != nullptr)
+                {
+                    detail::pool::bump(w.steals);
+                    return t;
+                }
+                if (contended)
+                {
+                    detail::pool::bump(w.failed_steals);
+                }
+            }
+            return nullptr;
+        }
+
+        bool has_work() const noexcept
+        {
+            if (!injection.empty_approx())
+            {
+                return true;
+            }
+            for (size_t i = 0; i < worker_count; ++i)
+            {
+                if (!workers[i]->deque.empty_approx() || !workers[i]->mailbox.empty_approx())
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void worker_main(size_t self) noexcept
+        {
+            detail::pool::current_worker& current = detail::pool::current();
+            current.pool = this;
+            current.index = self;
+            worker& w = *workers[self];
+            for (;;)
+            {
+                task* t = find_work(self);
+                if (t != nullptr)
+                {
+                    detail::pool::bump(w.executed);
+                    detail::pool::execute(t);
+                    continue;
+                }
+                if (stopping.load(std::memory_order_acquire))
+                {
+                    break;
+                }
+                detail::pool::bump(w.idle);
+                sleepers->wait_until([this]() noexcept { return stopping.load(std::memory_order_relaxed) || has_work(); });
+            }
+            current.pool = nullptr;
+        }
+
+        void shutdown() noexcept
+        {
+            stopping.store(true, std::memory_order_release);
+            sleepers->notify_all();
+            for (std::thread& t : threads)
+            {
+                if (t.joinable())
+                {
+                    t.join();
+                }
+            }
+            threads.clear();
+            /* Tasks queued by the last running tasks after their worker
+               left. */
+            for (task* t = find_work_external(); t != nullptr; t = find_work_external())
+            {
+                detail::pool::execute(t);
+            }
+        }
+    };
+
+    /* A set of tasks that can be waited for together. 'wait' runs queued
+       tasks of the pool while it waits, so nested groups inside tasks do
+       not block workers. The first exception thrown by a task is rethrown
+       by 'wait'. */
+    class task_group
+    {
+    private:
+        thread_pool& pool;
+        std::atomic<size_t> pending{0};
+        std::atomic<bool> failed{false};
+        std::exception_ptr error;
+
+    public:
+        explicit task_group(thread_pool& p) noexcept
+            : pool(p)
+        {
+        }
+
+        task_group(const task_group&) = delete;
+        task_group& operator=(const task_group&) = delete;
+
+        /* Waits, but drops any exception. Call 'wait' to see it. */
+        ~task_group()
+        {
+            wait_all();
+        }
+
+        template<typename Function>
+        void run(Function&& f)
+        {
+            pending.fetch_add(1, std::memory_order_relaxed);
+            try
+            {
+                pool.spawn(detail::pool::make_task(runner<typename std::decay<Function>::type>{this, std::forward<Function>(f)}));
+            }
+            catch (...)
+            {
+                pending.fetch_sub(1, std::memory_order_relaxed);
+                throw;
+            }
+        }
+
+        void wait()
+        {
+            wait_all();
+            if (failed.load(std::memory_order_acquire))
+            {
+                failed.store(false, std::memory_order_relaxed);
+                std::exception_ptr e = std::move(error);
+                error = nullptr;
+                std::rethrow_exception(e);
+            }
+        }
+
+    private:
+        template<typename Function>
+        struct runner
+        {
+            task_group* group;
+            Function function;
+
+            void operator()() noexcept
+            {
+                try
+                {
+                    function();
+                }
+                catch (...)
+                {
+                    if (!group->failed.exchange(true, std::memory_order_acq_rel))
+                    {
+                        group->error = std::current_exception();
+                    }
+                }
+                group->pending.fetch_sub(1, std::memory_order_release);
+            }
+        };
+
+        void wait_all() noexcept
+        {
+            while (pending.load(std::memory_order_acquire) != 0)
+            {
+                if (!pool.run_one())
+                {
+                    std::this_thread::yield();
+                }
+            }
+        }
+    };
+
+    namespace detail
+    {
+        namespace pool
+        {
+            inline size_t default_grain(const thread_pool& pool, size_t count) noexcept
+            {
+                /* About eight chunks per worker leave room for balancing. */
+                size_t grain = count / (pool.size() * 8);
+                return grain == 0 ? 1 : grain;
+            }
+
+            template<typename Function>
+            void split_for(task_group& group, size_t first, size_t last, size_t grain, Function& body)
+            {
+                while (last - first > grain)
+                {
+                    size_t middle = first + (last - first) / 2;
+                    group.run([&group, middle, last, grain, &body]() { split_for(group, middle, last, grain, body); });
+                    last = middle;
+                }
+                for (; first != last; ++first)
+                {
+                    body(first);
+                }
+            }
+
+            template<typename T, typename RangeFunction, typename Combine>
+            T split_reduce(thread_pool& pool, size_t first, size_t last, size_t grain, const T& identity,
+                           RangeFunction& range_function, Combine& combine)
+            {
+                if (last - first <= grain)
+                {
+                    return range_function(first, last, identity);
+                }
+                size_t middle = first + (last - first) / 2;
+                T right = identity;
+                task_group group(pool);
+                group.run([&]() { right = split_reduce(pool, middle, last, grain, identity, range_function, combine); });
+                T left = split_reduce(pool, first, middle, grain, identity, range_function, combine);
+                group.wait();
+                return combine(std::move(left), std::move(right));
+            }
+        } // namespace pool
+    } // namespace detail
+
+    /* Call 'body(i)' for every 'i' in [first, last) on the pool and wait.
+       The range is split in halves down to 'grain' indices (0 picks a
+       grain from the pool size). Idle workers steal the larger halves. */
+    template<typename Function>
+    void parallel_for(thread_pool& pool, size_t first, size_t last, Function&& body, size_t grain = 0)
+    {
+        if (first >= last)
+        {
+            return;
+        }
+        if (grain == 0)
+        {
+            grain = detail::pool::default_grain(pool, last - first);
+        }
+        task_group group(pool);
+        detail::pool::split_for(group, first, last, grain, body);
+        group.wait();
+    }
+
+    /* Reduce [first, last) on the pool.
+       'range_function(begin, end, identity)' reduces one chunk to a 'T',
+       and 'combine(T, T)' merges two results in index order, so it only
+       needs to be associative. */
+    template<typename T, typename RangeFunction, typename Combine>
+    T parallel_reduce(thread_pool& pool, size_t first, size_t last, T identity, RangeFunction&& range_function, Combine&& combine,
+                      size_t grain = 0)
+    {
+        if (first >= last)
+        {
+            return identity;
+        }
+        if (grain == 0)
+        {
+            grain = detail::pool::default_grain(pool, last - first);
+        }
+        return detail::pool::split_reduce(pool, first, last, grain, identity, range_function, combine);
+    }
+} // namespace cppp
+
+#endif
@@ -0,0 +1,86 @@
+/* Copyright (C) 1999-2023 Free Software Foundation, Inc.
+   This file is part of the cppp-base library.
+
+   The cppp-base library is free software; you can redistribute it
+   and/or modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either version 3
+   of the License, or (at your option) any later version.
+
+   The cppp-base library is distributed in the hope that it will be
+   useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the cppp-base library; see the file COPYING.
+   If not, see <https://www.gnu.org/licenses/>.  */
+
+/* We do not use '#pragma once' because it may has bugs in some compiler. */
+#ifndef _CPPP_TYPE_TRAITS_HPP
+#define _CPPP_TYPE_TRAITS_HPP
+
+/* C++ Plus type traits */
+
+#include "basedef.hpp"
+
+#include <type_traits>
+
+namespace cppp
+{
+    /* Whether moving a 'T' to a new address and ending the lifetime of the
+       old one can be done with 'memcpy'.  True for trivially copyable types,
+       specialize it to 'std::true_type' for types like 'std::unique_ptr'
+       that hold no pointer to themselves.  Containers use it to move their
+       elements in bulk when they grow. */
+    template<typename T>
+    struct is_trivially_relocatable : std::integral_constant<bool, std::is_trivially_copyable<T>::value>
+    {
+    };
+
+    /* Tag for ordered containers taking input that is already sorted by
+       their comparator and free of equivalent keys, which they can then
+       build in linear time.  The behavior is undefined if it is not. */
+    struct sorted_unique_t
+    {
+        explicit sorted_unique_t() = default;
+    };
+
+    constexpr sorted_unique_t sorted_unique{};
+
+    namespace detail
+    {
+        /* Whether 'T' declares 'is_transparent', which lets the hashers,
+           equality predicates and comparators of the containers take any
+           key type. */
+        template<typename T>
+        struct is_transparent_helper
+        {
+            template<typename U>
+            static std::true_type test(typename U::is_transparent*);
+            template<typename U>
+            static std::false_type test(...);
+            static constexpr bool value = decltype(test<T>(nullptr))::value;
+        };
+
+        template<typename T>
+        constexpr bool is_transparent_helper<T>::value;
+
+        /* Lookup key type, 'K' when the functors are transparent.
+           A direct alias, so 'K' stays deducible. */
+        template<bool Transparent>
+        struct key_arg_helper
+        {
+            template<typename K, typename Key>
+            using type = K;
+        };
+
+        template<>
+        struct key_arg_helper<false>
+        {
+            template<typename K, typename Key>
+            using type = Key;
+        };
+    } // namespace detail
+} // namespace cppp
+
+#endif
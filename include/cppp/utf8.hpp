@@ -0,0 +1,1365 @@
+/* Copyright (C) 1999-2023 Free Software Foundation, Inc.
+   This file is part of the cppp-base library.
+
+   The cppp-base library is free software; you can redistribute it
+   and/or modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either version 3
+   of the License, or (at your option) any later version.
+
+   The cppp-base library is distributed in the hope that it will be
+   useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the cppp-base library; see the file COPYING.
+   If not, see <https://www.gnu.org/licenses/>.  */
+
+/* We do not use '#pragma once' because it may has bugs in some compiler. */
+#ifndef _CPPP_UTF8_HPP
+#define _CPPP_UTF8_HPP
+
+/* C++ Plus UTF-8 validation and transcoding
+
+   - Validation checks 64 bytes at a time with the lookup algorithm of
+     John Keiser and Daniel Lemire, "Validating UTF-8 In Less Than One
+     Instruction Per Byte". Three 16-entry tables, indexed by the
+     nibbles of each byte and the byte before it, flag every invalid
+     pair of bytes. A saturating subtract then finds the third and
+     fourth bytes. Blocks of ASCII skip the tables.
+   - Counting code points and UTF-16 units is a vector count of lead
+     bytes.
+   - Transcoding validates, then converts. ASCII runs are widened or
+     narrowed a vector at a time, and other sequences are decoded one
+     at a time.
+
+   The kernels use SSSE3 and AVX2 on x86, picked at runtime, and NEON
+   on ARM64. Other targets get portable code that skips ASCII eight
+   bytes at a time.
+
+   Conversions return a 'result'. On success 'count' is the number of
+   units written. On invalid input 'ec' is
+   'std::errc::illegal_byte_sequence', and 'count' is the index of the
+   first unit of the invalid sequence. Nothing is written beyond what
+   the matching '*_length' function returns. */
+
+#include "basedef.hpp"
+#include "bits.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <system_error>
+
+/* As in string_search.hpp, x86 kernels are for GCC, Clang and MSVC
+   only. */
+#if (defined(CPPP_COMPILER_GNU_LIKE) || defined(CPPP_COMPILER_MSVC)) && \
+    (defined(CPPP_ARCH_X86_64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#include <immintrin.h>
+#if defined(CPPP_COMPILER_MSVC)
+#include <intrin.h>
+#endif
+#define CPPP_UTF8_X86 1
+#elif defined(CPPP_ARCH_ARM64) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define CPPP_UTF8_NEON 1
+#endif
+
+/* The same scheme as string_search.hpp. Each ISA gets entry points with
+   a 'target' attribute, and 'flatten' inlines the kernels into them.
+   AVX2 is left out of unoptimized builds because they ignore
+   'flatten'. */
+#if defined(CPPP_UTF8_X86) && defined(CPPP_COMPILER_GNU_LIKE)
+#define CPPP_UTF8_TARGET(isa) __attribute__((__target__(isa)))
+#define CPPP_UTF8_ENTRY(isa) __attribute__((__target__(isa), __flatten__))
+#else
+#define CPPP_UTF8_TARGET(isa)
+#define CPPP_UTF8_ENTRY(isa)
+#endif
+
+#if defined(CPPP_UTF8_X86) && (defined(__AVX2__) || defined(__OPTIMIZE__) || defined(CPPP_COMPILER_MSVC))
+#define CPPP_UTF8_AVX2 1
+#endif
+
+#if defined(CPPP_COMPILER_GCC)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
+namespace cppp
+{
+    namespace utf8
+    {
+        struct result
+        {
+            size_t count;
+            std::errc ec;
+        };
+    } // namespace utf8
+
+    namespace detail
+    {
+        namespace unicode
+        {
+            /* Error bits of the validation tables. A pair of bytes is
+               invalid when the three lookups share a bit. */
+            constexpr unsigned char too_short = 1 << 0;      /* lead not followed by continuation */
+            constexpr unsigned char too_long = 1 << 1;       /* ASCII followed by continuation */
+            constexpr unsigned char overlong_3 = 1 << 2;     /* E0 80..9F */
+            constexpr unsigned char too_large = 1 << 3;      /* F4 90..BF, F5..FF */
+            constexpr unsigned char surrogate = 1 << 4;      /* ED A0..BF */
+            constexpr unsigned char overlong_2 = 1 << 5;     /* C0, C1 */
+            constexpr unsigned char too_large_1000 = 1 << 6; /* F5..FF 80..8F */
+            constexpr unsigned char overlong_4 = 1 << 6;     /* F0 80..8F */
+            constexpr unsigned char two_conts = 1 << 7;      /* continuation after continuation */
+            constexpr unsigned char carry = too_short | too_long | two_conts;
+
+            template<typename = void>
+            struct tables
+            {
+                /* By the high nibble of the first byte. */
+                static constexpr unsigned char byte_1_high[16] = {
+                    too_long, too_long, too_long, too_long, too_long, too_long, too_long, too_long,
+                    two_conts, two_conts, two_conts, two_conts,
+                    too_short | overlong_2,
+                    too_short,
+                    too_short | overlong_3 | surrogate,
+                    too_short | too_large | too_large_1000 | overlong_4};
+
+                /* By the low nibble of the first byte. */
+                static constexpr unsigned char byte_1_low[16] = {
+                    carry | overlong_3 | overlong_2 | overlong_4,
+                    carry | overlong_2,
+                    carry,
+                    carry,
+                    carry | too_large,
+                    carry | too_large | too_large_1000,
+                    carry | too_large | too_large_1000,
+                    carry | too_large | too_large_1000,
+                    carry | too_large | too_large_1000,
+                    carry | too_large | too_large_1000,
+                    carry | too_large | too_large_1000,
+                    carry | too_large | too_large_1000,
+                    carry | too_large | too_large_1000,
+                    carry | too_large | too_large_1000 | surrogate,
+                    carry | too_large | too_large_1000,
+                    carry | too_large | too_large_1000};
+
+                /* By the high nibble of the second byte. */
+                static constexpr unsigned char byte_2_high[16] = {
+                    too_short, too_short, too_short, too_short, too_short, too_short, too_short, too_short,
+                    too_long | overlong_2 | two_conts | overlong_3 | too_large_1000 | overlong_4,
+                    too_long | overlong_2 | two_conts | overlong_3 | too_large,
+                    too_long | overlong_2 | two_conts | surrogate | too_large,
+                    too_long | overlong_2 | two_conts | surrogate | too_large,
+                    too_short, too_short, too_short, too_short};
+
+                /* Subtracted from the last block: nonzero where a
+                   sequence would continue past it. Vectors of 16 bytes
+                   use the last 16 entries. */
+                static constexpr unsigned char incomplete[32] = {
+                    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+                    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+                    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xF0 - 1, 0xE0 - 1, 0xC0 - 1};
+            };
+
+            template<typename T>
+            constexpr unsigned char tables<T>::byte_1_high[16];
+            template<typename T>
+            constexpr unsigned char tables<T>::byte_1_low[16];
+            template<typename T>
+            constexpr unsigned char tables<T>::byte_2_high[16];
+            template<typename T>
+            constexpr unsigned char tables<T>::incomplete[32];
+
+            inline bool is_continuation(char c) noexcept
+            {
+                return (static_cast<unsigned char>(c) & 0xC0) == 0x80;
+            }
+
+            inline std::uint64_t load64(const void* p) noexcept
+            {
+                std::uint64_t v;
+                std::memcpy(&v, p, sizeof(v));
+                return v;
+            }
+
+            /* ---- Portable code ---- */
+
+            /* First byte of the first invalid sequence, or 'last'. */
+            inline const char* validate_scalar(const char* p, const char* last) noexcept
+            {
+                while (p != last)
+                {
+                    while (last - p >= 8 && (load64(p) & 0x8080808080808080u) == 0)
+                    {
+                        p += 8;
+                    }
+                    if (p == last)
+                    {
+                        break;
+                    }
+                    unsigned char c = static_cast<unsigned char>(*p);
+                    if (c < 0x80)
+                    {
+                        ++p;
+                        continue;
+                    }
+                    size_t length;
+                    unsigned char low = 0x80, high = 0xBF;
+                    if (c < 0xC2)
+                    {
+                        return p;
+                    }
+                    else if (c < 0xE0)
+                    {
+                        length = 2;
+                    }
+                    else if (c < 0xF0)
+                    {
+                        length = 3;
+                        low = c == 0xE0 ? 0xA0 : 0x80;
+                        high = c == 0xED ? 0x9F : 0xBF;
+                    }
+                    else if (c < 0xF5)
+                    {
+                        length = 4;
+                        low = c == 0xF0 ? 0x90 : 0x80;
+                        high = c == 0xF4 ? 0x8F : 0xBF;
+                    }
+                    else
+                    {
+                        return p;
+                    }
+                    if (static_cast<size_t>(last - p) < length)
+                    {
+                        return p;
+                    }
+                    unsigned char second = static_cast<unsigned char>(p[1]);
+                    if (second < low || second > high)
+                    {
+                        return p;
+                    }
+                    for (size_t i = 2; i < length; ++i)
+                    {
+                        if (!is_continuation(p[i]))
+                        {
+                            return p;
+                        }
+                    }
+                    p += length;
+                }
+                return last;
+            }
+
+            /* Number of lead bytes, plus the four-byte leads again when
+               counting UTF-16 units. */
+            template<bool Pairs>
+            inline size_t count_scalar(const char* p, const char* last) noexcept
+            {
+                size_t count = 0;
+                for (; p != last; ++p)
+                {
+                    unsigned char c = static_cast<unsigned char>(*p);
+                    count += (c & 0xC0) != 0x80 ? 1 : 0;
+                    count += Pairs && c >= 0xF0 ? 1 : 0;
+                }
+                return count;
+            }
+
+            /* Decode the valid sequence at 'p' and advance past it. */
+            CPPP_FORCE_INLINE char32_t decode(const char*& p) noexcept
+            {
+                unsigned char c = static_cast<unsigned char>(p[0]);
+                if (c < 0x80)
+                {
+                    p += 1;
+                    return c;
+                }
+                if (c < 0xE0)
+                {
+                    char32_t cp = (char32_t(c & 0x1F) << 6) | (static_cast<unsigned char>(p[1]) & 0x3F);
+                    p += 2;
+                    return cp;
+                }
+                if (c < 0xF0)
+                {
+                    char32_t cp = (char32_t(c & 0x0F) << 12) | (char32_t(static_cast<unsigned char>(p[1]) & 0x3F) << 6) |
+                                  (static_cast<unsigned char>(p[2]) & 0x3F);
+                    p += 3;
+                    return cp;
+                }
+                char32_t cp = (char32_t(c & 0x07) << 18) | (char32_t(static_cast<unsigned char>(p[1]) & 0x3F) << 12) |
+                              (char32_t(static_cast<unsigned char>(p[2]) & 0x3F) << 6) | (static_cast<unsigned char>(p[3]) & 0x3F);
+                p += 4;
+                return cp;
+            }
+
+            /* Encode a scalar value, not a surrogate. */
+            CPPP_FORCE_INLINE char* encode(char32_t cp, char* out) noexcept
+            {
+                if (cp < 0x80)
+                {
+                    *out++ = static_cast<char>(cp);
+                }
+                else if (cp < 0x800)
+                {
+                    *out++ = static_cast<char>(0xC0 | (cp >> 6));
+                    *out++ = static_cast<char>(0x80 | (cp & 0x3F));
+                }
+                else if (cp < 0x10000)
+                {
+                    *out++ = static_cast<char>(0xE0 | (cp >> 12));
+                    *out++ = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+                    *out++ = static_cast<char>(0x80 | (cp & 0x3F));
+                }
+                else
+                {
+                    *out++ = static_cast<char>(0xF0 | (cp >> 18));
+                    *out++ = static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+                    *out++ = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+                    *out++ = static_cast<char>(0x80 | (cp & 0x3F));
+                }
+                return out;
+            }
+
+            /* ---- Vector types ----
+
+               The transcoding kernels only need the '*_ascii' operations,
+               which convert 'width' units when all of them are ASCII.
+               'portable' provides those with plain 64-bit words. */
+
+            struct portable
+            {
+                static constexpr size_t width = 8;
+
+                static bool widen_ascii16(const char* in, char16_t* out) noexcept
+                {
+                    if ((load64(in) & 0x8080808080808080u) != 0)
+                    {
+                        return false;
+                    }
+                    for (size_t i = 0; i < width; ++i)
+                    {
+                        out[i] = static_cast<char16_t>(in[i]);
+                    }
+                    return true;
+                }
+
+                static bool widen_ascii32(const char* in, char32_t* out) noexcept
+                {
+                    if ((load64(in) & 0x8080808080808080u) != 0)
+                    {
+                        return false;
+                    }
+                    for (size_t i = 0; i < width; ++i)
+                    {
+                        out[i] = static_cast<char32_t>(in[i]);
+                    }
+                    return true;
+                }
+
+                static bool narrow_ascii16(const char16_t* in, char* out) noexcept
+                {
+                    if (((load64(in) | load64(in + 4)) & 0xFF80FF80FF80FF80u) != 0)
+                    {
+                        return false;
+                    }
+                    for (size_t i = 0; i < width; ++i)
+                    {
+                        out[i] = static_cast<char>(in[i]);
+                    }
+                    return true;
+                }
+
+                static bool narrow_ascii32(const char32_t* in, char* out) noexcept
+                {
+                    std::uint64_t bits = load64(in) | load64(in + 2) | load64(in + 4) | load64(in + 6);
+                    if ((bits & 0xFFFFFF80FFFFFF80u) != 0)
+                    {
+                        return false;
+                    }
+                    for (size_t i = 0; i < width; ++i)
+                    {
+                        out[i] = static_cast<char>(in[i]);
+                    }
+                    return true;
+                }
+            };
+
+#if defined(CPPP_UTF8_X86)
+            struct sse2
+            {
+                typedef __m128i vector;
+                static constexpr size_t width = 16;
+
+                static vector load(const char* p) noexcept
+                {
+                    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+                }
+
+                static vector table(const unsigned char* p) noexcept
+                {
+                    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+                }
+
+                static vector splat(unsigned char c) noexcept
+                {
+                    return _mm_set1_epi8(static_cast<char>(c));
+                }
+
+                static vector zero() noexcept
+                {
+                    return _mm_setzero_si128();
+                }
+
+                static vector either(vector a, vector b) noexcept
+                {
+                    return _mm_or_si128(a, b);
+                }
+
+                static vector both(vector a, vector b) noexcept
+                {
+                    return _mm_and_si128(a, b);
+                }
+
+                static vector differ(vector a, vector b) noexcept
+                {
+                    return _mm_xor_si128(a, b);
+                }
+
+                static vector high_nibbles(vector v) noexcept
+                {
+                    return _mm_and_si128(_mm_srli_epi16(v, 4), _mm_set1_epi8(0x0F));
+                }
+
+                static vector low_nibbles(vector v) noexcept
+                {
+                    return _mm_and_si128(v, _mm_set1_epi8(0x0F));
+                }
+
+                static vector subtract_saturate(vector a, vector b) noexcept
+                {
+                    return _mm_subs_epu8(a, b);
+                }
+
+                static bool is_ascii(vector v) noexcept
+                {
+                    return _mm_movemask_epi8(v) == 0;
+                }
+
+                static bool any(vector v) noexcept
+                {
+                    return _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128())) != 0xFFFF;
+                }
+
+                CPPP_UTF8_TARGET("ssse3") static vector lookup(vector table, vector index) noexcept
+                {
+                    return _mm_shuffle_epi8(table, index);
+                }
+
+                /* The input shifted by 'N' bytes, with the last bytes of
+                   the block before it in front. */
+                template<int N>
+                CPPP_UTF8_TARGET("ssse3") static vector previous(vector input, vector before) noexcept
+                {
+                    return _mm_alignr_epi8(input, before, 16 - N);
+                }
+
+                /* All-ones bytes at lead bytes, and at four-byte leads. */
+                static vector leads(vector v) noexcept
+                {
+                    return _mm_cmpgt_epi8(v, _mm_set1_epi8(-65));
+                }
+
+                static vector four_byte_leads(vector v) noexcept
+                {
+                    return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(-17)), _mm_cmpgt_epi8(_mm_setzero_si128(), v));
+                }
+
+                static vector count(vector counter, vector matches) noexcept
+                {
+                    return _mm_sub_epi8(counter, matches);
+                }
+
+                static std::uint64_t sum(vector counter) noexcept
+                {
+                    __m128i sums = _mm_sad_epu8(counter, _mm_setzero_si128());
+                    return static_cast<std::uint64_t>(_mm_cvtsi128_si32(sums)) +
+                           static_cast<std::uint64_t>(_mm_cvtsi128_si32(_mm_srli_si128(sums, 8)));
+                }
+
+                static bool widen_ascii16(const char* in, char16_t* out) noexcept
+                {
+                    __m128i v = load(in);
+                    if (_mm_movemask_epi8(v) != 0)
+                    {
+                        return false;
+                    }
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_unpacklo_epi8(v, _mm_setzero_si128()));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 8), _mm_unpackhi_epi8(v, _mm_setzero_si128()));
+                    return true;
+                }
+
+                static bool widen_ascii32(const char* in, char32_t* out) noexcept
+                {
+                    __m128i v = load(in);
+                    if (_mm_movemask_epi8(v) != 0)
+                    {
+                        return false;
+                    }
+                    __m128i z = _mm_setzero_si128();
+                    __m128i low = _mm_unpacklo_epi8(v, z);
+                    __m128i high = _mm_unpackhi_epi8(v, z);
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_unpacklo_epi16(low, z));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 4), _mm_unpackhi_epi16(low, z));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 8), _mm_unpacklo_epi16(high, z));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 12), _mm_unpackhi_epi16(high, z));
+                    return true;
+                }
+
+                static bool narrow_ascii16(const char16_t* in, char* out) noexcept
+                {
+                    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+                    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 8));
+                    __m128i high = _mm_and_si128(_mm_or_si128(a, b), _mm_set1_epi16(static_cast<short>(0xFF80)));
+                    if (_mm_movemask_epi8(_mm_cmpeq_epi8(high, _mm_setzero_si128())) != 0xFFFF)
+                    {
+                        return false;
+                    }
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_packus_epi16(a, b));
+                    return true;
+                }
+
+                static bool narrow_ascii32(const char32_t* in, char* out) noexcept
+                {
+                    const __m128i* p = reinterpret_cast<const __m128i*>(in);
+                    __m128i a = _mm_loadu_si128(p), b = _mm_loadu_si128(p + 1);
+                    __m128i c = _mm_loadu_si128(p + 2), d = _mm_loadu_si128(p + 3);
+                    __m128i high = _mm_and_si128(_mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d)),
+                                                 _mm_set1_epi32(static_cast<int>(0xFFFFFF80u)));
+                    if (_mm_movemask_epi8(_mm_cmpeq_epi8(high, _mm_setzero_si128())) != 0xFFFF)
+                    {
+                        return false;
+                    }
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d)));
+                    return true;
+                }
+            };
+
+#if defined(CPPP_UTF8_AVX2)
+            struct avx2
+            {
+                typedef __m256i vector;
+                static constexpr size_t width = 32;
+
+                CPPP_UTF8_TARGET("avx2") static vector load(const char* p) noexcept
+                {
+                    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+                }
+
+                /* Shuffles index within 128-bit lanes, so repeat the table. */
+                CPPP_UTF8_TARGET("avx2") static vector table(const unsigned char* p) noexcept
+                {
+                    return _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+                }
+
+                CPPP_UTF8_TARGET("avx2") static vector splat(unsigned char c) noexcept
+                {
+                    return _mm256_set1_epi8(static_cast<char>(c));
+                }
+
+                CPPP_UTF8_TARGET("avx2") static vector zero() noexcept
+                {
+                    return _mm256_setzero_si256();
+                }
+
+                CPPP_UTF8_TARGET("avx2") static vector either(vector a, vector b) noexcept
+                {
+                    return _mm256_or_si256(a, b);
+                }
+
+                CPPP_UTF8_TARGET("avx2") static vector both(vector a, vector b) noexcept
+                {
+                    return _mm256_and_si256(a, b);
+                }
+
+                CPPP_UTF8_TARGET("avx2") static vector differ(vector a, vector b) noexcept
+                {
+                    return _mm256_xor_si256(a, b);
+                }
+
+                CPPP_UTF8_TARGET("avx2") static vector high_nibbles(vector v) noexcept
+                {
+                    return _mm256_and_si256(_mm256_srli_epi16(v, 4), _mm256_set1_epi8(0x0F));
+                }
+
+                CPPP_UTF8_TARGET("avx2") static vector low_nibbles(vector v) noexcept
+                {
+                    return _mm256_and_si256(v, _mm256_set1_epi8(0x0F));
+                }
+
+                CPPP_UTF8_TARGET("avx2") static vector subtract_saturate(vector a, vector b) noexcept
+                {
+                    return _mm256_subs_epu8(a, b);
+                }
+
+                CPPP_UTF8_TARGET("avx2") static bool is_ascii(vector v) noexcept
+                {
+                    return _mm256_movemask_epi8(v) == 0;
+                }
+
+                CPPP_UTF8_TARGET("avx2") static bool any(vector v) noexcept
+                {
+                    return _mm256_testz_si256(v, v) == 0;
+                }
+
+                CPPP_UTF8_TARGET("avx2") static vector lookup(vector table, vector index) noexcept
+                {
+                    return _mm256_shuffle_epi8(table, index);
+                }
+
+                /* 'alignr' also works per lane, the lower lane takes its
+                   bytes from the upper lane of 'before'. */
+                template<int N>
+                CPPP_UTF8_TARGET("avx2") static vector previous(vector input, vector before) noexcept
+                {
+                    return _mm256_alignr_epi8(input, _mm256_permute2x128_si256(before, input, 0x21), 16 - N);
+                }
+
+                CPPP_UTF8_TARGET("avx2") static vector leads(vector v) noexcept
+                {
+                    return _mm256_cmpgt_epi8(v, _mm256_set1_epi8(-65));
+                }
+
+                CPPP_UTF8_TARGET("avx2") static vector four_byte_leads(vector v) noexcept
+                {
+                    return _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8(-17)),
+                                            _mm256_cmpgt_epi8(_mm256_setzero_si256(), v));
+                }
+
+                CPPP_UTF8_TARGET("avx2") static vector count(vector counter, vector matches) noexcept
+                {
+                    return _mm256_sub_epi8(counter, matches);
+                }
+
+                CPPP_UTF8_TARGET("avx2") static std::uint64_t sum(vector counter) noexcept
+                {
+                    __m256i sums = _mm256_sad_epu8(counter, _mm256_setzero_si256());
+                    __m128i pair = _mm_add_epi64(_mm256_castsi256_si128(sums), _mm256_extracti128_si256(sums, 1));
+                    return static_cast<std::uint64_t>(_mm_cvtsi128_si32(pair)) +
+                           static_cast<std::uint64_t>(_mm_cvtsi128_si32(_mm_srli_si128(pair, 8)));
+                }
+
+                CPPP_UTF8_TARGET("avx2") static bool widen_ascii16(const char* in, char16_t* out) noexcept
+                {
+                    __m256i v = load(in);
+                    if (_mm256_movemask_epi8(v) != 0)
+                    {
+                        return false;
+                    }
+                    __m256i* p = reinterpret_cast<__m256i*>(out);
+                    _mm256_storeu_si256(p, _mm256_cvtepu8_epi16(_mm256_castsi256_si128(v)));
+                    _mm256_storeu_si256(p + 1, _mm256_cvtepu8_epi16(_mm256_extracti128_si256(v, 1)));
+                    return true;
+                }
+
+                CPPP_UTF8_TARGET("avx2") static bool widen_ascii32(const char* in, char32_t* out) noexcept
+                {
+                    __m256i v = load(in);
+                    if (_mm256_movemask_epi8(v) != 0)
+                    {
+                        return false;
+                    }
+                    __m256i* p = reinterpret_cast<__m256i*>(out);
+                    for (int i = 0; i < 4; ++i)
+                    {
+                        __m128i eight = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(in + 8 * i));
+                        _mm256_storeu_si256(p + i, _mm256_cvtepu8_epi32(eight));
+                    }
+                    return true;
+                }
+
+                CPPP_UTF8_TARGET("avx2") static bool narrow_ascii16(const char16_t* in, char* out) noexcept
+                {
+                    const __m256i* p = reinterpret_cast<const __m256i*>(in);
+                    __m256i a = _mm256_loadu_si256(p), b = _mm256_loadu_si256(p + 1);
+                    __m256i high = _mm256_and_si256(_mm256_or_si256(a, b), _mm256_set1_epi16(static_cast<short>(0xFF80)));
+                    if (_mm256_testz_si256(high, high) == 0)
+                    {
+                        return false;
+                    }
+                    /* 'packus' interleaves the lanes of 'a' and 'b'. */
+                    __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8);
+                    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), packed);
+                    return true;
+                }
+
+                CPPP_UTF8_TARGET("avx2") static bool narrow_ascii32(const char32_t* in, char* out) noexcept
+                {
+                    const __m256i* p = reinterpret_cast<const __m256i*>(in);
+                    __m256i a = _mm256_loadu_si256(p), b = _mm256_loadu_si256(p + 1);
+                    __m256i c = _mm256_loadu_si256(p + 2), d = _mm256_loadu_si256(p + 3);
+                    __m256i high = _mm256_and_si256(_mm256_or_si256(_mm256_or_si256(a, b), _mm256_or_si256(c, d)),
+                                                    _mm256_set1_epi32(static_cast<int>(0xFFFFFF80u)));
+                    if (_mm256_testz_si256(high, high) == 0)
+                    {
+                        return false;
+                    }
+                    __m256i packed = _mm256_packus_epi16(_mm256_packs_epi32(a, b), _mm256_packs_epi32(c, d));
+                    packed = _mm256_permutevar8x32_epi32(packed, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+                    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), packed);
+                    return true;
+                }
+            };
+
+            inline bool avx2_available() noexcept
+            {
+#if defined(__AVX2__)
+                return true;
+#elif defined(CPPP_COMPILER_GNU_LIKE)
+                return __builtin_cpu_supports("avx2");
+#elif defined(CPPP_COMPILER_MSVC)
+                int info[4];
+                __cpuid(info, 0);
+                if (info[0] < 7)
+                {
+                    return false;
+                }
+                __cpuid(info, 1);
+                if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0 || (_xgetbv(0) & 6) != 6)
+                {
+                    return false;
+                }
+                __cpuidex(info, 7, 0);
+                return (info[1] & (1 << 5)) != 0;
+#else
+                return false;
+#endif
+            }
+#endif
+
+            inline bool ssse3_available() noexcept
+            {
+#if defined(__SSSE3__)
+                return true;
+#elif defined(CPPP_COMPILER_GNU_LIKE)
+                return __builtin_cpu_supports("ssse3");
+#elif defined(CPPP_COMPILER_MSVC)
+                int info[4];
+                __cpuid(info, 1);
+                return (info[2] & (1 << 9)) != 0;
+#else
+                return false;
+#endif
+            }
+#elif defined(CPPP_UTF8_NEON)
+            struct neon
+            {
+                typedef uint8x16_t vector;
+                static constexpr size_t width = 16;
+
+                static vector load(const char* p) noexcept
+                {
+                    return vld1q_u8(reinterpret_cast<const std::uint8_t*>(p));
+                }
+
+                static vector table(const unsigned char* p) noexcept
+                {
+                    return vld1q_u8(p);
+                }
+
+                static vector splat(unsigned char c) noexcept
+                {
+                    return vdupq_n_u8(c);
+                }
+
+                static vector zero() noexcept
+                {
+                    return vdupq_n_u8(0);
+                }
+
+                static vector either(vector a, vector b) noexcept
+                {
+                    return vorrq_u8(a, b);
+                }
+
+                static vector both(vector a, vector b) noexcept
+                {
+                    return vandq_u8(a, b);
+                }
+
+                static vector differ(vector a, vector b) noexcept
+                {
+                    return veorq_u8(a, b);
+                }
+
+                static vector high_nibbles(vector v) noexcept
+                {
+                    return vshrq_n_u8(v, 4);
+                }
+
+                static vector low_nibbles(vector v) noexcept
+                {
+                    return vandq_u8(v, vdupq_n_u8(0x0F));
+                }
+
+                static vector subtract_saturate(vector a, vector b) noexcept
+                {
+                    return vqsubq_u8(a, b);
+                }
+
+                static bool is_ascii(vector v) noexcept
+                {
+                    return vmaxvq_u8(v) < 0x80;
+                }
+
+                static bool any(vector v) noexcept
+                {
+                    return vmaxvq_u8(v) != 0;
+                }
+
+                static vector lookup(vector table, vector index) noexcept
+                {
+                    return vqtbl1q_u8(table, index);
+                }
+
+                template<int N>
+                static vector previous(vector input, vector before) noexcept
+                {
+                    return vextq_u8(before, input, 16 - N);
+                }
+
+                static vector leads(vector v) noexcept
+                {
+                    return vcgtq_s8(vreinterpretq_s8_u8(v), vdupq_n_s8(-65));
+                }
+
+                static vector four_byte_leads(vector v) noexcept
+                {
+                    return vcgeq_u8(v, vdupq_n_u8(0xF0));
+                }
+
+                static vector count(vector counter, vector matches) noexcept
+                {
+                    return vsubq_u8(counter, matches);
+                }
+
+                static std::uint64_t sum(vector counter) noexcept
+                {
+                    return vaddlvq_u8(counter);
+                }
+
+                static bool widen_ascii16(const char* in, char16_t* out) noexcept
+                {
+                    uint8x16_t v = load(in);
+                    if (!is_ascii(v))
+                    {
+                        return false;
+                    }
+                    std::uint16_t* p = reinterpret_cast<std::uint16_t*>(out);
+                    vst1q_u16(p, vmovl_u8(vget_low_u8(v)));
+                    vst1q_u16(p + 8, vmovl_u8(vget_high_u8(v)));
+                    return true;
+                }
+
+                static bool widen_ascii32(const char* in, char32_t* out) noexcept
+                {
+                    uint8x16_t v = load(in);
+                    if (!is_ascii(v))
+                    {
+                        return false;
+                    }
+                    std::uint32_t* p = reinterpret_cast<std::uint32_t*>(out);
+                    uint16x8_t low = vmovl_u8(vget_low_u8(v));
+                    uint16x8_t high = vmovl_u8(vget_high_u8(v));
+                    vst1q_u32(p, vmovl_u16(vget_low_u16(low)));
+                    vst1q_u32(p + 4, vmovl_u16(vget_high_u16(low)));
+                    vst1q_u32(p + 8, vmovl_u16(vget_low_u16(high)));
+                    vst1q_u32(p + 12, vmovl_u16(vget_high_u16(high)));
+                    return true;
+                }
+
+                static bool narrow_ascii16(const char16_t* in, char* out) noexcept
+                {
+                    const std::uint16_t* p = reinterpret_cast<const std::uint16_t*>(in);
+                    uint16x8_t a = vld1q_u16(p), b = vld1q_u16(p + 8);
+                    if (vmaxvq_u16(vorrq_u16(a, b)) >= 0x80)
+                    {
+                        return false;
+                    }
+                    vst1q_u8(reinterpret_cast<std::uint8_t*>(out), vcombine_u8(vmovn_u16(a), vmovn_u16(b)));
+                    return true;
+                }
+
+                static bool narrow_ascii32(const char32_t* in, char* out) noexcept
+                {
+                    const std::uint32_t* p = reinterpret_cast<const std::uint32_t*>(in);
+                    uint32x4_t a = vld1q_u32(p), b = vld1q_u32(p + 4), c = vld1q_u32(p + 8), d = vld1q_u32(p + 12);
+                    if (vmaxvq_u32(vorrq_u32(vorrq_u32(a, b), vorrq_u32(c, d))) >= 0x80)
+                    {
+                        return false;
+                    }
+                    uint16x8_t ab = vcombine_u16(vmovn_u32(a), vmovn_u32(b));
+                    uint16x8_t cd = vcombine_u16(vmovn_u32(c), vmovn_u32(d));
+                    vst1q_u8(reinterpret_cast<std::uint8_t*>(out), vcombine_u8(vmovn_u16(ab), vmovn_u16(cd)));
+                    return true;
+                }
+            };
+#endif
+
+            /* ---- Kernels ---- */
+
+            constexpr size_t block_size = 64;
+
+            template<typename V>
+            struct checker
+            {
+                typedef typename V::vector vector;
+
+                vector error = V::zero();
+                vector before = V::zero();
+                vector incomplete = V::zero();
+                vector byte_1_high = V::table(tables<>::byte_1_high);
+                vector byte_1_low = V::table(tables<>::byte_1_low);
+                vector byte_2_high = V::table(tables<>::byte_2_high);
+                vector last_bytes = V::load(reinterpret_cast<const char*>(tables<>::incomplete) + 32 - V::width);
+
+                void check(const vector& input) noexcept
+                {
+                    vector prev1 = V::template previous<1>(input, before);
+                    vector special = V::both(V::both(V::lookup(byte_1_high, V::high_nibbles(prev1)),
+                                                     V::lookup(byte_1_low, V::low_nibbles(prev1))),
+                                             V::lookup(byte_2_high, V::high_nibbles(input)));
+                    /* Third and fourth bytes must be continuations, which
+                       the pair tables flag as 'two_conts'. */
+                    vector third = V::subtract_saturate(V::template previous<2>(input, before), V::splat(0xE0 - 0x80));
+                    vector fourth = V::subtract_saturate(V::template previous<3>(input, before), V::splat(0xF0 - 0x80));
+                    vector must_continue = V::both(V::either(third, fourth), V::splat(0x80));
+                    error = V::either(error, V::differ(must_continue, special));
+                    incomplete = V::subtract_saturate(input, last_bytes);
+                    before = input;
+                }
+
+                void check_block(const char* p) noexcept
+                {
+                    constexpr size_t count = block_size / V::width;
+                    vector input[count];
+                    vector all = V::zero();
+                    for (size_t i = 0; i < count; ++i)
+                    {
+                        input[i] = V::load(p + i * V::width);
+                        all = V::either(all, input[i]);
+                    }
+                    if (V::is_ascii(all))
+                    {
+                        error = V::either(error, incomplete);
+                        incomplete = V::zero();
+                        before = input[count - 1];
+                        return;
+                    }
+                    for (size_t i = 0; i < count; ++i)
+                    {
+                        check(input[i]);
+                    }
+                }
+            };
+
+            /* Start of the first block with an error, or 'last'. */
+            template<typename V>
+            inline const char* validate(const char* first, const char* last) noexcept
+            {
+                checker<V> state;
+                const char* p = first;
+                for (; last - p >= static_cast<std::ptrdiff_t>(block_size); p += block_size)
+                {
+                    state.check_block(p);
+                    if (CPPP_UNLIKELY(V::any(state.error)))
+                    {
+                        return p;
+                    }
+                }
+                if (p == last)
+                {
+                    /* A sequence left open by the last block. */
+                    return V::any(state.incomplete) ? p - block_size : last;
+                }
+                /* Zero padding is ASCII, and ends any open sequence. */
+                char tail[block_size] = {};
+                std::memcpy(tail, p, static_cast<size_t>(last - p));
+                state.check_block(tail);
+                return V::any(V::either(state.error, state.incomplete)) ? p : last;
+            }
+
+            template<typename V, bool Pairs>
+            inline size_t count(const char* first, const char* last) noexcept
+            {
+                size_t total = 0;
+                const char* p = first;
+                while (static_cast<size_t>(last - p) >= V::width)
+                {
+                    /* Up to two per byte and block, in byte counters. */
+                    size_t blocks = static_cast<size_t>(last - p) / V::width;
+                    if (blocks > 127)
+                    {
+                        blocks = 127;
+                    }
+                    typename V::vector counter = V::zero();
+                    for (size_t i = 0; i < blocks; ++i, p += V::width)
+                    {
+                        typename V::vector v = V::load(p);
+                        counter = V::count(counter, V::leads(v));
+                        if (Pairs)
+                        {
+                            counter = V::count(counter, V::four_byte_leads(v));
+                        }
+                    }
+                    total += static_cast<size_t>(V::sum(counter));
+                }
+                return total + count_scalar<Pairs>(p, last);
+            }
+
+            /* The converters from UTF-8 expect valid input. After a block
+               that is not all ASCII, they decode to its end before trying
+               the next block. */
+            template<typename V>
+            inline size_t to_utf16(const char* p, const char* last, char16_t* out) noexcept
+            {
+                char16_t* start = out;
+                while (p != last)
+                {
+                    if (static_cast<size_t>(last - p) >= V::width && V::widen_ascii16(p, out))
+                    {
+                        p += V::width;
+                        out += V::width;
+                        continue;
+                    }
+                    const char* stop = static_cast<size_t>(last - p) > V::width ? p + V::width : last;
+                    while (p < stop)
+                    {
+                        char32_t cp = decode(p);
+                        if (cp >= 0x10000)
+                        {
+                            cp -= 0x10000;
+                            *out++ = static_cast<char16_t>(0xD800 + (cp >> 10));
+                            *out++ = static_cast<char16_t>(0xDC00 + (cp & 0x3FF));
+                        }
+                        else
+                        {
+                            *out++ = static_cast<char16_t>(cp);
+                        }
+                    }
+                }
+                return static_cast<size_t>(out - start);
+            }
+
+            template<typename V>
+            inline size_t to_utf32(const char* p, const char* last, char32_t* out) noexcept
+            {
+                char32_t* start = out;
+                while (p != last)
+                {
+                    if (static_cast<size_t>(last - p) >= V::width && V::widen_ascii32(p, out))
+                    {
+                        p += V::width;
+                        out += V::width;
+                        continue;
+                    }
+                    const char* stop = static_cast<size_t>(last - p) > V::width ? p + V::width : last;
+                    while (p < stop)
+                    {
+                        *out++ = decode(p);
+                    }
+                }
+                return static_cast<size_t>(out - start);
+            }
+
+            template<typename V>
+            inline utf8::result from_utf16(const char16_t* first, const char16_t* last, char* out) noexcept
+            {
+                char* start = out;
+                const char16_t* p = first;
+                while (p != last)
+                {
+                    if (static_cast<size_t>(last - p) >= V::width && V::narrow_ascii16(p, out))
+                    {
+                        p += V::width;
+                        out += V::width;
+                        continue;
+                    }
+                    const char16_t* stop = static_cast<size_t>(last - p) > V::width ? p + V::width : last;
+                    while (p < stop)
+                    {
+                        char32_t unit = *p;
+                        if ((unit & 0xF800) != 0xD800)
+                        {
+                            out = encode(unit, out);
+                            ++p;
+                            continue;
+                        }
+                        /* A high surrogate, then a low one. */
+                        if (unit >= 0xDC00 || last - p < 2 || (p[1] & 0xFC00) != 0xDC00)
+                        {
+                            return utf8::result{static_cast<size_t>(p - first), std::errc::illegal_byte_sequence};
+                        }
+                        out = encode(0x10000 + ((unit - 0xD800) << 10) + (p[1] - 0xDC00u), out);
+                        p += 2;
+                    }
+                }
+                return utf8::result{static_cast<size_t>(out - start), std::errc()};
+            }
+
+            template<typename V>
+            inline utf8::result from_utf32(const char32_t* first, const char32_t* last, char* out) noexcept
+            {
+                char* start = out;
+                const char32_t* p = first;
+                while (p != last)
+                {
+                    if (static_cast<size_t>(last - p) >= V::width && V::narrow_ascii32(p, out))
+                    {
+                        p += V::width;
+                        out += V::width;
+                        continue;
+                    }
+                    const char32_t* stop = static_cast<size_t>(last - p) > V::width ? p + V::width : last;
+                    for (; p < stop; ++p)
+                    {
+                        if (*p > 0x10FFFF || (*p & 0xFFFFF800) == 0xD800)
+                        {
+                            return utf8::result{static_cast<size_t>(p - first), std::errc::illegal_byte_sequence};
+                        }
+                        out = encode(*p, out);
+                    }
+                }
+                return utf8::result{static_cast<size_t>(out - start), std::errc()};
+            }
+
+            /* ---- Entry points and dispatch ---- */
+
+            struct dispatch_table
+            {
+                const char* (*validate)(const char*, const char*) noexcept;
+                size_t (*count_code_points)(const char*, const char*) noexcept;
+                size_t (*utf16_length)(const char*, const char*) noexcept;
+                size_t (*to_utf16)(const char*, const char*, char16_t*) noexcept;
+                size_t (*to_utf32)(const char*, const char*, char32_t*) noexcept;
+                utf8::result (*from_utf16)(const char16_t*, const char16_t*, char*) noexcept;
+                utf8::result (*from_utf32)(const char32_t*, const char32_t*, char*) noexcept;
+                const char* name;
+            };
+
+#if defined(CPPP_UTF8_X86)
+#if defined(CPPP_UTF8_AVX2)
+            CPPP_UTF8_ENTRY("avx2") inline const char* validate_avx2(const char* first, const char* last) noexcept
+            {
+                return validate<avx2>(first, last);
+            }
+
+            CPPP_UTF8_ENTRY("avx2") inline size_t count_code_points_avx2(const char* first, const char* last) noexcept
+            {
+                return count<avx2, false>(first, last);
+            }
+
+            CPPP_UTF8_ENTRY("avx2") inline size_t utf16_length_avx2(const char* first, const char* last) noexcept
+            {
+                return count<avx2, true>(first, last);
+            }
+
+            CPPP_UTF8_ENTRY("avx2") inline size_t to_utf16_avx2(const char* first, const char* last, char16_t* out) noexcept
+            {
+                return to_utf16<avx2>(first, last, out);
+            }
+
+            CPPP_UTF8_ENTRY("avx2") inline size_t to_utf32_avx2(const char* first, const char* last, char32_t* out) noexcept
+            {
+                return to_utf32<avx2>(first, last, out);
+            }
+
+            CPPP_UTF8_ENTRY("avx2") inline utf8::result from_utf16_avx2(const char16_t* first, const char16_t* last, char* out) noexcept
+            {
+                return from_utf16<avx2>(first, last, out);
+            }
+
+            CPPP_UTF8_ENTRY("avx2") inline utf8::result from_utf32_avx2(const char32_t* first, const char32_t* last, char* out) noexcept
+            {
+                return from_utf32<avx2>(first, last, out);
+            }
+#endif
+
+            CPPP_UTF8_ENTRY("ssse3") inline const char* validate_ssse3(const char* first, const char* last) noexcept
+            {
+                return validate<sse2>(first, last);
+            }
+
+            inline const dispatch_table& dispatch() noexcept
+            {
+                static const dispatch_table selected = []() noexcept -> dispatch_table
+                {
+#if defined(CPPP_UTF8_AVX2)
+                    if (avx2_available())
+                    {
+                        return dispatch_table{&validate_avx2,   &count_code_points_avx2, &utf16_length_avx2, &to_utf16_avx2,
+                                              &to_utf32_avx2,   &from_utf16_avx2,        &from_utf32_avx2,   "avx2"};
+                    }
+#endif
+                    bool ssse3 = ssse3_available();
+                    return dispatch_table{ssse3 ? &validate_ssse3 : &validate_scalar,
+                                          &count<sse2, false>,
+                                          &count<sse2, true>,
+                                          &to_utf16<sse2>,
+                                          &to_utf32<sse2>,
+                                          &from_utf16<sse2>,
+                                          &from_utf32<sse2>,
+                                          ssse3 ? "ssse3" : "sse2"};
+                }();
+                return selected;
+            }
+#else
+#if defined(CPPP_UTF8_NEON)
+            typedef neon native;
+#define CPPP_UTF8_NAME "neon"
+#else
+            typedef portable native;
+#define CPPP_UTF8_NAME "scalar"
+#endif
+
+            inline const dispatch_table& dispatch() noexcept
+            {
+                static constexpr dispatch_table selected = {
+#if defined(CPPP_UTF8_NEON)
+                    &validate<neon>,          &count<neon, false>,     &count<neon, true>,
+#else
+                    &validate_scalar,         &count_scalar<false>,    &count_scalar<true>,
+#endif
+                    &to_utf16<native>,        &to_utf32<native>,       &from_utf16<native>,
+                    &from_utf32<native>,      CPPP_UTF8_NAME};
+                return selected;
+            }
+#undef CPPP_UTF8_NAME
+#endif
+        } // namespace unicode
+    } // namespace detail
+
+    namespace utf8
+    {
+        /* Whether 'size' bytes at 'data' are valid UTF-8: shortest form,
+           no surrogates, nothing above U+10FFFF. */
+        inline bool validate(const char* data, size_t size) noexcept
+        {
+            return detail::unicode::dispatch().validate(data, data + size) == data + size;
+        }
+
+        /* Like 'validate', with the offset of the first invalid sequence
+           in 'count' on failure and 'size' on success. */
+        inline result validate_with_errors(const char* data, size_t size) noexcept
+        {
+            const char* last = data + size;
+            const char* block = detail::unicode::dispatch().validate(data, last);
+            if (block == last)
+            {
+                return result{size, std::errc()};
+            }
+            /* Everything before the block is valid, except a sequence
+               that runs into it. Start at its lead byte. */
+            const char* start = block - (block - data < 3 ? block - data : 3);
+            while (start != block && detail::unicode::is_continuation(*start))
+            {
+                ++start;
+            }
+            const char* error = detail::unicode::validate_scalar(start, last);
+            return result{static_cast<size_t>(error - data), error == last ? std::errc() : std::errc::illegal_byte_sequence};
+        }
+
+        /* Code points in valid UTF-8, also the UTF-32 length. */
+        inline size_t count_code_points(const char* data, size_t size) noexcept
+        {
+            return detail::unicode::dispatch().count_code_points(data, data + size);
+        }
+
+        /* UTF-16 units for valid UTF-8. */
+        inline size_t utf16_length(const char* data, size_t size) noexcept
+        {
+            return detail::unicode::dispatch().utf16_length(data, data + size);
+        }
+
+        /* UTF-8 bytes for valid UTF-16. */
+        inline size_t length_from_utf16(const char16_t* data, size_t size) noexcept
+        {
+            size_t length = 0;
+            for (size_t i = 0; i < size; ++i)
+            {
+                char16_t unit = data[i];
+                /* A surrogate pair makes four bytes, two for each half. */
+                length += unit < 0x80 ? 1 : unit < 0x800 || (unit & 0xF800) == 0xD800 ? 2 : 3;
+            }
+            return length;
+        }
+
+        /* UTF-8 bytes for valid UTF-32. */
+        inline size_t length_from_utf32(const char32_t* data, size_t size) noexcept
+        {
+            size_t length = 0;
+            for (size_t i = 0; i < size; ++i)
+            {
+                char32_t cp = data[i];
+                length += cp < 0x80 ? 1 : cp < 0x800 ? 2 : cp < 0x10000 ? 3 : 4;
+            }
+            return length;
+        }
+
+        /* UTF-8 to UTF-16, 'out' has room for 'utf16_length' units. */
+        inline result to_utf16(const char* data, size_t size, char16_t* out) noexcept
+        {
+            result checked = validate_with_errors(data, size);
+            if (checked.ec != std::errc())
+            {
+                return checked;
+            }
+            return result{detail::unicode::dispatch().to_utf16(data, data + size, out), std::errc()};
+        }
+
+        /* UTF-8 to UTF-32, 'out' has room for 'count_code_points' units. */
+        inline result to_utf32(const char* data, size_t size, char32_t* out) noexcept
+        {
+            result checked = validate_with_errors(data, size);
+            if (checked.ec != std::errc())
+            {
+                return checked;
+            }
+            return result{detail::unicode::dispatch().to_utf32(data, data + size, out), std::errc()};
+        }
+
+        /* UTF-16 to UTF-8, 'out' has room for 'length_from_utf16' bytes.
+           Unpaired surrogates are errors. */
+        inline result from_utf16(const char16_t* data, size_t size, char* out) noexcept
+        {
+            return detail::unicode::dispatch().from_utf16(data, data + size, out);
+        }
+
+        /* UTF-32 to UTF-8, 'out' has room for 'length_from_utf32' bytes.
+           Surrogates and values above U+10FFFF are errors. */
+        inline result from_utf32(const char32_t* data, size_t size, char* out) noexcept
+        {
+            return detail::unicode::dispatch().from_utf32(data, data + size, out);
+        }
+
+        /* Name of the kernels in use: "avx2", "ssse3", "sse2", "neon" or
+           "scalar". */
+        inline const char* implementation() noexcept
+        {
+            return detail::unicode::dispatch().name;
+        }
+    } // namespace utf8
+} // namespace cppp
+
+#if defined(CPPP_COMPILER_GCC)
+#pragma GCC diagnostic pop
+#endif
+
+#undef CPPP_UTF8_TARGET
+#undef CPPP_UTF8_ENTRY
+#undef CPPP_UTF8_X86
+#undef CPPP_UTF8_NEON
+#undef CPPP_UTF8_AVX2
+
+#endif
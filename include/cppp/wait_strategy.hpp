@@ -0,0 +1,204 @@
+/* Copyright (C) 1999-2023 Free Software Foundation, Inc.
+   This file is part of the cppp-base library.
+
+   The cppp-base library is free software; you can redistribute it
+   and/or modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either version 3
+   of the License, or (at your option) any later version.
+
+   The cppp-base library is distributed in the hope that it will be
+   useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the cppp-base library; see the file COPYING.
+   If not, see <https://www.gnu.org/licenses/>.  */
+
+/* We do not use '#pragma once' because it may has bugs in some compiler. */
+#ifndef _CPPP_WAIT_STRATEGY_HPP
+#define _CPPP_WAIT_STRATEGY_HPP
+
+/* C++ Plus wait strategies for concurrent containers
+
+   A wait strategy tells a blocked thread how to wait until a condition
+   becomes true.  It is a small object shared by the waiters and the
+   notifiers:
+
+       template<typename Predicate>
+       void wait_until(Predicate ready);   (returns once 'ready()' is true)
+       void notify_all() noexcept;         (called after the state changed)
+
+   'spin_wait' burns the core and has the lowest hand-off latency,
+   'yield_wait' gives the core back to the scheduler after a short spin,
+   'park_wait' sleeps in the kernel (futex on Linux) and only costs the
+   notifier a fence and a load while nobody sleeps. */
+
+#include "basedef.hpp"
+
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <thread>
+
+#if defined(CPPP_ARCH_X86_64) || defined(CPPP_ARCH_X86)
+#if !defined(CPPP_COMPILER_MSVC)
+#include <immintrin.h>
+#endif
+#endif
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace cppp
+{
+    /* Tell the core that we are in a spin loop, this saves power and
+       stops the pipeline from filling with speculative loads. */
+    CPPP_FORCE_INLINE void cpu_relax() noexcept
+    {
+#if defined(CPPP_ARCH_X86_64) || defined(CPPP_ARCH_X86)
+        _mm_pause();
+#elif defined(CPPP_ARCH_ARM64) && defined(CPPP_COMPILER_MSVC)
+        __yield();
+#elif (defined(CPPP_ARCH_ARM64) || defined(CPPP_ARCH_ARM)) && defined(CPPP_COMPILER_GNU_LIKE)
+        __asm__ __volatile__("yield");
+#endif
+    }
+
+    namespace detail
+    {
+        namespace waiting
+        {
+            /* Spins before 'yield_wait' and 'park_wait' give up the core. */
+            constexpr int spin_limit = 128;
+
+            inline void park(std::atomic<std::uint32_t>& word, std::uint32_t old) noexcept
+            {
+#if defined(__linux__)
+                syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word), FUTEX_WAIT_PRIVATE, old, nullptr, nullptr, 0);
+#elif defined(__cpp_lib_atomic_wait)
+                word.wait(old, std::memory_order_relaxed);
+#else
+                (void)word;
+                (void)old;
+                std::this_thread::yield();
+#endif
+            }
+
+            inline void unpark_all(std::atomic<std::uint32_t>& word) noexcept
+            {
+#if defined(__linux__)
+                syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word), FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+#elif defined(__cpp_lib_atomic_wait)
+                word.notify_all();
+#else
+                (void)word;
+#endif
+            }
+        } // namespace waiting
+    } // namespace detail
+
+    /* Busy-wait, for threads pinned to dedicated cores. */
+    struct spin_wait
+    {
+        template<typename Predicate>
+        void wait_until(Predicate ready)
+        {
+            while (!ready())
+            {
+                cpu_relax();
+            }
+        }
+
+        void notify_all() noexcept
+        {
+        }
+    };
+
+    /* Spin for a while, then yield the core between checks. */
+    struct yield_wait
+    {
+        template<typename Predicate>
+        void wait_until(Predicate ready)
+        {
+            for (int i = 0; !ready(); ++i)
+            {
+                if (i < detail::waiting::spin_limit)
+                {
+                    cpu_relax();
+                }
+                else
+                {
+                    std::this_thread::yield();
+                }
+            }
+        }
+
+        void notify_all() noexcept
+        {
+        }
+    };
+
+    /* Spin for a while, then sleep until notified.
+       This is an event count: a waiter registers itself and reads the
+       epoch before checking the condition again, a notifier that sees a
+       registered waiter bumps the epoch and wakes it.  The fences on both
+       sides make sure that either the waiter sees the new state or the
+       notifier sees the waiter. */
+    class park_wait
+    {
+    private:
+        std::atomic<std::uint32_t> epoch{0};
+        std::atomic<std::uint32_t> waiters{0};
+
+    public:
+        park_wait() = default;
+        park_wait(const park_wait&) = delete;
+        park_wait& operator=(const park_wait&) = delete;
+
+        template<typename Predicate>
+        void wait_until(Predicate ready)
+        {
+            for (int i = 0; i < detail::waiting::spin_limit; ++i)
+            {
+                if (ready())
+                {
+                    return;
+                }
+                cpu_relax();
+            }
+            for (;;)
+            {
+                waiters.fetch_add(1, std::memory_order_relaxed);
+                std::uint32_t old = epoch.load(std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (ready())
+                {
+                    waiters.fetch_sub(1, std::memory_order_relaxed);
+                    return;
+                }
+                detail::waiting::park(epoch, old);
+                waiters.fetch_sub(1, std::memory_order_relaxed);
+                if (ready())
+                {
+                    return;
+                }
+            }
+        }
+
+        void notify_all() noexcept
+        {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (CPPP_UNLIKELY(waiters.load(std::memory_order_relaxed) != 0))
+            {
+                epoch.fetch_add(1, std::memory_order_relaxed);
+                detail::waiting::unpark_all(epoch);
+            }
+        }
+    };
+} // namespace cppp
+
+#endif